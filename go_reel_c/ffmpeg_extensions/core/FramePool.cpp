@@ -0,0 +1,168 @@
+#include "FramePool.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+static const long long kDefaultBudget = 256LL * 1024 * 1024;
+
+FramePool& FramePool::instance() {
+  // 有意泄漏: 编码任务可能在 DLL 卸载前仍持有帧
+  static FramePool* pool = new FramePool();
+  return *pool;
+}
+
+void FramePool::set_budget(long long bytes) {
+  std::vector<uint8_t*> dropped;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = bytes > 0 ? bytes : kDefaultBudget;
+
+    // 缓存不超过预算的一半
+    for (auto it = free_.begin(); it != free_.end() && cached_ > budget_ / 2; ) {
+      while (!it->second.empty() && cached_ > budget_ / 2) {
+        dropped.push_back(it->second.back());
+        it->second.pop_back();
+        cached_ -= (long long)it->first;
+      }
+      it = it->second.empty() ? free_.erase(it) : std::next(it);
+    }
+  }
+  cv_.notify_all();
+  for (uint8_t* data : dropped) av_free(data);
+}
+
+uint8_t* FramePool::take_buffer(size_t size) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  // 预算不足时等待 (没有在途帧时总是允许，单帧超过预算也不会永久阻塞)
+  if (in_use_ > 0 && in_use_ + (long long)size > budget_) {
+    waits_++;
+    while (in_use_ > 0 && in_use_ + (long long)size > budget_) {
+      lock.unlock();
+      bool helped = ThreadPool::instance().run_pending_task();
+      lock.lock();
+      // 解锁期间可能已经释放，重新检查后再阻塞 (release_buffer / 调整预算时唤醒)
+      if (!helped && in_use_ > 0 && in_use_ + (long long)size > budget_) cv_.wait(lock);
+    }
+  }
+
+  in_use_ += (long long)size;
+  peak_ = (std::max)(peak_, in_use_);
+
+  auto it = free_.find(size);
+  if (it != free_.end() && !it->second.empty()) {
+    uint8_t* data = it->second.back();
+    it->second.pop_back();
+    cached_ -= (long long)size;
+    return data;
+  }
+
+  lock.unlock();
+  uint8_t* data = (uint8_t*)av_malloc(size);
+  if (!data) {
+    lock.lock();
+    in_use_ -= (long long)size;
+    lock.unlock();
+    cv_.notify_all();
+  }
+  return data;
+}
+
+void FramePool::release_buffer(void* opaque, uint8_t* data) {
+  Block* block = (Block*)opaque;
+  FramePool* pool = block->pool;
+  size_t size = block->size;
+  delete block;
+
+  bool keep = false;
+  {
+    std::lock_guard<std::mutex> lock(pool->mutex_);
+    pool->in_use_ -= (long long)size;
+    if (pool->cached_ + (long long)size <= pool->budget_ / 2) {
+      pool->free_[size].push_back(data);
+      pool->cached_ += (long long)size;
+      keep = true;
+    }
+  }
+  pool->cv_.notify_all();
+  if (!keep) av_free(data);
+}
+
+AVFrame* FramePool::acquire(int width, int height, AVPixelFormat format) {
+  int size = av_image_get_buffer_size(format, width, height, kAlign);
+  if (size <= 0) return nullptr;
+
+  uint8_t* data = take_buffer((size_t)size);
+  if (!data) return nullptr;
+
+  Block* block = new Block{ this, (size_t)size };
+  AVBufferRef* buf = av_buffer_create(data, (size_t)size, &FramePool::release_buffer, block, 0);
+  if (!buf) {
+    release_buffer(block, data);
+    return nullptr;
+  }
+
+  AVFrame* frame = av_frame_alloc();
+  if (!frame) {
+    av_buffer_unref(&buf);
+    return nullptr;
+  }
+
+  frame->buf[0] = buf;
+  frame->format = format;
+  frame->width = width;
+  frame->height = height;
+  av_image_fill_arrays(frame->data, frame->linesize, buf->data, format, width, height, kAlign);
+  return frame;
+}
+
+long long FramePool::budget_bytes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return budget_;
+}
+
+long long FramePool::in_use_bytes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return in_use_;
+}
+
+long long FramePool::peak_bytes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return peak_;
+}
+
+long long FramePool::cached_bytes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return cached_;
+}
+
+int FramePool::wait_count() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return waits_;
+}
+
+void FramePool::reset_peak() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  peak_ = in_use_;
+  waits_ = 0;
+}
+
+// =================================================================
+// 导出接口
+// =================================================================
+DLLEXPORT void frame_memory_configure(long long budget_bytes) {
+  FramePool::instance().set_budget(budget_bytes);
+}
+
+DLLEXPORT void frame_memory_get_stats(FrameMemoryStats* out_stats) {
+  if (!out_stats) return;
+  FramePool& pool = FramePool::instance();
+  out_stats->budget_bytes = pool.budget_bytes();
+  out_stats->in_use_bytes = pool.in_use_bytes();
+  out_stats->peak_bytes = pool.peak_bytes();
+  out_stats->cached_bytes = pool.cached_bytes();
+  out_stats->waits = pool.wait_count();
+}
+
+DLLEXPORT void frame_memory_reset_peak() {
+  FramePool::instance().reset_peak();
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "../common.h"
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// =================================================================
+// 在途帧内存池 (进程内共享)
+//
+// 批量截图在解码线程上先把帧转换为输出尺寸，再交给编码任务。
+// 转换后的帧缓冲区从这里分配:
+// - 所有批量任务共享一个内存预算，超出时解码循环阻塞，直到编码任务释放帧
+// - 释放的缓冲区按大小回收复用 (缩略图尺寸通常一致)
+// - 阻塞期间协助线程池执行排队任务，避免解码任务占满线程池时编码任务无法执行
+// =================================================================
+
+class FramePool {
+public:
+  static FramePool& instance();
+
+  /**
+   * @brief 分配一帧 (像素数据来自池)，预算不足时阻塞。
+   *        av_frame_free 释放最后一个引用时缓冲区归还到池中。
+   * @return 失败返回 NULL。
+   */
+  AVFrame* acquire(int width, int height, AVPixelFormat format);
+
+  void set_budget(long long bytes);
+
+  long long budget_bytes();
+  long long in_use_bytes();
+  long long peak_bytes();
+  long long cached_bytes();
+  int wait_count();
+  void reset_peak();
+
+private:
+  static const int kAlign = 32;
+
+  struct Block {
+    FramePool* pool;
+    size_t size;
+  };
+
+  FramePool() = default;
+  uint8_t* take_buffer(size_t size);
+  static void release_buffer(void* opaque, uint8_t* data);
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::map<size_t, std::vector<uint8_t*>> free_; // 按大小回收的缓冲区
+  long long budget_ = 256LL * 1024 * 1024;
+  long long in_use_ = 0;
+  long long peak_ = 0;
+  long long cached_ = 0;
+  int waits_ = 0;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef struct {
+    long long budget_bytes; // 在途帧内存预算
+    long long in_use_bytes; // 当前在途帧占用
+    long long peak_bytes;   // 峰值占用 (自上次 reset 以来)
+    long long cached_bytes; // 池中缓存、可复用的缓冲区
+    int waits;              // 解码循环因预算不足阻塞的次数
+  } FrameMemoryStats;
+
+  /**
+   * @brief 设置批量截图在途帧的内存预算。
+   * @param budget_bytes 字节数，小于等于 0 表示默认值 (256 MB)。
+   */
+  DLLEXPORT void frame_memory_configure(long long budget_bytes);
+
+  /**
+   * @brief 查询在途帧内存统计。
+   */
+  DLLEXPORT void frame_memory_get_stats(FrameMemoryStats* out_stats);
+
+  /**
+   * @brief 重置峰值统计。
+   */
+  DLLEXPORT void frame_memory_reset_peak();
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,95 @@
+#include "IoBatch.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <winioctl.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// 队列深度: 机械硬盘 / 固态硬盘 / 无法判断
+static const int kHddQueueDepth = 2;
+static const int kSsdQueueDepth = 32;
+static const int kDefaultQueueDepth = 8;
+
+// Windows: 查询卷所在磁盘的 seek penalty 属性
+int storage_queue_depth(const char* path) {
+#ifdef _WIN32
+  std::wstring wpath = fs::u8path(path).wstring();
+  wchar_t volume[MAX_PATH];
+  if (!GetVolumePathNameW(wpath.c_str(), volume, MAX_PATH)) return kDefaultQueueDepth;
+
+  // "C:\" -> "\\.\C:"，网络路径等无法打开卷设备时使用默认值
+  std::wstring device = L"\\\\.\\" + std::wstring(volume);
+  if (!device.empty() && device.back() == L'\\') device.pop_back();
+
+  HANDLE volume_handle = CreateFileW(device.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+  if (volume_handle == INVALID_HANDLE_VALUE) return kDefaultQueueDepth;
+
+  STORAGE_PROPERTY_QUERY query = {};
+  query.PropertyId = StorageDeviceSeekPenaltyProperty;
+  query.QueryType = PropertyStandardQuery;
+  DEVICE_SEEK_PENALTY_DESCRIPTOR desc = {};
+  DWORD bytes = 0;
+  BOOL ok = DeviceIoControl(volume_handle, IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(query),
+    &desc, sizeof(desc), &bytes, NULL);
+  CloseHandle(volume_handle);
+
+  if (!ok || bytes < sizeof(desc)) return kDefaultQueueDepth;
+  return desc.IncursSeekPenalty ? kHddQueueDepth : kSsdQueueDepth;
+#else
+  (void)path;
+  return kDefaultQueueDepth;
+#endif
+}
+
+void run_io_batch(int count, int queue_depth, const std::function<void(int index)>& task,
+  const std::function<void(int processed, int total, int last_index)>& progress) {
+  if (count <= 0) return;
+  int thread_count = (std::min)((std::max)(queue_depth, 1), count);
+
+  std::atomic<int> next{ 0 };
+  std::atomic<int> done{ 0 };
+  std::atomic<int> last_done{ -1 };
+  std::mutex mutex;
+  std::condition_variable cv;
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < thread_count; t++) {
+    workers.emplace_back([&]() {
+      for (int i = next++; i < count; i = next++) {
+        task(i);
+        last_done = i;
+        done++;
+        cv.notify_one();
+      }
+      });
+  }
+
+  const int step = (std::max)(count / 100, 1);
+  int reported = 0;
+  while (reported < count) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait_for(lock, std::chrono::milliseconds(100), [&]() { return done.load() - reported >= step || done.load() == count; });
+    }
+    int current = done.load();
+    if (current != reported) {
+      reported = current;
+      if (progress) progress(reported, count, last_done.load());
+    }
+  }
+
+  for (auto& worker : workers) worker.join();
+}
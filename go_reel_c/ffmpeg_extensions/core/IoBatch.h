@@ -0,0 +1,20 @@
+#pragma once
+
+#include <functional>
+
+// =================================================================
+// I/O 密集的批量任务 (文件指纹、元数据探测等)
+//
+// 这些任务大部分时间阻塞在磁盘读取上，放进共享线程池会占用 CPU 预算，
+// 因此使用独立的 I/O 线程，线程数即同时进行的读取数 (队列深度):
+// 机械硬盘并发过高会导致磁头来回寻道，固态硬盘则需要较深的队列才能跑满。
+// =================================================================
+
+// 按 path 所在磁盘选择队列深度 (Windows 上查询是否有寻道开销: HDD 2，SSD 32，无法判断 8)
+int storage_queue_depth(const char* path);
+
+// 在 queue_depth 个 I/O 线程上执行 task(i)，i ∈ [0, count)，全部完成后返回。
+// progress 只在调用线程上触发 (Koffi 回调不能从任意线程调用)，大约每 1% 一次；
+// last_index 为最近完成的任务 (并发执行，完成顺序与下标无关)
+void run_io_batch(int count, int queue_depth, const std::function<void(int index)>& task,
+  const std::function<void(int processed, int total, int last_index)>& progress);
@@ -0,0 +1,171 @@
+#include "Job.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+static thread_local JobControl* t_current_job = nullptr;
+
+JobControl* JobControl::current() {
+  return t_current_job;
+}
+
+JobScope::JobScope(JobControl* job) : previous_(t_current_job) {
+  t_current_job = job;
+}
+
+JobScope::~JobScope() {
+  t_current_job = previous_;
+}
+
+bool job_cancelled() {
+  JobControl* job = t_current_job;
+  return job && job->cancelled.load(std::memory_order_relaxed);
+}
+
+void job_add_progress(long long done, long long frames, long long bytes) {
+  JobControl* job = t_current_job;
+  if (!job) return;
+  if (done) job->done.fetch_add(done, std::memory_order_relaxed);
+  if (frames) job->frames.fetch_add(frames, std::memory_order_relaxed);
+  if (bytes) job->bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void job_set_total(long long total) {
+  JobControl* job = t_current_job;
+  if (job) job->total = total;
+}
+
+JobRegistry& JobRegistry::instance() {
+  // 与线程池一样有意泄漏: 任务可能在 DLL 卸载时仍在执行
+  static JobRegistry* registry = new JobRegistry();
+  return *registry;
+}
+
+std::shared_ptr<JobRegistry::Job> JobRegistry::create(int kind, long long total, std::shared_ptr<void> payload,
+  long long& id) {
+  auto job = std::make_shared<Job>();
+  job->kind = kind;
+  job->control.total = total;
+  job->payload = std::move(payload);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  id = next_id_++;
+  jobs_[id] = job;
+  return job;
+}
+
+// 任务持有 Job 的引用: job_release 之后仍可安全执行完
+std::function<void()> JobRegistry::runner(std::shared_ptr<Job> job, std::function<int()> fn) {
+  return [this, job, fn = std::move(fn)]() {
+    int result = -1;
+    if (!job->control.cancelled.load()) {
+      job->state = JOB_STATE_RUNNING;
+      JobScope scope(&job->control);
+      result = fn();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      job->result = result;
+      job->state = job->control.cancelled.load() ? JOB_STATE_CANCELLED : JOB_STATE_DONE;
+    }
+    finished_cv_.notify_all();
+  };
+}
+
+long long JobRegistry::submit(int kind, int priority, long long total, std::shared_ptr<void> payload,
+  std::function<int()> fn) {
+  long long id;
+  auto job = create(kind, total, std::move(payload), id);
+  ThreadPool::instance().submit(runner(job, std::move(fn)), priority);
+  return id;
+}
+
+long long JobRegistry::submit_dedicated(int kind, long long total, std::shared_ptr<void> payload,
+  std::function<int()> fn) {
+  long long id;
+  auto job = create(kind, total, std::move(payload), id);
+  std::thread(runner(job, std::move(fn))).detach();
+  return id;
+}
+
+std::shared_ptr<JobRegistry::Job> JobRegistry::find(long long job_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = jobs_.find(job_id);
+  return it == jobs_.end() ? nullptr : it->second;
+}
+
+std::shared_ptr<void> JobRegistry::finished_payload(long long job_id, int kind) {
+  std::shared_ptr<Job> job = find(job_id);
+  if (!job || job->kind != kind || job->state.load() < JOB_STATE_DONE) return nullptr;
+  return job->payload;
+}
+
+int JobRegistry::poll(long long job_id, JobProgress* out) {
+  std::shared_ptr<Job> job = find(job_id);
+  if (!job) return -1;
+
+  int state = job->state.load();
+  if (out) {
+    out->state = state;
+    out->result = state >= JOB_STATE_DONE ? job->result : 0;
+    out->done = job->control.done.load(std::memory_order_relaxed);
+    out->total = job->control.total.load(std::memory_order_relaxed);
+    out->frames = job->control.frames.load(std::memory_order_relaxed);
+    out->bytes = job->control.bytes.load(std::memory_order_relaxed);
+    out->percent = out->total > 0 ? (std::min)(100.0 * out->done / out->total, 100.0) : 0.0;
+    if (state == JOB_STATE_DONE) out->percent = 100.0;
+  }
+  return state;
+}
+
+int JobRegistry::cancel(long long job_id) {
+  std::shared_ptr<Job> job = find(job_id);
+  if (!job) return -1;
+  job->control.cancelled = true;
+  return 0;
+}
+
+int JobRegistry::wait(long long job_id, int timeout_ms) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = jobs_.find(job_id);
+  if (it == jobs_.end()) return -1;
+  std::shared_ptr<Job> job = it->second;
+
+  auto finished = [&job]() { return job->state.load() >= JOB_STATE_DONE; };
+  if (timeout_ms < 0) finished_cv_.wait(lock, finished);
+  else finished_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), finished);
+  return job->state.load();
+}
+
+void JobRegistry::release(long long job_id) {
+  std::shared_ptr<Job> job;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(job_id);
+    if (it == jobs_.end()) return;
+    job = it->second;
+    jobs_.erase(it);
+  }
+  job->control.cancelled = true; // 已结束时无影响
+}
+
+// =================================================================
+// 导出接口
+// =================================================================
+DLLEXPORT int job_poll(long long job_id, JobProgress* out) {
+  return JobRegistry::instance().poll(job_id, out);
+}
+
+DLLEXPORT int job_cancel(long long job_id) {
+  return JobRegistry::instance().cancel(job_id);
+}
+
+DLLEXPORT int job_wait(long long job_id, int timeout_ms) {
+  return JobRegistry::instance().wait(job_id, timeout_ms);
+}
+
+DLLEXPORT void job_release(long long job_id) {
+  JobRegistry::instance().release(job_id);
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "../common.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// =================================================================
+// 异步任务 (job)
+//
+// 耗时的导出函数 (裁剪、批量截图、转码) 提供 *_submit 版本: 提交到线程池后立即返回任务编号，
+// 调用方轮询进度 (job_poll，只读取原子计数，不等待任务)、取消 (job_cancel)、等待 (job_wait)，
+// 取完结果后 job_release。
+//
+// - 任务执行期间当前线程绑定它的 JobControl (线程局部)。ThreadPool::submit 让子任务继承提交者的
+//   JobControl，所以解码 / 裁剪循环不需要额外参数就能检查取消、上报进度
+// - 取消在读包粒度生效: 循环退出后解码器随 MediaLease 归还，线程交还线程池给交互任务
+// =================================================================
+
+enum JobKind {
+  JOB_KIND_TRIM = 1,
+  JOB_KIND_SCREENSHOTS = 2,
+  JOB_KIND_SCREENSHOTS_MULTI = 3,
+  JOB_KIND_TRANSCODE = 4,
+};
+
+// 任务的取消标记与进度计数 (各线程直接原子读写)
+struct JobControl {
+  std::atomic<bool> cancelled{ false };
+  std::atomic<long long> done{ 0 };   // 已完成的工作量，单位由任务类型决定
+  std::atomic<long long> total{ 0 };  // 总工作量 (同一单位)，0 表示未知
+  std::atomic<long long> frames{ 0 }; // 已处理的视频包 / 帧
+  std::atomic<long long> bytes{ 0 };  // 已处理的数据字节数
+
+  // 当前线程绑定的任务，不在任务中时为 NULL
+  static JobControl* current();
+};
+
+// 作用域内把任务绑定到当前线程 (可嵌套，析构时恢复)
+// 子任务只保存裸指针: 任务函数返回前会等待它提交的全部子任务
+class JobScope {
+public:
+  explicit JobScope(JobControl* job);
+  ~JobScope();
+  JobScope(const JobScope&) = delete;
+  JobScope& operator=(const JobScope&) = delete;
+
+private:
+  JobControl* previous_;
+};
+
+// 当前任务是否已被取消 (不在任务中时返回 false)
+bool job_cancelled();
+
+// 向当前任务累加进度 (不在任务中时忽略)
+void job_add_progress(long long done, long long frames, long long bytes);
+
+// 设置当前任务的总工作量 (提交时未知、执行中才能确定时使用)
+void job_set_total(long long total);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef enum {
+    JOB_STATE_QUEUED = 0,    // 排队中
+    JOB_STATE_RUNNING = 1,   // 执行中
+    JOB_STATE_DONE = 2,      // 已完成 (result 为对应同步函数的返回值)
+    JOB_STATE_CANCELLED = 3, // 已取消 (result 为取消时的部分结果，未开始时为 -1)
+  } JobState;
+
+  typedef struct JobProgress {
+    int state;        // JobState
+    int result;       // 结束后有效
+    long long done;   // 已完成的工作量: 裁剪 / 转码为输出视频毫秒数，截图为张数，多视频截图为视频数
+    long long total;  // 总工作量 (同一单位)，0 表示未知
+    long long frames; // 已处理的视频包 / 帧数
+    long long bytes;  // 已处理的数据字节数
+    double percent;   // 0-100，总量未知时为 0
+  } JobProgress;
+
+  /**
+   * @brief 查询任务状态与进度 (不等待任务，可高频调用)。
+   * @return JobState；任务不存在时返回 -1。
+   */
+  DLLEXPORT int job_poll(long long job_id, JobProgress* out);
+
+  /**
+   * @brief 请求取消任务。排队中的任务不再执行，执行中的任务在下一次读包时退出。
+   * @return 0 已请求；-1 任务不存在。
+   */
+  DLLEXPORT int job_cancel(long long job_id);
+
+  /**
+   * @brief 等待任务结束。
+   * @param timeout_ms 超时毫秒数，小于 0 表示一直等待。
+   * @return 当前 JobState (超时时为 QUEUED / RUNNING)；任务不存在时返回 -1。
+   */
+  DLLEXPORT int job_wait(long long job_id, int timeout_ms);
+
+  /**
+   * @brief 释放任务记录 (执行中的任务会先被取消，结束后自动清理)。
+   */
+  DLLEXPORT void job_release(long long job_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+class JobRegistry {
+public:
+  static JobRegistry& instance();
+
+  // 提交任务。fn 的返回值作为任务结果；payload 保存结束后供结果查询函数读取的数据
+  long long submit(int kind, int priority, long long total, std::shared_ptr<void> payload,
+    std::function<int()> fn);
+
+  // 同 submit，但在独立线程上执行: 自己创建流水线线程、大部分时间在等待它们的长任务 (转码)
+  // 不应占用线程池的后台名额
+  long long submit_dedicated(int kind, long long total, std::shared_ptr<void> payload, std::function<int()> fn);
+
+  // 按编号和类型取得任务数据，任务不存在、类型不符或尚未结束时返回 NULL
+  std::shared_ptr<void> finished_payload(long long job_id, int kind);
+
+  int poll(long long job_id, JobProgress* out);
+  int cancel(long long job_id);
+  int wait(long long job_id, int timeout_ms);
+  void release(long long job_id);
+
+private:
+  struct Job {
+    int kind = 0;
+    JobControl control;
+    std::atomic<int> state{ 0 };
+    int result = 0;
+    std::shared_ptr<void> payload;
+  };
+
+  JobRegistry() = default;
+  std::shared_ptr<Job> find(long long job_id);
+  std::shared_ptr<Job> create(int kind, long long total, std::shared_ptr<void> payload, long long& id);
+  std::function<void()> runner(std::shared_ptr<Job> job, std::function<int()> fn);
+
+  std::mutex mutex_;
+  std::condition_variable finished_cv_;
+  std::map<long long, std::shared_ptr<Job>> jobs_;
+  long long next_id_ = 1;
+};
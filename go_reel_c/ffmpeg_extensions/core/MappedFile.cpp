@@ -0,0 +1,97 @@
+#include "MappedFile.h"
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+bool MappedFile::open(const std::string& path) {
+  close();
+
+#ifdef _WIN32
+  HANDLE file = CreateFileW(fs::u8path(path).wstring().c_str(), GENERIC_READ,
+    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) return false;
+
+  LARGE_INTEGER size;
+  HANDLE mapping = GetFileSizeEx(file, &size) && size.QuadPart > 0
+    ? CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+  const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+  if (!view) {
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  file_handle_ = file;
+  mapping_handle_ = mapping;
+  data_ = (const uint8_t*)view;
+  size_ = (size_t)size.QuadPart;
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat st;
+  void* view = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  ::close(fd); // 映射建立后不再需要描述符
+  if (view == MAP_FAILED) return false;
+
+  data_ = (const uint8_t*)view;
+  size_ = (size_t)st.st_size;
+#endif
+  return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+  if (data_) UnmapViewOfFile(data_);
+  if (mapping_handle_) CloseHandle((HANDLE)mapping_handle_);
+  if (file_handle_) CloseHandle((HANDLE)file_handle_);
+  mapping_handle_ = nullptr;
+  file_handle_ = nullptr;
+#else
+  if (data_) munmap((void*)data_, size_);
+#endif
+  data_ = nullptr;
+  size_ = 0;
+}
+
+std::FILE* open_utf8_file(const std::string& path, const char* mode) {
+#ifdef _WIN32
+  std::wstring wmode(mode, mode + strlen(mode));
+  return _wfopen(fs::u8path(path).wstring().c_str(), wmode.c_str());
+#else
+  return std::fopen(path.c_str(), mode);
+#endif
+}
+
+int seek_file(std::FILE* f, uint64_t offset) {
+#ifdef _WIN32
+  return _fseeki64(f, (long long)offset, SEEK_SET);
+#else
+  return fseeko(f, (off_t)offset, SEEK_SET);
+#endif
+}
+
+int64_t file_length(std::FILE* f) {
+#ifdef _WIN32
+  if (_fseeki64(f, 0, SEEK_END) != 0) return -1;
+  return _ftelli64(f);
+#else
+  if (fseeko(f, 0, SEEK_END) != 0) return -1;
+  return (int64_t)ftello(f);
+#endif
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// =================================================================
+// 只读内存映射文件 (MediaIndex / ThumbArchive 共用)
+//
+// 映射期间其它句柄仍可追加写入 (映射范围固定为打开时的大小)；
+// Windows 上映射中的文件不能被替换或截断，需要先 close()。
+// =================================================================
+class MappedFile {
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile() { close(); }
+
+  // path 为 UTF-8。空文件无法映射，返回 false
+  bool open(const std::string& path);
+  void close();
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool is_open() const { return data_ != nullptr; }
+
+private:
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  void* file_handle_ = nullptr;
+  void* mapping_handle_ = nullptr;
+#endif
+};
+
+// 以 UTF-8 路径打开文件 (Windows 上转为宽字符，避免本地代码页无法表示的文件名)
+std::FILE* open_utf8_file(const std::string& path, const char* mode);
+
+// 64 位文件定位 (MSVC 的 fseek / ftell 只有 32 位)
+int seek_file(std::FILE* f, uint64_t offset);
+int64_t file_length(std::FILE* f);
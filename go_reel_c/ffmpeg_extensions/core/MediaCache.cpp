@@ -0,0 +1,271 @@
+#include "MediaCache.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+long long media_cache_now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool stat_media_file(const char* path, long long& mtime, long long& size) {
+  std::error_code ec;
+  fs::path p = fs::u8path(path);
+  auto file_size = fs::file_size(p, ec);
+  if (ec) return false;
+  auto write_time = fs::last_write_time(p, ec);
+  if (ec) return false;
+
+  size = (long long)file_size;
+  mtime = (long long)write_time.time_since_epoch().count();
+  return true;
+}
+
+// =================================================================
+// MediaContext
+// =================================================================
+MediaContext::~MediaContext() {
+  if (codec_ctx) avcodec_free_context(&codec_ctx);
+  if (format_ctx) avformat_close_input(&format_ctx);
+}
+
+int MediaContext::open_decoder(int thread_count) {
+  if (video_stream_index < 0 || !decoder) return -1;
+
+  if (codec_ctx) {
+    if (decoder_thread_count == thread_count) {
+      // 复用: 丢弃上一次调用残留的参考帧
+      avcodec_flush_buffers(codec_ctx);
+      return 0;
+    }
+    avcodec_free_context(&codec_ctx);
+  }
+
+  codec_ctx = avcodec_alloc_context3(decoder);
+  if (!codec_ctx) return -1;
+
+  avcodec_parameters_to_context(codec_ctx, video_stream()->codecpar);
+  codec_ctx->pkt_timebase = video_stream()->time_base;
+  codec_ctx->thread_count = thread_count;
+
+  if (avcodec_open2(codec_ctx, decoder, NULL) < 0) {
+    avcodec_free_context(&codec_ctx);
+    return -1;
+  }
+
+  decoder_thread_count = thread_count;
+  return 0;
+}
+
+// =================================================================
+// MediaLease
+// =================================================================
+MediaLease& MediaLease::operator=(MediaLease&& other) noexcept {
+  if (this != &other) {
+    release();
+    ctx_ = other.ctx_;
+    valid_ = other.valid_;
+    other.ctx_ = nullptr;
+  }
+  return *this;
+}
+
+void MediaLease::release() {
+  if (ctx_) {
+    MediaCache::instance().release(ctx_, valid_);
+    ctx_ = nullptr;
+  }
+}
+
+// =================================================================
+// MediaCache
+// =================================================================
+MediaCache& MediaCache::instance() {
+  // 有意泄漏: 避免 DLL 卸载时在静态析构中等待后台线程
+  static MediaCache* cache = new MediaCache();
+  return *cache;
+}
+
+MediaLease MediaCache::acquire(const char* path, int decoder_thread_count) {
+  if (!path) return MediaLease();
+
+  long long mtime = 0, size = 0;
+  if (!stat_media_file(path, mtime, size)) return MediaLease();
+
+  std::unique_ptr<MediaContext> ctx;
+  std::vector<std::unique_ptr<MediaContext>> stale;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = idle_.begin(); it != idle_.end(); ) {
+      if ((*it)->path != path) { ++it; continue; }
+
+      if ((*it)->mtime == mtime && (*it)->size == size && !ctx) {
+        ctx = std::move(*it);
+      }
+      else if ((*it)->mtime != mtime || (*it)->size != size) {
+        stale.push_back(std::move(*it));
+      }
+      else {
+        ++it;
+        continue;
+      }
+      it = idle_.erase(it);
+    }
+
+    // 打开前就登记为借出，打开期间发生的 evict 也能标记到
+    if (!ctx) {
+      ctx.reset(new MediaContext());
+      ctx->path = path;
+      ctx->mtime = mtime;
+      ctx->size = size;
+    }
+    leased_.insert(ctx.get());
+  }
+  stale.clear(); // 在锁外关闭，NAS 上关闭句柄可能较慢
+
+  auto fail = [&]() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      leased_.erase(ctx.get());
+    }
+    ctx.reset();
+    return MediaLease();
+  };
+
+  if (!ctx->format_ctx) {
+    if (avformat_open_input(&ctx->format_ctx, path, NULL, NULL) != 0) return fail();
+    if (avformat_find_stream_info(ctx->format_ctx, NULL) < 0) return fail();
+
+    ctx->video_stream_index = av_find_best_stream(ctx->format_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, &ctx->decoder, 0);
+  }
+
+  if (decoder_thread_count >= 0 && ctx->open_decoder(decoder_thread_count) < 0) {
+    return fail();
+  }
+
+  ctx->last_used_ms = media_cache_now_ms();
+  return MediaLease(ctx.release());
+}
+
+void MediaCache::release(MediaContext* raw, bool reusable) {
+  std::unique_ptr<MediaContext> ctx(raw);
+  std::vector<std::unique_ptr<MediaContext>> closing;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    leased_.erase(raw);
+    if (!reusable || ctx->evicted || max_idle_entries_ <= 0) {
+      closing.push_back(std::move(ctx));
+    }
+    else {
+      ctx->last_used_ms = media_cache_now_ms();
+      idle_.push_front(std::move(ctx));
+
+      while ((int)idle_.size() > max_idle_entries_) {
+        closing.push_back(std::move(idle_.back()));
+        idle_.pop_back();
+      }
+
+      if (!janitor_started_) {
+        janitor_started_ = true;
+        std::thread([this]() { janitor_loop(); }).detach();
+      }
+    }
+  }
+  cv_.notify_all();
+}
+
+void MediaCache::janitor_loop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    if (idle_.empty()) {
+      cv_.wait(lock);
+      continue;
+    }
+
+    long long now = media_cache_now_ms();
+    std::vector<std::unique_ptr<MediaContext>> expired;
+    for (auto it = idle_.begin(); it != idle_.end(); ) {
+      if (now - (*it)->last_used_ms >= idle_timeout_ms_) {
+        expired.push_back(std::move(*it));
+        it = idle_.erase(it);
+      }
+      else {
+        ++it;
+      }
+    }
+
+    if (!expired.empty()) {
+      lock.unlock();
+      expired.clear();
+      lock.lock();
+      continue;
+    }
+
+    // 最久未使用的条目在链表尾部
+    long long wait_ms = idle_timeout_ms_ - (now - idle_.back()->last_used_ms);
+    cv_.wait_for(lock, std::chrono::milliseconds((std::max)(wait_ms, 1LL)));
+  }
+}
+
+void MediaCache::evict(const char* path) {
+  if (!path) return;
+  std::vector<std::unique_ptr<MediaContext>> closing;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = idle_.begin(); it != idle_.end(); ) {
+      if ((*it)->path == path) {
+        closing.push_back(std::move(*it));
+        it = idle_.erase(it);
+      }
+      else {
+        ++it;
+      }
+    }
+    for (MediaContext* ctx : leased_) {
+      if (ctx->path == path) ctx->evicted = true;
+    }
+  }
+}
+
+void MediaCache::clear() {
+  std::list<std::unique_ptr<MediaContext>> closing;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closing.swap(idle_);
+    for (MediaContext* ctx : leased_) ctx->evicted = true;
+  }
+}
+
+void MediaCache::set_limits(int max_idle_entries, int idle_timeout_ms) {
+  std::vector<std::unique_ptr<MediaContext>> closing;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_idle_entries_ = (std::max)(max_idle_entries, 0);
+    idle_timeout_ms_ = (std::max)(idle_timeout_ms, 0);
+    while ((int)idle_.size() > max_idle_entries_) {
+      closing.push_back(std::move(idle_.back()));
+      idle_.pop_back();
+    }
+  }
+  cv_.notify_all();
+}
+
+// =================================================================
+// 导出接口
+// =================================================================
+DLLEXPORT void media_cache_evict(const char* video_path) {
+  MediaCache::instance().evict(video_path);
+}
+
+DLLEXPORT void media_cache_clear() {
+  MediaCache::instance().clear();
+}
+
+DLLEXPORT void media_cache_configure(int max_idle_entries, int idle_timeout_ms) {
+  MediaCache::instance().set_limits(max_idle_entries, idle_timeout_ms);
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "../common.h"
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// =================================================================
+// 已打开媒体上下文缓存 (进程内共享)
+//
+// 同一文件短时间内被多次访问 (封面 + 元数据 + 若干截图) 时，
+// 复用已经 avformat_open_input + avformat_find_stream_info 的 demuxer，
+// 以及已经 avcodec_open2 的视频解码器，避免重复探测。
+//
+// - 键: 路径 + mtime + size，文件被修改后旧条目自动失效
+// - 同一时刻一个上下文只会被一个调用方持有 (借出/归还)
+// - 空闲条目有数量上限，超过空闲时间后由后台线程关闭 (释放文件句柄)
+// =================================================================
+
+struct MediaContext {
+  AVFormatContext* format_ctx = nullptr;
+  AVCodecContext* codec_ctx = nullptr; // 视频解码器，按需打开
+  const AVCodec* decoder = nullptr;
+  int video_stream_index = -1;
+  int decoder_thread_count = -1;
+
+  // 视频关键帧 pts (视频流 time_base，升序)，由 media_load_keyframes 按需填充
+  std::vector<int64_t> keyframes;
+  bool keyframes_loaded = false;
+
+  std::string path;
+  long long mtime = 0;
+  long long size = 0;
+  long long last_used_ms = 0;
+  bool evicted = false; // 借出期间被 evict / clear，归还时直接关闭 (受 MediaCache 的锁保护)
+
+  MediaContext() = default;
+  MediaContext(const MediaContext&) = delete;
+  MediaContext& operator=(const MediaContext&) = delete;
+  ~MediaContext();
+
+  AVStream* video_stream() const {
+    return video_stream_index >= 0 ? format_ctx->streams[video_stream_index] : nullptr;
+  }
+
+  /**
+   * @brief 确保视频解码器已打开。thread_count 与已打开的不一致时会重新打开。
+   * @return 0 表示成功, 小于 0 表示失败。
+   */
+  int open_decoder(int thread_count);
+};
+
+/**
+ * @brief 借出的媒体上下文。析构时自动归还给缓存。
+ *        调用方发现上下文状态异常 (例如读包出错) 时可调用 invalidate()，归还时直接关闭。
+ */
+class MediaLease {
+public:
+  MediaLease() = default;
+  explicit MediaLease(MediaContext* ctx) : ctx_(ctx) {}
+  MediaLease(MediaLease&& other) noexcept : ctx_(other.ctx_), valid_(other.valid_) { other.ctx_ = nullptr; }
+  MediaLease& operator=(MediaLease&& other) noexcept;
+  MediaLease(const MediaLease&) = delete;
+  MediaLease& operator=(const MediaLease&) = delete;
+  ~MediaLease() { release(); }
+
+  MediaContext* operator->() const { return ctx_; }
+  MediaContext* get() const { return ctx_; }
+  explicit operator bool() const { return ctx_ != nullptr; }
+
+  void invalidate() { valid_ = false; }
+  void release();
+
+private:
+  MediaContext* ctx_ = nullptr;
+  bool valid_ = true;
+};
+
+class MediaCache {
+public:
+  static MediaCache& instance();
+
+  /**
+   * @brief 借出指定文件的媒体上下文，缓存未命中时打开并探测。
+   * @param decoder_thread_count 小于 0 表示不需要解码器；否则确保解码器已按该线程数打开
+   * @return 失败时返回空 lease。
+   */
+  MediaLease acquire(const char* path, int decoder_thread_count = -1);
+
+  void release(MediaContext* ctx, bool reusable);
+
+  // 关闭指定路径的所有空闲条目，借出中的条目归还时关闭 (文件即将被移动/删除时调用)
+  void evict(const char* path);
+  void clear();
+
+  void set_limits(int max_idle_entries, int idle_timeout_ms);
+
+private:
+  MediaCache() = default;
+  void janitor_loop();
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::list<std::unique_ptr<MediaContext>> idle_; // 最近使用的在前
+  std::unordered_set<MediaContext*> leased_;       // 借出中 (含正在打开) 的条目
+  int max_idle_entries_ = 8;
+  int idle_timeout_ms_ = 10000;
+  bool janitor_started_ = false;
+};
+
+// 当前时间 (毫秒，单调时钟)
+long long media_cache_now_ms();
+
+// 文件身份: mtime + size，任一变化都视为不同文件 (MediaIndex 使用同一组值作为键)
+bool stat_media_file(const char* path, long long& mtime, long long& size);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /**
+   * @brief 释放缓存中指定文件的已打开句柄。移动、删除文件前调用，避免 Windows 上文件被占用。
+   *        正在使用中的句柄在使用结束时关闭，不再放回缓存。
+   */
+  DLLEXPORT void media_cache_evict(const char* video_path);
+
+  /**
+   * @brief 清空媒体上下文缓存。
+   */
+  DLLEXPORT void media_cache_clear();
+
+  /**
+   * @brief 调整缓存上限。
+   * @param max_idle_entries 最多保留的空闲上下文数量 (0 = 禁用缓存)
+   * @param idle_timeout_ms  空闲超过该时长后自动关闭
+   */
+  DLLEXPORT void media_cache_configure(int max_idle_entries, int idle_timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,294 @@
+#include "MediaIndex.h"
+#include <cstring>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// =================================================================
+// 文件格式 (小端)
+//
+//   文件头 16 字节: "GRMI" | u32 版本 | u64 保留
+//   记录 (8 字节对齐):
+//     RecordHeader (40 字节) | 路径 (UTF-8，不含 '\0') | 数据 | 补齐到 8 字节
+// =================================================================
+static const char kMagic[4] = { 'G', 'R', 'M', 'I' };
+static const uint32_t kVersion = 2; // 2: Matroska 关键帧不再加 dts 偏移
+static const size_t kFileHeaderSize = 16;
+
+// 失效记录超过一半且文件超过该大小时，打开时重写
+static const size_t kCompactMinBytes = 1024 * 1024;
+
+struct RecordHeader {
+  uint32_t type;
+  uint32_t payload_size;
+  uint64_t path_hash;
+  int64_t mtime;
+  int64_t size;
+  uint32_t path_size;
+  uint32_t checksum; // 路径 + 数据的 FNV-1a 32，用于发现写了一半的记录
+};
+static_assert(sizeof(RecordHeader) == 40, "RecordHeader layout");
+
+static uint64_t fnv1a64(const void* data, size_t size) {
+  const uint8_t* p = (const uint8_t*)data;
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= p[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static uint32_t fnv1a32(const void* data, size_t size, uint32_t hash = 0x811c9dc5u) {
+  const uint8_t* p = (const uint8_t*)data;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= p[i];
+    hash *= 0x01000193u;
+  }
+  return hash;
+}
+
+static size_t record_total_size(const RecordHeader& h) {
+  size_t n = sizeof(RecordHeader) + h.path_size + h.payload_size;
+  return (n + 7) & ~(size_t)7;
+}
+
+static RecordHeader read_header(const uint8_t* record) {
+  RecordHeader h;
+  memcpy(&h, record, sizeof(h));
+  return h;
+}
+
+static bool is_known_type(uint32_t type) {
+  return type == MEDIA_INDEX_VIDEO_INFO || type == MEDIA_INDEX_KEYFRAMES || type == MEDIA_INDEX_FINGERPRINT;
+}
+
+static bool write_file_header(std::FILE* f) {
+  uint8_t header[kFileHeaderSize] = {};
+  memcpy(header, kMagic, 4);
+  memcpy(header + 4, &kVersion, 4);
+  return fwrite(header, 1, sizeof(header), f) == sizeof(header);
+}
+
+static std::vector<uint8_t> build_record(const char* path, long long mtime, long long size, uint32_t type,
+  const void* data, size_t data_size) {
+  size_t path_size = strlen(path);
+
+  RecordHeader h = {};
+  h.type = type;
+  h.payload_size = (uint32_t)data_size;
+  h.path_hash = fnv1a64(path, path_size);
+  h.mtime = mtime;
+  h.size = size;
+  h.path_size = (uint32_t)path_size;
+  h.checksum = fnv1a32(data, data_size, fnv1a32(path, path_size));
+
+  std::vector<uint8_t> record(record_total_size(h), 0);
+  memcpy(record.data(), &h, sizeof(h));
+  memcpy(record.data() + sizeof(h), path, path_size);
+  if (data_size > 0) memcpy(record.data() + sizeof(h) + path_size, data, data_size);
+  return record;
+}
+
+// =================================================================
+// 映射
+// =================================================================
+bool MediaIndex::map_file() {
+  std::error_code ec;
+
+  // 不存在或连文件头都不完整: 新建
+  if (fs::file_size(fs::u8path(path_), ec) < kFileHeaderSize || ec) {
+    std::FILE* f = open_utf8_file(path_, "wb");
+    if (!f) return false;
+    bool ok = write_file_header(f);
+    fclose(f);
+    if (!ok) return false;
+  }
+
+  if (!mapping_.open(path_)) return false;
+  mapped_ = mapping_.data();
+  mapped_size_ = mapping_.size();
+  return true;
+}
+
+void MediaIndex::unmap_file() {
+  mapping_.close();
+  mapped_ = nullptr;
+  mapped_size_ = 0;
+  tail_.clear();
+  slots_.clear();
+  live_bytes_ = 0;
+}
+
+const uint8_t* MediaIndex::record_at(uint64_t offset) const {
+  if (offset < mapped_size_) return mapped_ + offset;
+  return tail_.data() + (offset - mapped_size_);
+}
+
+// 顺序读取记录，建立 路径 -> 最新记录 的表；遇到不完整或校验失败的记录即停止
+size_t MediaIndex::scan_records() {
+  if (mapped_size_ < kFileHeaderSize || memcmp(mapped_, kMagic, 4) != 0) return 0;
+  uint32_t version;
+  memcpy(&version, mapped_ + 4, 4);
+  if (version != kVersion) return 0;
+
+  size_t offset = kFileHeaderSize;
+  while (offset + sizeof(RecordHeader) <= mapped_size_) {
+    RecordHeader h = read_header(mapped_ + offset);
+    size_t total = record_total_size(h);
+    if (total > mapped_size_ - offset) break;
+
+    const uint8_t* body = mapped_ + offset + sizeof(h);
+    if (fnv1a32(body + h.path_size, h.payload_size, fnv1a32(body, h.path_size)) != h.checksum) break;
+
+    if (is_known_type(h.type)) {
+      uint64_t& slot = slots_[h.path_hash].offsets[h.type - 1];
+      if (slot != 0) live_bytes_ -= record_total_size(read_header(mapped_ + slot));
+      slot = offset;
+      live_bytes_ += total;
+    }
+    offset += total;
+  }
+  return offset;
+}
+
+// 只保留每个路径每种类型的最新记录，写入临时文件后替换
+bool MediaIndex::compact() {
+  std::string tmp_path = path_ + ".tmp";
+  std::FILE* f = open_utf8_file(tmp_path, "wb");
+  if (!f) return false;
+
+  bool ok = write_file_header(f);
+  for (const auto& kv : slots_) {
+    for (uint64_t offset : kv.second.offsets) {
+      if (offset == 0 || !ok) continue;
+      const uint8_t* record = record_at(offset);
+      size_t total = record_total_size(read_header(record));
+      ok = fwrite(record, 1, total, f) == total;
+    }
+  }
+  ok = fclose(f) == 0 && ok;
+
+  std::error_code ec;
+  if (ok) {
+    unmap_file(); // Windows 上映射中的文件不能被替换
+    fs::rename(fs::u8path(tmp_path), fs::u8path(path_), ec);
+    ok = !ec;
+  }
+  if (!ok) fs::remove(fs::u8path(tmp_path), ec);
+  return ok;
+}
+
+// =================================================================
+// MediaIndex
+// =================================================================
+MediaIndex& MediaIndex::instance() {
+  // 与 MediaCache 相同: 有意泄漏，避免 DLL 卸载时的静态析构顺序问题
+  static MediaIndex* index = new MediaIndex();
+  return *index;
+}
+
+int MediaIndex::open(const char* index_path) {
+  if (!index_path || !index_path[0]) return -1;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (append_) {
+    fclose(append_);
+    append_ = nullptr;
+  }
+  unmap_file();
+  path_ = index_path;
+
+  if (!map_file()) return -2;
+  size_t valid_end = scan_records();
+  std::error_code ec;
+
+  if (valid_end < kFileHeaderSize) {
+    // 版本不符或文件头损坏: 重建
+    unmap_file();
+    fs::remove(fs::u8path(path_), ec);
+  }
+  else if (valid_end < mapped_size_) {
+    // 尾部有写了一半的记录 (上次写入时进程退出): 截断到最后一条有效记录
+    unmap_file();
+    fs::resize_file(fs::u8path(path_), valid_end, ec);
+    if (ec) return -3;
+  }
+  else if (mapped_size_ > kCompactMinBytes && live_bytes_ * 2 < mapped_size_ - kFileHeaderSize) {
+    compact(); // 失败时继续使用原文件
+  }
+
+  if (!mapped_) {
+    if (!map_file()) return -2;
+    scan_records();
+  }
+
+  append_ = open_utf8_file(path_, "ab");
+  if (!append_) {
+    unmap_file();
+    return -4;
+  }
+  return 0;
+}
+
+void MediaIndex::close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (append_) {
+    fclose(append_);
+    append_ = nullptr;
+  }
+  unmap_file();
+}
+
+bool MediaIndex::lookup(const char* path, long long mtime, long long size, MediaIndexRecordType type,
+  std::vector<uint8_t>& out) {
+  if (!path || !is_known_type(type)) return false;
+  size_t path_size = strlen(path);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!append_) return false;
+
+  auto it = slots_.find(fnv1a64(path, path_size));
+  if (it == slots_.end() || it->second.offsets[type - 1] == 0) return false;
+
+  const uint8_t* record = record_at(it->second.offsets[type - 1]);
+  RecordHeader h = read_header(record);
+  if (h.mtime != mtime || h.size != size || h.path_size != path_size) return false;
+  if (memcmp(record + sizeof(h), path, path_size) != 0) return false;
+
+  const uint8_t* payload = record + sizeof(h) + path_size;
+  out.assign(payload, payload + h.payload_size);
+  return true;
+}
+
+void MediaIndex::store(const char* path, long long mtime, long long size, MediaIndexRecordType type,
+  const void* data, size_t data_size) {
+  if (!path || !is_known_type(type)) return;
+
+  std::vector<uint8_t> record = build_record(path, mtime, size, type, data, data_size);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!append_) return;
+
+  // 写入失败时不更新内存表，避免与文件内容不一致
+  if (fwrite(record.data(), 1, record.size(), append_) != record.size() || fflush(append_) != 0) return;
+
+  uint64_t offset = mapped_size_ + tail_.size();
+  tail_.insert(tail_.end(), record.begin(), record.end());
+
+  uint64_t& slot = slots_[read_header(record.data()).path_hash].offsets[type - 1];
+  if (slot != 0) live_bytes_ -= record_total_size(read_header(record_at(slot)));
+  slot = offset;
+  live_bytes_ += record.size();
+}
+
+// =================================================================
+// 导出接口
+// =================================================================
+DLLEXPORT int media_index_open(const char* index_path) {
+  return MediaIndex::instance().open(index_path);
+}
+
+DLLEXPORT void media_index_close() {
+  MediaIndex::instance().close();
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "../common.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// =================================================================
+// 持久化媒体索引 (进程内共享，跨进程启动保留)
+//
+// 保存探测结果、关键帧列表等"只取决于文件内容"的数据，
+// 冷启动时只需 mmap 一次文件并建立内存表，之后的查询不再打开视频。
+//
+// - 键: 路径 + mtime + size (与 MediaCache 相同)，文件被修改后旧记录自动失效
+// - 文件是只追加的记录日志，同一路径同一类型的后写记录覆盖先写的
+// - 打开时跳过尾部写了一半的记录；失效记录过多时重写文件 (压缩)
+// - 未调用 media_index_open 时所有查询都未命中，写入被忽略
+// =================================================================
+
+enum MediaIndexRecordType : uint32_t {
+  MEDIA_INDEX_VIDEO_INFO = 1,  // VideoInfoResult
+  MEDIA_INDEX_KEYFRAMES = 2,   // int32 time_base.num, int32 time_base.den, int64 pts[]
+  MEDIA_INDEX_FINGERPRINT = 3, // int32 采样帧数, int32 算法版本, uint64 hash[] (fingerprint/VideoFingerprint.h)
+};
+
+class MediaIndex {
+public:
+  static MediaIndex& instance();
+
+  /**
+   * @brief 打开 (不存在时创建) 索引文件。已打开时先关闭旧文件。
+   * @return 0 成功；小于 0 表示无法打开或创建。
+   */
+  int open(const char* index_path);
+  void close();
+
+  /**
+   * @brief 查询记录。mtime / size 与写入时不一致视为未命中。
+   */
+  bool lookup(const char* path, long long mtime, long long size, MediaIndexRecordType type,
+    std::vector<uint8_t>& out);
+
+  /**
+   * @brief 追加记录 (立即写入文件)。
+   */
+  void store(const char* path, long long mtime, long long size, MediaIndexRecordType type,
+    const void* data, size_t data_size);
+
+private:
+  MediaIndex() = default;
+
+  struct Slot {
+    uint64_t offsets[3] = { 0, 0, 0 }; // 按记录类型，0 = 无
+  };
+
+  bool map_file();
+  void unmap_file();
+  size_t scan_records(); // 返回有效数据的末尾偏移
+  bool compact();
+  const uint8_t* record_at(uint64_t offset) const;
+
+  std::mutex mutex_;
+  std::string path_;
+  std::FILE* append_ = nullptr;
+
+  // 打开时映射的文件内容，之后追加的记录保存在 tail_ (与文件内容一致)
+  MappedFile mapping_;
+  const uint8_t* mapped_ = nullptr;
+  size_t mapped_size_ = 0;
+  std::vector<uint8_t> tail_;
+
+  std::unordered_map<uint64_t, Slot> slots_;
+  size_t live_bytes_ = 0;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /**
+   * @brief 打开持久化媒体索引 (应用启动时调用一次)。元数据、关键帧、截图调用会先查询它。
+   * @param index_path 索引文件路径 (UTF-8)
+   * @return 0 成功；小于 0 表示失败 (此时各接口照常工作，只是不使用索引)
+   */
+  DLLEXPORT int media_index_open(const char* index_path);
+
+  /**
+   * @brief 关闭媒体索引。
+   */
+  DLLEXPORT void media_index_close();
+
+#ifdef __cplusplus
+}
+#endif
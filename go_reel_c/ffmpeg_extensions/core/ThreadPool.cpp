@@ -0,0 +1,219 @@
+#include "ThreadPool.h"
+#include "Job.h"
+#include <algorithm>
+#include <thread>
+
+// 当前线程在池中的编号，非工作线程为 -1
+static thread_local int t_worker_index = -1;
+
+// 当前线程正在执行的任务的优先级 (决定等待时可以协助执行哪些全局任务)
+static thread_local int t_task_priority = TASK_PRIORITY_INTERACTIVE;
+
+static int default_budget() {
+  int cores = (int)std::thread::hardware_concurrency();
+  return cores > 0 ? cores : 4;
+}
+
+ThreadPool& ThreadPool::instance() {
+  // 有意泄漏: 工作线程是分离的，DLL 卸载时不能在静态析构中等待它们
+  static ThreadPool* pool = new ThreadPool();
+  return *pool;
+}
+
+ThreadPool::ThreadPool() {
+  budget_ = (std::min)(default_budget(), kMaxWorkers);
+}
+
+void ThreadPool::set_cpu_budget(int threads) {
+  if (threads <= 0) threads = default_budget();
+  budget_ = (std::min)(threads, kMaxWorkers);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ensure_workers();
+  }
+  cv_.notify_all();
+}
+
+int ThreadPool::decoder_threads() const {
+  int budget = (std::max)(budget_.load() - reserved_.load(), 1);
+  int busy = (std::max)(running_.load(), 1);
+  int share = (std::max)(budget / busy, 1);
+
+  int threads = 1;
+  while (threads * 2 <= share && threads < 16) threads *= 2;
+  return threads;
+}
+
+int ThreadPool::reserve_threads(int wanted) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  int available = budget_.load() - reserved_.load() - 1; // 至少留一个线程给交互任务
+  int granted = (std::max)((std::min)(wanted, available), 1);
+  reserved_ += granted;
+  return granted;
+}
+
+void ThreadPool::release_threads(int count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  reserved_ -= count;
+}
+
+// 调用方持有 mutex_
+void ThreadPool::ensure_workers() {
+  int budget = budget_.load();
+  for (int i = worker_count_.load(); i < budget; i++) {
+    workers_[i].reset(new Worker());
+    worker_count_ = i + 1;
+    std::thread([this, i]() { worker_loop(i); }).detach();
+  }
+}
+
+void ThreadPool::submit(std::function<void()> fn, int priority) {
+  Task task;
+  // 子任务只属于提交者所在的异步任务 (取消标记与进度)，没有任务时也要设置:
+  // 等待中协助执行的线程可能正处于另一个任务中，不能让子任务继承它的任务
+  JobControl* job = JobControl::current();
+  task.fn = [job, fn = std::move(fn)]() {
+    JobScope scope(job);
+    fn();
+  };
+
+  int self = t_worker_index;
+  if (self >= 0) {
+    // 工作线程内的子任务: 放入本线程队列，由本线程或窃取者执行。后台任务的子任务也是后台工作
+    task.priority = (std::max)(priority, t_task_priority);
+    {
+      std::lock_guard<std::mutex> lock(workers_[self]->mutex);
+      workers_[self]->local.push_back(std::move(task));
+    }
+    pending_local_++;
+    // 与空闲线程的条件检查同步，避免丢失唤醒
+    std::lock_guard<std::mutex> lock(mutex_);
+  }
+  else {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ensure_workers();
+    task.priority = priority == TASK_PRIORITY_BACKGROUND ? TASK_PRIORITY_BACKGROUND : TASK_PRIORITY_INTERACTIVE;
+    if (task.priority == TASK_PRIORITY_BACKGROUND) background_.push_back(std::move(task));
+    else interactive_.push_back(std::move(task));
+    if (waiters_ > 0) progress_cv_.notify_all();
+  }
+  cv_.notify_one();
+}
+
+// 调用方持有 mutex_；只有 max_priority 允许后台任务时才检查后台队列，后台名额用完时排队的后台任务不算可执行
+bool ThreadPool::has_global_task_locked(int max_priority) const {
+  if (!interactive_.empty()) return true;
+  return max_priority >= TASK_PRIORITY_BACKGROUND && !background_.empty() &&
+    running_background_ < (std::max)(budget_.load() - 1, 1);
+}
+
+// 取任务顺序: 本线程队列 (队尾) -> 全局交互队列 -> 全局后台队列 -> 窃取其它线程 (队首)
+// helping: 等待中协助执行，只取本线程队列与优先级不低于当前任务的全局任务，不窃取
+bool ThreadPool::take_task(int self, Task& task, bool helping) {
+  if (self >= 0) {
+    std::lock_guard<std::mutex> lock(workers_[self]->mutex);
+    if (!workers_[self]->local.empty()) {
+      task = std::move(workers_[self]->local.back());
+      workers_[self]->local.pop_back();
+      pending_local_--;
+      return true;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!interactive_.empty()) {
+      task = std::move(interactive_.front());
+      interactive_.pop_front();
+      return true;
+    }
+    if (has_global_task_locked(helping ? t_task_priority : TASK_PRIORITY_BACKGROUND)) {
+      task = std::move(background_.front());
+      background_.pop_front();
+      running_background_++;
+      task.background_slot = true;
+      return true;
+    }
+  }
+  if (helping) return false;
+
+  int count = worker_count_.load();
+  for (int n = 1; n <= count; n++) {
+    int victim = (self + n + count) % count;
+    if (victim == self) continue;
+
+    std::lock_guard<std::mutex> lock(workers_[victim]->mutex);
+    if (!workers_[victim]->local.empty()) {
+      task = std::move(workers_[victim]->local.front());
+      workers_[victim]->local.pop_front();
+      pending_local_--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::run_task(Task& task) {
+  int previous_priority = t_task_priority;
+  t_task_priority = task.priority;
+  running_++;
+  task.fn();
+  running_--;
+  t_task_priority = previous_priority;
+
+  // 计数在锁内递增: wait_for_progress 在锁内比较，不会错过唤醒
+  bool notify_waiters;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    completed_++;
+    if (task.background_slot) running_background_--;
+    notify_waiters = waiters_ > 0;
+  }
+  if (task.background_slot) cv_.notify_one(); // 后台名额释放
+  if (notify_waiters) progress_cv_.notify_all();
+}
+
+bool ThreadPool::run_pending_task() {
+  Task task;
+  if (!take_task(t_worker_index, task, true)) return false;
+  run_task(task);
+  return true;
+}
+
+// 阻塞到 seen 之后有任务完成，或出现当前线程可以协助执行的全局任务。
+// 本线程队列在等待期间不会增加 (只有本线程向其中提交)，不需要检查
+void ThreadPool::wait_for_progress(unsigned long long seen) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  waiters_++;
+  progress_cv_.wait(lock, [&]() { return completed_.load() != seen || has_global_task_locked(t_task_priority); });
+  waiters_--;
+}
+
+void ThreadPool::worker_loop(int index) {
+  t_worker_index = index;
+
+  for (;;) {
+    Task task;
+    bool found = index < budget_.load() && take_task(index, task, false);
+
+    if (!found) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait_for(lock, std::chrono::milliseconds(100), [&]() {
+        return index < budget_.load() && (has_global_task_locked(TASK_PRIORITY_BACKGROUND) || pending_local_.load() > 0);
+      });
+      continue;
+    }
+    run_task(task);
+  }
+}
+
+// =================================================================
+// 导出接口
+// =================================================================
+DLLEXPORT void thread_pool_configure(int cpu_budget) {
+  ThreadPool::instance().set_cpu_budget(cpu_budget);
+}
+
+DLLEXPORT int thread_pool_cpu_budget() {
+  return ThreadPool::instance().cpu_budget();
+}
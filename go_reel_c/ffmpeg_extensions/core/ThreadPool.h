@@ -0,0 +1,137 @@
+#pragma once
+
+#include "../common.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+
+// =================================================================
+// 进程内共享的工作线程池
+//
+// 所有导出函数的并行任务 (批量截图的编码、多视频截图、并行解码器等)
+// 都提交到这里，而不是各自 std::async 创建线程。
+//
+// - 线程总数受 CPU 预算限制 (默认 = 逻辑核数)，可通过 thread_pool_configure 调整
+// - 工作线程内提交的子任务进入本线程的双端队列 (LIFO 执行)，空闲线程从其它线程队首窃取
+// - 外部提交的任务按优先级排队: 后台任务最多占用 预算 - 1 个线程，
+//   保证交互任务 (界面上的单张缩略图) 总有线程可用
+// - 等待任务结果时调用 wait()，等待期间只协助执行本线程提交的子任务 (避免嵌套等待死锁)
+//   和优先级不低于当前任务的全局任务，没有可执行的任务时阻塞到有任务完成。
+//   交互调用不会在等待时顺带执行整批后台任务
+// =================================================================
+
+enum TaskPriority {
+  TASK_PRIORITY_INTERACTIVE = 0,
+  TASK_PRIORITY_BACKGROUND = 1,
+};
+
+class ThreadPool {
+public:
+  static ThreadPool& instance();
+
+  void submit(std::function<void()> task, int priority = TASK_PRIORITY_INTERACTIVE);
+
+  // 提交任务并返回 future (结果通过 wait() 取得)
+  template <class F>
+  auto async(int priority, F&& f) -> std::future<decltype(f())> {
+    using R = decltype(f());
+    auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+    std::future<R> result = task->get_future();
+    submit([task]() { (*task)(); }, priority);
+    return result;
+  }
+
+  // 等待 future 完成，期间协助执行排队任务
+  template <class T>
+  T wait(std::future<T>& future) {
+    wait_until([&]() { return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; });
+    return future.get();
+  }
+
+  // 等待 done() 为 true (只能由池中任务的完成使其成立)，期间协助执行排队任务
+  template <class Pred>
+  void wait_until(Pred done) {
+    for (;;) {
+      unsigned long long seen = completed_.load();
+      if (done()) return;
+      if (!run_pending_task()) wait_for_progress(seen);
+    }
+  }
+
+  // 在当前线程协助执行一个排队任务: 本线程队列中的子任务，或优先级不低于当前任务的全局任务
+  // (非池线程按交互优先级)。没有可执行的任务时返回 false
+  bool run_pending_task();
+
+  // 线程总预算 (<= 0 表示逻辑核数)
+  void set_cpu_budget(int threads);
+  int cpu_budget() const { return budget_.load(); }
+
+  // 解码器线程数: 按预算与正在执行的任务数分配，取 2 的幂以减少缓存解码器的重新打开
+  int decoder_threads() const;
+
+  // 长时间占用多个核、但不在池中执行的工作 (转码流水线的编解码线程) 从预算中预留线程。
+  // 返回实际分到的数量: 总预留尽量不超过 预算 - 1，但每次至少 1；预留部分不再参与 decoder_threads 的分配
+  int reserve_threads(int wanted);
+  void release_threads(int count);
+
+private:
+  static const int kMaxWorkers = 64;
+
+  struct Task {
+    std::function<void()> fn;
+    int priority = TASK_PRIORITY_INTERACTIVE;
+    bool background_slot = false; // 从全局后台队列取出，执行完需归还名额
+  };
+
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> local;
+  };
+
+  ThreadPool();
+  void ensure_workers();
+  void worker_loop(int index);
+  bool take_task(int self, Task& task, bool helping);
+  bool has_global_task_locked(int max_priority) const;
+  void run_task(Task& task);
+  void wait_for_progress(unsigned long long seen);
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::condition_variable progress_cv_; // 任务完成或有新的全局任务时唤醒 wait_until
+  int waiters_ = 0;
+  std::deque<Task> interactive_;
+  std::deque<Task> background_;
+  int running_background_ = 0;
+
+  std::unique_ptr<Worker> workers_[kMaxWorkers];
+  std::atomic<int> worker_count_{ 0 };
+  std::atomic<int> budget_{ 0 };
+  std::atomic<int> reserved_{ 0 };
+  std::atomic<int> running_{ 0 };
+  std::atomic<int> pending_local_{ 0 }; // 各工作线程本地队列中的任务总数
+  std::atomic<unsigned long long> completed_{ 0 };
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /**
+   * @brief 设置库内线程池的 CPU 预算 (工作线程 + 解码线程的总量)。
+   * @param cpu_budget 线程数，小于等于 0 表示使用逻辑核数。
+   */
+  DLLEXPORT void thread_pool_configure(int cpu_budget);
+
+  /**
+   * @brief 当前 CPU 预算。
+   */
+  DLLEXPORT int thread_pool_cpu_budget();
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,173 @@
+#include "FastHash.h"
+#include "../core/IoBatch.h"
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// 与 hash.ts 的 CONFIG 一致
+static const long long kThreshold = 10 * 1024;
+static const long long kBlockSize = 2 * 1024;
+
+static const uint64_t kFnvOffset = 0xcbf29ce484222325ULL;
+static const uint64_t kFnvPrime = 0x100000001b3ULL;
+
+static uint64_t fnv1a64(const uint8_t* data, size_t size, uint64_t hash = kFnvOffset) {
+  for (size_t i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash *= kFnvPrime;
+  }
+  return hash;
+}
+
+// =================================================================
+// 定位读取 (不移动文件指针，多个线程可以同时读取不同文件)
+// =================================================================
+class HashFile {
+public:
+  explicit HashFile(const char* path) {
+#ifdef _WIN32
+    std::wstring wpath = fs::u8path(path).wstring();
+    handle_ = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+      NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+#else
+    fd_ = open(path, O_RDONLY);
+#endif
+  }
+
+  ~HashFile() {
+#ifdef _WIN32
+    if (handle_ != INVALID_HANDLE_VALUE) CloseHandle(handle_);
+#else
+    if (fd_ >= 0) close(fd_);
+#endif
+  }
+
+  bool is_open() const {
+#ifdef _WIN32
+    return handle_ != INVALID_HANDLE_VALUE;
+#else
+    return fd_ >= 0;
+#endif
+  }
+
+  bool size(long long& out) const {
+#ifdef _WIN32
+    LARGE_INTEGER li;
+    if (!GetFileSizeEx(handle_, &li)) return false;
+    out = li.QuadPart;
+#else
+    struct stat st;
+    if (fstat(fd_, &st) != 0) return false;
+    out = (long long)st.st_size;
+#endif
+    return true;
+  }
+
+  // 读到末尾时允许少读 (与 Node 的 fileHandle.read 一致，未读到的部分保持为 0)
+  bool read_at(uint8_t* buffer, long long length, long long offset) const {
+#ifdef _WIN32
+    OVERLAPPED ov = {};
+    ov.Offset = (DWORD)(offset & 0xFFFFFFFF);
+    ov.OffsetHigh = (DWORD)(offset >> 32);
+    DWORD read = 0;
+    if (!ReadFile(handle_, buffer, (DWORD)length, &read, &ov)) {
+      return GetLastError() == ERROR_HANDLE_EOF;
+    }
+    return true;
+#else
+    while (length > 0) {
+      ssize_t n = pread(fd_, buffer, (size_t)length, (off_t)offset);
+      if (n < 0) return false;
+      if (n == 0) break;
+      buffer += n;
+      length -= n;
+      offset += n;
+    }
+    return true;
+#endif
+  }
+
+private:
+#ifdef _WIN32
+  HANDLE handle_ = INVALID_HANDLE_VALUE;
+#else
+  int fd_ = -1;
+#endif
+};
+
+// =================================================================
+// 导出接口
+// =================================================================
+DLLEXPORT int fast_hash_file(const char* path, unsigned long long* out_hash) {
+  if (!path || !out_hash) return -1;
+
+  HashFile file(path);
+  long long file_size = 0;
+  if (!file.is_open() || !file.size(file_size)) return -1;
+
+  uint8_t buffer[kBlockSize * 3] = {};
+  std::vector<uint8_t> small;
+  const uint8_t* data = buffer;
+  size_t data_size = sizeof(buffer);
+
+  if (file_size < kThreshold) {
+    // 小文件: 读取全部内容
+    small.assign((size_t)file_size, 0);
+    if (file_size > 0 && !file.read_at(small.data(), file_size, 0)) return -2;
+    data = small.data();
+    data_size = small.size();
+  }
+  else {
+    // 大文件: 头 + 中 + 尾
+    long long mid_offset = file_size / 2 - kBlockSize / 2;
+    long long tail_offset = file_size - kBlockSize;
+    if (!file.read_at(buffer, kBlockSize, 0) ||
+      !file.read_at(buffer + kBlockSize, kBlockSize, mid_offset) ||
+      !file.read_at(buffer + kBlockSize * 2, kBlockSize, tail_offset)) {
+      return -2;
+    }
+  }
+
+  uint64_t hash = fnv1a64(data, data_size);
+
+  // 混入文件大小 (8 字节小端)
+  uint8_t size_bytes[8];
+  for (int i = 0; i < 8; i++) size_bytes[i] = (uint8_t)(((unsigned long long)file_size >> (i * 8)) & 0xFF);
+  hash = fnv1a64(size_bytes, sizeof(size_bytes), hash);
+
+  *out_hash = hash;
+  return 0;
+}
+
+DLLEXPORT int fast_hash_batch(const char* const* paths, int count, unsigned long long* out_hashes, int* out_status,
+  int queue_depth, FastHashProgressCallback progress) {
+  if (!paths || !out_hashes || count < 0) return -1;
+  if (count == 0) return 0;
+
+  if (queue_depth <= 0) queue_depth = storage_queue_depth(paths[0]);
+
+  std::atomic<int> succeeded{ 0 };
+  run_io_batch(count, queue_depth, [&](int i) {
+    int status = paths[i] ? fast_hash_file(paths[i], &out_hashes[i]) : -1;
+    if (status != 0) out_hashes[i] = 0;
+    else succeeded++;
+    if (out_status) out_status[i] = status;
+    }, [&](int processed, int total, int last_index) {
+      if (progress) progress(processed, total, last_index);
+    });
+
+  return succeeded.load();
+}
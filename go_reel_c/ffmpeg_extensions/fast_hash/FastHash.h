@@ -0,0 +1,54 @@
+// fast_hash/FastHash.h
+#pragma once
+
+#include "../common.h"
+
+// =================================================================
+// 文件快速指纹 (与 src/main/utils/hash.ts 的 calculateFastHash 逐位一致)
+//
+//   文件 < 10KB : FNV-1a 64 (整个文件)
+//   文件 >= 10KB: FNV-1a 64 (头 2KB + 中间 2KB + 尾 2KB)
+//   再以该值为种子，对 8 字节小端文件大小继续 FNV-1a 64
+//
+// 批量版本用多个 I/O 线程同时发出定位读取，队列深度按存储介质选择 (见 core/IoBatch.h)。
+// =================================================================
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  // 进度回调，只在调用 fast_hash_batch 的线程上触发；last_index 为最近完成的文件下标 (并发读取，完成顺序不定)
+  typedef void (*FastHashProgressCallback)(int processed, int total, int last_index);
+
+  /**
+   * @brief 计算单个文件的快速指纹。
+   * @param path      文件路径 (UTF-8)
+   * @param out_hash  [输出] 64 位指纹
+   * @return 0 成功；小于 0 表示无法打开或读取
+   */
+  DLLEXPORT int fast_hash_file(const char* path, unsigned long long* out_hash);
+
+  /**
+   * @brief 批量计算快速指纹。
+   *
+   * @param paths        文件路径数组 (UTF-8)
+   * @param count        文件数量
+   * @param out_hashes   [输出] 长度为 count 的指纹数组
+   * @param out_status   [输出] 长度为 count，0 = 成功，小于 0 = 该文件失败 (可为 NULL)
+   * @param queue_depth  同时进行的读取数，0 = 按第一个文件所在磁盘自动选择 (HDD 2，SSD 32)
+   * @param progress     进度回调 (可为 NULL)，大约每 1% 调用一次
+   *
+   * @return 成功的文件数；小于 0 表示参数错误
+   */
+  DLLEXPORT int fast_hash_batch(
+    const char* const* paths,
+    int count,
+    unsigned long long* out_hashes,
+    int* out_status,
+    int queue_depth,
+    FastHashProgressCallback progress
+  );
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,292 @@
+#include "FileScanner.h"
+#include "../core/ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef _WIN32
+static const char kSeparator = '\\';
+#else
+static const char kSeparator = '/';
+#endif
+
+// 与 src/main/utils/videoUtils.ts 的 VIDEO_EXTENSIONS 一致 (调用方未传入时使用)
+static const char* const kDefaultExtensions[] = {
+  ".mp4", ".mkv", ".avi", ".mov", ".wmv", ".flv", ".webm",
+  ".m4v", ".mpg", ".mpeg", ".3gp", ".ts", ".mts", ".m2ts",
+};
+
+struct FileScanResult {
+  std::vector<std::string> paths;
+  std::vector<ScannedFile> entries;
+};
+
+struct FoundFile {
+  std::string path;
+  double created_ms;
+  double mtime_ms;
+  long long size;
+};
+
+static std::string to_lower_ascii(std::string s) {
+  for (char& c : s) {
+    if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+  }
+  return s;
+}
+
+static std::string join_path(const std::string& dir, const std::string& name) {
+  if (!dir.empty() && (dir.back() == '/' || dir.back() == '\\')) return dir + name;
+  return dir + kSeparator + name;
+}
+
+// 扩展名 (与 path.extname 相同: 最后一个点之后，以点开头的文件名没有扩展名)
+static bool has_extension(const std::string& name, const std::unordered_set<std::string>& extensions) {
+  size_t dot = name.find_last_of('.');
+  if (dot == std::string::npos || dot == 0) return false;
+  return extensions.count(to_lower_ascii(name.substr(dot))) > 0;
+}
+
+// =================================================================
+// 黑名单前缀树: 目录路径 (小写) 以任一条目开头即排除
+// =================================================================
+class PrefixTrie {
+public:
+  PrefixTrie() : nodes_(1) {}
+
+  void insert(const std::string& key) {
+    if (key.empty()) return;
+    int node = 0;
+    for (unsigned char c : key) {
+      auto it = nodes_[node].children.find(c);
+      if (it == nodes_[node].children.end()) {
+        int child = (int)nodes_.size();
+        nodes_[node].children[c] = child;
+        nodes_.emplace_back();
+        node = child;
+      }
+      else {
+        node = it->second;
+      }
+    }
+    nodes_[node].terminal = true;
+  }
+
+  bool matches_prefix_of(const std::string& s) const {
+    int node = 0;
+    for (unsigned char c : s) {
+      auto it = nodes_[node].children.find(c);
+      if (it == nodes_[node].children.end()) return false;
+      node = it->second;
+      if (nodes_[node].terminal) return true;
+    }
+    return false;
+  }
+
+  bool empty() const { return nodes_.size() == 1; }
+
+private:
+  struct Node {
+    std::map<unsigned char, int> children;
+    bool terminal = false;
+  };
+  std::vector<Node> nodes_;
+};
+
+// 一次扫描共享的状态
+struct ScanContext {
+  std::unordered_set<std::string> extensions;
+  PrefixTrie blacklist;
+
+  std::mutex mutex;
+  std::vector<FoundFile> files;
+  std::atomic<int> outstanding{ 0 }; // 未完成的目录任务数
+};
+
+static void scan_directory(ScanContext* ctx, std::string dir);
+
+static void submit_directory(ScanContext* ctx, std::string dir) {
+  ctx->outstanding++;
+  ThreadPool::instance().submit([ctx, dir]() {
+    scan_directory(ctx, dir);
+    ctx->outstanding--;
+    }, TASK_PRIORITY_INTERACTIVE);
+}
+
+#ifdef _WIN32
+static std::string wide_to_utf8(const wchar_t* s) {
+  int len = WideCharToMultiByte(CP_UTF8, 0, s, -1, NULL, 0, NULL, NULL);
+  if (len <= 1) return std::string();
+  std::string out((size_t)len - 1, '\0');
+  WideCharToMultiByte(CP_UTF8, 0, s, -1, &out[0], len, NULL, NULL);
+  return out;
+}
+
+// FILETIME (1601 起的 100ns) -> Unix 毫秒
+static double filetime_to_ms(const FILETIME& ft) {
+  ULARGE_INTEGER v;
+  v.LowPart = ft.dwLowDateTime;
+  v.HighPart = ft.dwHighDateTime;
+  return (double)((long long)v.QuadPart - 116444736000000000LL) / 10000.0;
+}
+#else
+static double timespec_ms(long long sec, long long nsec) {
+  return (double)sec * 1000.0 + (double)nsec / 1e6;
+}
+#endif
+
+static void scan_directory(ScanContext* ctx, std::string dir) {
+  if (!ctx->blacklist.empty() && ctx->blacklist.matches_prefix_of(to_lower_ascii(dir))) return;
+
+  std::vector<FoundFile> found;
+
+#ifdef _WIN32
+  std::wstring pattern = fs::u8path(dir).wstring();
+  if (!pattern.empty() && pattern.back() != L'\\' && pattern.back() != L'/') pattern += L'\\';
+  pattern += L'*';
+  if (pattern.size() >= MAX_PATH && pattern.compare(0, 4, L"\\\\?\\") != 0) {
+    for (wchar_t& c : pattern) if (c == L'/') c = L'\\';
+    pattern = L"\\\\?\\" + pattern;
+  }
+
+  // FindExInfoBasic 不取 8.3 短文件名，LARGE_FETCH 一次读取更多目录项
+  WIN32_FIND_DATAW data;
+  HANDLE find = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, NULL,
+    FIND_FIRST_EX_LARGE_FETCH);
+  if (find == INVALID_HANDLE_VALUE) return;
+
+  do {
+    const wchar_t* name = data.cFileName;
+    if (name[0] == L'.' && (name[1] == 0 || (name[1] == L'.' && name[2] == 0))) continue;
+
+    // 符号链接 / 目录联接 (Node 视为 symlink，不跟随)
+    if ((data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) &&
+      (data.dwReserved0 == IO_REPARSE_TAG_SYMLINK || data.dwReserved0 == IO_REPARSE_TAG_MOUNT_POINT)) {
+      continue;
+    }
+
+    std::string utf8_name = wide_to_utf8(name);
+    if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+      submit_directory(ctx, join_path(dir, utf8_name));
+    }
+    else if (has_extension(utf8_name, ctx->extensions)) {
+      ULARGE_INTEGER size;
+      size.LowPart = data.nFileSizeLow;
+      size.HighPart = data.nFileSizeHigh;
+      found.push_back({ join_path(dir, utf8_name), filetime_to_ms(data.ftCreationTime),
+        filetime_to_ms(data.ftLastWriteTime), (long long)size.QuadPart });
+    }
+  } while (FindNextFileW(find, &data));
+  FindClose(find);
+#else
+  DIR* d = opendir(dir.c_str());
+  if (!d) return;
+  int dfd = dirfd(d);
+
+  while (struct dirent* entry = readdir(d)) {
+    const char* name = entry->d_name;
+    if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) continue;
+
+    unsigned char type = entry->d_type;
+    if (type == DT_UNKNOWN) {
+      // 部分文件系统不提供 d_type，退回 lstat
+      struct stat st;
+      if (fstatat(dfd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+      type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+    }
+
+    if (type == DT_DIR) {
+      submit_directory(ctx, join_path(dir, name));
+    }
+    else if (type == DT_REG && has_extension(name, ctx->extensions)) {
+#ifdef STATX_BTIME
+      struct statx stx;
+      if (statx(dfd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, STATX_SIZE | STATX_MTIME | STATX_BTIME | STATX_CTIME, &stx) != 0) continue;
+      double created = (stx.stx_mask & STATX_BTIME)
+        ? timespec_ms(stx.stx_btime.tv_sec, stx.stx_btime.tv_nsec)
+        : timespec_ms(stx.stx_ctime.tv_sec, stx.stx_ctime.tv_nsec);
+      found.push_back({ join_path(dir, name), created,
+        timespec_ms(stx.stx_mtime.tv_sec, stx.stx_mtime.tv_nsec), (long long)stx.stx_size });
+#else
+      struct stat st;
+      if (fstatat(dfd, name, &st, 0) != 0) continue;
+      found.push_back({ join_path(dir, name), timespec_ms(st.st_ctim.tv_sec, st.st_ctim.tv_nsec),
+        timespec_ms(st.st_mtim.tv_sec, st.st_mtim.tv_nsec), (long long)st.st_size });
+#endif
+    }
+  }
+  closedir(d);
+#endif
+
+  if (!found.empty()) {
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+    for (auto& f : found) ctx->files.push_back(std::move(f));
+  }
+}
+
+// =================================================================
+// 导出接口
+// =================================================================
+DLLEXPORT FileScanResult* scan_video_files(const char* root_dir, const char* const* blacklist, int blacklist_count,
+  const char* const* extensions, int extension_count) {
+  FileScanResult* result = new FileScanResult();
+  if (!root_dir || !root_dir[0]) return result;
+
+  ScanContext ctx;
+  if (extensions && extension_count > 0) {
+    for (int i = 0; i < extension_count; i++) {
+      if (extensions[i]) ctx.extensions.insert(to_lower_ascii(extensions[i]));
+    }
+  }
+  else {
+    for (const char* ext : kDefaultExtensions) ctx.extensions.insert(ext);
+  }
+  for (int i = 0; blacklist && i < blacklist_count; i++) {
+    if (blacklist[i]) ctx.blacklist.insert(to_lower_ascii(blacklist[i]));
+  }
+
+  // 调用线程也参与执行目录任务，直到全部完成
+  ThreadPool& pool = ThreadPool::instance();
+  submit_directory(&ctx, root_dir);
+  pool.wait_until([&ctx]() { return ctx.outstanding.load() == 0; });
+
+  result->paths.reserve(ctx.files.size());
+  result->entries.reserve(ctx.files.size());
+  for (auto& f : ctx.files) result->paths.push_back(std::move(f.path));
+  for (size_t i = 0; i < ctx.files.size(); i++) {
+    const FoundFile& f = ctx.files[i];
+    result->entries.push_back({ result->paths[i].c_str(), f.created_ms, f.mtime_ms, f.size });
+  }
+  return result;
+}
+
+DLLEXPORT int file_scan_count(const FileScanResult* result) {
+  return result ? (int)result->entries.size() : 0;
+}
+
+DLLEXPORT const ScannedFile* file_scan_entries(const FileScanResult* result, int offset) {
+  if (!result || offset < 0 || offset >= (int)result->entries.size()) return nullptr;
+  return result->entries.data() + offset;
+}
+
+DLLEXPORT void file_scan_free(FileScanResult* result) {
+  delete result;
+}
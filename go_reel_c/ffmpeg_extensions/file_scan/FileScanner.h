@@ -0,0 +1,65 @@
+// file_scan/FileScanner.h
+#pragma once
+
+#include "../common.h"
+
+// =================================================================
+// 视频文件目录扫描 (替代 src/main/utils/fileScanner.ts)
+//
+// - 每个目录是共享线程池中的一个任务，子目录任务进入本线程队列，空闲线程窃取
+// - Windows 上 FindFirstFileEx 直接返回创建时间 / 修改时间 / 大小，不需要逐个 stat；
+//   其它平台使用 d_type 判断类型，只对视频文件做一次 statx (最小掩码)
+// - 扩展名预先编入集合，黑名单编入前缀树 (与 JS 版相同: 小写后按字符串前缀匹配目录)
+// - 符号链接 / 目录联接不跟随 (与 Node 的 Dirent 判断一致)
+// =================================================================
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef struct {
+    const char* path;   // 绝对路径 (UTF-8)，有效期到 file_scan_free
+    double created_ms;  // 创建时间 (Unix 毫秒，同 birthtimeMs)
+    double mtime_ms;    // 修改时间 (Unix 毫秒，同 mtimeMs)
+    long long size;     // 文件大小 (字节)
+  } ScannedFile;
+
+  typedef struct FileScanResult FileScanResult;
+
+  /**
+   * @brief 递归扫描目录下的视频文件。
+   *
+   * @param root_dir         根目录 (UTF-8，调用方应先规范化)
+   * @param blacklist        排除的目录前缀 (UTF-8，调用方应先规范化)，可为 NULL
+   * @param blacklist_count  排除列表长度
+   * @param extensions       视频扩展名 (带点，例如 ".mp4")，NULL 表示内置列表
+   * @param extension_count  扩展名数量
+   *
+   * @return 扫描结果，用完后必须调用 file_scan_free；根目录无法读取时返回空结果
+   */
+  DLLEXPORT FileScanResult* scan_video_files(
+    const char* root_dir,
+    const char* const* blacklist,
+    int blacklist_count,
+    const char* const* extensions,
+    int extension_count
+  );
+
+  /**
+   * @brief 扫描到的文件数。
+   */
+  DLLEXPORT int file_scan_count(const FileScanResult* result);
+
+  /**
+   * @brief 从 offset 开始的连续条目 (调用方可分段读取)，offset 越界时返回 NULL。
+   */
+  DLLEXPORT const ScannedFile* file_scan_entries(const FileScanResult* result, int offset);
+
+  /**
+   * @brief 释放扫描结果。
+   */
+  DLLEXPORT void file_scan_free(FileScanResult* result);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,615 @@
+#include "VideoFingerprint.h"
+#include "../core/IoBatch.h"
+#include "../core/MediaCache.h"
+#include "../core/MediaIndex.h"
+#include "../core/ThreadPool.h"
+#include "../screen_shot/ScreenshotterInternal.h"
+#include "../screen_shot/ScreenshotterPlanner.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define FINGERPRINT_USE_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// 算法有变化时递增，使媒体索引中的旧指纹失效
+static const int kFingerprintVersion = 2; // 2: 固定时间网格 + 精确定位
+
+static const int kHashInput = 32;  // DCT 输入边长
+static const int kHashLowFreq = 8; // 保留的低频系数边长
+
+static const int kDefaultQueryDistance = 8;
+
+// 采样网格的最小间隔；实际间隔为它乘以 2 的幂
+static const long long kGridBaseMs = 1000;
+
+// 一方有效帧数少于该值时，命中比例不可靠 (1-2 帧的视频会与任何含相似画面的视频"完全相同")
+static const int kMinReliableFrames = 4;
+
+static inline int popcount64(uint64_t v) {
+#if defined(_MSC_VER) && defined(_M_X64)
+  return (int)__popcnt64(v);
+#elif defined(__GNUC__)
+  return __builtin_popcountll(v);
+#else
+  int n = 0;
+  for (; v; v &= v - 1) n++;
+  return n;
+#endif
+}
+
+// =================================================================
+// pHash
+// =================================================================
+
+// DCT-II 基的前 8 行 (正交归一化)，每行 32 个系数
+struct DctBasis {
+  alignas(16) float rows[kHashLowFreq][kHashInput];
+
+  DctBasis() {
+    const double pi = 3.14159265358979323846;
+    for (int u = 0; u < kHashLowFreq; u++) {
+      double scale = u == 0 ? std::sqrt(1.0 / kHashInput) : std::sqrt(2.0 / kHashInput);
+      for (int x = 0; x < kHashInput; x++) {
+        rows[u][x] = (float)(scale * std::cos((2 * x + 1) * u * pi / (2 * kHashInput)));
+      }
+    }
+  }
+};
+
+static const DctBasis& dct_basis() {
+  static const DctBasis basis;
+  return basis;
+}
+
+// 只计算低频 8x8: coeffs = B * pixels * B^T，B 为 8x32 的 DCT 基
+static void dct_low_freq(const float* pixels, float* coeffs) {
+  const DctBasis& basis = dct_basis();
+  alignas(16) float rows[kHashLowFreq][kHashInput];
+
+#ifdef FINGERPRINT_USE_SSE2
+  // 1. rows = B * pixels: 每行 32 列用 8 个寄存器累加
+  for (int u = 0; u < kHashLowFreq; u++) {
+    __m128 acc[kHashInput / 4];
+    for (int j = 0; j < kHashInput / 4; j++) acc[j] = _mm_setzero_ps();
+    for (int y = 0; y < kHashInput; y++) {
+      __m128 b = _mm_set1_ps(basis.rows[u][y]);
+      const float* src = pixels + y * kHashInput;
+      for (int j = 0; j < kHashInput / 4; j++) acc[j] = _mm_add_ps(acc[j], _mm_mul_ps(b, _mm_load_ps(src + j * 4)));
+    }
+    for (int j = 0; j < kHashInput / 4; j++) _mm_store_ps(rows[u] + j * 4, acc[j]);
+  }
+
+  // 2. coeffs = rows * B^T: 32 元点积
+  for (int u = 0; u < kHashLowFreq; u++) {
+    for (int v = 0; v < kHashLowFreq; v++) {
+      __m128 acc = _mm_setzero_ps();
+      for (int j = 0; j < kHashInput; j += 4) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(rows[u] + j), _mm_load_ps(basis.rows[v] + j)));
+      }
+      acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+      acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+      coeffs[u * kHashLowFreq + v] = _mm_cvtss_f32(acc);
+    }
+  }
+#else
+  for (int u = 0; u < kHashLowFreq; u++) {
+    for (int x = 0; x < kHashInput; x++) rows[u][x] = 0.0f;
+    for (int y = 0; y < kHashInput; y++) {
+      float b = basis.rows[u][y];
+      const float* src = pixels + y * kHashInput;
+      for (int x = 0; x < kHashInput; x++) rows[u][x] += b * src[x];
+    }
+  }
+  for (int u = 0; u < kHashLowFreq; u++) {
+    for (int v = 0; v < kHashLowFreq; v++) {
+      float sum = 0.0f;
+      for (int x = 0; x < kHashInput; x++) sum += rows[u][x] * basis.rows[v][x];
+      coeffs[u * kHashLowFreq + v] = sum;
+    }
+  }
+#endif
+}
+
+// 计算一帧的哈希；无内容的帧返回 false
+static bool hash_frame(SwsContext** sws, const AVFrame* frame, uint64_t* out_hash) {
+  *sws = sws_getCachedContext(*sws,
+    frame->width, frame->height, (AVPixelFormat)frame->format,
+    kHashInput, kHashInput, AV_PIX_FMT_GRAY8,
+    SWS_AREA, NULL, NULL, NULL);
+  if (!*sws) return false;
+
+  alignas(16) uint8_t gray[kHashInput * kHashInput];
+  uint8_t* dst[4] = { gray, nullptr, nullptr, nullptr };
+  int dst_linesize[4] = { kHashInput, 0, 0, 0 };
+  if (sws_scale(*sws, frame->data, frame->linesize, 0, frame->height, dst, dst_linesize) <= 0) return false;
+
+  if (!luma_has_content(gray, kHashInput * kHashInput)) return false;
+
+  alignas(16) float pixels[kHashInput * kHashInput];
+  for (int i = 0; i < kHashInput * kHashInput; i++) pixels[i] = gray[i];
+
+  float coeffs[kHashLowFreq * kHashLowFreq];
+  dct_low_freq(pixels, coeffs);
+
+  // 中位数不含直流分量 (它只反映平均亮度，且远大于其余系数)
+  float ac[kHashLowFreq * kHashLowFreq - 1];
+  memcpy(ac, coeffs + 1, sizeof(ac));
+  const int mid = (int)(sizeof(ac) / sizeof(ac[0])) / 2;
+  std::nth_element(ac, ac + mid, ac + sizeof(ac) / sizeof(ac[0]));
+  const float median = ac[mid];
+
+  uint64_t hash = 0;
+  for (int i = 1; i < kHashLowFreq * kHashLowFreq; i++) {
+    if (coeffs[i] > median) hash |= 1ULL << i;
+  }
+  *out_hash = hash;
+  return true;
+}
+
+// =================================================================
+// 采样与媒体索引
+// =================================================================
+
+// 索引中的指纹: int32 frame_count, int32 version, uint64 hash[]
+static bool index_lookup_fingerprint(const char* path, long long mtime, long long size, int frame_count,
+  std::vector<uint64_t>& out) {
+  std::vector<uint8_t> data;
+  if (!MediaIndex::instance().lookup(path, mtime, size, MEDIA_INDEX_FINGERPRINT, data)) return false;
+  if (data.size() < 8 || (data.size() - 8) % sizeof(uint64_t) != 0) return false;
+
+  int32_t stored_count = 0, version = 0;
+  memcpy(&stored_count, data.data(), 4);
+  memcpy(&version, data.data() + 4, 4);
+  if (stored_count != frame_count || version != kFingerprintVersion) return false;
+
+  out.resize((data.size() - 8) / sizeof(uint64_t));
+  if (!out.empty()) memcpy(out.data(), data.data() + 8, data.size() - 8);
+  return true;
+}
+
+static void index_store_fingerprint(const char* path, long long mtime, long long size, int frame_count,
+  const std::vector<uint64_t>& hashes) {
+  std::vector<uint8_t> data(8 + hashes.size() * sizeof(uint64_t));
+  int32_t version = kFingerprintVersion;
+  memcpy(data.data(), &frame_count, 4);
+  memcpy(data.data() + 4, &version, 4);
+  if (!hashes.empty()) memcpy(data.data() + 8, hashes.data(), hashes.size() * sizeof(uint64_t));
+  MediaIndex::instance().store(path, mtime, size, MEDIA_INDEX_FINGERPRINT, data.data(), data.size());
+}
+
+// 采样时间: 间隔为 kGridBaseMs 乘以 2 的幂 (采样点不超过 frame_count 的最小值)，取每个间隔的中点。
+// 间隔只在 2 倍处跳变，重新编码 / 换封装的副本时长几乎相同，采样时间完全一致；
+// 裁剪出的片段间隔是原视频的 1/2^k，原视频落在片段范围内的每个采样点附近 (半个片段间隔内) 都有片段的采样点
+static std::vector<long long> grid_timestamps(long long duration_ms, int frame_count) {
+  long long interval = kGridBaseMs;
+  while ((duration_ms + interval / 2) / interval > frame_count) interval *= 2;
+
+  std::vector<long long> timestamps;
+  for (long long t = interval / 2; t < duration_ms && (int)timestamps.size() < frame_count; t += interval) {
+    timestamps.push_back(t);
+  }
+  return timestamps;
+}
+
+static int compute_fingerprint(MediaContext* media, int frame_count, std::vector<uint64_t>& out) {
+  long long duration_ms = media_duration_ms(media);
+  if (duration_ms <= 0) return -1;
+
+  // 精确定位: 关键帧位置随编码参数变化，不能吸附到关键帧
+  std::vector<long long> timestamps = grid_timestamps(duration_ms, frame_count);
+
+  ScreenshotOptions seek_options;
+  screenshot_options_init(&seek_options);
+  seek_options.seek_mode = SCREENSHOT_SEEK_EXACT;
+  seek_options.priority = TASK_PRIORITY_BACKGROUND;
+
+  std::vector<ShotTarget> targets = plan_shot_targets(media, timestamps, seek_options);
+
+  SwsContext* sws = nullptr;
+  ScreenshotBatchStats stats{};
+  {
+    BatchFrameDecoder decoder(media, seek_options, &stats);
+    // 只需 32x32 的缩略图，环路滤波的效果看不出来 (析构时恢复)
+    media->codec_ctx->skip_loop_filter = AVDISCARD_ALL;
+
+    decoder.run(targets, [&](size_t, size_t, const AVFrame* frame, long long) {
+      uint64_t hash = 0;
+      if (hash_frame(&sws, frame, &hash)) out.push_back(hash);
+      });
+  }
+  if (sws) sws_freeContext(sws);
+
+  return stats.frames_used > 0 ? 0 : -1;
+}
+
+static int resolve_frame_count(int frame_count) {
+  if (frame_count <= 0) return FINGERPRINT_DEFAULT_FRAMES;
+  return (std::min)(frame_count, FINGERPRINT_MAX_FRAMES);
+}
+
+// batch = true 时用完即关闭上下文，不把缓存中正在使用的条目挤出去
+static int fingerprint_file(const char* path, int frame_count, int decoder_threads, bool batch,
+  unsigned long long* out_hashes) {
+  long long mtime = 0, size = 0;
+  if (!stat_media_file(path, mtime, size)) return -1;
+
+  std::vector<uint64_t> hashes;
+  if (!index_lookup_fingerprint(path, mtime, size, frame_count, hashes)) {
+    MediaLease media = MediaCache::instance().acquire(path, decoder_threads);
+    if (!media || !media->video_stream()) return -1;
+    if (batch) media.invalidate();
+
+    int ret = compute_fingerprint(media.get(), frame_count, hashes);
+    if (ret < 0) return ret;
+    index_store_fingerprint(path, mtime, size, frame_count, hashes);
+  }
+
+  for (size_t i = 0; i < hashes.size(); i++) out_hashes[i] = hashes[i];
+  return (int)hashes.size();
+}
+
+// =================================================================
+// 检索索引
+// =================================================================
+static const int kChunkCount = 4;
+static const int kChunkBits = 16;
+static const int kBucketCount = 1 << kChunkBits;
+
+// 检索数据 (可拷贝: 分组时在锁内拷贝一份快照，之后的查询不阻塞其它调用)
+struct FingerprintIndexData {
+  struct Video {
+    long long id = 0;
+    uint32_t first = 0; // 在 hashes 中的起始位置
+    uint32_t count = 0;
+    bool alive = true;
+  };
+
+  std::vector<uint64_t> hashes;
+  std::vector<uint32_t> owners; // hashes[i] 所属的 videos 下标
+  std::vector<Video> videos;
+  std::unordered_map<long long, uint32_t> slots; // video_id -> videos 下标 (只含存活的)
+  // 桶内除 hashes 下标外还存相邻两段 (32 位) 作为预筛: 它们的距离已超过半径时不必读取完整哈希
+  struct BucketEntry {
+    uint32_t entry;
+    uint32_t tag;
+  };
+  std::vector<std::vector<BucketEntry>> buckets; // [段 * kBucketCount + 段值] -> hashes 下标
+  size_t dead_hashes = 0;
+
+  FingerprintIndexData() : buckets((size_t)kChunkCount * kBucketCount) {}
+
+  // 第 c 段之后的两段 (循环)
+  static uint32_t tag(uint64_t hash, int c) {
+    const int shift = (c + 1) % kChunkCount * kChunkBits;
+    return (uint32_t)(shift == 0 ? hash : (hash >> shift) | (hash << (64 - shift)));
+  }
+
+  static uint32_t chunk(uint64_t hash, int c) {
+    return (uint32_t)(hash >> (c * kChunkBits)) & (kBucketCount - 1);
+  }
+
+  void insert(long long id, const uint64_t* data, int count) {
+    uint32_t slot = (uint32_t)videos.size();
+    Video video;
+    video.id = id;
+    video.first = (uint32_t)hashes.size();
+    video.count = (uint32_t)count;
+    videos.push_back(video);
+    slots[id] = slot;
+
+    for (int i = 0; i < count; i++) {
+      uint32_t entry = (uint32_t)hashes.size();
+      hashes.push_back(data[i]);
+      owners.push_back(slot);
+      for (int c = 0; c < kChunkCount; c++) {
+        buckets[(size_t)c * kBucketCount + chunk(data[i], c)].push_back({ entry, tag(data[i], c) });
+      }
+    }
+  }
+
+  bool erase(long long id) {
+    auto it = slots.find(id);
+    if (it == slots.end()) return false;
+    Video& video = videos[it->second];
+    video.alive = false;
+    dead_hashes += video.count;
+    slots.erase(it);
+    return true;
+  }
+
+  // 删除 / 替换累积的失效条目超过一半时重建
+  void maybe_compact() {
+    if (dead_hashes < 4096 || dead_hashes * 2 < hashes.size()) return;
+
+    std::vector<uint64_t> old_hashes;
+    std::vector<Video> old_videos;
+    old_hashes.swap(hashes);
+    old_videos.swap(videos);
+    owners.clear();
+    slots.clear();
+    for (auto& bucket : buckets) bucket.clear();
+    dead_hashes = 0;
+
+    for (const Video& video : old_videos) {
+      if (video.alive) insert(video.id, old_hashes.data() + video.first, (int)video.count);
+    }
+  }
+};
+
+struct FingerprintIndex : FingerprintIndexData {
+  std::mutex mutex;
+};
+
+// 16 位段内距离 <= radius 的全部异或掩码 (radius 0-2: 1 / 17 / 137 个)
+struct NeighbourMasks {
+  std::vector<uint32_t> by_radius[3];
+
+  NeighbourMasks() {
+    for (int r = 0; r < 3; r++) {
+      by_radius[r].push_back(0);
+      for (int a = 0; r >= 1 && a < kChunkBits; a++) by_radius[r].push_back(1u << a);
+      for (int a = 0; r >= 2 && a < kChunkBits; a++) {
+        for (int b = a + 1; b < kChunkBits; b++) by_radius[r].push_back((1u << a) | (1u << b));
+      }
+    }
+  }
+};
+
+static const std::vector<uint32_t>& neighbour_masks(int radius) {
+  static const NeighbourMasks masks;
+  return masks.by_radius[(std::min)(radius, 2)];
+}
+
+// 命中帧按位图中最高位与最低位之间的帧数 (哈希按时间顺序存放，即命中的时间范围)
+static int frame_span(uint64_t bits) {
+  int low = 0, high = 63;
+  while (!(bits >> low & 1)) low++;
+  while (!(bits >> high & 1)) high--;
+  return high - low + 1;
+}
+
+// 相似度 (0-1):
+// - 整体: 双方命中帧比例中较大的一个
+// - 包含 (裁剪片段与原视频): 命中的时间范围内的命中比例，两个方向取较大者。
+//   双方的采样间隔不同，片段只有在原视频采样点附近的帧能命中，因此在原视频一侧连续命中
+// 任一方有效帧少于 kMinReliableFrames 时比例不可靠，只按较长一方的帧数计算
+static double match_similarity(uint64_t query_bits, int query_count, uint64_t candidate_bits, int candidate_count) {
+  const int query_hits = popcount64(query_bits);
+  const int candidate_hits = popcount64(candidate_bits);
+  if ((std::min)(query_count, candidate_count) < kMinReliableFrames) {
+    return (double)(std::min)(query_hits, candidate_hits) / (std::max)(query_count, candidate_count);
+  }
+
+  double similarity = (std::max)((double)query_hits / query_count, (double)candidate_hits / candidate_count);
+  if (query_hits >= kMinReliableFrames) similarity = (std::max)(similarity, (double)query_hits / frame_span(query_bits));
+  if (candidate_hits >= kMinReliableFrames) {
+    similarity = (std::max)(similarity, (double)candidate_hits / frame_span(candidate_bits));
+  }
+  return similarity;
+}
+
+static int resolve_query_radius(int max_distance) {
+  return max_distance < 0 ? kDefaultQueryDistance : (std::min)(max_distance, FINGERPRINT_MAX_DISTANCE);
+}
+
+// 查询相似度不低于 min_similarity 的视频 (调用方持有 index 的锁，或 index 是快照)，on_match(候选下标, 结果)
+template <class OnMatch>
+static void query_index(const FingerprintIndexData& index, const uint64_t* hashes, int count, int radius,
+  double min_similarity, long long exclude_id, OnMatch on_match) {
+  const std::vector<uint32_t>& masks = neighbour_masks(radius / kChunkCount);
+
+  // 每个候选视频: 命中的查询帧 / 被命中的候选帧 (按位)
+  struct Hit {
+    uint64_t query_frames = 0;
+    uint64_t candidate_frames = 0;
+  };
+  std::unordered_map<uint32_t, Hit> hits;
+
+  for (int q = 0; q < count; q++) {
+    const uint64_t query = hashes[q];
+    for (int c = 0; c < kChunkCount; c++) {
+      const uint32_t key = FingerprintIndexData::chunk(query, c);
+      const uint32_t query_tag = FingerprintIndexData::tag(query, c);
+      for (uint32_t mask : masks) {
+        for (const FingerprintIndexData::BucketEntry& bucket_entry : index.buckets[(size_t)c * kBucketCount + (key ^ mask)]) {
+          if (popcount64(bucket_entry.tag ^ query_tag) > radius) continue;
+          const uint32_t entry = bucket_entry.entry;
+          if (popcount64(index.hashes[entry] ^ query) > radius) continue;
+          const uint32_t slot = index.owners[entry];
+          const FingerprintIndexData::Video& video = index.videos[slot];
+          if (!video.alive || video.id == exclude_id) continue;
+
+          Hit& hit = hits[slot];
+          hit.query_frames |= 1ULL << q;
+          hit.candidate_frames |= 1ULL << (entry - video.first);
+        }
+      }
+    }
+  }
+
+  for (const auto& kv : hits) {
+    const FingerprintIndexData::Video& video = index.videos[kv.first];
+    FingerprintMatch m;
+    m.video_id = video.id;
+    m.matched_frames = popcount64(kv.second.query_frames);
+    m.candidate_frames = popcount64(kv.second.candidate_frames);
+    m.similarity = match_similarity(kv.second.query_frames, count, kv.second.candidate_frames, (int)video.count);
+    if (m.similarity >= min_similarity) on_match(kv.first, m);
+  }
+}
+
+// =================================================================
+// 导出接口
+// =================================================================
+DLLEXPORT int video_fingerprint(const char* video_path, int frame_count, unsigned long long* out_hashes) {
+  if (!video_path || !out_hashes) return -1;
+
+  av_log_set_level(AV_LOG_ERROR);
+  return fingerprint_file(video_path, resolve_frame_count(frame_count), ThreadPool::instance().decoder_threads(),
+    false, out_hashes);
+}
+
+DLLEXPORT int video_fingerprint_batch(const char* const* video_paths, int count, int frame_count,
+  unsigned long long* out_hashes, int* out_counts, FingerprintProgressCallback progress) {
+  if (!video_paths || !out_hashes || !out_counts || count < 0) return -1;
+  if (count == 0) return 0;
+
+  av_log_set_level(AV_LOG_ERROR);
+
+  // 解码为主，并发数同时受磁盘与 CPU 预算限制；每个文件单线程解码
+  const int frames = resolve_frame_count(frame_count);
+  int queue_depth = (std::min)(storage_queue_depth(video_paths[0]), (std::max)(ThreadPool::instance().cpu_budget(), 2));
+
+  std::atomic<int> succeeded{ 0 };
+  run_io_batch(count, queue_depth, [&](int i) {
+    int n = video_paths[i] ? fingerprint_file(video_paths[i], frames, 1, true, out_hashes + (size_t)i * frames) : -1;
+    out_counts[i] = n;
+    if (n >= 0) succeeded++;
+    }, [&](int processed, int total, int) {
+      if (progress) progress(processed, total);
+    });
+
+  return succeeded.load();
+}
+
+DLLEXPORT int fingerprint_distance(unsigned long long a, unsigned long long b) {
+  return popcount64(a ^ b);
+}
+
+DLLEXPORT FingerprintIndex* fingerprint_index_create() {
+  return new FingerprintIndex();
+}
+
+DLLEXPORT void fingerprint_index_destroy(FingerprintIndex* index) {
+  delete index;
+}
+
+DLLEXPORT int fingerprint_index_add(FingerprintIndex* index, long long video_id, const unsigned long long* hashes, int count) {
+  if (!index || count < 0 || (count > 0 && !hashes)) return -1;
+  count = (std::min)(count, FINGERPRINT_MAX_FRAMES);
+
+  std::lock_guard<std::mutex> lock(index->mutex);
+  index->erase(video_id);
+  index->insert(video_id, (const uint64_t*)hashes, count);
+  index->maybe_compact();
+  return 0;
+}
+
+DLLEXPORT int fingerprint_index_remove(FingerprintIndex* index, long long video_id) {
+  if (!index) return 0;
+
+  std::lock_guard<std::mutex> lock(index->mutex);
+  bool removed = index->erase(video_id);
+  index->maybe_compact();
+  return removed ? 1 : 0;
+}
+
+DLLEXPORT int fingerprint_index_size(FingerprintIndex* index) {
+  if (!index) return 0;
+
+  std::lock_guard<std::mutex> lock(index->mutex);
+  return (int)index->slots.size();
+}
+
+DLLEXPORT int fingerprint_index_query(FingerprintIndex* index, const unsigned long long* hashes, int count,
+  int max_distance, double min_similarity, long long exclude_id, FingerprintMatch* out_matches, int capacity) {
+  if (!index || count < 0 || (count > 0 && !hashes) || capacity < 0 || (capacity > 0 && !out_matches)) return -1;
+  count = (std::min)(count, FINGERPRINT_MAX_FRAMES);
+  if (count == 0 || capacity == 0) return 0;
+
+  std::vector<FingerprintMatch> matches;
+  {
+    std::lock_guard<std::mutex> lock(index->mutex);
+    query_index(*index, (const uint64_t*)hashes, count, resolve_query_radius(max_distance), min_similarity,
+      exclude_id, [&](uint32_t, const FingerprintMatch& m) { matches.push_back(m); });
+  }
+
+  std::sort(matches.begin(), matches.end(), [](const FingerprintMatch& a, const FingerprintMatch& b) {
+    if (a.similarity != b.similarity) return a.similarity > b.similarity;
+    if (a.matched_frames != b.matched_frames) return a.matched_frames > b.matched_frames;
+    return a.video_id < b.video_id;
+    });
+
+  int written = (std::min)((int)matches.size(), capacity);
+  for (int i = 0; i < written; i++) out_matches[i] = matches[i];
+  return written;
+}
+
+DLLEXPORT int fingerprint_index_group(FingerprintIndex* index, int max_distance, double min_similarity,
+  long long* out_ids, long long* out_groups, int capacity) {
+  if (!index || capacity < 0 || (capacity > 0 && (!out_ids || !out_groups))) return -1;
+
+  // 全部查询耗时较长 (后台优先级，可能排队): 在快照上进行，期间的添加 / 删除 / 查询不被阻塞
+  FingerprintIndexData snapshot;
+  {
+    std::lock_guard<std::mutex> lock(index->mutex);
+    snapshot = *index;
+  }
+  const FingerprintIndexData& data = snapshot;
+  const int radius = resolve_query_radius(max_distance);
+  const uint32_t video_count = (uint32_t)data.videos.size();
+
+  // 每个视频查询一次 (只读，按段并行)，相似度对称，只保留 slot < other 的边
+  ThreadPool& pool = ThreadPool::instance();
+  const uint32_t parts = (uint32_t)(std::max)(pool.cpu_budget(), 1);
+  std::vector<std::vector<std::pair<uint32_t, uint32_t>>> edges(parts);
+  std::vector<std::future<void>> tasks;
+  for (uint32_t part = 0; part < parts; part++) {
+    tasks.push_back(pool.async(TASK_PRIORITY_BACKGROUND, [&, part]() {
+      for (uint32_t slot = part; slot < video_count; slot += parts) {
+        const FingerprintIndexData::Video& video = data.videos[slot];
+        if (!video.alive || video.count == 0) continue;
+        query_index(data, data.hashes.data() + video.first, (int)video.count, radius, min_similarity, video.id,
+          [&](uint32_t other, const FingerprintMatch&) {
+            if (slot < other) edges[part].push_back({ slot, other });
+          });
+      }
+      }));
+  }
+  for (auto& task : tasks) pool.wait(task);
+
+  // 并查集 (videos 下标)，每次合并把根挂到 video_id 较小的一方
+  std::vector<uint32_t> parent(video_count);
+  for (uint32_t i = 0; i < video_count; i++) parent[i] = i;
+  auto find = [&parent](uint32_t v) {
+    while (parent[v] != v) v = parent[v] = parent[parent[v]];
+    return v;
+  };
+  for (const auto& part_edges : edges) {
+    for (const auto& edge : part_edges) {
+      uint32_t a = find(edge.first), b = find(edge.second);
+      if (a == b) continue;
+      if (data.videos[b].id < data.videos[a].id) std::swap(a, b);
+      parent[b] = a;
+    }
+  }
+
+  std::vector<uint32_t> group_size(parent.size(), 0);
+  for (uint32_t slot = 0; slot < parent.size(); slot++) {
+    if (data.videos[slot].alive) group_size[find(slot)]++;
+  }
+
+  int total = 0;
+  for (uint32_t slot = 0; slot < parent.size(); slot++) {
+    const uint32_t root = find(slot);
+    if (!data.videos[slot].alive || group_size[root] < 2) continue;
+    if (total < capacity) {
+      out_ids[total] = data.videos[slot].id;
+      out_groups[total] = data.videos[root].id;
+    }
+    total++;
+  }
+  return total;
+}
@@ -0,0 +1,144 @@
+// fingerprint/VideoFingerprint.h
+#pragma once
+
+#include "../common.h"
+
+// =================================================================
+// 视频感知指纹与近似重复检索
+//
+// 指纹: 在固定时间网格上精确取最多 N 帧 (间隔为 1 秒乘以 2 的幂，沿用截图的批量解码，关闭环路滤波)，
+// 每帧缩小为 32x32 灰度图，做二维 DCT，取左上 8x8 低频系数与其中位数比较得到 64 位 pHash。
+// 采样时间只由时长决定 (与关键帧位置无关)，重新编码、改分辨率、换封装后取到的是同一批画面，
+// 指纹基本不变 (汉明距离通常 < 8)。
+// 纯黑 / 纯白等几乎无内容的帧会被跳过 (它们与任何视频都"相似")，因此实际帧数可能少于 N。
+//
+// - 结果写入持久化媒体索引 (core/MediaIndex.h)，文件未修改时不再解码
+// - 检索索引把每个 64 位哈希拆成 4 段 16 位 (multi-index hashing):
+//   两个哈希距离 <= r 时至少有一段的距离 <= r / 4，只需查这些段的邻近桶再逐个比较，
+//   5 万个视频 (约 300 万帧) 时单次查询为毫秒级
+// - 相似度 = max(查询视频命中帧比例, 候选视频命中帧比例, 命中时间范围内的命中比例)。
+//   裁剪出的片段采样更密，原视频落在片段范围内的采样点附近都有片段的采样点，
+//   片段覆盖原视频至少 4 个采样点、且采样点附近画面变化不大时可以匹配。
+//   任一方有效帧少于 4 个时只按较长一方的帧数计算，避免少量帧的视频与任何视频都"相同"
+// =================================================================
+
+#define FINGERPRINT_MAX_FRAMES 64
+#define FINGERPRINT_DEFAULT_FRAMES 16
+#define FINGERPRINT_MAX_DISTANCE 11
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  // 进度回调，只在调用 video_fingerprint_batch 的线程上触发
+  typedef void (*FingerprintProgressCallback)(int processed, int total);
+
+  typedef struct FingerprintIndex FingerprintIndex;
+
+  typedef struct {
+    long long video_id;
+    int matched_frames;   // 查询视频中找到近似帧的帧数
+    int candidate_frames; // 候选视频中被匹配到的帧数
+    double similarity;    // 0-1
+  } FingerprintMatch;
+
+  /**
+   * @brief 计算视频指纹。
+   * @param frame_count 采样帧数 1-FINGERPRINT_MAX_FRAMES，0 = FINGERPRINT_DEFAULT_FRAMES
+   * @param out_hashes  [输出] 长度至少为 frame_count 的哈希数组 (按时间顺序)
+   * @return 实际的哈希数 (跳过无内容的帧后可能更少，也可能为 0)；小于 0 表示无法打开或解码
+   */
+  DLLEXPORT int video_fingerprint(const char* video_path, int frame_count, unsigned long long* out_hashes);
+
+  /**
+   * @brief 批量计算视频指纹 (并发数同时受磁盘与 CPU 预算限制，见 core/IoBatch.h)。
+   * @param out_hashes  [输出] 长度为 count * frame_count，第 i 个视频的哈希从 i * frame_count 开始
+   * @param out_counts  [输出] 长度为 count，每个视频的哈希数，小于 0 表示该视频失败
+   * @param progress    进度回调 (可为 NULL)
+   * @return 成功的视频数；小于 0 表示参数错误
+   */
+  DLLEXPORT int video_fingerprint_batch(
+    const char* const* video_paths,
+    int count,
+    int frame_count,
+    unsigned long long* out_hashes,
+    int* out_counts,
+    FingerprintProgressCallback progress
+  );
+
+  /**
+   * @brief 两个 64 位哈希的汉明距离。
+   */
+  DLLEXPORT int fingerprint_distance(unsigned long long a, unsigned long long b);
+
+  /**
+   * @brief 创建 / 销毁近似重复检索索引 (各接口线程安全)。
+   */
+  DLLEXPORT FingerprintIndex* fingerprint_index_create();
+  DLLEXPORT void fingerprint_index_destroy(FingerprintIndex* index);
+
+  /**
+   * @brief 添加视频指纹，同一 video_id 已存在时替换。
+   * @param count 哈希数，超过 FINGERPRINT_MAX_FRAMES 的部分被忽略
+   * @return 0 成功；小于 0 表示参数错误
+   */
+  DLLEXPORT int fingerprint_index_add(FingerprintIndex* index, long long video_id, const unsigned long long* hashes, int count);
+
+  /**
+   * @brief 移除视频。
+   * @return 1 已移除；0 不存在
+   */
+  DLLEXPORT int fingerprint_index_remove(FingerprintIndex* index, long long video_id);
+
+  /**
+   * @brief 索引中的视频数。
+   */
+  DLLEXPORT int fingerprint_index_size(FingerprintIndex* index);
+
+  /**
+   * @brief 查询近似重复的视频。
+   *
+   * @param hashes          查询视频的指纹 (video_fingerprint 的结果)
+   * @param count           哈希数
+   * @param max_distance    两帧视为相同的最大汉明距离 (0-FINGERPRINT_MAX_DISTANCE，小于 0 = 默认 8)
+   * @param min_similarity  最小相似度 (0-1)
+   * @param exclude_id      不返回的 video_id (通常是查询视频自身)，没有时传 -1
+   * @param out_matches     [输出] 按相似度从高到低排列
+   * @param capacity        out_matches 的长度
+   *
+   * @return 写入 out_matches 的数量；小于 0 表示参数错误
+   */
+  DLLEXPORT int fingerprint_index_query(
+    FingerprintIndex* index,
+    const unsigned long long* hashes,
+    int count,
+    int max_distance,
+    double min_similarity,
+    long long exclude_id,
+    FingerprintMatch* out_matches,
+    int capacity
+  );
+
+  /**
+   * @brief 把互相近似重复的视频分组 (传递闭包)，一次调用完成全部查询。
+   *
+   * @param max_distance    同 fingerprint_index_query
+   * @param min_similarity  同 fingerprint_index_query
+   * @param out_ids         [输出] 属于某个组 (至少两个视频) 的 video_id
+   * @param out_groups      [输出] 对应的组编号 (组内最小的 video_id)
+   * @param capacity        out_ids / out_groups 的长度
+   *
+   * @return 分组视频的总数 (可能大于 capacity，此时只写入前 capacity 个)；小于 0 表示参数错误
+   */
+  DLLEXPORT int fingerprint_index_group(
+    FingerprintIndex* index,
+    int max_distance,
+    double min_similarity,
+    long long* out_ids,
+    long long* out_groups,
+    int capacity
+  );
+
+#ifdef __cplusplus
+}
+#endif
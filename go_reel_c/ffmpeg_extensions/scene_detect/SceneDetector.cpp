@@ -0,0 +1,247 @@
+#include "SceneDetector.h"
+#include "../core/Job.h"
+#include "../core/MediaCache.h"
+#include "../core/ThreadPool.h"
+#include "../screen_shot/ScreenshotterInternal.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <vector>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SCENE_USE_SSE2 1
+#endif
+
+static const int kAnalysisWidth = 64;
+static const int kAnalysisHeight = 36;
+static const int kAnalysisPixels = kAnalysisWidth * kAnalysisHeight; // 16 的倍数
+static const int kHistogramBins = 64;
+
+// 平均每像素亮度差达到该值时 SAD 分量记为 1
+static const double kSadFullScale = 48.0;
+
+static const double kMaxSampleFps = 60.0;
+
+// 缩小后的亮度图与直方图
+struct LumaThumb {
+  alignas(16) uint8_t pixels[kAnalysisPixels];
+  alignas(16) uint16_t histogram[kHistogramBins];
+};
+
+static uint32_t luma_sad(const uint8_t* a, const uint8_t* b) {
+#ifdef SCENE_USE_SSE2
+  // psadbw: 每 16 字节得到两个 64 位部分和
+  __m128i acc = _mm_setzero_si128();
+  for (int i = 0; i < kAnalysisPixels; i += 16) {
+    __m128i va = _mm_load_si128((const __m128i*)(a + i));
+    __m128i vb = _mm_load_si128((const __m128i*)(b + i));
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+  }
+  return (uint32_t)(_mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+#else
+  uint32_t sum = 0;
+  for (int i = 0; i < kAnalysisPixels; i++) sum += (uint32_t)std::abs((int)a[i] - (int)b[i]);
+  return sum;
+#endif
+}
+
+static uint32_t histogram_diff(const uint16_t* a, const uint16_t* b) {
+#ifdef SCENE_USE_SSE2
+  // |a - b| = 饱和减法 (a - b) | (b - a)；每个计数 <= kAnalysisPixels，pmaddwd 累加不会溢出
+  const __m128i ones = _mm_set1_epi16(1);
+  __m128i acc = _mm_setzero_si128();
+  for (int i = 0; i < kHistogramBins; i += 8) {
+    __m128i va = _mm_load_si128((const __m128i*)(a + i));
+    __m128i vb = _mm_load_si128((const __m128i*)(b + i));
+    __m128i diff = _mm_or_si128(_mm_subs_epu16(va, vb), _mm_subs_epu16(vb, va));
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(diff, ones));
+  }
+  acc = _mm_add_epi32(acc, _mm_srli_si128(acc, 8));
+  acc = _mm_add_epi32(acc, _mm_srli_si128(acc, 4));
+  return (uint32_t)_mm_cvtsi128_si32(acc);
+#else
+  uint32_t sum = 0;
+  for (int i = 0; i < kHistogramBins; i++) sum += (uint32_t)std::abs((int)a[i] - (int)b[i]);
+  return sum;
+#endif
+}
+
+// 缩小为分析尺寸的灰度图并统计直方图；无内容的帧返回 false
+static bool build_thumb(SwsContext** sws, const AVFrame* frame, LumaThumb* thumb) {
+  *sws = sws_getCachedContext(*sws,
+    frame->width, frame->height, (AVPixelFormat)frame->format,
+    kAnalysisWidth, kAnalysisHeight, AV_PIX_FMT_GRAY8,
+    SWS_AREA, NULL, NULL, NULL);
+  if (!*sws) return false;
+
+  uint8_t* dst[4] = { thumb->pixels, nullptr, nullptr, nullptr };
+  int dst_linesize[4] = { kAnalysisWidth, 0, 0, 0 };
+  if (sws_scale(*sws, frame->data, frame->linesize, 0, frame->height, dst, dst_linesize) <= 0) return false;
+
+  std::fill(thumb->histogram, thumb->histogram + kHistogramBins, (uint16_t)0);
+  for (int i = 0; i < kAnalysisPixels; i++) thumb->histogram[thumb->pixels[i] * kHistogramBins / 256]++;
+  return luma_has_content(thumb->pixels, kAnalysisPixels);
+}
+
+// 直方图差异与 SAD 归一化后的几何平均
+static double scene_score(const LumaThumb& prev, const LumaThumb& cur) {
+  double hist = histogram_diff(prev.histogram, cur.histogram) / (2.0 * kAnalysisPixels);
+  double sad = (std::min)(luma_sad(prev.pixels, cur.pixels) / (double)kAnalysisPixels / kSadFullScale, 1.0);
+  return std::sqrt(hist * sad);
+}
+
+// =================================================================
+// 分析
+// =================================================================
+SceneDetectOptions resolve_scene_options(const SceneDetectOptions* options) {
+  SceneDetectOptions resolved;
+  scene_detect_options_init(&resolved);
+  if (!options) return resolved;
+
+  if (options->analyze_mode == SCENE_ANALYZE_FRAMES) resolved.analyze_mode = SCENE_ANALYZE_FRAMES;
+  if (options->sample_fps > 0) resolved.sample_fps = (std::min)(options->sample_fps, kMaxSampleFps);
+  if (options->threshold > 0 && options->threshold <= 1) resolved.threshold = options->threshold;
+  if (options->min_scene_ms >= 0) resolved.min_scene_ms = options->min_scene_ms;
+  return resolved;
+}
+
+int run_scene_analysis(MediaContext* media, const SceneDetectOptions& options, const SceneFrameCallback& on_frame) {
+  AVFormatContext* format_ctx = media->format_ctx;
+  AVCodecContext* codec_ctx = media->codec_ctx;
+  AVStream* stream = media->video_stream();
+  if (!codec_ctx || !stream) return -1;
+
+  AVFrame* frame = av_frame_alloc();
+  AVPacket* packet = av_packet_alloc();
+  if (!frame || !packet) {
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    return -1;
+  }
+
+  const bool keyframes_only = options.analyze_mode == SCENE_ANALYZE_KEYFRAMES;
+  const long long sample_interval_ms = keyframes_only ? 0 : (long long)(1000.0 / options.sample_fps);
+  const AVRational ms_base = { 1, 1000 };
+
+  // 只解复用视频流；关键帧模式下解复用器直接跳过非关键帧 (MP4 不读取其数据)，解码器只输出 I 帧
+  std::vector<AVDiscard> saved_discard(format_ctx->nb_streams);
+  for (unsigned i = 0; i < format_ctx->nb_streams; i++) {
+    saved_discard[i] = format_ctx->streams[i]->discard;
+    if ((int)i != media->video_stream_index) format_ctx->streams[i]->discard = AVDISCARD_ALL;
+  }
+  if (keyframes_only) {
+    stream->discard = AVDISCARD_NONKEY;
+    codec_ctx->skip_frame = AVDISCARD_NONKEY;
+  }
+  // 只需 64x36 的缩略图，环路滤波的效果看不出来
+  codec_ctx->skip_loop_filter = AVDISCARD_ALL;
+
+  // 缓存中的上下文可能停在任意位置，从头开始
+  avcodec_flush_buffers(codec_ctx);
+  av_seek_frame(format_ctx, media->video_stream_index, stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0,
+    AVSEEK_FLAG_BACKWARD);
+
+  SwsContext* sws = nullptr;
+  std::vector<LumaThumb> thumbs(2); // 当前帧 / 上一个有内容的帧
+  int current = 0;
+  bool has_reference = false;
+  long long last_start_ms = LLONG_MIN;
+  long long next_sample_ms = LLONG_MIN;
+  int analyzed = 0;
+  bool draining = false;
+
+  auto analyze = [&]() {
+    int64_t ts = frame_timestamp(frame);
+    if (ts == AV_NOPTS_VALUE) return;
+    long long frame_ms = av_rescale_q(ts, stream->time_base, ms_base);
+    if (frame_ms < next_sample_ms) return;
+
+    LumaThumb& thumb = thumbs[current];
+    if (!build_thumb(&sws, frame, &thumb)) return; // 无内容的帧不更新比较基准
+    next_sample_ms = frame_ms + sample_interval_ms;
+    analyzed++;
+
+    if (!has_reference) {
+      last_start_ms = frame_ms;
+      on_frame(frame_ms, 0.0, true);
+    }
+    else {
+      double score = scene_score(thumbs[1 - current], thumb);
+      bool scene_start = score >= options.threshold && frame_ms - last_start_ms >= options.min_scene_ms;
+      if (scene_start) last_start_ms = frame_ms;
+      on_frame(frame_ms, score, scene_start);
+    }
+    has_reference = true;
+    current = 1 - current;
+  };
+
+  for (;;) {
+    while (avcodec_receive_frame(codec_ctx, frame) == 0) {
+      job_add_progress(0, 1, 0);
+      analyze();
+      av_frame_unref(frame);
+    }
+    if (draining || job_cancelled()) break;
+
+    if (av_read_frame(format_ctx, packet) < 0) {
+      draining = true;
+      avcodec_send_packet(codec_ctx, NULL);
+      continue;
+    }
+    // 不支持按关键帧丢弃的解复用器仍会输出非关键帧
+    if (packet->stream_index != media->video_stream_index || (keyframes_only && !(packet->flags & AV_PKT_FLAG_KEY))) {
+      av_packet_unref(packet);
+      continue;
+    }
+
+    job_add_progress(0, 0, packet->size);
+    avcodec_send_packet(codec_ctx, packet);
+    av_packet_unref(packet);
+  }
+
+  // 恢复上下文供缓存中的其它调用方使用 (冲刷也清除解码器的结束状态)
+  avcodec_flush_buffers(codec_ctx);
+  reset_decoder_discard(codec_ctx);
+  for (unsigned i = 0; i < format_ctx->nb_streams; i++) format_ctx->streams[i]->discard = saved_discard[i];
+
+  if (sws) sws_freeContext(sws);
+  av_packet_free(&packet);
+  av_frame_free(&frame);
+  return analyzed;
+}
+
+// =================================================================
+// 导出接口
+// =================================================================
+DLLEXPORT void scene_detect_options_init(SceneDetectOptions* options) {
+  if (!options) return;
+  options->analyze_mode = SCENE_ANALYZE_KEYFRAMES;
+  options->sample_fps = 4.0;
+  options->threshold = 0.3;
+  options->min_scene_ms = 1000;
+}
+
+DLLEXPORT int detect_scenes(const char* video_path, const SceneDetectOptions* options,
+  SceneBoundary* out_scenes, int capacity) {
+  if (!video_path) return -1;
+
+  av_log_set_level(AV_LOG_ERROR);
+
+  const SceneDetectOptions resolved = resolve_scene_options(options);
+  MediaLease media = MediaCache::instance().acquire(video_path, ThreadPool::instance().decoder_threads());
+  if (!media || !media->video_stream()) return -1;
+
+  std::vector<SceneBoundary> scenes;
+  int ret = run_scene_analysis(media.get(), resolved, [&](long long frame_ms, double score, bool scene_start) {
+    // 第一个有内容的帧是视频开头，不算边界
+    if (scene_start && score > 0) scenes.push_back({ frame_ms, score });
+    });
+  if (ret < 0) return ret;
+
+  if (out_scenes) {
+    int n = (std::min)((int)scenes.size(), (std::max)(capacity, 0));
+    std::copy(scenes.begin(), scenes.begin() + n, out_scenes);
+  }
+  return (int)scenes.size();
+}
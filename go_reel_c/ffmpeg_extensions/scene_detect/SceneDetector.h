@@ -0,0 +1,80 @@
+// scene_detect/SceneDetector.h
+#pragma once
+
+#include "../common.h"
+
+// =================================================================
+// 镜头切换 (场景边界) 检测
+//
+// 顺序解码一遍视频，每个被分析的帧缩小为 64x36 灰度图，与上一个有内容的帧比较:
+//   - 亮度直方图差异 (64 级)，对运动不敏感
+//   - 逐像素绝对差之和 (SAD)，对构图变化敏感
+// 分数为两者归一化后的几何平均 (0-1)，只有两者同时较大才会超过阈值，
+// 因此镜头内的快速运动 (SAD 大、直方图相近) 和闪光 (直方图变化、构图不变) 都不会误判。
+//
+// 分析模式:
+//   - 关键帧 (默认): 只解码关键帧，MP4 等容器连非关键帧的数据都不读取。
+//     编码器通常在镜头切换处插入关键帧，精度取决于 GOP 长度
+//   - 逐帧: 解码全部帧 (关闭环路滤波)，按 sample_fps 抽样分析，边界精确到抽样间隔
+//
+// 纯黑 / 纯白等几乎无内容的帧不参与比较 (淡出 -> 黑场 -> 淡入按一次切换计算)。
+// =================================================================
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef enum {
+    SCENE_ANALYZE_KEYFRAMES = 0, // 只解码关键帧
+    SCENE_ANALYZE_FRAMES = 1,    // 解码全部帧，按 sample_fps 抽样分析
+  } SceneAnalyzeMode;
+
+  typedef struct {
+    int analyze_mode;       // SceneAnalyzeMode
+    double sample_fps;      // 仅 SCENE_ANALYZE_FRAMES: 每秒最多分析的帧数 (默认 4)
+    double threshold;       // 场景边界的最小分数 0-1 (默认 0.3)
+    long long min_scene_ms; // 相邻边界的最小间隔 (默认 1000)，更近的切换被忽略
+  } SceneDetectOptions;
+
+  typedef struct {
+    long long time_ms; // 新镜头第一个被分析帧的时间
+    double score;      // 0-1，越大切换越明显
+  } SceneBoundary;
+
+  /**
+   * @brief 填充场景检测选项默认值。
+   */
+  DLLEXPORT void scene_detect_options_init(SceneDetectOptions* options);
+
+  /**
+   * @brief 检测视频中的镜头切换。
+   * @param options    检测选项，可为 NULL
+   * @param out_scenes [输出] 按时间升序的场景边界 (不含视频开头)，可为 NULL (仅查询数量)
+   * @param capacity   out_scenes 的容量
+   * @return 边界总数 (可能大于 capacity，此时只写入前 capacity 个)；小于 0 表示失败
+   */
+  DLLEXPORT int detect_scenes(const char* video_path, const SceneDetectOptions* options,
+    SceneBoundary* out_scenes, int capacity);
+
+#ifdef __cplusplus
+}
+
+#include <functional>
+
+struct MediaContext;
+
+// 分析回调: 每个有内容的分析帧调用一次 (时间升序)。
+// scene_start 为 true 表示该帧开始一个新镜头 (第一个有内容的帧也是，此时 score 为 0)
+using SceneFrameCallback = std::function<void(long long frame_ms, double score, bool scene_start)>;
+
+/**
+ * 在已借出的上下文上从头分析整个视频 (解码器必须已打开)，结束后恢复解码器与流的丢弃设置。
+ * 截图的"最佳场景帧"模式 (SCREENSHOT_SELECT_SCENES) 用它选择时间点。
+ * @param options 必须是有效值 (见 resolve_scene_options)
+ * @return 分析的帧数；小于 0 表示失败
+ */
+int run_scene_analysis(MediaContext* media, const SceneDetectOptions& options, const SceneFrameCallback& on_frame);
+
+// NULL 转为默认选项，并修正非法取值
+SceneDetectOptions resolve_scene_options(const SceneDetectOptions* options);
+#endif
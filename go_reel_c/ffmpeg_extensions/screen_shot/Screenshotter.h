@@ -14,11 +14,131 @@ extern "C" {
     int height;            // 高度
     double framerate;      // 帧率 (FPS)
     int success;           // 1 = 成功, 0 = 失败
+
+    // 以下字段供转码判断 / 播放器旋转使用，避免再做一次 ffprobe
+    int rotation;            // 显示矩阵中的旋转 (顺时针 0 / 90 / 180 / 270)
+    long long bit_rate;      // 总码率 (bps)，未知为 0
+    int video_codec_id;      // 视频 AVCodecID
+    int profile;             // 视频编码 profile (AV_PROFILE_*)，未知为 -99
+    int pixel_format;        // AVPixelFormat，未知为 -1
+    int has_audio;           // 1 = 有音频流
+    int audio_codec_id;      // 音频 AVCodecID，无音频为 0
+    char video_codec[32];    // 视频编码名称 (例如 "h264")
+    char pixel_format_name[32]; // 像素格式名称 (例如 "yuv420p")，未知为空
+    char audio_codec[32];    // 音频编码名称，无音频为空
   } VideoInfoResult;
 
+  /**
+   * @brief 元数据探测选项 (位标志)。
+   */
+  typedef enum {
+    VIDEO_PROBE_FULL = 0, // 默认 probesize / analyzeduration，与 ffprobe 一致
+    VIDEO_PROBE_FAST = 1, // 限制探测读取量；容器头已包含全部字段时不解码
+  } VideoProbeFlags;
+
+
+  /**
+   * @brief 截图定位模式。
+   */
+  typedef enum {
+    SCREENSHOT_SEEK_EXACT = 0,     // 精确: 解码到第一个 pts >= 目标时间的帧 (默认)
+    SCREENSHOT_SEEK_KEYFRAME = 1,  // 最近的关键帧: 只解码一个 I 帧，适合封面 / 网格缩略图
+    SCREENSHOT_SEEK_TOLERANCE = 2, // 容差: 第一个落在 [目标 - tolerance_ms, ...) 内的帧
+  } ScreenshotSeekMode;
+
+  /**
+   * @brief 单视频多截图的时间点来源。
+   */
+  typedef enum {
+    SCREENSHOT_SELECT_TIMESTAMPS = 0, // 使用传入的时间戳 (默认)
+    SCREENSHOT_SELECT_SCENES = 1,     // 忽略传入的时间戳，按镜头切换自动选出 count 张 (见 scene_detect/SceneDetector.h)
+  } ScreenshotSelectMode;
+
+  /**
+   * @brief 编码速度预设，映射到各编码器的压缩力度。
+   */
+  typedef enum {
+    SCREENSHOT_SPEED_FAST = 0,     // WebP method 1 / PNG 级别 3 / JPEG 默认霍夫曼表
+    SCREENSHOT_SPEED_BALANCED = 1, // WebP method 4 / PNG 级别 7 (默认)
+    SCREENSHOT_SPEED_BEST = 2,     // WebP method 6 / PNG 级别 9
+  } ScreenshotSpeedPreset;
+
+  /**
+   * @brief 输出图片选项。裁剪、缩放、格式转换在同一次 swscale 中完成，旋转作用于缩放后的小图。
+   *        处理顺序: 裁剪 -> 缩放 -> 旋转 -> 编码。
+   */
+  typedef struct {
+    int max_width;    // 输出最大宽度 (旋转后)，0 = 不限制；等比缩放，不会放大
+    int max_height;   // 输出最大高度 (旋转后)，0 = 不限制
+    int crop_x;       // 裁剪矩形 (源帧像素坐标)
+    int crop_y;
+    int crop_width;   // 小于等于 0 表示不裁剪
+    int crop_height;
+    int rotation;     // 顺时针旋转角度: 0 / 90 / 180 / 270
+    int quality;      // 0-100，用于 WebP / JPEG；小于 0 = 编码器默认 (WebP 80)
+    int speed_preset; // ScreenshotSpeedPreset
+  } ScreenshotOutputOptions;
+
+  /**
+   * @brief 截图选项。传 NULL 等价于 screenshot_options_init 的默认值。
+   */
+  typedef struct {
+    int seek_mode;          // ScreenshotSeekMode
+    long long tolerance_ms; // 仅 SCREENSHOT_SEEK_TOLERANCE 使用
+    int parallel_decoders;  // 批量截图的并行解码器数量: 0 = 自动, 1 = 关闭, N = 最多 N 个
+    ScreenshotOutputOptions output;
+    int priority;           // 线程池优先级: 0 = 交互 (界面缩略图), 1 = 后台 (批量刷新)
+    int select_mode;        // ScreenshotSelectMode，仅单视频多截图使用
+  } ScreenshotOptions;
+
+  DLLEXPORT void screenshot_options_init(ScreenshotOptions* options);
+
+  /**
+   * @brief 批量截图的解码统计，用于验证 seek 规划的效果。
+   */
+  typedef struct {
+    int seeks;            // 实际执行的 av_seek_frame 次数
+    int packets_read;     // 读取的视频包数量
+    int packets_skipped;  // 只解复用、未送入解码器的视频包数量
+    int frames_decoded;   // 解码器输出的帧数量
+    int frames_used;      // 被截图使用的不同帧数量
+  } ScreenshotBatchStats;
 
   DLLEXPORT VideoInfoResult get_video_metadata(const char* video_path);
 
+  /**
+   * @brief 不经过 MediaCache 的元数据探测 (只读取文件头部附近的数据)。
+   * @param video_path  视频路径 (UTF-8)
+   * @param flags       VideoProbeFlags
+   */
+  DLLEXPORT VideoInfoResult probe_video_metadata(const char* video_path, int flags);
+
+  // 批量元数据进度回调，只在调用线程上触发
+  typedef void (*MetadataProgressCallback)(int processed, int total);
+
+  /**
+   * @brief 批量获取视频元数据 (一次调用探测整个列表)。
+   *        使用库内的 I/O 线程并发探测，并发数按磁盘类型与 CPU 预算选择；不占用 MediaCache。
+   * @param video_paths  视频路径数组 (UTF-8)
+   * @param count        数量
+   * @param flags        VideoProbeFlags
+   * @param out_results  [输出] 长度为 count，单个文件失败时对应条目 success = 0
+   * @param progress     进度回调 (可为 NULL)
+   * @return 成功的文件数；小于 0 表示参数错误
+   */
+  DLLEXPORT int get_video_metadata_batch(const char* const* video_paths, int count, int flags, VideoInfoResult* out_results,
+    MetadataProgressCallback progress);
+
+  /**
+   * @brief 获取视频流全部关键帧的时间戳（毫秒，升序）。
+   *        优先读取容器自带索引 (MP4 stss / Matroska Cues)，否则逐包扫描（不解码）。
+   * @param video_path 视频文件的完整路径。
+   * @param out_array  [输出] 关键帧时间戳数组，可为 NULL (仅查询数量)。
+   * @param capacity   out_array 的容量。
+   * @return 关键帧总数 (可能大于 capacity，此时只写入前 capacity 个)。小于 0 表示失败。
+   */
+  DLLEXPORT int get_keyframes(const char* video_path, long long* out_array, int capacity);
+
   /**
    * @brief [新增功能] 获取视频时长（毫秒）。
    * @param video_path 视频文件的完整路径。
@@ -36,6 +156,15 @@ extern "C" {
    */
   DLLEXPORT int generate_screenshot(const char* video_path, long long timestamp_ms, const char* output_path);
 
+  /**
+   * @brief [扩展] 带选项的单张截图。
+   * @param options       截图选项，可为 NULL。
+   * @param out_actual_ms [输出] 实际使用帧的时间戳 (毫秒)，可为 NULL。
+   * @return 0 表示成功, 小于 0 表示失败。
+   */
+  DLLEXPORT int generate_screenshot_ex(const char* video_path, long long timestamp_ms, const char* output_path,
+    const ScreenshotOptions* options, long long* out_actual_ms);
+
   /**
    * @brief [新增功能] 根据视频时长的百分比生成截图。
    * @param video_path 视频文件的完整路径。
@@ -45,16 +174,83 @@ extern "C" {
    */
   DLLEXPORT int generate_screenshot_at_percentage(const char* video_path, double percentage, const char* output_path);
 
+  /**
+   * @brief [扩展] 带选项的百分比截图。
+   * @param options 截图选项，可为 NULL。
+   */
+  DLLEXPORT int generate_screenshot_at_percentage_ex(const char* video_path, double percentage, const char* output_path,
+    const ScreenshotOptions* options);
+
   /**
    * @brief [批量功能] 单视频多截图 (高性能版)。
    */
   DLLEXPORT int generate_screenshots_for_video(const char* video_path, const long long* timestamps_ms, int count, const char* output_path_template);
 
+  /**
+   * @brief [扩展] 带选项的单视频多截图。文件名中的 %ms 仍替换为请求的时间戳。
+   *        output_path_template 以 .gra 结尾时写入截图归档 (WebP，键为请求的时间戳，见 ThumbArchive.h)。
+   *
+   *        options->select_mode 为 SCREENSHOT_SELECT_SCENES 时 timestamps_ms 可为 NULL，count 为截图张数:
+   *        先分析镜头切换 (seek_mode 为 KEYFRAME 时只解码关键帧，否则逐帧抽样)，把时间轴等分为 count 段，
+   *        每段取切换最明显的新镜头第一帧，没有切换的段取中点；%ms / 归档键为选出的时间戳。
+   * @param options       截图选项，可为 NULL。
+   * @param out_actual_ms [输出] 长度为 count，与 timestamps_ms 一一对应的实际帧时间戳；失败项为 -1。可为 NULL。
+   *                      场景模式下为选出的时间戳 (升序)。
+   * @param out_stats     [输出] 解码统计，可为 NULL。
+   * @return 成功生成的截图数量，小于 0 表示打开视频失败。
+   */
+  DLLEXPORT int generate_screenshots_for_video_ex(const char* video_path, const long long* timestamps_ms, int count,
+    const char* output_path_template, const ScreenshotOptions* options, long long* out_actual_ms,
+    ScreenshotBatchStats* out_stats);
+
   /**
    * @brief [批量功能] 多视频同时间点截图 (IO优化版)。
    */
   DLLEXPORT int generate_screenshots_for_videos(const char* const* video_paths, int count, long long timestamp_ms, const char* output_dir);
 
+  /**
+   * @brief [扩展] 带选项的多视频同时间点截图。
+   * @param options 截图选项，可为 NULL。
+   */
+  DLLEXPORT int generate_screenshots_for_videos_ex(const char* const* video_paths, int count, long long timestamp_ms,
+    const char* output_dir, const ScreenshotOptions* options);
+
+  /**
+   * @brief [异步] 提交单视频多截图任务 (参数在调用时拷贝)，立即返回。进度单位为截图张数，
+   *        通过 job_poll / job_cancel / job_wait / job_release (core/Job.h) 管理；
+   *        结束后 result 与 generate_screenshots_for_video_ex 的返回值相同。
+   * @param options 截图选项，可为 NULL (priority 决定任务在线程池中的优先级)。
+   * @return 任务编号；小于 0 表示参数错误。
+   */
+  DLLEXPORT long long generate_screenshots_for_video_submit(const char* video_path, const long long* timestamps_ms,
+    int count, const char* output_path_template, const ScreenshotOptions* options);
+
+  /**
+   * @brief 读取已结束的单视频多截图任务的实际帧时间戳 (与提交的 timestamps_ms 一一对应，失败项为 -1)。
+   * @return 写入的数量；任务不存在、类型不符或尚未结束时返回 -1。
+   */
+  DLLEXPORT int screenshot_job_actual_ms(long long job_id, long long* out_actual_ms, int capacity);
+
+  /**
+   * @brief [异步] 提交多视频同时间点截图任务，立即返回。进度单位为视频数量。
+   * @return 任务编号；小于 0 表示参数错误。
+   */
+  DLLEXPORT long long generate_screenshots_for_videos_submit(const char* const* video_paths, int count,
+    long long timestamp_ms, const char* output_dir, const ScreenshotOptions* options);
+
+  /**
+   * @brief 按输出选项转换已有图片 (例如导出时旋转截图)，输出格式由后缀决定。
+   *        input_path 可以是截图归档中的项 "<归档路径>#<键>"。
+   * @param output 输出选项，可为 NULL。
+   * @return 0 表示成功, 小于 0 表示失败。
+   */
+  DLLEXPORT int convert_image_file(const char* input_path, const char* output_path, const ScreenshotOutputOptions* output);
+
+  /**
+   * @brief 进程内打开过的图片编码器总数 (各线程编码缓存未命中的次数)，用于确认编码器被复用。
+   */
+  DLLEXPORT long long image_encoder_open_count();
+
 #ifdef __cplusplus
 }
 #endif
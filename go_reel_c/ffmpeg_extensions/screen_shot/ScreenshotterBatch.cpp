@@ -1,181 +1,424 @@
 #include "Screenshotter.h"
 #include "ScreenshotterInternal.h"
+#include "ScreenshotterPlanner.h"
+#include "../core/Job.h"
+#include "../core/MediaCache.h"
+#include "../core/ThreadPool.h"
+#include "../scene_detect/SceneDetector.h"
+#include "../thumb_archive/ThumbArchive.h"
 #include <vector>
 #include <algorithm>
 #include <filesystem>
 #include <future>
+#include <memory>
+#include <string>
 #include <deque>
 #include <thread>
+#include <mutex>
+#include <atomic>
 
 using namespace std::chrono_literals;
 
 
+// 并行解码时每个解码器至少分到的目标数: 再少时多开一个 demuxer 的成本超过收益
+static const size_t kMinTargetsPerDecoder = 8;
+
+// 码率超过该值时主要受 I/O 限制，多路并发读取反而造成磁盘来回寻道
+static const int64_t kIoBoundBitRate = 80LL * 1000 * 1000;
+
+// 异步保存队列: 多个解码线程共享，在途任务数不超过 max_concurrent
+// 等待时不持有锁: ThreadPool::wait 可能在当前线程执行其它解码任务，它们同样会提交到这里
+// archive 不为 NULL 时编码到内存并写入归档 (键为 key)，否则写入 final_path
+class SaveQueue {
+public:
+  SaveQueue(int max_concurrent, int priority, const ScreenshotOutputOptions& output, ThumbArchiveWriter* archive)
+    : max_concurrent_((size_t)(std::max)(max_concurrent, 1)), priority_(priority), output_(output), archive_(archive) {}
+
+  // prepared 由 prepare_output_frame 生成，所有权转移给保存任务
+  void submit(AVFrame* prepared, std::string final_path, long long key) {
+    ThreadPool& pool = ThreadPool::instance();
+    std::future<int> oldest;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto it = tasks_.begin(); it != tasks_.end(); ) {
+        if (it->wait_for(0s) == std::future_status::ready) {
+          if (it->get() == 0) success_count_++;
+          it = tasks_.erase(it);
+        }
+        else {
+          ++it;
+        }
+      }
+
+      if (tasks_.size() >= max_concurrent_) {
+        oldest = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+    }
+    if (oldest.valid() && pool.wait(oldest) == 0) success_count_++;
+
+    ScreenshotOutputOptions output = output_;
+    ThumbArchiveWriter* archive = archive_;
+    std::future<int> task = pool.async(priority_, [prepared, final_path, key, output, archive]() {
+      int res;
+      if (archive) {
+        std::vector<uint8_t> encoded;
+        res = encode_prepared_frame(prepared, ".webp", &output, encoded);
+        if (res == 0) res = archive->put(key, encoded.data(), encoded.size());
+      }
+      else {
+        // [修改] 调用新的内部函数，支持多种格式
+        res = save_prepared_frame(prepared, final_path.c_str(), &output);
+      }
+      AVFrame* to_free = prepared;
+      av_frame_free(&to_free); // 缓冲区归还 FramePool
+      return res;
+      });
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+
+  int wait_all() {
+    std::deque<std::future<int>> remaining;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      remaining.swap(tasks_);
+    }
+    for (auto& task : remaining) {
+      if (ThreadPool::instance().wait(task) == 0) success_count_++;
+    }
+    return success_count_;
+  }
+
+private:
+  std::mutex mutex_;
+  std::deque<std::future<int>> tasks_;
+  size_t max_concurrent_;
+  int priority_;
+  ScreenshotOutputOptions output_;
+  ThumbArchiveWriter* archive_;
+  std::atomic<int> success_count_{ 0 };
+};
+
+// 根据 CPU 预算、分辨率与码率决定并行解码器数量
+static int choose_decoder_count(MediaContext* media, size_t target_count, int requested) {
+  int by_targets = (int)(std::max)(target_count / kMinTargetsPerDecoder, (size_t)1);
+  if (requested > 0) return (std::min)(requested, by_targets);
+
+  int k = (std::max)(ThreadPool::instance().cpu_budget() / 2, 1);
+  const AVCodecParameters* par = media->video_stream()->codecpar;
+  if ((int64_t)par->width * par->height < 1280 * 720) k = (std::min)(k, 2); // 低分辨率解码很便宜
+  if (media->format_ctx->bit_rate > kIoBoundBitRate) k = (std::min)(k, 4);
+  k = (std::min)(k, 8);
+
+  return (std::min)(k, by_targets);
+}
+
+// 把升序目标切成 k 段，切分点对齐到关键帧: 同一 GOP 的目标必须在同一段内
+static std::vector<std::pair<size_t, size_t>> partition_targets(const std::vector<ShotTarget>& targets, int k) {
+  std::vector<std::pair<size_t, size_t>> ranges;
+  size_t n = targets.size();
+  size_t begin = 0;
+
+  for (int part = 1; part <= k && begin < n; part++) {
+    size_t end = part == k ? n : (std::max)(n * part / k, begin + 1);
+    while (end < n && targets[end].keyframe != AV_NOPTS_VALUE && targets[end].keyframe == targets[end - 1].keyframe) {
+      end++;
+    }
+    ranges.push_back({ begin, end });
+    begin = end;
+  }
+  return ranges;
+}
+
+// 最佳场景帧: 时间轴等分为 count 段，每段取切换分数最高的新镜头第一帧，没有切换的段取中点 (升序)
+// 先只选时间点再用批量解码截图: 同时持有 count 张待选的输出帧会超出 FramePool 预算
+static std::vector<long long> select_scene_timestamps(MediaContext* media, int count, const ScreenshotOptions& options) {
+  std::vector<long long> selected;
+  long long duration_ms = media_duration_ms(media);
+  if (duration_ms <= 0) return selected;
+
+  SceneDetectOptions scene_options = resolve_scene_options(nullptr);
+  scene_options.analyze_mode = options.seek_mode == SCREENSHOT_SEEK_KEYFRAME ? SCENE_ANALYZE_KEYFRAMES : SCENE_ANALYZE_FRAMES;
+
+  std::vector<double> best_score(count, 0.0);
+  selected.resize(count);
+  for (int i = 0; i < count; i++) selected[i] = (2 * i + 1) * duration_ms / (2LL * count);
+
+  int ret = run_scene_analysis(media, scene_options, [&](long long frame_ms, double score, bool scene_start) {
+    if (!scene_start || score <= 0) return; // 视频开头不算切换
+    int w = (int)(std::min)((std::max)(frame_ms, 0LL) * count / duration_ms, (long long)count - 1);
+    if (score > best_score[w]) {
+      best_score[w] = score;
+      selected[w] = frame_ms;
+    }
+    });
+  if (ret < 0) selected.clear();
+  return selected;
+}
+
 // =================================================================
 // 3. [核心功能] 单视频批量截图
+//    目标较多时按关键帧切段，每段使用独立的 demuxer + 解码器并行处理
 // =================================================================
-DLLEXPORT int generate_screenshots_for_video(const char* video_path, const long long* timestamps_ms, int count, const char* output_path_template) {
+DLLEXPORT int generate_screenshots_for_video_ex(const char* video_path, const long long* timestamps_ms, int count,
+  const char* output_path_template, const ScreenshotOptions* options, long long* out_actual_ms,
+  ScreenshotBatchStats* out_stats) {
+  if (out_stats) *out_stats = ScreenshotBatchStats{};
   if (count <= 0) return 0;
 
+  if (out_actual_ms) std::fill(out_actual_ms, out_actual_ms + count, -1LL);
+  ScreenshotOptions resolved = resolve_screenshot_options(options);
+
+  if (resolved.select_mode == SCREENSHOT_SELECT_SCENES) {
+    std::vector<long long> selected;
+    {
+      av_log_set_level(AV_LOG_ERROR);
+      MediaLease media = MediaCache::instance().acquire(video_path, ThreadPool::instance().decoder_threads());
+      if (!media || !media->video_stream()) return -1;
+      selected = select_scene_timestamps(media.get(), count, resolved);
+    }
+    if (selected.empty() || job_cancelled()) return selected.empty() ? -1 : 0;
+
+    // 选出的时间点按普通模式截图 (上下文已归还缓存，关键帧列表等状态可以复用)
+    resolved.select_mode = SCREENSHOT_SELECT_TIMESTAMPS;
+    std::vector<long long> actual(count, -1);
+    int ret = generate_screenshots_for_video_ex(video_path, selected.data(), count, output_path_template, &resolved,
+      actual.data(), out_stats);
+    if (out_actual_ms) {
+      for (int i = 0; i < count; i++) out_actual_ms[i] = actual[i] >= 0 ? selected[i] : -1;
+    }
+    return ret;
+  }
+
   std::vector<long long> sorted_timestamps(timestamps_ms, timestamps_ms + count);
   std::sort(sorted_timestamps.begin(), sorted_timestamps.end());
   sorted_timestamps.erase(std::unique(sorted_timestamps.begin(), sorted_timestamps.end()), sorted_timestamps.end());
 
   av_log_set_level(AV_LOG_ERROR);
 
-  unsigned int max_concurrent = std::thread::hardware_concurrency();
-  if (max_concurrent == 0) max_concurrent = 4;
-  std::deque<std::future<int>> tasks;
-
-  int success_count = 0;
-
-  AVFormatContext* format_ctx = nullptr;
-  if (avformat_open_input(&format_ctx, video_path, NULL, NULL) != 0) {
+  ThreadPool& pool = ThreadPool::instance();
+  MediaLease media = MediaCache::instance().acquire(video_path, pool.decoder_threads());
+  if (!media) {
     return -1;
   }
 
-  if (avformat_find_stream_info(format_ctx, NULL) < 0) {
-    avformat_close_input(&format_ctx);
-    return -1;
+  // 归档模式: 全部截图写入同一个文件，结束时一次性提交索引
+  std::unique_ptr<ThumbArchiveWriter> archive;
+  if (ends_with_ignore_case(output_path_template, ".gra")) {
+    archive.reset(new ThumbArchiveWriter(output_path_template));
+    if (!archive->is_open()) return -2;
   }
+  SaveQueue save_queue(pool.cpu_budget(), resolved.priority, resolved.output, archive.get());
+
+  std::vector<ShotTarget> targets = plan_shot_targets(media.get(), sorted_timestamps, resolved);
+  std::vector<long long> actual_ms(targets.size(), -1);
+
+  int decoder_count = choose_decoder_count(media.get(), targets.size(), resolved.parallel_decoders);
+  std::vector<std::pair<size_t, size_t>> ranges = partition_targets(targets, decoder_count);
+  std::vector<ScreenshotBatchStats> range_stats(ranges.size(), ScreenshotBatchStats{});
+
+  auto on_frame = [&](size_t first, size_t last, const AVFrame* frame, long long frame_ms) {
+    // 异步任务被取消后不再提交新的保存任务
+    if (job_cancelled()) return;
+    job_add_progress((long long)(last - first), 0, 0);
+
+    // 每帧只转换一次 (裁剪 / 缩小到输出尺寸)，共用该帧的目标只增加引用
+    AVFrame* prepared = nullptr;
+
+    for (size_t t = first; t < last; t++) {
+      long long target_ms = targets[t].target_ms;
+      std::string final_path = output_path_template;
+      if (!archive) {
+        size_t pos = final_path.find("%ms");
+        if (pos != std::string::npos) {
+          final_path.replace(pos, 3, std::to_string(target_ms));
+        }
+        else {
+          final_path += "_" + std::to_string(target_ms);
+        }
+      }
 
-  const AVCodec* decoder = nullptr;
-  int video_stream_index = av_find_best_stream(format_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
-  if (video_stream_index < 0) {
-    avformat_close_input(&format_ctx);
-    return -1;
-  }
-
-  AVStream* video_stream = format_ctx->streams[video_stream_index];
-  AVCodecContext* codec_ctx_dec = avcodec_alloc_context3(decoder);
-  avcodec_parameters_to_context(codec_ctx_dec, video_stream->codecpar);
-  codec_ctx_dec->thread_count = 0;
-
-  if (avcodec_open2(codec_ctx_dec, decoder, NULL) < 0) {
-    avcodec_free_context(&codec_ctx_dec);
-    avformat_close_input(&format_ctx);
-    return -1;
-  }
+      actual_ms[t] = frame_ms;
 
-  AVFrame* frame = av_frame_alloc();
-  AVPacket* packet = av_packet_alloc();
+      if (!prepared) prepared = prepare_output_frame(frame, archive ? ".webp" : final_path.c_str(), &resolved.output);
+      if (!prepared) continue;
 
-  for (long long target_ms : sorted_timestamps) {
-    std::string final_path = output_path_template;
-    size_t pos = final_path.find("%ms");
-    if (pos != std::string::npos) {
-      final_path.replace(pos, 3, std::to_string(target_ms));
-    }
-    else {
-      final_path += "_" + std::to_string(target_ms);
+      AVFrame* frame_ref = t + 1 < last ? av_frame_clone(prepared) : prepared;
+      if (!frame_ref) continue;
+      save_queue.submit(frame_ref, final_path, target_ms);
     }
+  };
 
-    int64_t seek_target = av_rescale(target_ms, video_stream->time_base.den, (int64_t)video_stream->time_base.num * 1000);
+  auto run_range = [&](MediaContext* ctx, size_t range_index) {
+    size_t begin = ranges[range_index].first;
+    size_t end = ranges[range_index].second;
+    std::vector<ShotTarget> sub(targets.begin() + begin, targets.begin() + end);
 
-    if (av_seek_frame(format_ctx, video_stream_index, seek_target, AVSEEK_FLAG_BACKWARD) < 0) {
-      continue;
-    }
+    BatchFrameDecoder decoder(ctx, resolved, &range_stats[range_index]);
+    decoder.run(sub, [&](size_t first, size_t last, const AVFrame* frame, long long frame_ms) {
+      on_frame(begin + first, begin + last, frame, frame_ms);
+    });
+  };
 
-    avcodec_flush_buffers(codec_ctx_dec);
-
-    while (av_read_frame(format_ctx, packet) >= 0) {
-      if (packet->stream_index == video_stream_index) {
-        if (avcodec_send_packet(codec_ctx_dec, packet) == 0) {
-          while (avcodec_receive_frame(codec_ctx_dec, frame) == 0) {
-            int64_t frame_ts_ms = av_rescale_q(frame->pts, video_stream->time_base, { 1, 1000 });
-
-            if (frame_ts_ms >= target_ms) {
-              AVFrame* frame_clone = av_frame_clone(frame);
-              if (!frame_clone) break;
-
-              for (auto it = tasks.begin(); it != tasks.end(); ) {
-                if (it->wait_for(0s) == std::future_status::ready) {
-                  if (it->get() == 0) success_count++;
-                  it = tasks.erase(it);
-                }
-                else {
-                  ++it;
-                }
-              }
-
-              if (tasks.size() >= max_concurrent) {
-                if (tasks.front().get() == 0) success_count++;
-                tasks.pop_front();
-              }
-
-              tasks.push_back(std::async(std::launch::async, [frame_clone, final_path]() {
-                // [修改] 调用新的内部函数，支持多种格式
-                int res = save_frame_internal(frame_clone, final_path.c_str());
-                AVFrame* to_free = frame_clone;
-                av_frame_free(&to_free);
-                return res;
-                }));
-
-              goto next_timestamp_label;
-            }
-          }
+  if (ranges.size() <= 1) {
+    run_range(media.get(), 0);
+  }
+  else {
+    // 每个解码器分到的线程数，总数约等于 CPU 预算
+    int threads_per_decoder = (std::max)(pool.cpu_budget() / (int)ranges.size(), 1);
+    if (media->open_decoder(threads_per_decoder) < 0) return -1;
+
+    std::vector<std::future<void>> workers;
+    for (size_t r = 1; r < ranges.size(); r++) {
+      workers.push_back(pool.async(resolved.priority, [&, r]() {
+        MediaLease lease = MediaCache::instance().acquire(video_path, threads_per_decoder);
+        if (!lease) return;
+        if (!lease->keyframes_loaded && media->keyframes_loaded) {
+          lease->keyframes = media->keyframes;
+          lease->keyframes_loaded = true;
         }
-      }
-      av_packet_unref(packet);
+        run_range(lease.get(), r);
+        }));
     }
-  next_timestamp_label:
-    av_packet_unref(packet);
+
+    run_range(media.get(), 0);
+    for (auto& worker : workers) pool.wait(worker);
   }
 
-  for (auto& task : tasks) {
-    if (task.get() == 0) success_count++;
+  int success_count = save_queue.wait_all();
+  if (archive && archive->commit() != 0) success_count = 0;
+
+  if (out_actual_ms) {
+    for (int i = 0; i < count; i++) {
+      auto it = std::lower_bound(sorted_timestamps.begin(), sorted_timestamps.end(), timestamps_ms[i]);
+      out_actual_ms[i] = actual_ms[it - sorted_timestamps.begin()];
+    }
   }
 
-  av_packet_free(&packet);
-  av_frame_free(&frame);
-  avcodec_free_context(&codec_ctx_dec);
-  avformat_close_input(&format_ctx);
+  if (out_stats) {
+    for (const auto& st : range_stats) {
+      out_stats->seeks += st.seeks;
+      out_stats->packets_read += st.packets_read;
+      out_stats->packets_skipped += st.packets_skipped;
+      out_stats->frames_decoded += st.frames_decoded;
+      out_stats->frames_used += st.frames_used;
+    }
+  }
 
   return success_count;
 }
 
+DLLEXPORT int generate_screenshots_for_video(const char* video_path, const long long* timestamps_ms, int count, const char* output_path_template) {
+  return generate_screenshots_for_video_ex(video_path, timestamps_ms, count, output_path_template, nullptr, nullptr, nullptr);
+}
+
 
 // =================================================================
 // 4. [修改] 多视频处理 (适配 save_frame_internal 的变化)
 // =================================================================
-DLLEXPORT int generate_screenshots_for_videos(const char* const* video_paths, int count, long long timestamp_ms, const char* output_dir) {
+DLLEXPORT int generate_screenshots_for_videos_ex(const char* const* video_paths, int count, long long timestamp_ms,
+  const char* output_dir, const ScreenshotOptions* options) {
+  ScreenshotOptions resolved = resolve_screenshot_options(options);
+  ThreadPool& pool = ThreadPool::instance();
   int total_success = 0;
-  unsigned int max_concurrent = std::thread::hardware_concurrency();
-  if (max_concurrent == 0) max_concurrent = 4;
 
-  std::deque<std::future<int>> file_tasks;
+  // 并发数由线程池的 CPU 预算控制
+  std::vector<std::future<int>> file_tasks;
+  file_tasks.reserve(count > 0 ? count : 0);
 
   for (int i = 0; i < count; ++i) {
-    for (auto it = file_tasks.begin(); it != file_tasks.end(); ) {
-      if (it->wait_for(0s) == std::future_status::ready) {
-        if (it->get() == 0) total_success++;
-        it = file_tasks.erase(it);
-      }
-      else {
-        ++it;
-      }
-    }
-
-    if (file_tasks.size() >= max_concurrent) {
-      if (file_tasks.front().get() == 0) total_success++;
-      file_tasks.pop_front();
-    }
-
     std::string v_path = video_paths[i];
     std::string o_dir = output_dir;
 
-    file_tasks.push_back(std::async(std::launch::async, [v_path, o_dir, timestamp_ms]() {
+    file_tasks.push_back(pool.async(resolved.priority, [v_path, o_dir, timestamp_ms, resolved]() {
+      if (job_cancelled()) return -1;
+
       std::filesystem::path video_p(v_path);
       // 默认保存为 webp，如果需要其他格式，可以在这里修改逻辑或者传入参数
       std::string output_filename = video_p.stem().string() + ".webp";
       std::filesystem::path final_path = std::filesystem::path(o_dir) / output_filename;
 
-      return generate_screenshot(v_path.c_str(), timestamp_ms, final_path.string().c_str());
+      int res = generate_screenshot_ex(v_path.c_str(), timestamp_ms, final_path.string().c_str(), &resolved, nullptr);
+      job_add_progress(1, 0, 0);
+      return res;
       }));
   }
 
   for (auto& t : file_tasks) {
-    if (t.get() == 0) total_success++;
+    if (pool.wait(t) == 0) total_success++;
   }
 
   return total_success;
 }
+
+DLLEXPORT int generate_screenshots_for_videos(const char* const* video_paths, int count, long long timestamp_ms, const char* output_dir) {
+  return generate_screenshots_for_videos_ex(video_paths, count, timestamp_ms, output_dir, nullptr);
+}
+
+
+// =================================================================
+// 5. 异步任务版本 (参数拷贝到任务数据中，结果在任务结束后读取)
+// =================================================================
+struct ScreenshotJobData {
+  std::vector<std::string> video_paths;
+  std::vector<long long> timestamps_ms;
+  std::string output;
+  ScreenshotOptions options;
+  std::vector<long long> actual_ms;
+};
+
+DLLEXPORT long long generate_screenshots_for_video_submit(const char* video_path, const long long* timestamps_ms,
+  int count, const char* output_path_template, const ScreenshotOptions* options) {
+  ScreenshotOptions resolved = resolve_screenshot_options(options);
+  bool select_scenes = resolved.select_mode == SCREENSHOT_SELECT_SCENES;
+  if (!video_path || !output_path_template || count < 0 || (count > 0 && !timestamps_ms && !select_scenes)) return -1;
+
+  auto data = std::make_shared<ScreenshotJobData>();
+  data->video_paths.push_back(video_path);
+  if (select_scenes) data->timestamps_ms.assign(count, 0); // 只占位，时间点在任务中选出
+  else data->timestamps_ms.assign(timestamps_ms, timestamps_ms + count);
+  data->output = output_path_template;
+  data->options = resolved;
+  data->actual_ms.assign(count, -1);
+
+  // 进度按去重后的目标计数
+  std::vector<long long> unique_ms = data->timestamps_ms;
+  std::sort(unique_ms.begin(), unique_ms.end());
+  long long total = select_scenes ? count : std::unique(unique_ms.begin(), unique_ms.end()) - unique_ms.begin();
+
+  ScreenshotJobData* raw = data.get();
+  return JobRegistry::instance().submit(JOB_KIND_SCREENSHOTS, data->options.priority, total, data, [raw]() {
+    return generate_screenshots_for_video_ex(raw->video_paths[0].c_str(), raw->timestamps_ms.data(),
+      (int)raw->timestamps_ms.size(), raw->output.c_str(), &raw->options, raw->actual_ms.data(), nullptr);
+    });
+}
+
+DLLEXPORT int screenshot_job_actual_ms(long long job_id, long long* out_actual_ms, int capacity) {
+  std::shared_ptr<void> payload = JobRegistry::instance().finished_payload(job_id, JOB_KIND_SCREENSHOTS);
+  if (!payload) return -1;
+  const ScreenshotJobData* data = static_cast<const ScreenshotJobData*>(payload.get());
+  int n = (std::min)((int)data->actual_ms.size(), (std::max)(capacity, 0));
+  if (out_actual_ms) std::copy(data->actual_ms.begin(), data->actual_ms.begin() + n, out_actual_ms);
+  return n;
+}
+
+DLLEXPORT long long generate_screenshots_for_videos_submit(const char* const* video_paths, int count,
+  long long timestamp_ms, const char* output_dir, const ScreenshotOptions* options) {
+  if (!output_dir || count < 0 || (count > 0 && !video_paths)) return -1;
+
+  auto data = std::make_shared<ScreenshotJobData>();
+  for (int i = 0; i < count; i++) data->video_paths.push_back(video_paths[i] ? video_paths[i] : "");
+  data->timestamps_ms.push_back(timestamp_ms);
+  data->output = output_dir;
+  data->options = resolve_screenshot_options(options);
+
+  ScreenshotJobData* raw = data.get();
+  return JobRegistry::instance().submit(JOB_KIND_SCREENSHOTS_MULTI, data->options.priority, count, data, [raw]() {
+    std::vector<const char*> paths;
+    for (const auto& p : raw->video_paths) paths.push_back(p.c_str());
+    return generate_screenshots_for_videos_ex(paths.data(), (int)paths.size(), raw->timestamps_ms[0],
+      raw->output.c_str(), &raw->options);
+    });
+}
@@ -0,0 +1,141 @@
+#include "Screenshotter.h"
+#include "ScreenshotterInternal.h"
+#include "../thumb_archive/ThumbArchive.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+
+// =================================================================
+// 7. 图片转换 (导出时旋转 / 缩放已有截图)
+//    解码图片文件的第一帧，复用截图的转换与编码流程
+// =================================================================
+// 按文件头识别截图归档中的图片格式
+static AVCodecID detect_image_codec(const uint8_t* data, int size) {
+  if (size >= 12 && memcmp(data, "RIFF", 4) == 0 && memcmp(data + 8, "WEBP", 4) == 0) return AV_CODEC_ID_WEBP;
+  if (size >= 8 && memcmp(data, "\x89PNG\r\n\x1a\n", 8) == 0) return AV_CODEC_ID_PNG;
+  if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF) return AV_CODEC_ID_MJPEG;
+  return AV_CODEC_ID_NONE;
+}
+
+// 解码内存中的单张图片 (不经过 demuxer)
+static int decode_image_memory(const uint8_t* data, int size, AVFrame* frame) {
+  const AVCodec* decoder = avcodec_find_decoder(detect_image_codec(data, size));
+  if (!decoder) return -1;
+
+  int ret = -1;
+  AVCodecContext* codec_ctx = avcodec_alloc_context3(decoder);
+  AVPacket* packet = av_packet_alloc();
+  if (!codec_ctx || !packet || avcodec_open2(codec_ctx, decoder, NULL) < 0) goto cleanup;
+
+  // 解码器要求输入带填充，拷贝一份
+  if (av_new_packet(packet, size) < 0) goto cleanup;
+  memcpy(packet->data, data, size);
+
+  if (avcodec_send_packet(codec_ctx, packet) >= 0) {
+    avcodec_send_packet(codec_ctx, NULL);
+    if (avcodec_receive_frame(codec_ctx, frame) == 0) ret = 0;
+  }
+
+cleanup:
+  if (packet) av_packet_free(&packet);
+  if (codec_ctx) avcodec_free_context(&codec_ctx);
+  return ret;
+}
+
+// "<归档路径>#<键>": 解码截图归档中的一项
+static bool split_archive_path(const char* path, std::string& archive_path, long long& key) {
+  const char* hash = strrchr(path, '#');
+  if (!hash || hash[1] == '\0') return false;
+
+  char* end = nullptr;
+  key = strtoll(hash + 1, &end, 10);
+  if (*end != '\0') return false;
+
+  archive_path.assign(path, hash - path);
+  return ends_with_ignore_case(archive_path.c_str(), ".gra");
+}
+
+static int decode_archive_image(const std::string& archive_path, long long key, AVFrame* frame) {
+  ThumbArchive* archive = thumb_archive_open(archive_path.c_str());
+  if (!archive) return -1;
+
+  int ret = -1;
+  int size = 0;
+  const uint8_t* data = thumb_archive_data(archive, thumb_archive_find(archive, key), &size);
+  if (data && size > 0) ret = decode_image_memory(data, size, frame);
+
+  thumb_archive_close(archive);
+  return ret;
+}
+
+int decode_image_file(const char* path, AVFrame* frame) {
+  if (!path || !frame) return -1;
+
+  std::string archive_path;
+  long long key = 0;
+  if (split_archive_path(path, archive_path, key)) return decode_archive_image(archive_path, key, frame);
+
+  int ret = -1;
+  AVFormatContext* format_ctx = nullptr;
+  AVCodecContext* codec_ctx = nullptr;
+  AVPacket* packet = nullptr;
+  const AVCodec* decoder = nullptr;
+  int stream_idx = -1;
+  bool draining = false;
+
+  if (avformat_open_input(&format_ctx, path, NULL, NULL) != 0) return -1;
+  if (avformat_find_stream_info(format_ctx, NULL) < 0) goto cleanup;
+
+  stream_idx = av_find_best_stream(format_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
+  if (stream_idx < 0 || !decoder) goto cleanup;
+
+  codec_ctx = avcodec_alloc_context3(decoder);
+  if (!codec_ctx) goto cleanup;
+  avcodec_parameters_to_context(codec_ctx, format_ctx->streams[stream_idx]->codecpar);
+  if (avcodec_open2(codec_ctx, decoder, NULL) < 0) goto cleanup;
+
+  packet = av_packet_alloc();
+  if (!packet) goto cleanup;
+
+  while (ret != 0) {
+    if (!draining) {
+      if (av_read_frame(format_ctx, packet) < 0) {
+        draining = true;
+        avcodec_send_packet(codec_ctx, NULL);
+      }
+      else {
+        if (packet->stream_index == stream_idx) avcodec_send_packet(codec_ctx, packet);
+        av_packet_unref(packet);
+      }
+    }
+
+    if (avcodec_receive_frame(codec_ctx, frame) == 0) {
+      ret = 0;
+    }
+    else if (draining) {
+      break;
+    }
+  }
+
+cleanup:
+  if (packet) av_packet_free(&packet);
+  if (codec_ctx) avcodec_free_context(&codec_ctx);
+  if (format_ctx) avformat_close_input(&format_ctx);
+  return ret;
+}
+
+DLLEXPORT int convert_image_file(const char* input_path, const char* output_path, const ScreenshotOutputOptions* output) {
+  if (!input_path || !output_path) return -1;
+
+  av_log_set_level(AV_LOG_ERROR);
+
+  AVFrame* frame = av_frame_alloc();
+  if (!frame) return -1;
+
+  int ret = decode_image_file(input_path, frame);
+  if (ret == 0) ret = save_frame_internal(frame, output_path, output);
+
+  av_frame_free(&frame);
+  return ret;
+}
@@ -1,34 +1,79 @@
 #include "Screenshotter.h" // 包含 DLLEXPORT 定义
 #include "ScreenshotterInternal.h" // 包含 FFmpeg 头文件
+#include "../core/IoBatch.h"
+#include "../core/MediaCache.h"
+#include "../core/MediaIndex.h"
+#include "../core/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+// format_ctx->duration 单位是 AV_TIME_BASE (微秒)，转换为毫秒，未知时返回 0
+static long long format_duration_ms(const AVFormatContext* format_ctx) {
+  if (format_ctx->duration != AV_NOPTS_VALUE) {
+    return format_ctx->duration / 1000;
+  }
+  return 0;
+}
+
+long long media_duration_ms(const MediaContext* media) {
+  return format_duration_ms(media->format_ctx);
+}
+
+// 持久化索引 (core/MediaIndex.h) 中的元数据: VideoInfoResult | int32 探测方式 (VideoProbeFlags)
+// VIDEO_PROBE_FAST 的时长 / 帧率可能是估算值，只给同样接受 FAST 的调用方使用；
+// 大小不一致 (旧版本写入，不知道探测方式) 视为未命中
+static bool index_lookup_info(const char* path, long long mtime, long long size, int flags, VideoInfoResult* out) {
+  std::vector<uint8_t> data;
+  if (!MediaIndex::instance().lookup(path, mtime, size, MEDIA_INDEX_VIDEO_INFO, data)) return false;
+  if (data.size() != sizeof(VideoInfoResult) + sizeof(int32_t)) return false;
+
+  int32_t stored_flags;
+  memcpy(&stored_flags, data.data() + sizeof(VideoInfoResult), sizeof(stored_flags));
+  if ((stored_flags & VIDEO_PROBE_FAST) && !(flags & VIDEO_PROBE_FAST)) return false;
+
+  memcpy(out, data.data(), sizeof(VideoInfoResult));
+  return true;
+}
+
+static void index_store_info(const char* path, long long mtime, long long size, int flags, const VideoInfoResult* info) {
+  uint8_t data[sizeof(VideoInfoResult) + sizeof(int32_t)];
+  int32_t stored_flags = flags & VIDEO_PROBE_FAST;
+  memcpy(data, info, sizeof(VideoInfoResult));
+  memcpy(data + sizeof(VideoInfoResult), &stored_flags, sizeof(stored_flags));
+  MediaIndex::instance().store(path, mtime, size, MEDIA_INDEX_VIDEO_INFO, data, sizeof(data));
+}
+
+static void fill_video_info(const AVFormatContext* format_ctx, int video_stream_index, VideoInfoResult* result);
 
 
 // =================================================================
 // 2. 获取视频时长 (毫秒)
 // =================================================================
 DLLEXPORT long long get_video_duration(const char* video_path) {
-  AVFormatContext* format_ctx = nullptr;
   // 抑制日志
   av_log_set_level(AV_LOG_ERROR);
 
-  if (avformat_open_input(&format_ctx, video_path, NULL, NULL) != 0) {
-    return -1;
-  }
+  long long mtime = 0, size = 0;
+  if (!video_path || !stat_media_file(video_path, mtime, size)) return -1;
 
-  // 必须调用这个才能获取准确时长
-  if (avformat_find_stream_info(format_ctx, NULL) < 0) {
-    avformat_close_input(&format_ctx);
-    return -1;
-  }
+  VideoInfoResult info;
+  if (index_lookup_info(video_path, mtime, size, VIDEO_PROBE_FULL, &info)) return info.duration_ms;
 
-  long long duration_ms = 0;
-  if (format_ctx->duration != AV_NOPTS_VALUE) {
-    // format_ctx->duration 单位是 AV_TIME_BASE (微秒)
-    // 转换为毫秒: duration / 1000
-    duration_ms = format_ctx->duration / 1000;
+  // 缓存未命中时内部会调用 avformat_find_stream_info，才能获取准确时长
+  MediaLease media = MediaCache::instance().acquire(video_path);
+  if (!media) {
+    return -1;
   }
 
-  avformat_close_input(&format_ctx);
-  return duration_ms;
+  // 顺便写入完整元数据，之后的 get_video_metadata 直接命中索引
+  fill_video_info(media->format_ctx, media->video_stream_index, &info);
+  if (info.success) index_store_info(video_path, mtime, size, VIDEO_PROBE_FULL, &info);
+  return media_duration_ms(media.get());
 }
 
 
@@ -36,53 +81,373 @@ DLLEXPORT long long get_video_duration(const char* video_path) {
 // 获取视频完整元数据
 // =================================================================
 
+// 快速探测: 最多读取 1MB / 分析 1 秒，帧率只看前几帧
+static const char* kFastProbeSize = "1048576";
+static const char* kFastAnalyzeDuration = "1000000";
+static const char* kFastFpsProbeSize = "3";
+
+static void copy_name(char* dst, size_t size, const char* name) {
+  snprintf(dst, size, "%s", name ? name : "");
+}
+
+// 显示矩阵的旋转，换算为顺时针 0 / 90 / 180 / 270 (与 ffmpeg 命令行自动旋转的取值相同)
+static int stream_rotation(const AVStream* stream) {
+  const AVCodecParameters* par = stream->codecpar;
+  const AVPacketSideData* sd = av_packet_side_data_get(par->coded_side_data, par->nb_coded_side_data,
+    AV_PKT_DATA_DISPLAYMATRIX);
+  if (!sd || sd->size < 9 * sizeof(int32_t)) return 0;
+
+  double theta = -av_display_rotation_get((const int32_t*)sd->data);
+  if (std::isnan(theta)) return 0;
+
+  int degrees = ((int)std::lround(theta / 90.0) * 90) % 360;
+  return degrees < 0 ? degrees + 360 : degrees;
+}
+
+// format_ctx->duration 只在 avformat_find_stream_info 之后可靠，跳过时用视频流时长兜底
+static long long probe_duration_ms(const AVFormatContext* format_ctx, const AVStream* stream) {
+  long long duration = format_duration_ms(format_ctx);
+  if (duration > 0 || !stream || stream->duration == AV_NOPTS_VALUE) return duration;
+  return av_rescale_q(stream->duration, stream->time_base, AVRational{ 1, 1000 });
+}
+
+// 从已打开的格式上下文填充元数据 (video_stream_index < 0 时 success = 0)
+static void fill_video_info(const AVFormatContext* format_ctx, int video_stream_index, VideoInfoResult* result) {
+  *result = {};
+  result->profile = AV_PROFILE_UNKNOWN;
+  result->pixel_format = AV_PIX_FMT_NONE;
+
+  AVStream* stream = video_stream_index >= 0 ? format_ctx->streams[video_stream_index] : nullptr;
+
+  // 1. 获取总时长 (转换 AV_TIME_BASE 到 毫秒)
+  result->duration_ms = probe_duration_ms(format_ctx, stream);
+  result->bit_rate = format_ctx->bit_rate;
+
+  // 音频: 第一个音频流
+  for (unsigned int i = 0; i < format_ctx->nb_streams; i++) {
+    const AVCodecParameters* par = format_ctx->streams[i]->codecpar;
+    if (par->codec_type != AVMEDIA_TYPE_AUDIO) continue;
+    result->has_audio = 1;
+    result->audio_codec_id = par->codec_id;
+    copy_name(result->audio_codec, sizeof(result->audio_codec), avcodec_get_name(par->codec_id));
+    break;
+  }
+
+  // 2. 最佳视频流
+  if (!stream) return;
+
+  AVCodecParameters* codecpar = stream->codecpar;
+
+  // 获取宽、高
+  result->width = codecpar->width;
+  result->height = codecpar->height;
+
+  // 获取帧率 (优先使用 avg_frame_rate)
+  if (stream->avg_frame_rate.den > 0) {
+    result->framerate = av_q2d(stream->avg_frame_rate);
+  }
+  else if (stream->r_frame_rate.den > 0) {
+    // 如果 avg 无效，尝试 r_frame_rate (基本帧率)
+    result->framerate = av_q2d(stream->r_frame_rate);
+  }
+  else {
+    result->framerate = 30.0; // 兜底
+  }
+
+  // 编码参数
+  result->video_codec_id = codecpar->codec_id;
+  result->profile = codecpar->profile;
+  result->pixel_format = codecpar->format;
+  result->rotation = stream_rotation(stream);
+  if (result->bit_rate <= 0) result->bit_rate = codecpar->bit_rate;
+  copy_name(result->video_codec, sizeof(result->video_codec), avcodec_get_name(codecpar->codec_id));
+  copy_name(result->pixel_format_name, sizeof(result->pixel_format_name),
+    av_get_pix_fmt_name((AVPixelFormat)codecpar->format));
+
+  result->success = 1; // 标记成功
+}
+
 DLLEXPORT VideoInfoResult get_video_metadata(const char* video_path) {
-  VideoInfoResult result = { 0, 0, 0, 0.0, 0 }; // 初始化默认值 (success=0)
+  VideoInfoResult result = {}; // 初始化默认值 (success=0)
 
   // 抑制日志
   av_log_set_level(AV_LOG_ERROR);
 
-  AVFormatContext* format_ctx = nullptr;
-  if (avformat_open_input(&format_ctx, video_path, NULL, NULL) != 0) {
+  long long mtime = 0, size = 0;
+  if (!video_path || !stat_media_file(video_path, mtime, size)) return result;
+  if (index_lookup_info(video_path, mtime, size, VIDEO_PROBE_FULL, &result)) return result;
+
+  MediaLease media = MediaCache::instance().acquire(video_path);
+  if (!media) {
     return result;
   }
 
-  if (avformat_find_stream_info(format_ctx, NULL) < 0) {
-    avformat_close_input(&format_ctx);
-    return result;
+  // 最佳视频流在打开时已查找
+  fill_video_info(media->format_ctx, media->video_stream_index, &result);
+  if (result.success) index_store_info(video_path, mtime, size, VIDEO_PROBE_FULL, &result);
+  return result;
+}
+
+// 容器头是否已经给出全部需要的字段 (MKV / 部分 MP4 的轨道头)，此时不需要读包解码
+static bool headers_complete(const AVFormatContext* format_ctx, int video_stream_index) {
+  if (video_stream_index < 0) return false;
+  const AVStream* video = format_ctx->streams[video_stream_index];
+  const AVCodecParameters* par = video->codecpar;
+  if (par->codec_id == AV_CODEC_ID_NONE || par->width <= 0 || par->height <= 0 || par->format < 0) return false;
+  if (video->avg_frame_rate.den <= 0 || video->avg_frame_rate.num <= 0) return false;
+  if (probe_duration_ms(format_ctx, video) <= 0) return false;
+
+  for (unsigned int i = 0; i < format_ctx->nb_streams; i++) {
+    const AVCodecParameters* p = format_ctx->streams[i]->codecpar;
+    if (p->codec_type == AVMEDIA_TYPE_AUDIO && (p->codec_id == AV_CODEC_ID_NONE || p->sample_rate <= 0)) return false;
   }
+  return true;
+}
 
-  // 1. 获取总时长 (转换 AV_TIME_BASE 到 毫秒)
-  if (format_ctx->duration != AV_NOPTS_VALUE) {
-    result.duration_ms = format_ctx->duration / 1000;
+// 不经过 MediaCache: 批量探测整个媒体库时会把缓存中正在使用的上下文挤出去
+static void probe_video_file(const char* video_path, int flags, VideoInfoResult* result) {
+  *result = {};
+  long long mtime = 0, size = 0;
+  if (!video_path || !stat_media_file(video_path, mtime, size)) return;
+  // 完整探测的结果 FAST 也可以使用，反之不行；FAST 只在没有完整结果时写入，不会覆盖完整结果
+  if (index_lookup_info(video_path, mtime, size, flags, result)) return;
+
+  AVDictionary* options = nullptr;
+  if (flags & VIDEO_PROBE_FAST) {
+    av_dict_set(&options, "probesize", kFastProbeSize, 0);
+    av_dict_set(&options, "analyzeduration", kFastAnalyzeDuration, 0);
+    av_dict_set(&options, "fpsprobesize", kFastFpsProbeSize, 0);
+  }
+
+  AVFormatContext* format_ctx = nullptr;
+  int ret = avformat_open_input(&format_ctx, video_path, NULL, &options);
+  av_dict_free(&options);
+  if (ret != 0) return;
+
+  int stream_idx = av_find_best_stream(format_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+  bool ready = (flags & VIDEO_PROBE_FAST) && headers_complete(format_ctx, stream_idx);
+
+  if (!ready) {
+    // MP4 等容器头里没有像素格式 / profile，仍需解码首帧 (FAST 下读取量受上面的限制)
+    ready = avformat_find_stream_info(format_ctx, NULL) >= 0;
+    stream_idx = av_find_best_stream(format_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
   }
 
-  // 2. 查找最佳视频流
-  int video_stream_index = av_find_best_stream(format_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+  if (ready) fill_video_info(format_ctx, stream_idx, result);
+  avformat_close_input(&format_ctx);
+
+  if (result->success) index_store_info(video_path, mtime, size, flags, result);
+}
+
+DLLEXPORT VideoInfoResult probe_video_metadata(const char* video_path, int flags) {
+  VideoInfoResult result;
+
+  av_log_set_level(AV_LOG_ERROR);
+  probe_video_file(video_path, flags, &result);
+  return result;
+}
+
+DLLEXPORT int get_video_metadata_batch(const char* const* video_paths, int count, int flags, VideoInfoResult* out_results,
+  MetadataProgressCallback progress) {
+  if (!video_paths || !out_results || count < 0) return -1;
+  if (count == 0) return 0;
+
+  av_log_set_level(AV_LOG_ERROR);
+
+  // 探测除了读取文件头还要解析 / 解码少量数据，并发数同时受磁盘与 CPU 预算限制
+  int queue_depth = (std::min)(storage_queue_depth(video_paths[0]), (std::max)(ThreadPool::instance().cpu_budget(), 2));
+
+  std::atomic<int> succeeded{ 0 };
+  run_io_batch(count, queue_depth, [&](int i) {
+    probe_video_file(video_paths[i], flags, &out_results[i]);
+    if (out_results[i].success) succeeded++;
+    }, [&](int processed, int total, int) {
+      if (progress) progress(processed, total);
+    });
+
+  return succeeded.load();
+}
+
+
+// =================================================================
+// 获取关键帧列表
+// =================================================================
+
+// 这些容器的索引包含每一个视频关键帧 (MP4/MOV 的 stss + 样本表、Matroska 的 Cues、AVI 的 idx1)
+static bool has_complete_keyframe_index(const AVFormatContext* format_ctx) {
+  const char* name = format_ctx->iformat ? format_ctx->iformat->name : nullptr;
+  if (!name) return false;
+  return strstr(name, "mov") || strstr(name, "matroska") || strcmp(name, "avi") == 0;
+}
 
-  if (video_stream_index >= 0) {
-    AVStream* stream = format_ctx->streams[video_stream_index];
-    AVCodecParameters* codecpar = stream->codecpar;
+// MP4/MOV 的样本表与 AVI 的 idx1 记录的是 dts；Matroska 的 Cues 本身就是 pts，不能再加偏移
+static bool index_holds_dts(const AVFormatContext* format_ctx) {
+  const char* name = format_ctx->iformat ? format_ctx->iformat->name : nullptr;
+  if (!name) return false;
+  return strstr(name, "mov") || strcmp(name, "avi") == 0;
+}
 
-    // 获取宽、高
-    result.width = codecpar->width;
-    result.height = codecpar->height;
+// 记录 dts 的索引中，关键帧的 pts = dts + 解码延迟。
+// 读取第一个关键帧包求出该偏移，用于修正全部索引条目。
+static int64_t probe_keyframe_pts_offset(AVFormatContext* format_ctx, int stream_idx) {
+  int64_t offset = 0;
+  AVPacket* packet = av_packet_alloc();
+  if (!packet) return 0;
 
-    // 获取帧率 (优先使用 avg_frame_rate)
-    if (stream->avg_frame_rate.den > 0) {
-      result.framerate = av_q2d(stream->avg_frame_rate);
+  AVStream* stream = format_ctx->streams[stream_idx];
+  int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+  if (av_seek_frame(format_ctx, stream_idx, start, AVSEEK_FLAG_BACKWARD) >= 0) {
+    while (av_read_frame(format_ctx, packet) >= 0) {
+      bool found = packet->stream_index == stream_idx && (packet->flags & AV_PKT_FLAG_KEY);
+      if (found && packet->pts != AV_NOPTS_VALUE && packet->dts != AV_NOPTS_VALUE) {
+        offset = packet->pts - packet->dts;
+      }
+      av_packet_unref(packet);
+      if (found) break;
     }
-    else if (stream->r_frame_rate.den > 0) {
-      // 如果 avg 无效，尝试 r_frame_rate (基本帧率)
-      result.framerate = av_q2d(stream->r_frame_rate);
+  }
+
+  av_packet_free(&packet);
+  return offset;
+}
+
+static void load_keyframes_from_index(MediaContext* media, std::vector<int64_t>& out) {
+  AVStream* stream = media->video_stream();
+  int entries = avformat_index_get_entries_count(stream);
+
+  for (int i = 0; i < entries; i++) {
+    const AVIndexEntry* entry = avformat_index_get_entry(stream, i);
+    if (!entry || !(entry->flags & AVINDEX_KEYFRAME) || (entry->flags & AVINDEX_DISCARD_FRAME)) continue;
+    out.push_back(entry->timestamp);
+  }
+
+  if (!out.empty() && index_holds_dts(media->format_ctx)) {
+    int64_t offset = probe_keyframe_pts_offset(media->format_ctx, media->video_stream_index);
+    for (int64_t& ts : out) ts += offset;
+  }
+}
+
+// 兜底：顺序读包，只看 AV_PKT_FLAG_KEY，不送解码器
+static int load_keyframes_by_scan(MediaContext* media, std::vector<int64_t>& out) {
+  AVFormatContext* format_ctx = media->format_ctx;
+  AVStream* stream = media->video_stream();
+  int stream_idx = media->video_stream_index;
+
+  int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+  if (av_seek_frame(format_ctx, stream_idx, start, AVSEEK_FLAG_BACKWARD) < 0) return -1;
+
+  // 其它流直接丢弃，demuxer 可以跳过它们的数据
+  std::vector<AVDiscard> saved_discard(format_ctx->nb_streams);
+  for (unsigned int i = 0; i < format_ctx->nb_streams; i++) {
+    saved_discard[i] = format_ctx->streams[i]->discard;
+    if ((int)i != stream_idx) format_ctx->streams[i]->discard = AVDISCARD_ALL;
+  }
+
+  AVPacket* packet = av_packet_alloc();
+  if (packet) {
+    while (av_read_frame(format_ctx, packet) >= 0) {
+      if (packet->stream_index == stream_idx && (packet->flags & AV_PKT_FLAG_KEY)) {
+        int64_t ts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+        if (ts != AV_NOPTS_VALUE) out.push_back(ts);
+      }
+      av_packet_unref(packet);
     }
-    else {
-      result.framerate = 30.0; // 兜底
+    av_packet_free(&packet);
+  }
+
+  for (unsigned int i = 0; i < format_ctx->nb_streams; i++) {
+    format_ctx->streams[i]->discard = saved_discard[i];
+  }
+  return packet ? 0 : -1;
+}
+
+// 索引中的关键帧: int32 time_base.num, int32 time_base.den, int64 pts[]
+static bool index_lookup_keyframes(const char* path, long long mtime, long long size, AVRational& time_base,
+  std::vector<int64_t>& out) {
+  std::vector<uint8_t> data;
+  if (!MediaIndex::instance().lookup(path, mtime, size, MEDIA_INDEX_KEYFRAMES, data)) return false;
+  if (data.size() < 8 || (data.size() - 8) % sizeof(int64_t) != 0) return false;
+
+  memcpy(&time_base.num, data.data(), 4);
+  memcpy(&time_base.den, data.data() + 4, 4);
+  if (time_base.num <= 0 || time_base.den <= 0) return false;
+
+  out.resize((data.size() - 8) / sizeof(int64_t));
+  if (!out.empty()) memcpy(out.data(), data.data() + 8, data.size() - 8);
+  return true;
+}
+
+static void index_store_keyframes(const MediaContext* media) {
+  AVRational time_base = media->video_stream()->time_base;
+  std::vector<uint8_t> data(8 + media->keyframes.size() * sizeof(int64_t));
+  memcpy(data.data(), &time_base.num, 4);
+  memcpy(data.data() + 4, &time_base.den, 4);
+  if (!media->keyframes.empty()) memcpy(data.data() + 8, media->keyframes.data(), media->keyframes.size() * sizeof(int64_t));
+  MediaIndex::instance().store(media->path.c_str(), media->mtime, media->size, MEDIA_INDEX_KEYFRAMES,
+    data.data(), data.size());
+}
+
+int media_load_keyframes(MediaContext* media, bool allow_scan) {
+  if (media->keyframes_loaded) return (int)media->keyframes.size();
+  if (media->video_stream_index < 0) return -1;
+
+  // 持久化索引命中时不需要读取容器索引或扫描数据包 (time_base 不同说明不是同一个视频流)
+  AVRational indexed_tb;
+  std::vector<int64_t> indexed;
+  if (index_lookup_keyframes(media->path.c_str(), media->mtime, media->size, indexed_tb, indexed) &&
+    av_cmp_q(indexed_tb, media->video_stream()->time_base) == 0) {
+    media->keyframes.swap(indexed);
+    media->keyframes_loaded = true;
+    return (int)media->keyframes.size();
+  }
+
+  std::vector<int64_t> keyframes;
+  if (has_complete_keyframe_index(media->format_ctx)) {
+    load_keyframes_from_index(media, keyframes);
+  }
+  if (keyframes.empty() && !allow_scan) return 0;
+  if (keyframes.empty() && load_keyframes_by_scan(media, keyframes) < 0) {
+    return -1;
+  }
+
+  std::sort(keyframes.begin(), keyframes.end());
+  keyframes.erase(std::unique(keyframes.begin(), keyframes.end()), keyframes.end());
+
+  media->keyframes.swap(keyframes);
+  media->keyframes_loaded = true;
+  index_store_keyframes(media);
+  return (int)media->keyframes.size();
+}
+
+// 时间戳 (time_base) -> 毫秒
+static int copy_keyframes_ms(const std::vector<int64_t>& keyframes, AVRational time_base, long long* out_array,
+  int capacity) {
+  int total = (int)keyframes.size();
+  if (out_array) {
+    int n = (std::min)(total, capacity);
+    for (int i = 0; i < n; i++) {
+      out_array[i] = av_rescale_q(keyframes[i], time_base, { 1, 1000 });
     }
+  }
+  return total;
+}
+
+DLLEXPORT int get_keyframes(const char* video_path, long long* out_array, int capacity) {
+  av_log_set_level(AV_LOG_ERROR);
 
-    result.success = 1; // 标记成功
+  // 持久化索引命中时不打开文件
+  long long mtime = 0, size = 0;
+  if (!video_path || !stat_media_file(video_path, mtime, size)) return -1;
+
+  AVRational indexed_tb;
+  std::vector<int64_t> indexed;
+  if (index_lookup_keyframes(video_path, mtime, size, indexed_tb, indexed)) {
+    return copy_keyframes_ms(indexed, indexed_tb, out_array, capacity);
   }
 
-  avformat_close_input(&format_ctx);
-  return result;
+  MediaLease media = MediaCache::instance().acquire(video_path);
+  if (!media) return -1;
+
+  if (media_load_keyframes(media.get()) < 0) return -1;
+  return copy_keyframes_ms(media->keyframes, media->video_stream()->time_base, out_array, capacity);
 }
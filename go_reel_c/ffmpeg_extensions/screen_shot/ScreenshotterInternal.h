@@ -1,9 +1,68 @@
 #pragma once
 #include <string>
+#include <vector>
 #include "../common.h"
+#include "Screenshotter.h"
+
+struct MediaContext;
 
 // 内部使用的辅助函数声明
 bool ends_with_ignore_case(const char* str, const char* suffix);
 
 // 核心保存函数，供 Batch 和 Single 模块调用
-int save_frame_internal(const AVFrame* frame, const char* out_path);
+// output 为 NULL 时按原尺寸、默认质量保存
+int save_frame_internal(const AVFrame* frame, const char* out_path, const ScreenshotOutputOptions* output = nullptr);
+
+// 批量截图分两步: 解码线程上把帧转换为输出尺寸 / 格式 (缓冲区来自 FramePool，预算不足时阻塞)，
+// 编码任务再把转换后的帧写入文件。两步的 out_path 与 output 必须一致
+AVFrame* prepare_output_frame(const AVFrame* frame, const char* out_path, const ScreenshotOutputOptions* output);
+int save_prepared_frame(AVFrame* prepared, const char* out_path, const ScreenshotOutputOptions* output);
+// 同上，但编码到内存 (写入截图归档时使用)，format_name 与 prepare_output_frame 的 out_path 后缀一致
+int encode_prepared_frame(AVFrame* prepared, const char* format_name, const ScreenshotOutputOptions* output,
+  std::vector<uint8_t>& out);
+
+// 编码到内存。format_name 只用于按后缀选择编码器 (例如 ".webp")
+int encode_frame_to_memory(const AVFrame* frame, const char* format_name, const ScreenshotOutputOptions* output,
+  std::vector<uint8_t>& out);
+
+// 解码图片文件 (webp / png / jpg ...) 的第一帧，成功返回 0
+// path 也可以是截图归档中的一项: "<归档路径.gra>#<键>"
+int decode_image_file(const char* path, AVFrame* frame);
+
+// 输出选项默认值 / NULL 转为默认值并修正非法取值
+void output_options_init(ScreenshotOutputOptions* output);
+ScreenshotOutputOptions resolve_output_options(const ScreenshotOutputOptions* output);
+
+// 时长 (毫秒)，未知时返回 0
+long long media_duration_ms(const MediaContext* media);
+
+// 加载视频关键帧列表到 media->keyframes (已加载则直接返回)
+// 返回关键帧数量，失败返回小于 0
+// allow_scan = false 时只读取容器索引，没有索引则返回 0 (不做全文件扫描)
+int media_load_keyframes(MediaContext* media, bool allow_scan = true);
+
+// 关键帧查询 (视频流 time_base，只使用容器索引)
+// nearest_keyframe: 无索引时返回 target；keyframe_at_or_before: 无索引时返回 AV_NOPTS_VALUE
+int64_t nearest_keyframe(MediaContext* media, int64_t target);
+int64_t keyframe_at_or_before(MediaContext* media, int64_t target);
+
+// 帧时间戳 (pts 缺失时使用 best_effort_timestamp)
+int64_t frame_timestamp(const AVFrame* frame);
+
+// NULL 转为默认选项，并修正非法取值
+ScreenshotOptions resolve_screenshot_options(const ScreenshotOptions* options);
+
+// 恢复解码器的丢帧设置 (缓存中的解码器归还前必须恢复)
+void reset_decoder_discard(AVCodecContext* codec_ctx);
+
+// 按 options 定位并解码目标帧，成功时返回 0，帧数据在 frame 中
+int seek_decode_frame(MediaContext* media, long long target_ms, const ScreenshotOptions& options,
+  AVFrame* frame, AVPacket* packet, long long* out_actual_ms);
+
+// 在已借出的上下文上截取单张图片 (解码器必须已打开)
+int generate_screenshot_with_context(MediaContext* media, long long timestamp_ms, const char* output_path,
+  const ScreenshotOptions& options, long long* out_actual_ms);
+
+// 缩小后的亮度图是否有内容: 标准差低于阈值的视为黑场、白场或纯色过渡
+// (指纹跳过这些帧，镜头检测不把它们当作镜头起点)
+bool luma_has_content(const uint8_t* pixels, int count);
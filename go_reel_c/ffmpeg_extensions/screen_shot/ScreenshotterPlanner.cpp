@@ -0,0 +1,226 @@
+#include "ScreenshotterPlanner.h"
+#include "ScreenshotterInternal.h"
+#include "../core/Job.h"
+#include "../core/MediaCache.h"
+#include <algorithm>
+
+// 只解复用跳过的数据量上限: 超过后 seek 更划算 (HDD 一次随机读约等于顺序读 1~2 MB)
+static const double kDemuxSkipMaxBytes = 2.0 * 1024 * 1024;
+
+
+std::vector<ShotTarget> plan_shot_targets(MediaContext* media, const std::vector<long long>& sorted_ms,
+  const ScreenshotOptions& options) {
+  AVRational ms_base = { 1, 1000 };
+  AVRational time_base = media->video_stream()->time_base;
+  bool has_index = media_load_keyframes(media, false) > 0;
+
+  std::vector<ShotTarget> targets;
+  targets.reserve(sorted_ms.size());
+
+  for (long long ms : sorted_ms) {
+    ShotTarget t;
+    t.target_ms = ms;
+    int64_t target = av_rescale_q(ms, ms_base, time_base);
+
+    if (options.seek_mode == SCREENSHOT_SEEK_KEYFRAME) {
+      if (has_index) {
+        t.accept_from = t.keyframe = nearest_keyframe(media, target);
+        t.seek_ts = t.accept_from;
+      }
+      else {
+        // 没有索引: 每个目标 seek 后取第一帧 (即 seek 落到的关键帧)
+        t.seek_ts = target;
+      }
+    }
+    else {
+      long long from_ms = options.seek_mode == SCREENSHOT_SEEK_TOLERANCE ? ms - options.tolerance_ms : ms;
+      t.accept_from = av_rescale_q(from_ms, ms_base, time_base);
+      t.keyframe = keyframe_at_or_before(media, t.accept_from);
+      t.seek_ts = t.accept_from;
+    }
+    targets.push_back(t);
+  }
+  return targets;
+}
+
+// =================================================================
+// BatchFrameDecoder
+// =================================================================
+BatchFrameDecoder::BatchFrameDecoder(MediaContext* media, const ScreenshotOptions& options, ScreenshotBatchStats* stats)
+  : media_(media), options_(options), stats_(stats) {
+  frame_ = av_frame_alloc();
+  packet_ = av_packet_alloc();
+
+  if (options_.seek_mode == SCREENSHOT_SEEK_KEYFRAME) {
+    media_->codec_ctx->skip_frame = AVDISCARD_NONKEY;
+  }
+}
+
+BatchFrameDecoder::~BatchFrameDecoder() {
+  reset_decoder_discard(media_->codec_ctx);
+  av_packet_free(&packet_);
+  av_frame_free(&frame_);
+}
+
+bool BatchFrameDecoder::seek_to(int64_t ts) {
+  stats_->seeks++;
+  avcodec_flush_buffers(media_->codec_ctx);
+
+  positioned_ = av_seek_frame(media_->format_ctx, media_->video_stream_index, ts, AVSEEK_FLAG_BACKWARD) >= 0;
+  draining_ = false;
+  eof_ = false;
+  position_ = ts;
+  skip_until_ = AV_NOPTS_VALUE;
+  last_key_pts_ = AV_NOPTS_VALUE;
+  return positioned_;
+}
+
+bool BatchFrameDecoder::cheap_to_demux(int64_t from, int64_t keyframe) const {
+  if (from == AV_NOPTS_VALUE) return false;
+
+  int64_t bit_rate = media_->format_ctx->bit_rate;
+  if (bit_rate > 0) {
+    double seconds = (keyframe - from) * av_q2d(media_->video_stream()->time_base);
+    return seconds * bit_rate / 8 <= kDemuxSkipMaxBytes;
+  }
+
+  // 码率未知: 只有目标关键帧是紧挨着的下一个关键帧时才跳过
+  const std::vector<int64_t>& keyframes = media_->keyframes;
+  auto first = std::upper_bound(keyframes.begin(), keyframes.end(), from);
+  auto last = std::upper_bound(keyframes.begin(), keyframes.end(), keyframe);
+  return last - first <= 1;
+}
+
+void BatchFrameDecoder::send_packet(AVPacket* packet, int64_t accept_from) {
+  AVCodecContext* codec_ctx = media_->codec_ctx;
+  int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+
+  if (options_.seek_mode == SCREENSHOT_SEEK_TOLERANCE) {
+    // 与单张截图一致: 窗口之前的非参考帧不会被输出，可直接丢弃
+    bool before_window = pts != AV_NOPTS_VALUE && accept_from != AV_NOPTS_VALUE && pts < accept_from;
+    codec_ctx->skip_frame = before_window ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+    codec_ctx->skip_loop_filter = before_window ? AVDISCARD_BIDIR : AVDISCARD_DEFAULT;
+  }
+
+  if (pts != AV_NOPTS_VALUE && (position_ == AV_NOPTS_VALUE || pts > position_)) {
+    position_ = pts;
+  }
+
+  avcodec_send_packet(codec_ctx, packet);
+  av_packet_unref(packet);
+}
+
+int BatchFrameDecoder::next_frame(int64_t accept_from) {
+  AVFormatContext* format_ctx = media_->format_ctx;
+  AVCodecContext* codec_ctx = media_->codec_ctx;
+  int stream_idx = media_->video_stream_index;
+
+  for (;;) {
+    // 先取出解码器里已有的帧 (上一个目标之后剩余的帧也在这里)
+    while (avcodec_receive_frame(codec_ctx, frame_) == 0) {
+      stats_->frames_decoded++;
+      job_add_progress(0, 1, 0);
+      int64_t ts = frame_timestamp(frame_);
+      if (accept_from == AV_NOPTS_VALUE || (ts != AV_NOPTS_VALUE && ts >= accept_from)) return 0;
+      av_frame_unref(frame_);
+    }
+
+    if (draining_) {
+      eof_ = true;
+      return -1;
+    }
+
+    // 异步任务被取消: 按读到末尾处理，后续目标全部放弃
+    if (job_cancelled()) {
+      eof_ = true;
+      return -1;
+    }
+
+    if (av_read_frame(format_ctx, packet_) < 0) {
+      // 读到文件末尾: 冲刷解码器取出剩余帧
+      draining_ = true;
+      avcodec_send_packet(codec_ctx, NULL);
+      continue;
+    }
+
+    if (packet_->stream_index != stream_idx) {
+      av_packet_unref(packet_);
+      continue;
+    }
+
+    stats_->packets_read++;
+    job_add_progress(0, 0, packet_->size);
+    int64_t pts = packet_->pts != AV_NOPTS_VALUE ? packet_->pts : packet_->dts;
+    bool is_key = (packet_->flags & AV_PKT_FLAG_KEY) && pts != AV_NOPTS_VALUE;
+
+    if (is_key) {
+      if (last_key_pts_ != AV_NOPTS_VALUE && pts > last_key_pts_) {
+        max_gop_ = (std::max)(max_gop_, pts - last_key_pts_);
+      }
+      last_key_pts_ = pts;
+    }
+
+    if (skip_until_ != AV_NOPTS_VALUE) {
+      if (!is_key || pts < skip_until_) {
+        stats_->packets_skipped++;
+        av_packet_unref(packet_);
+        continue;
+      }
+      // 到达目标关键帧: 解码器中剩余的都是更早的帧，不再需要
+      avcodec_flush_buffers(codec_ctx);
+      skip_until_ = AV_NOPTS_VALUE;
+    }
+
+    send_packet(packet_, accept_from);
+  }
+}
+
+void BatchFrameDecoder::run(const std::vector<ShotTarget>& targets, const FrameCallback& on_frame) {
+  if (!frame_ || !packet_) return;
+
+  AVRational time_base = media_->video_stream()->time_base;
+  size_t i = 0;
+
+  while (i < targets.size() && !job_cancelled()) {
+    const ShotTarget& t = targets[i];
+    bool positioned = true;
+
+    if (t.accept_from == AV_NOPTS_VALUE || !positioned_ || eof_) {
+      positioned = seek_to(t.seek_ts);
+    }
+    else if (t.keyframe != AV_NOPTS_VALUE) {
+      if (position_ != AV_NOPTS_VALUE && t.keyframe <= position_) {
+        // 目标所在 GOP 已在解码中: 继续向前
+      }
+      else if (cheap_to_demux(position_, t.keyframe)) {
+        skip_until_ = t.keyframe;
+      }
+      else {
+        positioned = seek_to(t.seek_ts);
+      }
+    }
+    else if (max_gop_ <= 0 || position_ == AV_NOPTS_VALUE || t.accept_from - position_ > max_gop_) {
+      // 无索引: 距离超过已观察到的 GOP 长度才 seek
+      positioned = seek_to(t.seek_ts);
+    }
+
+    if (!positioned || next_frame(t.accept_from) < 0) {
+      // 没有索引的关键帧模式每个目标独立 seek，其余模式到达末尾后后续目标同样无法获得
+      if (t.accept_from == AV_NOPTS_VALUE || !positioned) { i++; continue; }
+      break;
+    }
+
+    int64_t ts = frame_timestamp(frame_);
+    size_t last = i + 1;
+    if (t.accept_from != AV_NOPTS_VALUE) {
+      while (last < targets.size() && targets[last].accept_from != AV_NOPTS_VALUE && targets[last].accept_from <= ts) {
+        last++;
+      }
+    }
+
+    stats_->frames_used++;
+    on_frame(i, last, frame_, av_rescale_q(ts, time_base, { 1, 1000 }));
+    av_frame_unref(frame_);
+    i = last;
+  }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include "../common.h"
+#include "Screenshotter.h"
+
+struct MediaContext;
+
+// 单个截图目标 (时间均为视频流 time_base)
+struct ShotTarget {
+  long long target_ms = 0;
+  int64_t accept_from = AV_NOPTS_VALUE; // 第一个 pts >= accept_from 的帧即为结果；NOPTS = 定位后的第一帧
+  int64_t keyframe = AV_NOPTS_VALUE;    // accept_from 所在 GOP 的关键帧，未知为 NOPTS
+  int64_t seek_ts = 0;                  // 需要 seek 时的目标
+};
+
+// 根据选项与关键帧索引把升序毫秒时间戳转换为解码目标 (结果同样升序)
+std::vector<ShotTarget> plan_shot_targets(MediaContext* media, const std::vector<long long>& sorted_ms,
+  const ScreenshotOptions& options);
+
+// =================================================================
+// 按 GOP 规划的顺序解码器
+//
+// 对升序目标只向前解码，每个目标根据关键帧布局选择:
+//   1. 目标所在 GOP 已经开始解码      -> 继续向前解码
+//   2. 目标 GOP 的关键帧就在前方不远处 -> 只解复用跳到关键帧 (不解码、不 seek)
+//   3. 其余情况                        -> seek 到关键帧
+// seek 只会向前跳过未解码的区域，因此同一帧不会被解码两次；
+// 多个目标落在同一帧上时共用一次解码结果。
+// =================================================================
+class BatchFrameDecoder {
+public:
+  // 帧回调: targets[first, last) 共用该帧
+  using FrameCallback = std::function<void(size_t first, size_t last, const AVFrame* frame, long long actual_ms)>;
+
+  // stats 不能为 NULL
+  BatchFrameDecoder(MediaContext* media, const ScreenshotOptions& options, ScreenshotBatchStats* stats);
+  ~BatchFrameDecoder();
+
+  void run(const std::vector<ShotTarget>& targets, const FrameCallback& on_frame);
+
+private:
+  bool seek_to(int64_t ts);
+  bool cheap_to_demux(int64_t from, int64_t keyframe) const;
+  int next_frame(int64_t accept_from);
+  void send_packet(AVPacket* packet, int64_t accept_from);
+
+  MediaContext* media_;
+  ScreenshotOptions options_;
+  ScreenshotBatchStats* stats_;
+  AVFrame* frame_ = nullptr;
+  AVPacket* packet_ = nullptr;
+
+  bool positioned_ = false;
+  bool draining_ = false;
+  bool eof_ = false;
+  int64_t position_ = AV_NOPTS_VALUE;  // 已送入解码器的最大包 pts (seek 后为 seek 目标)
+  int64_t skip_until_ = AV_NOPTS_VALUE; // 非 NOPTS 时丢弃包直到该关键帧
+  int64_t last_key_pts_ = AV_NOPTS_VALUE;
+  int64_t max_gop_ = 0;                 // 无索引时根据已读关键帧估算的 GOP 长度
+};
@@ -0,0 +1,149 @@
+#include "Screenshotter.h"
+#include "ScreenshotterInternal.h"
+#include "../core/Job.h"
+#include "../core/MediaCache.h"
+#include "../core/ThreadPool.h"
+#include <algorithm>
+
+
+// =================================================================
+// 截图选项
+// =================================================================
+DLLEXPORT void screenshot_options_init(ScreenshotOptions* options) {
+  if (!options) return;
+  options->seek_mode = SCREENSHOT_SEEK_EXACT;
+  options->tolerance_ms = 0;
+  options->parallel_decoders = 0;
+  output_options_init(&options->output);
+  options->priority = TASK_PRIORITY_INTERACTIVE;
+  options->select_mode = SCREENSHOT_SELECT_TIMESTAMPS;
+}
+
+ScreenshotOptions resolve_screenshot_options(const ScreenshotOptions* options) {
+  ScreenshotOptions resolved;
+  screenshot_options_init(&resolved);
+  if (!options) return resolved;
+
+  resolved = *options;
+  if (resolved.seek_mode < SCREENSHOT_SEEK_EXACT || resolved.seek_mode > SCREENSHOT_SEEK_TOLERANCE) {
+    resolved.seek_mode = SCREENSHOT_SEEK_EXACT;
+  }
+  if (resolved.tolerance_ms < 0) resolved.tolerance_ms = 0;
+  if (resolved.parallel_decoders < 0) resolved.parallel_decoders = 0;
+  resolved.output = resolve_output_options(&resolved.output);
+  if (resolved.priority != TASK_PRIORITY_BACKGROUND) resolved.priority = TASK_PRIORITY_INTERACTIVE;
+  if (resolved.select_mode != SCREENSHOT_SELECT_SCENES) resolved.select_mode = SCREENSHOT_SELECT_TIMESTAMPS;
+  return resolved;
+}
+
+void reset_decoder_discard(AVCodecContext* codec_ctx) {
+  codec_ctx->skip_frame = AVDISCARD_DEFAULT;
+  codec_ctx->skip_loop_filter = AVDISCARD_DEFAULT;
+}
+
+// 距离 target 最近的关键帧 (只使用容器索引，避免为一张截图扫描全文件)
+int64_t nearest_keyframe(MediaContext* media, int64_t target) {
+  if (media_load_keyframes(media, false) <= 0) return target;
+
+  const std::vector<int64_t>& keyframes = media->keyframes;
+  auto it = std::lower_bound(keyframes.begin(), keyframes.end(), target);
+  if (it == keyframes.end()) return keyframes.back();
+  if (it == keyframes.begin()) return *it;
+
+  int64_t after = *it;
+  int64_t before = *(it - 1);
+  return (after - target < target - before) ? after : before;
+}
+
+int64_t keyframe_at_or_before(MediaContext* media, int64_t target) {
+  if (media_load_keyframes(media, false) <= 0) return AV_NOPTS_VALUE;
+
+  const std::vector<int64_t>& keyframes = media->keyframes;
+  auto it = std::upper_bound(keyframes.begin(), keyframes.end(), target);
+  return it == keyframes.begin() ? keyframes.front() : *(it - 1);
+}
+
+int64_t frame_timestamp(const AVFrame* frame) {
+  return frame->pts != AV_NOPTS_VALUE ? frame->pts : frame->best_effort_timestamp;
+}
+
+// =================================================================
+// 定位并解码目标帧
+//
+// - EXACT:     向前解码直到 pts >= 目标
+// - KEYFRAME:  定位到最近的关键帧，解码器只解 I 帧 (skip_frame = NONKEY)
+// - TOLERANCE: 进入容差窗口前丢弃非参考帧并跳过 B 帧环路滤波，
+//              窗口内恢复完整解码，返回第一个落入窗口的帧
+// =================================================================
+int seek_decode_frame(MediaContext* media, long long target_ms, const ScreenshotOptions& options,
+  AVFrame* frame, AVPacket* packet, long long* out_actual_ms) {
+  AVFormatContext* format_ctx = media->format_ctx;
+  AVCodecContext* codec_ctx = media->codec_ctx;
+  AVStream* stream = media->video_stream();
+  int stream_idx = media->video_stream_index;
+  AVRational ms_base = { 1, 1000 };
+
+  int64_t target = av_rescale_q(target_ms, ms_base, stream->time_base);
+  int64_t accept_from = target;
+  int64_t seek_target = target;
+  bool fast_forward = false;
+
+  if (options.seek_mode == SCREENSHOT_SEEK_KEYFRAME) {
+    seek_target = nearest_keyframe(media, target);
+    accept_from = AV_NOPTS_VALUE; // 第一帧即可
+    codec_ctx->skip_frame = AVDISCARD_NONKEY;
+  }
+  else if (options.seek_mode == SCREENSHOT_SEEK_TOLERANCE) {
+    accept_from = av_rescale_q(target_ms - options.tolerance_ms, ms_base, stream->time_base);
+    fast_forward = true;
+  }
+
+  if (av_seek_frame(format_ctx, stream_idx, seek_target, AVSEEK_FLAG_BACKWARD) < 0) {
+    reset_decoder_discard(codec_ctx);
+    return -1;
+  }
+  avcodec_flush_buffers(codec_ctx);
+
+  int ret = -1;
+  bool draining = false;
+  while (ret != 0 && !job_cancelled()) {
+    if (!draining) {
+      if (av_read_frame(format_ctx, packet) < 0) {
+        // 读到文件末尾: 冲刷解码器取出剩余帧
+        draining = true;
+        avcodec_send_packet(codec_ctx, NULL);
+      }
+      else if (packet->stream_index != stream_idx) {
+        av_packet_unref(packet);
+        continue;
+      }
+      else {
+        if (fast_forward) {
+          // 窗口之前的帧不会被输出: 非参考帧可直接丢弃，不影响后续帧的重建
+          bool before_window = packet->pts != AV_NOPTS_VALUE && packet->pts < accept_from;
+          codec_ctx->skip_frame = before_window ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+          codec_ctx->skip_loop_filter = before_window ? AVDISCARD_BIDIR : AVDISCARD_DEFAULT;
+        }
+        int send_ret = avcodec_send_packet(codec_ctx, packet);
+        av_packet_unref(packet);
+        if (send_ret < 0) continue; // 损坏的包直接跳过
+      }
+    }
+
+    int recv_ret;
+    while ((recv_ret = avcodec_receive_frame(codec_ctx, frame)) == 0) {
+      int64_t ts = frame_timestamp(frame);
+      if (accept_from == AV_NOPTS_VALUE || (ts != AV_NOPTS_VALUE && ts >= accept_from)) {
+        if (out_actual_ms) *out_actual_ms = av_rescale_q(ts, stream->time_base, ms_base);
+        ret = 0;
+        break;
+      }
+      av_frame_unref(frame);
+    }
+
+    if (draining && recv_ret != 0) break; // AVERROR_EOF: 没有更多帧
+  }
+
+  reset_decoder_discard(codec_ctx);
+  return ret;
+}
@@ -1,5 +1,9 @@
 #include "ScreenshotterInternal.h"
+#include "../core/FramePool.h"
+#include <algorithm>
+#include <atomic>
 #include <cstring> 
+#include <vector>
 
 #ifdef _WIN32
 #define STRICMP _stricmp
@@ -22,128 +26,522 @@ bool ends_with_ignore_case(const char* str, const char* suffix) {
 }
 
 // =================================================================
-// 1. [重构] 内部核心函数：通用帧保存 (支持 WebP, PNG, JPG)
-//    根据 out_path 的后缀自动选择编码器
+// 每线程编码缓存
+//
+// 批量截图时同一工作线程连续保存的图片尺寸、格式通常相同，
+// 打开的编码器、SwsContext 与转换缓冲区都可以复用，只在参数变化时重建。
+// 使用没有延迟的图片编码器 (libwebp / PNG / MJPEG): 送入一帧即可取出一个包，
+// 因此不需要冲刷编码器，编码完成后上下文仍可继续使用。
+// 注意 AV_CODEC_ID_WEBP 在标准构建中解析为 libwebp_anim (有延迟，每次都要冲刷)，必须按名称查找。
 // =================================================================
-int save_frame_internal(const AVFrame* frame, const char* out_path)
-{
-  int ret = 0;
+static std::atomic<long long> g_encoder_opens{ 0 };
 
-  // 1. 根据后缀确定编码器 ID 和像素格式
-  AVCodecID codec_id = AV_CODEC_ID_WEBP; // 默认
-  AVPixelFormat target_pix_fmt = AV_PIX_FMT_YUV420P; // 默认
+// 亮度标准差低于该值视为无内容
+static const double kMinLumaStdDev = 4.0;
+
+bool luma_has_content(const uint8_t* pixels, int count) {
+  if (count <= 0) return false;
+  uint64_t sum = 0, sum_sq = 0;
+  for (int i = 0; i < count; i++) {
+    uint32_t v = pixels[i];
+    sum += v;
+    sum_sq += v * v;
+  }
+  double mean = (double)sum / count;
+  double variance = (double)sum_sq / count - mean * mean;
+  return variance >= kMinLumaStdDev * kMinLumaStdDev;
+}
+
+struct ImageEncodeParams {
+  AVCodecID codec_id = AV_CODEC_ID_WEBP;
+  AVPixelFormat pix_fmt = AV_PIX_FMT_YUV420P;
+  int width = 0;
+  int height = 0;
+  int quality = -1;           // 编码器相关，-1 = 不设置
+  int compression_level = -1; // 编码器相关，-1 = 不设置
+  int speed_preset = SCREENSHOT_SPEED_BALANCED;
+
+  bool operator==(const ImageEncodeParams& o) const {
+    return codec_id == o.codec_id && pix_fmt == o.pix_fmt && width == o.width && height == o.height &&
+      quality == o.quality && compression_level == o.compression_level && speed_preset == o.speed_preset;
+  }
+};
+
+class ImageEncodeCache {
+public:
+  ~ImageEncodeCache() {
+    for (auto& e : encoders_) avcodec_free_context(&e.ctx);
+    sws_freeContext(sws_ctx_);
+    av_frame_free(&converted_);
+    av_frame_free(&rotated_);
+    av_frame_free(&view_);
+    av_packet_free(&packet_);
+  }
+
+  // 借出按 params 打开的编码器 (缓存最近使用的几个，最近使用的在前)
+  AVCodecContext* encoder(const ImageEncodeParams& params) {
+    for (size_t i = 0; i < encoders_.size(); i++) {
+      if (encoders_[i].params == params) {
+        Entry hit = encoders_[i];
+        encoders_.erase(encoders_.begin() + i);
+        encoders_.insert(encoders_.begin(), hit);
+        return hit.ctx;
+      }
+    }
+
+    AVCodecContext* ctx = open_encoder(params);
+    if (!ctx) return nullptr;
+
+    encoders_.insert(encoders_.begin(), Entry{ params, ctx });
+    if (encoders_.size() > kMaxEncoders) {
+      avcodec_free_context(&encoders_.back().ctx);
+      encoders_.pop_back();
+    }
+    return ctx;
+  }
+
+  // 编码器进入异常状态 (例如已被冲刷) 时丢弃
+  void discard(AVCodecContext* ctx) {
+    for (size_t i = 0; i < encoders_.size(); i++) {
+      if (encoders_[i].ctx == ctx) {
+        avcodec_free_context(&encoders_[i].ctx);
+        encoders_.erase(encoders_.begin() + i);
+        return;
+      }
+    }
+  }
+
+  SwsContext* scaler(const AVFrame* src, int dst_w, int dst_h, AVPixelFormat dst_fmt) {
+    sws_ctx_ = sws_getCachedContext(sws_ctx_,
+      src->width, src->height, (AVPixelFormat)src->format,
+      dst_w, dst_h, dst_fmt,
+      SWS_BILINEAR, NULL, NULL, NULL);
+    return sws_ctx_;
+  }
+
+  // 可写的转换目标帧 / 旋转目标帧，尺寸或格式变化时重新分配
+  AVFrame* converted_frame(int width, int height, AVPixelFormat fmt) {
+    return writable_frame(converted_, width, height, fmt);
+  }
+
+  AVFrame* rotated_frame(int width, int height, AVPixelFormat fmt) {
+    return writable_frame(rotated_, width, height, fmt);
+  }
+
+  // 源帧的引用 (用于裁剪，不拷贝像素)
+  AVFrame* view_of(const AVFrame* src) {
+    if (!view_) view_ = av_frame_alloc();
+    if (!view_) return nullptr;
+    av_frame_unref(view_);
+    if (av_frame_ref(view_, src) < 0) return nullptr;
+    return view_;
+  }
+
+  AVPacket* packet() {
+    if (!packet_) packet_ = av_packet_alloc();
+    return packet_;
+  }
+
+private:
+  static const size_t kMaxEncoders = 4;
+
+  static AVFrame* writable_frame(AVFrame*& frame, int width, int height, AVPixelFormat fmt) {
+    if (!frame) frame = av_frame_alloc();
+    if (!frame) return nullptr;
+
+    if (frame->width != width || frame->height != height || frame->format != fmt) {
+      av_frame_unref(frame);
+      frame->format = fmt;
+      frame->width = width;
+      frame->height = height;
+      if (av_frame_get_buffer(frame, 32) < 0) {
+        av_frame_unref(frame);
+        return nullptr;
+      }
+    }
+    // 编码器可能仍持有上一帧的引用
+    if (av_frame_make_writable(frame) < 0) return nullptr;
+    return frame;
+  }
+
+  struct Entry {
+    ImageEncodeParams params;
+    AVCodecContext* ctx;
+  };
+
+  static AVCodecContext* open_encoder(const ImageEncodeParams& params) {
+    const AVCodec* codec = nullptr;
+    if (params.codec_id == AV_CODEC_ID_WEBP) codec = avcodec_find_encoder_by_name("libwebp");
+    if (!codec) codec = avcodec_find_encoder(params.codec_id);
+    if (!codec) {
+      fprintf(stderr, "[Error] Encoder not found for output file.\n");
+      return nullptr;
+    }
+
+    AVCodecContext* codec_ctx = avcodec_alloc_context3(codec);
+    if (!codec_ctx) return nullptr;
+
+    // --- 编码参数配置 ---
+    codec_ctx->width = params.width;
+    codec_ctx->height = params.height;
+    codec_ctx->pix_fmt = params.pix_fmt;
+    codec_ctx->time_base = { 1, 25 };
+    codec_ctx->framerate = { 25, 1 };
+
+    // 针对不同格式的特定参数
+    if (params.codec_id == AV_CODEC_ID_WEBP) {
+      av_opt_set_int(codec_ctx->priv_data, "lossless", 0, 0); // 0=有损
+      if (params.quality >= 0) av_opt_set_int(codec_ctx->priv_data, "quality", params.quality, 0);
+      if (params.compression_level >= 0) av_opt_set_int(codec_ctx->priv_data, "compression_level", params.compression_level, 0);
+    }
+    else if (params.codec_id == AV_CODEC_ID_MJPEG) {
+      // 设置 color range 以防灰度偏色
+      if (params.pix_fmt == AV_PIX_FMT_YUVJ420P) {
+        codec_ctx->color_range = AVCOL_RANGE_JPEG;
+      }
+      // quality 为 qscale (2-31，越小越好)，编码时还需写入 frame->quality
+      if (params.quality > 0) {
+        codec_ctx->flags |= AV_CODEC_FLAG_QSCALE;
+        codec_ctx->global_quality = params.quality * FF_QP2LAMBDA;
+      }
+      if (params.speed_preset == SCREENSHOT_SPEED_FAST) {
+        av_opt_set(codec_ctx->priv_data, "huffman", "default", 0); // 跳过最优霍夫曼表的统计
+      }
+    }
+    else if (params.codec_id == AV_CODEC_ID_PNG) {
+      // PNG 压缩级别 0-9
+      if (params.compression_level >= 0) av_opt_set_int(codec_ctx->priv_data, "compression_level", params.compression_level, 0);
+    }
+
+    if (avcodec_open2(codec_ctx, codec, NULL) < 0) {
+      fprintf(stderr, "[Error] Could not open codec.\n");
+      avcodec_free_context(&codec_ctx);
+      return nullptr;
+    }
+    g_encoder_opens++;
+    return codec_ctx;
+  }
+
+  std::vector<Entry> encoders_;
+  SwsContext* sws_ctx_ = nullptr;
+  AVFrame* converted_ = nullptr;
+  AVFrame* rotated_ = nullptr;
+  AVFrame* view_ = nullptr;
+  AVPacket* packet_ = nullptr;
+};
+
+static ImageEncodeCache& thread_encode_cache() {
+  thread_local ImageEncodeCache cache;
+  return cache;
+}
+
+// =================================================================
+// 输出选项
+// =================================================================
+void output_options_init(ScreenshotOutputOptions* output) {
+  if (!output) return;
+  output->max_width = 0;
+  output->max_height = 0;
+  output->crop_x = 0;
+  output->crop_y = 0;
+  output->crop_width = 0;
+  output->crop_height = 0;
+  output->rotation = 0;
+  output->quality = -1;
+  output->speed_preset = SCREENSHOT_SPEED_BALANCED;
+}
+
+ScreenshotOutputOptions resolve_output_options(const ScreenshotOutputOptions* output) {
+  ScreenshotOutputOptions resolved;
+  output_options_init(&resolved);
+  if (!output) return resolved;
+
+  resolved = *output;
+  if (resolved.max_width < 0) resolved.max_width = 0;
+  if (resolved.max_height < 0) resolved.max_height = 0;
+  resolved.rotation = ((resolved.rotation % 360) + 360) % 360 / 90 * 90;
+  if (resolved.quality > 100) resolved.quality = 100;
+  if (resolved.speed_preset < SCREENSHOT_SPEED_FAST || resolved.speed_preset > SCREENSHOT_SPEED_BEST) {
+    resolved.speed_preset = SCREENSHOT_SPEED_BALANCED;
+  }
+  return resolved;
+}
+
+// 按后缀、质量与速度预设确定编码参数 (不含尺寸)
+static ImageEncodeParams encode_params_for(const char* out_path, const ScreenshotOutputOptions& output) {
+  static const int kWebpMethod[] = { 1, 4, 6 };
+  static const int kPngLevel[] = { 3, 7, 9 };
+
+  ImageEncodeParams params;
+  params.speed_preset = output.speed_preset;
 
   if (ends_with_ignore_case(out_path, ".png")) {
-    codec_id = AV_CODEC_ID_PNG;
-    target_pix_fmt = AV_PIX_FMT_RGB24; // PNG 通常用 RGB24 或 RGBA
+    params.codec_id = AV_CODEC_ID_PNG;
+    params.pix_fmt = AV_PIX_FMT_RGB24; // PNG 通常用 RGB24 或 RGBA
+    params.compression_level = kPngLevel[output.speed_preset];
   }
   else if (ends_with_ignore_case(out_path, ".jpg") || ends_with_ignore_case(out_path, ".jpeg")) {
-    codec_id = AV_CODEC_ID_MJPEG;
-    target_pix_fmt = AV_PIX_FMT_YUVJ420P; // JPEG 使用 YUVJ420P (全范围) 或 YUV420P
-  }
-  // else .webp
-
-  const AVCodec* codec = avcodec_find_encoder(codec_id);
-  if (!codec) {
-    fprintf(stderr, "[Error] Encoder not found for output file.\n");
-    return -1;
-  }
-
-  AVCodecContext* codec_ctx = avcodec_alloc_context3(codec);
-  if (!codec_ctx) return -1;
-
-  // --- 编码参数配置 ---
-  codec_ctx->width = frame->width;
-  codec_ctx->height = frame->height;
-  codec_ctx->pix_fmt = target_pix_fmt;
-  codec_ctx->time_base = { 1, 25 };
-  codec_ctx->framerate = { 25, 1 };
-
-  // 针对不同格式的特定参数
-  if (codec_id == AV_CODEC_ID_WEBP) {
-    av_opt_set_int(codec_ctx->priv_data, "lossless", 0, 0); // 0=有损
-    av_opt_set(codec_ctx->priv_data, "quality", "80", 0);
-    av_opt_set_int(codec_ctx->priv_data, "compression_level", 4, 0);
-  }
-  else if (codec_id == AV_CODEC_ID_MJPEG) {
-    // JPEG 质量范围 2-31 (越小越好)，或者用 qscale
-    // FFmpeg 中 global_quality 通常对应 lambda * FF_QP2LAMBDA
-    // 为了简单，我们尝试用 qmin/qmax 或者直接设置 bit_rate (不推荐)
-    // 使用 av_opt_set "q" 或者 codec_ctx->flags
-    // 这里简单设置 color range 以防灰度偏色
-    if (target_pix_fmt == AV_PIX_FMT_YUVJ420P) {
-      codec_ctx->color_range = AVCOL_RANGE_JPEG;
-    }
-    // 设置 JPEG 质量 (相当于 -q:v 3 左右，范围 1-31，1最好)
-    // 注意：API 控制 MJPEG 质量比较麻烦，这里作为示例使用默认
+    params.codec_id = AV_CODEC_ID_MJPEG;
+    params.pix_fmt = AV_PIX_FMT_YUVJ420P; // JPEG 使用 YUVJ420P (全范围) 或 YUV420P
+    // 0-100 映射到 qscale 31-2
+    if (output.quality >= 0) params.quality = 31 - output.quality * 29 / 100;
   }
-  else if (codec_id == AV_CODEC_ID_PNG) {
-    // PNG 压缩级别 0-9
-    av_opt_set_int(codec_ctx->priv_data, "compression_level", 7, 0);
+  else {
+    // 默认 .webp
+    params.codec_id = AV_CODEC_ID_WEBP;
+    params.pix_fmt = AV_PIX_FMT_YUV420P;
+    params.quality = output.quality >= 0 ? output.quality : 80;
+    params.compression_level = kWebpMethod[output.speed_preset];
   }
+  return params;
+}
+
+// 等比缩放到 max_w x max_h 以内 (不放大)，4:2:0 输出保持偶数尺寸
+static void fit_size(int src_w, int src_h, int max_w, int max_h, bool even, int& out_w, int& out_h) {
+  double scale = 1.0;
+  if (max_w > 0 && src_w > max_w) scale = (std::min)(scale, (double)max_w / src_w);
+  if (max_h > 0 && src_h > max_h) scale = (std::min)(scale, (double)max_h / src_h);
 
-  if (avcodec_open2(codec_ctx, codec, NULL) < 0) {
-    fprintf(stderr, "[Error] Could not open codec.\n");
-    avcodec_free_context(&codec_ctx);
-    return -1;
+  out_w = (std::max)((int)(src_w * scale + 0.5), 1);
+  out_h = (std::max)((int)(src_h * scale + 0.5), 1);
+  if (even) {
+    out_w = (std::max)(out_w & ~1, 2);
+    out_h = (std::max)(out_h & ~1, 2);
   }
+}
 
-  // --- 图像格式转换 (源格式 -> 目标格式) ---
-  // 即使源格式和目标格式一样，为了处理 linesize 对齐或数据拷贝，使用 sws_scale 也是最稳妥的
-  SwsContext* sws_ctx = sws_getContext(
-    frame->width, frame->height, (AVPixelFormat)frame->format,
-    codec_ctx->width, codec_ctx->height, codec_ctx->pix_fmt,
-    SWS_BILINEAR, NULL, NULL, NULL);
+// 按 90° 步进顺时针旋转 (逐平面拷贝，dst 尺寸已按旋转结果分配)
+static void rotate_frame(const AVFrame* src, AVFrame* dst, int rotation) {
+  const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get((AVPixelFormat)src->format);
+  int planes = av_pix_fmt_count_planes((AVPixelFormat)src->format);
+
+  for (int p = 0; p < planes; p++) {
+    bool chroma = p == 1 || p == 2;
+    int w = chroma ? AV_CEIL_RSHIFT(src->width, desc->log2_chroma_w) : src->width;
+    int h = chroma ? AV_CEIL_RSHIFT(src->height, desc->log2_chroma_h) : src->height;
 
-  if (!sws_ctx) {
-    avcodec_free_context(&codec_ctx);
-    return -1;
+    int bpp = 1;
+    for (int c = 0; c < desc->nb_components; c++) {
+      if (desc->comp[c].plane == p) { bpp = desc->comp[c].step; break; }
+    }
+
+    const uint8_t* s = src->data[p];
+    uint8_t* d = dst->data[p];
+    int sls = src->linesize[p];
+    int dls = dst->linesize[p];
+
+    for (int y = 0; y < h; y++) {
+      const uint8_t* row = s + (size_t)y * sls;
+      for (int x = 0; x < w; x++) {
+        uint8_t* out;
+        if (rotation == 90) out = d + (size_t)x * dls + (size_t)(h - 1 - y) * bpp;
+        else if (rotation == 180) out = d + (size_t)(h - 1 - y) * dls + (size_t)(w - 1 - x) * bpp;
+        else out = d + (size_t)(w - 1 - x) * dls + (size_t)y * bpp; // 270
+        memcpy(out, row + (size_t)x * bpp, bpp);
+      }
+    }
+  }
+}
+
+// 输出几何: 裁剪矩形、缩放尺寸 (旋转前) 与最终尺寸
+struct OutputGeometry {
+  int crop_x = 0, crop_y = 0, crop_w = 0, crop_h = 0; // crop_w = 0 表示不裁剪
+  int scaled_w = 0, scaled_h = 0;
+  int width = 0, height = 0;
+  int rotation = 0;
+  AVPixelFormat pix_fmt = AV_PIX_FMT_NONE;
+};
+
+static OutputGeometry compute_output_geometry(const AVFrame* frame, const ImageEncodeParams& params,
+  const ScreenshotOutputOptions& output) {
+  OutputGeometry g;
+  g.rotation = output.rotation;
+  g.pix_fmt = params.pix_fmt;
+
+  int src_w = frame->width;
+  int src_h = frame->height;
+  if (output.crop_width > 0 && output.crop_height > 0) {
+    g.crop_x = (std::min)((std::max)(output.crop_x, 0), frame->width - 1);
+    g.crop_y = (std::min)((std::max)(output.crop_y, 0), frame->height - 1);
+    g.crop_w = (std::min)(output.crop_width, frame->width - g.crop_x);
+    g.crop_h = (std::min)(output.crop_height, frame->height - g.crop_y);
+    src_w = g.crop_w;
+    src_h = g.crop_h;
   }
 
-  AVFrame* frame_converted = av_frame_alloc();
-  frame_converted->format = codec_ctx->pix_fmt;
-  frame_converted->width = codec_ctx->width;
-  frame_converted->height = codec_ctx->height;
+  // max_width / max_height 针对旋转后的图片
+  bool transposed = g.rotation == 90 || g.rotation == 270;
+  bool even = params.pix_fmt != AV_PIX_FMT_RGB24;
+  fit_size(src_w, src_h,
+    transposed ? output.max_height : output.max_width,
+    transposed ? output.max_width : output.max_height,
+    even, g.scaled_w, g.scaled_h);
+
+  g.width = transposed ? g.scaled_h : g.scaled_w;
+  g.height = transposed ? g.scaled_w : g.scaled_h;
+  return g;
+}
 
-  if (av_image_alloc(frame_converted->data, frame_converted->linesize,
-    frame_converted->width, frame_converted->height,
-    codec_ctx->pix_fmt, 32) < 0) {
-    av_frame_free(&frame_converted);
-    sws_freeContext(sws_ctx);
-    avcodec_free_context(&codec_ctx);
-    return -1;
+// 裁剪 (只调整数据指针) + 缩放 + 格式转换在同一次 sws_scale 中完成，
+// 旋转作用于缩放后的图片。dst 按 g.width x g.height 分配
+static int convert_to_output(const AVFrame* frame, const OutputGeometry& g, AVFrame* dst, ImageEncodeCache& cache) {
+  const AVFrame* source = frame;
+  AVFrame* view = nullptr;
+  if (g.crop_w > 0) {
+    view = cache.view_of(frame);
+    if (!view) return -1;
+    view->crop_left = g.crop_x;
+    view->crop_top = g.crop_y;
+    view->crop_right = frame->width - g.crop_x - g.crop_w;
+    view->crop_bottom = frame->height - g.crop_y - g.crop_h;
+    if (av_frame_apply_cropping(view, AV_FRAME_CROP_UNALIGNED) < 0) return -1;
+    source = view;
   }
 
+  // 即使源格式和目标格式一样，为了处理 linesize 对齐或数据拷贝，使用 sws_scale 也是最稳妥的
+  AVFrame* scaled = g.rotation != 0 ? cache.converted_frame(g.scaled_w, g.scaled_h, g.pix_fmt) : dst;
+  SwsContext* sws_ctx = cache.scaler(source, g.scaled_w, g.scaled_h, g.pix_fmt);
+  if (!sws_ctx || !scaled) return -1;
+
   sws_scale(sws_ctx,
-    (const uint8_t* const*)frame->data, frame->linesize, 0, frame->height,
-    frame_converted->data, frame_converted->linesize);
+    (const uint8_t* const*)source->data, source->linesize, 0, source->height,
+    scaled->data, scaled->linesize);
+  if (view) av_frame_unref(view); // 不在缓存中持有源帧
+
+  if (g.rotation != 0) rotate_frame(scaled, dst, g.rotation);
+  return 0;
+}
+
+// 编码已转换为目标格式 / 尺寸的帧，成功时数据在 cache.packet() 中 (调用方负责 unref)
+static int encode_packet(AVFrame* frame_encoded, ImageEncodeParams params, ImageEncodeCache& cache) {
+  params.width = frame_encoded->width;
+  params.height = frame_encoded->height;
+
+  AVCodecContext* codec_ctx = cache.encoder(params);
+  AVPacket* packet = cache.packet();
+  if (!codec_ctx || !packet) return -1;
+
+  frame_encoded->quality = codec_ctx->global_quality;
+
+  int ret = avcodec_send_frame(codec_ctx, frame_encoded);
+  if (ret < 0) {
+    cache.discard(codec_ctx);
+    return ret;
+  }
 
+  ret = avcodec_receive_packet(codec_ctx, packet);
+  if (ret == AVERROR(EAGAIN)) {
+    // 编码器有延迟: 冲刷后取包，之后该上下文不能再使用
+    avcodec_send_frame(codec_ctx, NULL);
+    ret = avcodec_receive_packet(codec_ctx, packet);
+    cache.discard(codec_ctx);
+  }
+  return ret;
+}
+
+static int encode_to_file(AVFrame* frame_encoded, const char* out_path, const ImageEncodeParams& params, ImageEncodeCache& cache) {
   // --- 编码与写入 ---
-  AVPacket* packet = av_packet_alloc();
-  ret = avcodec_send_frame(codec_ctx, frame_converted);
+  int ret = encode_packet(frame_encoded, params, cache);
+  AVPacket* packet = cache.packet();
+
   if (ret >= 0) {
-    avcodec_send_frame(codec_ctx, NULL); // Flush encoder
-    ret = avcodec_receive_packet(codec_ctx, packet);
-    if (ret >= 0) {
-      FILE* f = fopen(out_path, "wb");
-      if (f) {
-        fwrite(packet->data, 1, packet->size, f);
-        fclose(f);
-        ret = 0; // Success
-      }
-      else {
-        fprintf(stderr, "[Error] Could not open output file: %s\n", out_path);
-        ret = -1;
-      }
+    FILE* f = fopen(out_path, "wb");
+    if (f) {
+      fwrite(packet->data, 1, packet->size, f);
+      fclose(f);
+      ret = 0; // Success
+    }
+    else {
+      fprintf(stderr, "[Error] Could not open output file: %s\n", out_path);
+      ret = -1;
     }
   }
 
-  // --- 资源清理 ---
-  av_packet_free(&packet);
-  av_freep(&frame_converted->data[0]);
-  av_frame_free(&frame_converted);
-  sws_freeContext(sws_ctx);
-  avcodec_free_context(&codec_ctx);
+  if (packet) av_packet_unref(packet);
+  return ret;
+}
+
+// =================================================================
+// 1. [重构] 内部核心函数：通用帧保存 (支持 WebP, PNG, JPG)
+//    根据 out_path 的后缀自动选择编码器
+// =================================================================
+int save_frame_internal(const AVFrame* frame, const char* out_path, const ScreenshotOutputOptions* output_options)
+{
+  ScreenshotOutputOptions output = resolve_output_options(output_options);
+  ImageEncodeCache& cache = thread_encode_cache();
+
+  // 1. 根据后缀确定编码器 ID 和像素格式
+  ImageEncodeParams params = encode_params_for(out_path, output);
+  OutputGeometry g = compute_output_geometry(frame, params, output);
+
+  // 2. 转换到线程缓存的帧中
+  AVFrame* converted = g.rotation != 0
+    ? cache.rotated_frame(g.width, g.height, g.pix_fmt)
+    : cache.converted_frame(g.width, g.height, g.pix_fmt);
+  if (!converted || convert_to_output(frame, g, converted, cache) < 0) return -1;
+
+  // 3. 编码与写入
+  return encode_to_file(converted, out_path, params, cache);
+}
+
+AVFrame* prepare_output_frame(const AVFrame* frame, const char* out_path, const ScreenshotOutputOptions* output_options) {
+  ScreenshotOutputOptions output = resolve_output_options(output_options);
+  ImageEncodeCache& cache = thread_encode_cache();
+
+  ImageEncodeParams params = encode_params_for(out_path, output);
+  OutputGeometry g = compute_output_geometry(frame, params, output);
+
+  // 预算不足时在这里阻塞
+  AVFrame* prepared = FramePool::instance().acquire(g.width, g.height, g.pix_fmt);
+  if (!prepared) return nullptr;
+
+  if (convert_to_output(frame, g, prepared, cache) < 0) {
+    av_frame_free(&prepared);
+    return nullptr;
+  }
+  return prepared;
+}
+
+int save_prepared_frame(AVFrame* prepared, const char* out_path, const ScreenshotOutputOptions* output_options) {
+  ScreenshotOutputOptions output = resolve_output_options(output_options);
+  return encode_to_file(prepared, out_path, encode_params_for(out_path, output), thread_encode_cache());
+}
 
+// 编码已转换的帧，数据拷贝到 out
+static int encode_to_memory(AVFrame* converted, const ImageEncodeParams& params, ImageEncodeCache& cache,
+  std::vector<uint8_t>& out) {
+  int ret = encode_packet(converted, params, cache);
+  AVPacket* packet = cache.packet();
+  if (ret >= 0) {
+    out.assign(packet->data, packet->data + packet->size);
+    ret = 0;
+  }
+  if (packet) av_packet_unref(packet);
   return ret;
 }
+
+int encode_prepared_frame(AVFrame* prepared, const char* format_name, const ScreenshotOutputOptions* output_options,
+  std::vector<uint8_t>& out) {
+  ScreenshotOutputOptions output = resolve_output_options(output_options);
+  return encode_to_memory(prepared, encode_params_for(format_name, output), thread_encode_cache(), out);
+}
+
+int encode_frame_to_memory(const AVFrame* frame, const char* format_name, const ScreenshotOutputOptions* output_options,
+  std::vector<uint8_t>& out) {
+  ScreenshotOutputOptions output = resolve_output_options(output_options);
+  ImageEncodeCache& cache = thread_encode_cache();
+
+  ImageEncodeParams params = encode_params_for(format_name, output);
+  OutputGeometry g = compute_output_geometry(frame, params, output);
+
+  AVFrame* converted = g.rotation != 0
+    ? cache.rotated_frame(g.width, g.height, g.pix_fmt)
+    : cache.converted_frame(g.width, g.height, g.pix_fmt);
+  if (!converted || convert_to_output(frame, g, converted, cache) < 0) return -1;
+
+  return encode_to_memory(converted, params, cache, out);
+}
+
+DLLEXPORT long long image_encoder_open_count() {
+  return g_encoder_opens.load();
+}
@@ -0,0 +1,243 @@
+#include "Storyboard.h"
+#include "../screen_shot/ScreenshotterInternal.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// =================================================================
+// 故事板拼贴
+//
+// 原实现每张照片要经过 sharp 的 缩放 -> 加边 -> 导出 -> 旋转 -> 导出 -> 合成，
+// 中间生成多份完整图片。这里每张照片只做一次 sws 缩放到照片尺寸，
+// 加边、旋转和混合在一次逆映射遍历中完成，直接写入复用的画布。
+// =================================================================
+
+static const double kPi = 3.14159265358979323846;
+
+// 每个线程复用的缓冲区 (画布、缩放后的照片、sws 上下文)
+struct StoryboardBuffers {
+  std::vector<uint8_t> canvas; // RGB24
+  std::vector<uint8_t> photo;  // RGB24
+  SwsContext* sws = nullptr;
+
+  ~StoryboardBuffers() {
+    if (sws) sws_freeContext(sws);
+  }
+};
+
+static StoryboardBuffers& thread_buffers() {
+  static thread_local StoryboardBuffers buffers;
+  return buffers;
+}
+
+// 单张照片在画布上的位置
+struct PhotoPlacement {
+  int index;        // image_paths 中的下标
+  double center_x;
+  double center_y;
+  double angle;     // 弧度
+};
+
+static StoryboardLayout resolve_layout(const StoryboardLayout* layout) {
+  StoryboardLayout l;
+  storyboard_layout_init(&l);
+  if (!layout) return l;
+
+  l = *layout;
+  if (l.canvas_width <= 0 || l.canvas_height <= 0) {
+    l.canvas_width = 1920;
+    l.canvas_height = 1080;
+  }
+  if (l.columns < 0) l.columns = 0;
+  if (l.border < 0) l.border = 0;
+  if (l.photo_scale <= 0 || l.photo_scale > 1) l.photo_scale = 0.75;
+  if (l.max_rotation_deg < 0) l.max_rotation_deg = 0;
+  if (l.jitter < 0) l.jitter = 0;
+  if (l.quality < 0 || l.quality > 100) l.quality = 0;
+  return l;
+}
+
+// 缩放照片到 photo_w x photo_h (RGB24)，成功返回 0
+static int scale_photo(const AVFrame* frame, int photo_w, int photo_h, StoryboardBuffers& buffers) {
+  buffers.sws = sws_getCachedContext(buffers.sws,
+    frame->width, frame->height, (AVPixelFormat)frame->format,
+    photo_w, photo_h, AV_PIX_FMT_RGB24,
+    SWS_BILINEAR, NULL, NULL, NULL);
+  if (!buffers.sws) return -1;
+
+  buffers.photo.resize((size_t)photo_w * photo_h * 3);
+  uint8_t* dst_data[4] = { buffers.photo.data(), nullptr, nullptr, nullptr };
+  int dst_linesize[4] = { photo_w * 3, 0, 0, 0 };
+
+  sws_scale(buffers.sws, frame->data, frame->linesize, 0, frame->height, dst_data, dst_linesize);
+  return 0;
+}
+
+// 双线性采样 (坐标为像素中心坐标，超出范围时夹到边缘)
+static inline void sample_bilinear(const uint8_t* src, int w, int h, double x, double y, double out[3]) {
+  x = (std::min)((std::max)(x, 0.0), (double)(w - 1));
+  y = (std::min)((std::max)(y, 0.0), (double)(h - 1));
+  int x0 = (int)x, y0 = (int)y;
+  int x1 = (std::min)(x0 + 1, w - 1), y1 = (std::min)(y0 + 1, h - 1);
+  double fx = x - x0, fy = y - y0;
+
+  const uint8_t* p00 = src + ((size_t)y0 * w + x0) * 3;
+  const uint8_t* p01 = src + ((size_t)y0 * w + x1) * 3;
+  const uint8_t* p10 = src + ((size_t)y1 * w + x0) * 3;
+  const uint8_t* p11 = src + ((size_t)y1 * w + x1) * 3;
+  for (int c = 0; c < 3; c++) {
+    double top = p00[c] + (p01[c] - p00[c]) * fx;
+    double bottom = p10[c] + (p11[c] - p10[c]) * fx;
+    out[c] = top + (bottom - top) * fy;
+  }
+}
+
+// 把带白边的照片旋转后混合到画布上
+// 遍历旋转后外接矩形内的画布像素，逆旋转回照片坐标取色，边缘按覆盖率做抗锯齿
+static void composite_photo(StoryboardBuffers& buffers, int canvas_w, int canvas_h,
+  int photo_w, int photo_h, int border, const PhotoPlacement& p) {
+  const double outer_w = photo_w + 2.0 * border;
+  const double outer_h = photo_h + 2.0 * border;
+  const double c = std::cos(p.angle), s = std::sin(p.angle);
+
+  const double half_x = (std::fabs(c) * outer_w + std::fabs(s) * outer_h) / 2 + 1;
+  const double half_y = (std::fabs(s) * outer_w + std::fabs(c) * outer_h) / 2 + 1;
+  int x_begin = (std::max)((int)std::floor(p.center_x - half_x), 0);
+  int x_end = (std::min)((int)std::ceil(p.center_x + half_x), canvas_w);
+  int y_begin = (std::max)((int)std::floor(p.center_y - half_y), 0);
+  int y_end = (std::min)((int)std::ceil(p.center_y + half_y), canvas_h);
+
+  uint8_t* canvas = buffers.canvas.data();
+  const uint8_t* photo = buffers.photo.data();
+
+  for (int y = y_begin; y < y_end; y++) {
+    const double dy = y + 0.5 - p.center_y;
+    uint8_t* row = canvas + (size_t)y * canvas_w * 3;
+
+    for (int x = x_begin; x < x_end; x++) {
+      const double dx = x + 0.5 - p.center_x;
+      // 逆旋转到照片 (含白边) 的局部坐标
+      const double u = c * dx + s * dy + outer_w / 2;
+      const double v = -s * dx + c * dy + outer_h / 2;
+
+      double edge = (std::min)((std::min)(u, outer_w - u), (std::min)(v, outer_h - v));
+      double alpha = (std::min)(edge + 0.5, 1.0);
+      if (alpha <= 0) continue;
+
+      double color[3] = { 255, 255, 255 };
+      const double px = u - border, py = v - border;
+      if (px >= 0 && px < photo_w && py >= 0 && py < photo_h) {
+        sample_bilinear(photo, photo_w, photo_h, px - 0.5, py - 0.5, color);
+      }
+
+      uint8_t* dst = row + (size_t)x * 3;
+      for (int k = 0; k < 3; k++) {
+        dst[k] = (uint8_t)(dst[k] + (color[k] - dst[k]) * alpha + 0.5);
+      }
+    }
+  }
+}
+
+// =================================================================
+// 导出接口
+// =================================================================
+DLLEXPORT void storyboard_layout_init(StoryboardLayout* layout) {
+  if (!layout) return;
+  layout->canvas_width = 1920;
+  layout->canvas_height = 1080;
+  layout->columns = 0;
+  layout->border = 16;
+  layout->photo_scale = 0.75;
+  layout->max_rotation_deg = 13;
+  layout->jitter = 0.2;
+  layout->seed = 0;
+  layout->background_rgb = 0x141414;
+  layout->quality = 0;
+}
+
+DLLEXPORT int compose_storyboard(const char* const* image_paths, int count, const StoryboardLayout* layout_in,
+  unsigned char* out_buffer, int capacity) {
+  if (!image_paths || count <= 0) return -1;
+
+  av_log_set_level(AV_LOG_ERROR);
+
+  const StoryboardLayout layout = resolve_layout(layout_in);
+  const int canvas_w = layout.canvas_width;
+  const int canvas_h = layout.canvas_height;
+
+  const int cols = layout.columns > 0 ? layout.columns : (count > 8 ? 4 : 3);
+  const int rows = (count + cols - 1) / cols;
+  const double cell_w = (double)canvas_w / cols;
+  const double cell_h = (double)canvas_h / rows;
+  const int photo_w = (std::max)((int)(cell_w * layout.photo_scale), 1);
+
+  // 1. 先按网格顺序生成所有随机参数，再打乱层级顺序，保证同一种子结果稳定
+  std::mt19937 rng(layout.seed);
+  std::uniform_real_distribution<double> unit(-0.5, 0.5);
+
+  std::vector<PhotoPlacement> placements(count);
+  for (int i = 0; i < count; i++) {
+    PhotoPlacement& p = placements[i];
+    p.index = i;
+    p.angle = unit(rng) * 2 * layout.max_rotation_deg * kPi / 180;
+    p.center_x = (i % cols) * cell_w + cell_w / 2 + unit(rng) * cell_w * layout.jitter;
+    p.center_y = (i / cols) * cell_h + cell_h / 2 + unit(rng) * cell_h * layout.jitter;
+  }
+  std::shuffle(placements.begin(), placements.end(), rng);
+
+  // 2. 背景
+  StoryboardBuffers& buffers = thread_buffers();
+  buffers.canvas.resize((size_t)canvas_w * canvas_h * 3);
+  const uint8_t bg[3] = {
+    (uint8_t)((layout.background_rgb >> 16) & 0xFF),
+    (uint8_t)((layout.background_rgb >> 8) & 0xFF),
+    (uint8_t)(layout.background_rgb & 0xFF),
+  };
+  for (size_t i = 0; i < buffers.canvas.size(); i += 3) {
+    memcpy(&buffers.canvas[i], bg, 3);
+  }
+
+  // 3. 逐张解码、缩放、合成 (解码帧在照片之间复用)
+  AVFrame* frame = av_frame_alloc();
+  if (!frame) return -1;
+
+  int drawn = 0;
+  for (const PhotoPlacement& p : placements) {
+    av_frame_unref(frame);
+    if (!image_paths[p.index] || decode_image_file(image_paths[p.index], frame) != 0) continue;
+    if (frame->width <= 0 || frame->height <= 0) continue;
+
+    int photo_h = (std::max)((int)std::lround((double)photo_w * frame->height / frame->width), 1);
+    if (scale_photo(frame, photo_w, photo_h, buffers) != 0) continue;
+
+    composite_photo(buffers, canvas_w, canvas_h, photo_w, photo_h, layout.border, p);
+    drawn++;
+  }
+  av_frame_free(&frame);
+
+  if (drawn == 0) return -1;
+
+  // 4. 编码 WebP
+  AVFrame* canvas_frame = av_frame_alloc();
+  if (!canvas_frame) return -1;
+  canvas_frame->format = AV_PIX_FMT_RGB24;
+  canvas_frame->width = canvas_w;
+  canvas_frame->height = canvas_h;
+  canvas_frame->data[0] = buffers.canvas.data();
+  canvas_frame->linesize[0] = canvas_w * 3;
+
+  ScreenshotOutputOptions output;
+  output_options_init(&output);
+  output.quality = layout.quality;
+
+  std::vector<uint8_t> encoded;
+  int ret = encode_frame_to_memory(canvas_frame, ".webp", &output, encoded);
+  av_frame_free(&canvas_frame);
+  if (ret < 0) return ret;
+
+  int size = (int)encoded.size();
+  if (out_buffer && size <= capacity) memcpy(out_buffer, encoded.data(), encoded.size());
+  return size;
+}
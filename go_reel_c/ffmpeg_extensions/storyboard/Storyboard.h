@@ -0,0 +1,54 @@
+// storyboard/Storyboard.h
+#pragma once
+
+#include "../common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  // 故事板拼贴布局参数 (默认值见 storyboard_layout_init)
+  typedef struct {
+    int canvas_width;             // 画布宽度 (默认 1920)
+    int canvas_height;            // 画布高度 (默认 1080)
+    int columns;                  // 列数，0 = 自动 (超过 8 张为 4 列，否则 3 列)
+    int border;                   // 照片白边宽度 (默认 16)
+    double photo_scale;           // 照片宽度占格子宽度的比例 (默认 0.75)
+    double max_rotation_deg;      // 随机旋转的最大角度 (默认 13，即 ±13 度)
+    double jitter;                // 位置随机偏移占格子尺寸的比例 (默认 0.2，即 ±10%)
+    unsigned int seed;            // 随机种子 (旋转、偏移、层级顺序)，相同种子得到相同结果
+    unsigned int background_rgb;  // 背景颜色 0xRRGGBB (默认 0x141414)
+    int quality;                  // WebP 质量 1-100，0 = 默认
+  } StoryboardLayout;
+
+  /**
+   * @brief 填充故事板布局的默认值 (与原 sharp 实现的效果一致)。
+   */
+  DLLEXPORT void storyboard_layout_init(StoryboardLayout* layout);
+
+  /**
+   * @brief 把多张截图合成为一张故事板拼贴图 (WebP)。
+   *
+   * 每张图片解码后缩放到照片尺寸，加白边、旋转并与画布做抗锯齿混合，
+   * 整个过程只在一块复用的画布缓冲区上完成，不生成中间图片。
+   *
+   * @param image_paths  图片路径数组 (UTF-8)，按网格顺序排列；可以是截图归档中的项 "<归档路径>#<键>"
+   * @param count        图片数量
+   * @param layout       布局参数，NULL 表示默认值
+   * @param out_buffer   [输出] WebP 数据缓冲区
+   * @param capacity     缓冲区大小 (字节)
+   *
+   * @return 编码后的字节数；大于 capacity 时不写入数据，调用方应按返回值扩大缓冲区重试。
+   *         小于 0 表示失败 (无可用图片或编码失败)。无法解码的图片会被跳过。
+   */
+  DLLEXPORT int compose_storyboard(
+    const char* const* image_paths,
+    int count,
+    const StoryboardLayout* layout,
+    unsigned char* out_buffer,
+    int capacity
+  );
+
+#ifdef __cplusplus
+}
+#endif
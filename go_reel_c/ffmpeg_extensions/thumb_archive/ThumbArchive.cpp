@@ -0,0 +1,328 @@
+#include "ThumbArchive.h"
+#include "../core/MappedFile.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static const char kMagic[4] = { 'G', 'R', 'T', 'A' };
+static const uint32_t kVersion = 1;
+
+// 失效数据超过该大小且超过有效数据时，commit 时重写归档
+static const uint64_t kCompactMinBytes = 256 * 1024;
+
+// 文件头 (小端)
+struct ArchiveHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t entry_count;
+  uint32_t reserved;
+  uint64_t index_offset;
+  uint64_t garbage_bytes;
+};
+static_assert(sizeof(ArchiveHeader) == 32, "ArchiveHeader layout");
+static_assert(sizeof(ThumbArchiveEntry) == 24, "ThumbArchiveEntry layout");
+
+static uint64_t align8(uint64_t n) {
+  return (n + 7) & ~(uint64_t)7;
+}
+
+static bool valid_header(const ArchiveHeader& h, uint64_t file_size) {
+  if (memcmp(h.magic, kMagic, 4) != 0 || h.version != kVersion) return false;
+  if (h.index_offset < sizeof(ArchiveHeader) || h.index_offset % 8 != 0) return false;
+  return h.index_offset + (uint64_t)h.entry_count * sizeof(ThumbArchiveEntry) <= file_size;
+}
+
+static bool valid_entry(const ThumbArchiveEntry& e, uint64_t index_offset) {
+  return e.size >= 0 && e.offset >= (long long)sizeof(ArchiveHeader) &&
+    (uint64_t)e.offset + (uint64_t)e.size <= index_offset;
+}
+
+// 同一归档的写入者互斥 (按路径)
+static std::mutex* path_lock_for(const std::string& path) {
+  static std::mutex registry_mutex;
+  static std::map<std::string, std::unique_ptr<std::mutex>> registry;
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  auto& slot = registry[path];
+  if (!slot) slot.reset(new std::mutex());
+  return slot.get();
+}
+
+// =================================================================
+// 读取端
+// =================================================================
+struct ThumbArchive {
+  MappedFile mapping;
+  const ThumbArchiveEntry* entries = nullptr;
+  int count = 0;
+};
+
+DLLEXPORT ThumbArchive* thumb_archive_open(const char* archive_path) {
+  if (!archive_path) return nullptr;
+
+  std::unique_ptr<ThumbArchive> archive(new ThumbArchive());
+  if (!archive->mapping.open(archive_path) || archive->mapping.size() < sizeof(ArchiveHeader)) return nullptr;
+
+  ArchiveHeader h;
+  memcpy(&h, archive->mapping.data(), sizeof(h));
+  if (!valid_header(h, archive->mapping.size())) return nullptr;
+
+  // 索引按 8 字节对齐写入，可以直接作为条目数组使用
+  archive->entries = (const ThumbArchiveEntry*)(archive->mapping.data() + h.index_offset);
+  archive->count = (int)h.entry_count;
+  for (int i = 0; i < archive->count; i++) {
+    if (!valid_entry(archive->entries[i], h.index_offset)) return nullptr;
+  }
+  return archive.release();
+}
+
+DLLEXPORT void thumb_archive_close(ThumbArchive* archive) {
+  delete archive;
+}
+
+DLLEXPORT int thumb_archive_count(const ThumbArchive* archive) {
+  return archive ? archive->count : 0;
+}
+
+DLLEXPORT const ThumbArchiveEntry* thumb_archive_entries(const ThumbArchive* archive) {
+  return archive && archive->count > 0 ? archive->entries : nullptr;
+}
+
+DLLEXPORT int thumb_archive_find(const ThumbArchive* archive, long long key) {
+  if (!archive || archive->count == 0) return -1;
+  const ThumbArchiveEntry* begin = archive->entries;
+  const ThumbArchiveEntry* end = archive->entries + archive->count;
+  const ThumbArchiveEntry* it = std::lower_bound(begin, end, key,
+    [](const ThumbArchiveEntry& e, long long k) { return e.key < k; });
+  return it != end && it->key == key ? (int)(it - begin) : -1;
+}
+
+DLLEXPORT const uint8_t* thumb_archive_data(const ThumbArchive* archive, int index, int* out_size) {
+  if (!archive || index < 0 || index >= archive->count) return nullptr;
+  const ThumbArchiveEntry& e = archive->entries[index];
+  if (out_size) *out_size = e.size;
+  return archive->mapping.data() + e.offset;
+}
+
+// =================================================================
+// 写入端
+// =================================================================
+ThumbArchiveWriter::ThumbArchiveWriter(const char* archive_path) {
+  if (!archive_path) return;
+  path_ = archive_path;
+  path_lock_ = path_lock_for(path_);
+  path_lock_->lock();
+
+  if (!load()) {
+    if (file_) fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+ThumbArchiveWriter::~ThumbArchiveWriter() {
+  if (file_) {
+    if (dirty_) commit();
+    fclose(file_);
+  }
+  if (path_lock_) path_lock_->unlock();
+}
+
+// 读取现有索引；文件不存在或格式错误时新建
+bool ThumbArchiveWriter::load() {
+  file_ = open_utf8_file(path_, "r+b");
+
+  ArchiveHeader h = {};
+  bool valid = false;
+  int64_t length = file_ ? file_length(file_) : -1;
+  if (length >= 0) {
+    uint64_t file_size = (uint64_t)length;
+    valid = file_size >= sizeof(ArchiveHeader) && fseek(file_, 0, SEEK_SET) == 0 &&
+      fread(&h, sizeof(h), 1, file_) == 1 && valid_header(h, file_size);
+    end_ = align8(file_size);
+  }
+
+  if (!valid) {
+    if (file_) fclose(file_);
+    file_ = open_utf8_file(path_, "w+b");
+    if (!file_) return false;
+
+    ArchiveHeader empty = {};
+    memcpy(empty.magic, kMagic, 4);
+    empty.version = kVersion;
+    empty.index_offset = sizeof(ArchiveHeader);
+    if (fwrite(&empty, sizeof(empty), 1, file_) != 1 || fflush(file_) != 0) return false;
+    end_ = sizeof(ArchiveHeader);
+    return true;
+  }
+
+  std::vector<ThumbArchiveEntry> index(h.entry_count);
+  if (h.entry_count > 0 && (seek_file(file_, h.index_offset) != 0 ||
+    fread(index.data(), sizeof(ThumbArchiveEntry), index.size(), file_) != index.size())) {
+    return false;
+  }
+  for (const auto& e : index) {
+    if (!valid_entry(e, h.index_offset)) return false;
+    entries_[e.key] = { (uint64_t)e.offset, (uint32_t)e.size };
+  }
+
+  garbage_ = h.garbage_bytes;
+  index_size_ = index.size() * sizeof(ThumbArchiveEntry);
+  return true;
+}
+
+int ThumbArchiveWriter::put(long long key, const uint8_t* data, size_t size) {
+  if (!data || size > 0x7FFFFFFF) return -1;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!file_) return -1;
+
+  static const uint8_t kPadding[8] = {};
+  size_t padding = (size_t)(align8(size) - size);
+  if (seek_file(file_, end_) != 0 || fwrite(data, 1, size, file_) != size ||
+    (padding > 0 && fwrite(kPadding, 1, padding, file_) != padding)) {
+    return -2;
+  }
+
+  auto it = entries_.find(key);
+  if (it != entries_.end()) garbage_ += align8(it->second.size);
+  entries_[key] = { end_, (uint32_t)size };
+  end_ += align8(size);
+  dirty_ = true;
+  return 0;
+}
+
+bool ThumbArchiveWriter::remove(long long key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) return false;
+
+  garbage_ += align8(it->second.size);
+  entries_.erase(it);
+  dirty_ = true;
+  return true;
+}
+
+int ThumbArchiveWriter::commit() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!file_) return -1;
+  if (!dirty_) return 0;
+
+  std::vector<ThumbArchiveEntry> index;
+  index.reserve(entries_.size());
+  uint64_t live = 0;
+  for (const auto& kv : entries_) {
+    index.push_back({ kv.first, (long long)kv.second.offset, (int)kv.second.size, 0 });
+    live += align8(kv.second.size);
+  }
+
+  // 旧索引在新文件头写入后失效
+  garbage_ += index_size_;
+  if (garbage_ > kCompactMinBytes && garbage_ > live && compact()) {
+    dirty_ = false;
+    return 0;
+  }
+  if (!file_) return -2;
+
+  // 1. 新索引追加到末尾
+  uint64_t index_offset = end_;
+  if (seek_file(file_, index_offset) != 0) return -2;
+  if (!index.empty() && fwrite(index.data(), sizeof(ThumbArchiveEntry), index.size(), file_) != index.size()) return -2;
+  if (fflush(file_) != 0) return -2;
+
+  // 2. 最后改写文件头 (原子地切换到新索引)
+  ArchiveHeader h = {};
+  memcpy(h.magic, kMagic, 4);
+  h.version = kVersion;
+  h.entry_count = (uint32_t)index.size();
+  h.index_offset = index_offset;
+  h.garbage_bytes = garbage_;
+  if (fseek(file_, 0, SEEK_SET) != 0 || fwrite(&h, sizeof(h), 1, file_) != 1 || fflush(file_) != 0) return -2;
+
+  index_size_ = index.size() * sizeof(ThumbArchiveEntry);
+  end_ = align8(index_offset + index_size_);
+  dirty_ = false;
+  return 0;
+}
+
+// 只保留有效图片，写入临时文件后替换 (Windows 上读取端仍映射着旧文件时替换失败，保留原文件)
+bool ThumbArchiveWriter::compact() {
+  std::string tmp_path = path_ + ".tmp";
+  std::FILE* out = open_utf8_file(tmp_path, "wb");
+  if (!out) return false;
+
+  ArchiveHeader h = {};
+  bool ok = fwrite(&h, sizeof(h), 1, out) == 1;
+
+  std::vector<ThumbArchiveEntry> index;
+  std::vector<uint8_t> buffer;
+  uint64_t offset = sizeof(ArchiveHeader);
+  for (const auto& kv : entries_) {
+    if (!ok) break;
+    buffer.assign(align8(kv.second.size), 0);
+    ok = seek_file(file_, kv.second.offset) == 0 && fread(buffer.data(), 1, kv.second.size, file_) == kv.second.size &&
+      fwrite(buffer.data(), 1, buffer.size(), out) == buffer.size();
+    index.push_back({ kv.first, (long long)offset, (int)kv.second.size, 0 });
+    offset += buffer.size();
+  }
+
+  memcpy(h.magic, kMagic, 4);
+  h.version = kVersion;
+  h.entry_count = (uint32_t)index.size();
+  h.index_offset = offset;
+  ok = ok && (index.empty() || fwrite(index.data(), sizeof(ThumbArchiveEntry), index.size(), out) == index.size());
+  ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, out) == 1;
+  ok = fclose(out) == 0 && ok;
+
+  std::error_code ec;
+  if (ok) {
+    fclose(file_);
+    file_ = nullptr;
+    fs::rename(fs::u8path(tmp_path), fs::u8path(path_), ec);
+    ok = !ec;
+  }
+  if (!ok) {
+    fs::remove(fs::u8path(tmp_path), ec);
+    // 继续使用原文件，内存中未提交的修改保持不变
+    if (!file_) file_ = open_utf8_file(path_, "r+b");
+    return false;
+  }
+
+  // 以新文件为准重新加载
+  entries_.clear();
+  garbage_ = 0;
+  index_size_ = 0;
+  if (!load() && file_) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+  return file_ != nullptr;
+}
+
+// =================================================================
+// 导出接口
+// =================================================================
+DLLEXPORT int thumb_archive_put(const char* archive_path, long long key, const uint8_t* data, int size) {
+  if (!archive_path || !data || size < 0) return -1;
+  ThumbArchiveWriter writer(archive_path);
+  if (!writer.is_open()) return -1;
+  int ret = writer.put(key, data, (size_t)size);
+  return ret == 0 ? writer.commit() : ret;
+}
+
+DLLEXPORT int thumb_archive_delete(const char* archive_path, const long long* keys, int count) {
+  if (!archive_path || (!keys && count > 0)) return -1;
+  std::error_code ec;
+  if (!fs::exists(fs::u8path(archive_path), ec)) return 0;
+
+  ThumbArchiveWriter writer(archive_path);
+  if (!writer.is_open()) return -1;
+
+  int removed = 0;
+  for (int i = 0; i < count; i++) {
+    if (writer.remove(keys[i])) removed++;
+  }
+  return writer.commit() == 0 ? removed : -2;
+}
@@ -0,0 +1,124 @@
+// thumb_archive/ThumbArchive.h
+#pragma once
+
+#include "../common.h"
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+
+// =================================================================
+// 单视频截图归档 (代替截图目录中的大量小 WebP 文件)
+//
+//   文件头 32 字节 | 图片数据 (首尾相接，8 字节对齐) | 索引 (按键升序)
+//
+// - 追加 / 删除只在文件末尾写入新数据和新索引，最后改写文件头:
+//   中途退出时文件头仍指向旧索引，归档保持一致
+// - 失效数据 (被替换 / 删除的图片、旧索引) 超过有效数据时重写文件
+// - 读取端 mmap 整个文件，直接返回图片在映射中的指针与长度 (不拷贝)
+// - 截图接口的输出路径以 .gra 结尾时写入归档，键为请求的时间戳 (毫秒)；
+//   图片来源路径 (故事板、图片转换) 可写成 "<归档路径>#<键>"
+// =================================================================
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef struct {
+    long long key;     // 调用方定义的键 (截图为时间戳毫秒)
+    long long offset;  // 图片数据在文件中的偏移
+    int size;          // 图片字节数
+    int reserved;
+  } ThumbArchiveEntry;
+
+  typedef struct ThumbArchive ThumbArchive;
+
+  /**
+   * @brief 以只读方式打开归档 (打开时的快照，之后的写入需要重新打开才能看到)。
+   * @return 归档句柄；文件不存在或格式错误时返回 NULL。
+   */
+  DLLEXPORT ThumbArchive* thumb_archive_open(const char* archive_path);
+
+  /**
+   * @brief 关闭归档。之前取得的条目 / 数据指针随之失效。
+   */
+  DLLEXPORT void thumb_archive_close(ThumbArchive* archive);
+
+  /**
+   * @brief 条目数量。
+   */
+  DLLEXPORT int thumb_archive_count(const ThumbArchive* archive);
+
+  /**
+   * @brief 全部条目 (按键升序，指向映射内存)，没有条目时返回 NULL。
+   */
+  DLLEXPORT const ThumbArchiveEntry* thumb_archive_entries(const ThumbArchive* archive);
+
+  /**
+   * @brief 按键查找条目。
+   * @return 条目下标；不存在时返回 -1。
+   */
+  DLLEXPORT int thumb_archive_find(const ThumbArchive* archive, long long key);
+
+  /**
+   * @brief 第 index 个条目的图片数据 (指向映射内存，不拷贝)。
+   * @param out_size [输出] 字节数
+   * @return 数据指针；下标越界时返回 NULL。
+   */
+  DLLEXPORT const uint8_t* thumb_archive_data(const ThumbArchive* archive, int index, int* out_size);
+
+  /**
+   * @brief 写入一张图片 (归档不存在时创建，键已存在时替换)。
+   * @return 0 成功；小于 0 表示失败。
+   */
+  DLLEXPORT int thumb_archive_put(const char* archive_path, long long key, const uint8_t* data, int size);
+
+  /**
+   * @brief 删除若干键 (不存在的键忽略)。
+   * @return 实际删除的数量；小于 0 表示无法打开归档。
+   */
+  DLLEXPORT int thumb_archive_delete(const char* archive_path, const long long* keys, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+// =================================================================
+// 写入端 (C++ 内部使用)。同一进程内同一归档同时只有一个写入者，构造时等待。
+// put / remove 线程安全；commit 之前的修改对读取端不可见。
+// =================================================================
+class ThumbArchiveWriter {
+public:
+  explicit ThumbArchiveWriter(const char* archive_path);
+  ~ThumbArchiveWriter(); // 有未提交的修改时自动 commit
+  ThumbArchiveWriter(const ThumbArchiveWriter&) = delete;
+  ThumbArchiveWriter& operator=(const ThumbArchiveWriter&) = delete;
+
+  bool is_open() const { return file_ != nullptr; }
+
+  int put(long long key, const uint8_t* data, size_t size);
+  bool remove(long long key);
+
+  // 写入新索引并更新文件头，必要时压缩。0 成功
+  int commit();
+
+private:
+  struct Slot {
+    uint64_t offset;
+    uint32_t size;
+  };
+
+  bool load();
+  bool compact();
+
+  std::string path_;
+  std::FILE* file_ = nullptr;
+  std::map<long long, Slot> entries_;
+  uint64_t end_ = 0;       // 下一次追加的位置
+  uint64_t garbage_ = 0;   // 失效字节数
+  uint64_t index_size_ = 0;
+  bool dirty_ = false;
+  std::mutex* path_lock_ = nullptr;
+  std::mutex mutex_;
+};
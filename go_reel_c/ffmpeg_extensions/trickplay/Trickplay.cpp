@@ -0,0 +1,254 @@
+#include "Trickplay.h"
+#include "../core/FramePool.h"
+#include "../core/MediaCache.h"
+#include "../core/ThreadPool.h"
+#include "../screen_shot/ScreenshotterInternal.h"
+#include "../screen_shot/ScreenshotterPlanner.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <string>
+#include <vector>
+
+// 单个索引条目 (写文件前的内存形式)
+struct TrickplayEntry {
+  long long frame_ms = -1; // -1 = 尚未分配图块
+  int sheet = 0;
+  int x = 0;
+  int y = 0;
+};
+
+static void put_u16(std::vector<uint8_t>& out, uint32_t v) {
+  out.push_back((uint8_t)(v & 0xFF));
+  out.push_back((uint8_t)((v >> 8) & 0xFF));
+}
+
+static void put_u32(std::vector<uint8_t>& out, uint32_t v) {
+  put_u16(out, v & 0xFFFF);
+  put_u16(out, v >> 16);
+}
+
+static void put_i64(std::vector<uint8_t>& out, long long v) {
+  put_u32(out, (uint32_t)((unsigned long long)v & 0xFFFFFFFFu));
+  put_u32(out, (uint32_t)((unsigned long long)v >> 32));
+}
+
+static TrickplayOptions resolve_trickplay_options(const TrickplayOptions* options) {
+  TrickplayOptions o;
+  trickplay_options_init(&o);
+  if (!options) return o;
+
+  if (options->interval_ms > 0) o.interval_ms = options->interval_ms;
+  if (options->tile_width > 0) o.tile_width = (std::min)(options->tile_width, 1024);
+  if (options->columns > 0) o.columns = (std::min)(options->columns, 64);
+  if (options->rows > 0) o.rows = (std::min)(options->rows, 64);
+  if (options->quality > 0 && options->quality <= 100) o.quality = options->quality;
+  return o;
+}
+
+// 图块高度: 按显示宽高比 (考虑 SAR)，取偶数以对齐 YUV420P 色度平面
+static int tile_height_for(const AVStream* stream, int tile_width) {
+  const AVCodecParameters* par = stream->codecpar;
+  if (par->width <= 0 || par->height <= 0) return (tile_width * 9 / 16) & ~1;
+
+  AVRational sar = stream->sample_aspect_ratio.num > 0 ? stream->sample_aspect_ratio : par->sample_aspect_ratio;
+  double display_w = (double)par->width * (sar.num > 0 && sar.den > 0 ? av_q2d(sar) : 1.0);
+  int h = (int)(tile_width * par->height / display_w + 0.5);
+  return (std::max)(h & ~1, 2);
+}
+
+// 雪碧图 (YUV420P)，未使用的图块为黑色
+static AVFrame* new_sheet(int width, int height) {
+  AVFrame* sheet = FramePool::instance().acquire(width, height, AV_PIX_FMT_YUV420P);
+  if (!sheet) return nullptr;
+
+  for (int y = 0; y < height; y++) memset(sheet->data[0] + (size_t)y * sheet->linesize[0], 16, width);
+  for (int y = 0; y < height / 2; y++) {
+    memset(sheet->data[1] + (size_t)y * sheet->linesize[1], 128, width / 2);
+    memset(sheet->data[2] + (size_t)y * sheet->linesize[2], 128, width / 2);
+  }
+  return sheet;
+}
+
+// 把帧缩放到雪碧图的 (x, y) 位置 (x、y、尺寸均为偶数)
+static int scale_into_tile(SwsContext** sws, const AVFrame* frame, AVFrame* sheet, int x, int y, int tile_w, int tile_h) {
+  *sws = sws_getCachedContext(*sws,
+    frame->width, frame->height, (AVPixelFormat)frame->format,
+    tile_w, tile_h, AV_PIX_FMT_YUV420P,
+    SWS_BILINEAR, NULL, NULL, NULL);
+  if (!*sws) return -1;
+
+  uint8_t* dst[4] = {
+    sheet->data[0] + (size_t)y * sheet->linesize[0] + x,
+    sheet->data[1] + (size_t)(y / 2) * sheet->linesize[1] + x / 2,
+    sheet->data[2] + (size_t)(y / 2) * sheet->linesize[2] + x / 2,
+    nullptr
+  };
+  int dst_linesize[4] = { sheet->linesize[0], sheet->linesize[1], sheet->linesize[2], 0 };
+
+  sws_scale(*sws, frame->data, frame->linesize, 0, frame->height, dst, dst_linesize);
+  return 0;
+}
+
+static std::string sheet_path(const std::string& dir, int index) {
+  char name[32];
+  snprintf(name, sizeof(name), "sheet_%03d.webp", index);
+  return dir + "/" + name;
+}
+
+// =================================================================
+// 导出接口
+// =================================================================
+DLLEXPORT void trickplay_options_init(TrickplayOptions* options) {
+  if (!options) return;
+  options->interval_ms = 5000;
+  options->tile_width = 160;
+  options->columns = 10;
+  options->rows = 10;
+  options->quality = 0;
+}
+
+DLLEXPORT int generate_trickplay(const char* video_path, const char* output_dir, const TrickplayOptions* options) {
+  if (!video_path || !output_dir) return -1;
+
+  av_log_set_level(AV_LOG_ERROR);
+
+  const TrickplayOptions opts = resolve_trickplay_options(options);
+  const std::string dir = output_dir;
+  const int tile_w = opts.tile_width & ~1;
+  const int per_sheet = opts.columns * opts.rows;
+
+  ThreadPool& pool = ThreadPool::instance();
+  MediaLease media = MediaCache::instance().acquire(video_path, pool.decoder_threads());
+  if (!media || !media->video_stream()) return -1;
+
+  long long duration_ms = media_duration_ms(media.get());
+  if (duration_ms <= 0) return -1;
+
+  const int tile_h = tile_height_for(media->video_stream(), tile_w);
+
+  // 1. 固定间隔的时间点，按关键帧模式规划 (每个时间点只解码最近的一个 I 帧)
+  std::vector<long long> timestamps;
+  for (long long t = 0; t < duration_ms; t += opts.interval_ms) timestamps.push_back(t);
+
+  ScreenshotOptions seek_options;
+  screenshot_options_init(&seek_options);
+  seek_options.seek_mode = SCREENSHOT_SEEK_KEYFRAME;
+  seek_options.priority = TASK_PRIORITY_BACKGROUND;
+
+  std::vector<ShotTarget> targets = plan_shot_targets(media.get(), timestamps, seek_options);
+  std::vector<TrickplayEntry> entries(targets.size());
+
+  // 2. 解码并拼图，写满一张雪碧图就交给线程池编码
+  SwsContext* sws = nullptr;
+  AVFrame* sheet = nullptr;
+  int sheet_index = 0;
+  int tile_index = 0;
+  std::vector<std::future<int>> saves;
+  ScreenshotOutputOptions output;
+  output_options_init(&output);
+  output.quality = opts.quality;
+
+  auto flush_sheet = [&]() {
+    if (!sheet) return;
+    if (tile_index == 0) {
+      av_frame_free(&sheet);
+      return;
+    }
+    // 最后一张只保留用到的行
+    int used_rows = (tile_index + opts.columns - 1) / opts.columns;
+    sheet->height = used_rows * tile_h;
+
+    AVFrame* to_save = sheet;
+    std::string path = sheet_path(dir, sheet_index);
+    saves.push_back(pool.async(TASK_PRIORITY_BACKGROUND, [to_save, path, output]() {
+      int res = save_frame_internal(to_save, path.c_str(), &output);
+      AVFrame* to_free = to_save;
+      av_frame_free(&to_free); // 缓冲区归还 FramePool
+      return res;
+      }));
+
+    sheet = nullptr;
+    sheet_index++;
+    tile_index = 0;
+  };
+
+  ScreenshotBatchStats stats{};
+  {
+    BatchFrameDecoder decoder(media.get(), seek_options, &stats);
+    decoder.run(targets, [&](size_t first, size_t last, const AVFrame* frame, long long frame_ms) {
+      if (!sheet) {
+        sheet = new_sheet(opts.columns * tile_w, opts.rows * tile_h);
+        if (!sheet) return;
+      }
+
+      int x = (tile_index % opts.columns) * tile_w;
+      int y = (tile_index / opts.columns) * tile_h;
+      if (scale_into_tile(&sws, frame, sheet, x, y, tile_w, tile_h) < 0) return;
+
+      for (size_t t = first; t < last; t++) {
+        entries[t].frame_ms = frame_ms;
+        entries[t].sheet = sheet_index;
+        entries[t].x = x;
+        entries[t].y = y;
+      }
+
+      if (++tile_index == per_sheet) flush_sheet();
+      });
+  }
+  flush_sheet();
+  if (sws) sws_freeContext(sws);
+
+  int failed = 0;
+  for (auto& save : saves) {
+    if (pool.wait(save) != 0) failed++;
+  }
+  if (sheet_index == 0 || failed > 0) return -1;
+
+  // 3. 解码失败 / 超出文件末尾的时间点使用相邻图块
+  int last_valid = -1;
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (entries[i].frame_ms >= 0) last_valid = (int)i;
+    else if (last_valid >= 0) entries[i] = entries[last_valid];
+  }
+  for (size_t i = entries.size(); i-- > 0; ) {
+    if (entries[i].frame_ms >= 0) last_valid = (int)i;
+    else if (last_valid >= 0) entries[i] = entries[last_valid];
+  }
+
+  // 4. 写索引
+  std::vector<uint8_t> index;
+  index.reserve(TRICKPLAY_INDEX_HEADER_SIZE + entries.size() * TRICKPLAY_INDEX_ENTRY_SIZE);
+  index.insert(index.end(), TRICKPLAY_INDEX_MAGIC, TRICKPLAY_INDEX_MAGIC + 4);
+  put_u32(index, TRICKPLAY_INDEX_VERSION);
+  put_u32(index, (uint32_t)opts.interval_ms);
+  put_u16(index, (uint32_t)tile_w);
+  put_u16(index, (uint32_t)tile_h);
+  put_u16(index, (uint32_t)opts.columns);
+  put_u16(index, (uint32_t)opts.rows);
+  put_u32(index, (uint32_t)sheet_index);
+  put_u32(index, (uint32_t)entries.size());
+  put_i64(index, duration_ms);
+  put_u32(index, 0);
+
+  for (const TrickplayEntry& e : entries) {
+    put_u32(index, (uint32_t)(std::max)(e.frame_ms, 0LL));
+    put_u16(index, (uint32_t)e.sheet);
+    put_u16(index, (uint32_t)e.x);
+    put_u16(index, (uint32_t)e.y);
+    put_u16(index, 0);
+  }
+
+  std::string index_path = dir + "/index.bin";
+  FILE* f = fopen(index_path.c_str(), "wb");
+  if (!f) {
+    fprintf(stderr, "[Error] Could not open output file: %s\n", index_path.c_str());
+    return -1;
+  }
+  size_t written = fwrite(index.data(), 1, index.size(), f);
+  fclose(f);
+  if (written != index.size()) return -1;
+
+  return (int)entries.size();
+}
@@ -0,0 +1,69 @@
+// trickplay/Trickplay.h
+#pragma once
+
+#include "../common.h"
+
+// =================================================================
+// 进度条悬停预览 (trickplay) 索引
+//
+// 一次遍历按固定间隔取关键帧，缩小后拼成若干张雪碧图，并写出二进制索引:
+//   <output_dir>/sheet_000.webp, sheet_001.webp ...
+//   <output_dir>/index.bin
+//
+// index.bin (小端):
+//   头部 40 字节
+//     char[4]  magic        "GRTP"
+//     uint32   version      1
+//     uint32   interval_ms
+//     uint16   tile_width
+//     uint16   tile_height
+//     uint16   columns      每张雪碧图的列数
+//     uint16   rows         每张雪碧图的最大行数
+//     uint32   sheet_count
+//     uint32   entry_count
+//     int64    duration_ms
+//     uint32   reserved
+//   之后 entry_count 个条目，每个 12 字节，第 i 个条目对应 i * interval_ms
+//     uint32   frame_ms     实际使用的帧时间
+//     uint16   sheet        雪碧图序号
+//     uint16   x, y         图块左上角像素坐标
+//     uint16   reserved
+// 间隔内的关键帧相同时 (长 GOP)，多个条目指向同一个图块。
+// =================================================================
+
+#define TRICKPLAY_INDEX_MAGIC "GRTP"
+#define TRICKPLAY_INDEX_VERSION 1
+#define TRICKPLAY_INDEX_HEADER_SIZE 40
+#define TRICKPLAY_INDEX_ENTRY_SIZE 12
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef struct {
+    int interval_ms;   // 取帧间隔 (默认 5000)
+    int tile_width;    // 图块宽度，高度按显示宽高比计算 (默认 160)
+    int columns;       // 每张雪碧图的列数 (默认 10)
+    int rows;          // 每张雪碧图的最大行数 (默认 10)
+    int quality;       // WebP 质量 1-100，0 = 默认
+  } TrickplayOptions;
+
+  /**
+   * @brief 填充 trickplay 选项默认值。
+   */
+  DLLEXPORT void trickplay_options_init(TrickplayOptions* options);
+
+  /**
+   * @brief 为视频生成 trickplay 雪碧图与索引 (只解码关键帧)。
+   *
+   * @param video_path  视频路径 (UTF-8)
+   * @param output_dir  输出目录 (必须已存在)，已有的同名文件会被覆盖
+   * @param options     选项，NULL 表示默认值
+   *
+   * @return 索引条目数；小于 0 表示失败
+   */
+  DLLEXPORT int generate_trickplay(const char* video_path, const char* output_dir, const TrickplayOptions* options);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,239 @@
+#include "TransmuxStream.h"
+#include "../video_trim/VideoTrimerInternal.h"
+#include "../video_transcode/VideoTranscoder.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+static const int kIoBufferSize = 64 * 1024;
+
+// 片段最长 1 秒 (关键帧间隔更短时在关键帧处切分)，播放器收到第一个片段就能开始播放
+static const char* const kFragmentDurationUs = "1000000";
+
+// 已读走的字节超过该值时才整理缓冲区，避免每次读取都移动数据
+static const size_t kCompactThreshold = 1024 * 1024;
+
+struct TransmuxStream {
+  AVFormatContext* ifmt_ctx = nullptr;
+  AVFormatContext* ofmt_ctx = nullptr;
+  AVPacket* pkt = nullptr;
+  int video_idx = -1;
+  int audio_idx = -1;
+  std::vector<int> stream_mapping;
+  std::vector<StreamState> states;
+  std::unique_ptr<CopySegmentWriter> writer;
+  SegmentInfo segment = {};
+
+  // 输出字节: [read_pos, pending.size()) 尚未读走
+  std::vector<uint8_t> pending;
+  size_t read_pos = 0;
+  bool eof = false;
+  int error = 0;
+};
+
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+static int write_output(void* opaque, const uint8_t* buf, int size) {
+#else
+static int write_output(void* opaque, uint8_t* buf, int size) {
+#endif
+  TransmuxStream* stream = (TransmuxStream*)opaque;
+  stream->pending.insert(stream->pending.end(), buf, buf + size);
+  return size;
+}
+
+static void close_output(TransmuxStream* stream) {
+  stream->writer.reset();
+  if (!stream->ofmt_ctx) return;
+  if (stream->ofmt_ctx->pb) {
+    av_freep(&stream->ofmt_ctx->pb->buffer);
+    avio_context_free(&stream->ofmt_ctx->pb);
+  }
+  avformat_free_context(stream->ofmt_ctx);
+  stream->ofmt_ctx = nullptr;
+}
+
+// 新建分片 MP4 输出并写入文件头 (ftyp + 空 moov)
+static int open_output(TransmuxStream* stream) {
+  AVDictionary* muxer_opts = nullptr;
+  int ret;
+
+  avformat_alloc_output_context2(&stream->ofmt_ctx, NULL, "mp4", NULL);
+  if (!stream->ofmt_ctx) return AVERROR(ENOMEM);
+
+  uint8_t* io_buffer = (uint8_t*)av_malloc(kIoBufferSize);
+  if (!io_buffer) return AVERROR(ENOMEM);
+  stream->ofmt_ctx->pb = avio_alloc_context(io_buffer, kIoBufferSize, 1, stream, NULL, write_output, NULL);
+  if (!stream->ofmt_ctx->pb) { av_free(io_buffer); return AVERROR(ENOMEM); }
+  stream->ofmt_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+  if ((ret = create_copy_streams(stream->ifmt_ctx, stream->ofmt_ctx, stream->stream_mapping)) < 0) return ret;
+
+  // 输出不可 seek: moov 只描述轨道，样本都在之后的 moof 片段里
+  av_dict_set(&muxer_opts, "movflags", "frag_keyframe+empty_moov+default_base_moof", 0);
+  av_dict_set(&muxer_opts, "frag_duration", kFragmentDurationUs, 0);
+  ret = avformat_write_header(stream->ofmt_ctx, &muxer_opts);
+  av_dict_free(&muxer_opts);
+  if (ret < 0) return ret;
+  avio_flush(stream->ofmt_ctx->pb);
+
+  for (auto& state : stream->states) state = StreamState();
+  stream->writer.reset(new CopySegmentWriter(stream->ifmt_ctx, stream->ofmt_ctx, stream->video_idx,
+    stream->stream_mapping, stream->states, LLONG_MAX, &stream->segment));
+  return 0;
+}
+
+// 从源文件处理一个包；文件结束时写入最后一个片段
+// 写入失败时停止输出，已缓存的数据读完后 transmux_read 返回该错误码
+static void pump_packet(TransmuxStream* stream) {
+  int ret = av_read_frame(stream->ifmt_ctx, stream->pkt);
+  if (ret < 0) {
+    // 读取错误按文件结束处理，已输出的部分仍可播放
+    stream->eof = true;
+    if (stream->writer->started() && (ret = av_write_trailer(stream->ofmt_ctx)) < 0) stream->error = ret;
+    avio_flush(stream->ofmt_ctx->pb);
+    return;
+  }
+
+  if (!stream->writer->write(stream->pkt) && stream->writer->error() < 0) {
+    stream->error = stream->writer->error();
+    stream->eof = true;
+  }
+  av_packet_unref(stream->pkt);
+  avio_flush(stream->ofmt_ctx->pb);
+}
+
+// 重新开始输出: seek 到 time_ms 处或之前的关键帧，处理到起始关键帧 (确定实际起点)
+static int restart_at(TransmuxStream* stream, long long time_ms) {
+  close_output(stream);
+  stream->pending.clear();
+  stream->read_pos = 0;
+  stream->eof = false;
+  stream->error = 0;
+
+  int64_t seek_target = av_rescale_q(time_ms, { 1, 1000 }, stream->ifmt_ctx->streams[stream->video_idx]->time_base);
+  av_seek_frame(stream->ifmt_ctx, stream->video_idx, seek_target, AVSEEK_FLAG_BACKWARD);
+
+  int ret = open_output(stream);
+  if (ret < 0) {
+    stream->error = ret;
+    return ret;
+  }
+
+  while (!stream->eof && !stream->writer->started()) pump_packet(stream);
+  if (stream->error < 0) return stream->error;
+  return stream->writer->started() ? 0 : AVERROR_EOF;
+}
+
+// RFC 6381 codecs 字符串: avc1.PPCCLL (profile / constraint flags / level，取自 avcC)，AAC 为 mp4a.40.<AOT>
+static void build_codecs_string(const AVCodecParameters* video, const AVCodecParameters* audio, char* out, size_t size) {
+  int profile = video->profile & 0xFF;
+  int constraints = 0;
+  int level = video->level > 0 ? video->level : 0;
+  if (video->extradata_size >= 4 && video->extradata[0] == 1) {
+    profile = video->extradata[1];
+    constraints = video->extradata[2];
+    level = video->extradata[3];
+  }
+  int n = snprintf(out, size, "avc1.%02X%02X%02X", profile, constraints, level & 0xFF);
+  if (!audio || n < 0 || (size_t)n >= size) return;
+
+  if (audio->codec_id == AV_CODEC_ID_AAC) {
+    // AVCodecParameters.profile 为 AOT - 1，未知时按 AAC-LC
+    snprintf(out + n, size - n, ",mp4a.40.%d", audio->profile >= 0 ? audio->profile + 1 : 2);
+  }
+  else {
+    snprintf(out + n, size - n, ",mp4a.6B"); // MP3
+  }
+}
+
+static void fill_info(const TransmuxStream* stream, TransmuxInfo* out_info) {
+  if (!out_info) return;
+  memset(out_info, 0, sizeof(*out_info));
+
+  const AVCodecParameters* video = stream->ifmt_ctx->streams[stream->video_idx]->codecpar;
+  const AVCodecParameters* audio = stream->audio_idx >= 0 ? stream->ifmt_ctx->streams[stream->audio_idx]->codecpar : nullptr;
+  out_info->start_ms = stream->segment.actual_start_ms;
+  out_info->duration_ms = stream->ifmt_ctx->duration > 0 ? stream->ifmt_ctx->duration / 1000 : 0;
+  out_info->width = video->width;
+  out_info->height = video->height;
+  out_info->has_audio = audio != nullptr;
+  build_codecs_string(video, audio, out_info->codecs, sizeof(out_info->codecs));
+}
+
+DLLEXPORT TransmuxStream* transmux_open(const char* input_path, long long start_ms, TransmuxInfo* out_info) {
+  if (!input_path) return nullptr;
+
+  TransmuxStream* stream = new TransmuxStream();
+  int audio_idx = -1;
+
+  av_log_set_level(AV_LOG_ERROR);
+
+  if (avformat_open_input(&stream->ifmt_ctx, input_path, NULL, NULL) < 0) goto fail;
+  if (avformat_find_stream_info(stream->ifmt_ctx, NULL) < 0) goto fail;
+
+  // 只保留一路视频和一路音频 (不兼容的音频丢弃)
+  stream->video_idx = av_find_best_stream(stream->ifmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+  if (stream->video_idx < 0) goto fail;
+  if (!video_copy_compatible(stream->ifmt_ctx->streams[stream->video_idx]->codecpar, nullptr)) goto fail;
+  audio_idx = av_find_best_stream(stream->ifmt_ctx, AVMEDIA_TYPE_AUDIO, -1, stream->video_idx, NULL, 0);
+  if (audio_idx >= 0 && audio_copy_compatible(stream->ifmt_ctx->streams[audio_idx]->codecpar)) stream->audio_idx = audio_idx;
+
+  stream->states.resize(map_copy_streams(stream->ifmt_ctx, [stream](int i) {
+    return i == stream->video_idx || i == stream->audio_idx;
+    }, stream->stream_mapping));
+
+  stream->pkt = av_packet_alloc();
+  if (!stream->pkt) goto fail;
+
+  if (restart_at(stream, (std::max)(start_ms, 0LL)) < 0) goto fail;
+
+  fill_info(stream, out_info);
+  return stream;
+
+fail:
+  transmux_close(stream);
+  return nullptr;
+}
+
+DLLEXPORT int transmux_read(TransmuxStream* stream, uint8_t* buffer, int capacity) {
+  if (!stream || !buffer || capacity <= 0) return AVERROR(EINVAL);
+
+  while (!stream->eof && stream->error == 0 && stream->pending.size() - stream->read_pos < (size_t)capacity) {
+    pump_packet(stream);
+  }
+
+  size_t available = stream->pending.size() - stream->read_pos;
+  if (available == 0 && stream->error < 0) return stream->error;
+  int n = (int)(std::min)(available, (size_t)capacity);
+  if (n > 0) memcpy(buffer, stream->pending.data() + stream->read_pos, n);
+  stream->read_pos += n;
+
+  if (stream->read_pos == stream->pending.size()) {
+    stream->pending.clear();
+    stream->read_pos = 0;
+  }
+  else if (stream->read_pos >= kCompactThreshold) {
+    stream->pending.erase(stream->pending.begin(), stream->pending.begin() + stream->read_pos);
+    stream->read_pos = 0;
+  }
+  return n;
+}
+
+DLLEXPORT int transmux_seek(TransmuxStream* stream, long long time_ms, TransmuxInfo* out_info) {
+  if (!stream) return AVERROR(EINVAL);
+  int ret = restart_at(stream, (std::max)(time_ms, 0LL));
+  if (ret < 0) return ret;
+  fill_info(stream, out_info);
+  return 0;
+}
+
+DLLEXPORT void transmux_close(TransmuxStream* stream) {
+  if (!stream) return;
+  close_output(stream);
+  if (stream->pkt) av_packet_free(&stream->pkt);
+  if (stream->ifmt_ctx) avformat_close_input(&stream->ifmt_ctx);
+  delete stream;
+}
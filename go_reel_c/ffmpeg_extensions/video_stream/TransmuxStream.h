@@ -0,0 +1,59 @@
+// video_stream/TransmuxStream.h
+#pragma once
+
+#include "../common.h"
+
+// =================================================================
+// 分片 MP4 (fMP4) 实时换封装流
+//
+// 编码兼容 (H.264 + AAC / MP3，见 video_copy_compatible) 但容器不能直接播放的文件 (MKV / AVI / TS ...)
+// 不必先转出一份完整的 MP4: 按读取进度从源文件取包，流拷贝写入内存中的分片 MP4，
+// 调用方边读边交给播放器 (Electron 的自定义协议 / MSE)。
+//
+// - 输出为 ftyp + moov (不含样本)，之后是 moof + mdat 片段 (关键帧处或每 1 秒切分)
+// - 只在 transmux_read 时处理数据，内存中只保留尚未读走的字节，不落盘
+// - 起点与 seek 对齐到目标时间处或之前最近的关键帧，输出时间轴以该关键帧为 0 (与 trim_video 相同)
+// - 同一个流不能被多个线程同时调用
+// =================================================================
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef struct TransmuxStream TransmuxStream;
+
+  typedef struct {
+    long long start_ms;    // 输出起点在源视频中的时间 (关键帧，毫秒)，输出时间 0 对应此处
+    long long duration_ms; // 源视频时长 (毫秒)，未知时为 0
+    int width;
+    int height;
+    int has_audio;         // 是否包含音轨 (不兼容的音轨被丢弃)
+    char codecs[64];       // RFC 6381 codecs 字符串 (例如 "avc1.64001F,mp4a.40.2")，供 MSE 使用
+  } TransmuxInfo;
+
+  /**
+   * @brief 打开换封装流，从 start_ms 处或之前最近的关键帧开始。
+   * @param out_info [输出] 可为 NULL
+   * @return 流句柄；文件无法打开、没有视频或视频编码不能流拷贝时返回 NULL。
+   */
+  DLLEXPORT TransmuxStream* transmux_open(const char* input_path, long long start_ms, TransmuxInfo* out_info);
+
+  /**
+   * @brief 读取输出字节 (不足时从源文件继续处理，直到凑满 capacity 或文件结束)。
+   * @return 读取的字节数；0 表示已结束；小于 0 表示 FFmpeg 错误码 (写入失败时先读完已输出的字节)。
+   */
+  DLLEXPORT int transmux_read(TransmuxStream* stream, uint8_t* buffer, int capacity);
+
+  /**
+   * @brief 跳转到 time_ms 处或之前最近的关键帧，丢弃尚未读走的字节。
+   *        之后读到的是一个新的完整分片 MP4 (重新以 ftyp + moov 开始，时间轴以新的关键帧为 0)。
+   * @param out_info [输出] 可为 NULL，start_ms 为新的起点
+   * @return 0 表示成功，小于 0 表示 FFmpeg 错误码。
+   */
+  DLLEXPORT int transmux_seek(TransmuxStream* stream, long long time_ms, TransmuxInfo* out_info);
+
+  DLLEXPORT void transmux_close(TransmuxStream* stream);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,854 @@
+#include "VideoTranscoder.h"
+#include "../core/Job.h"
+#include "../core/ThreadPool.h"
+#include "../video_trim/VideoTrimer.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <libavutil/audio_fifo.h>
+#include <libswresample/swresample.h>
+}
+
+static const int kDefaultCrf = 23;
+static const char* const kDefaultPreset = "veryfast";
+static const int kDefaultAudioBitrate = 128000;
+
+// 队列容量: 压缩包很小可以多缓存；解码后的帧很大 (4K yuv420p 一帧约 12 MB)，只保留几帧
+static const size_t kPacketQueueSize = 64;
+static const size_t kFrameQueueSize = 4;
+
+// =================================================================
+// 转码线程份额
+//
+// 正在执行的转码任务平分 CPU 预算 (留一个线程给交互任务)。编解码器打开后线程数不能再改，
+// 所以份额在任务开始时按当时的任务数计算: 后开始的任务与先开始的任务分到同样多的线程，
+// 而不是只拿到剩下的部分。线程池中的预留总量随任务开始 / 结束重新计算。
+// =================================================================
+class TranscodeThreadShares {
+public:
+  static TranscodeThreadShares& instance() {
+    static TranscodeThreadShares* shares = new TranscodeThreadShares();
+    return *shares;
+  }
+
+  // wanted > 0 时按指定线程数，否则按正在执行的任务数平分；返回分到的线程数
+  int join(int wanted) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    active_++;
+    int budget = (std::max)(ThreadPool::instance().cpu_budget() - 1, 1);
+    int share = wanted > 0 ? wanted : (std::max)(budget / active_, 2);
+    granted_ += share;
+    update_reservation_locked();
+    return share;
+  }
+
+  void leave(int share) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    active_--;
+    granted_ -= share;
+    update_reservation_locked();
+  }
+
+private:
+  void update_reservation_locked() {
+    ThreadPool& pool = ThreadPool::instance();
+    if (reserved_ > 0) pool.release_threads(reserved_);
+    reserved_ = granted_ > 0 ? pool.reserve_threads(granted_) : 0;
+  }
+
+  std::mutex mutex_;
+  int active_ = 0;
+  int granted_ = 0;  // 各任务份额之和
+  int reserved_ = 0; // 当前在线程池中的预留 (不超过 预算 - 1)
+};
+
+DLLEXPORT void transcode_options_init(TranscodeOptions* options) {
+  if (!options) return;
+  memset(options, 0, sizeof(*options));
+  options->crf = -1;
+  snprintf(options->preset, sizeof(options->preset), "%s", kDefaultPreset);
+}
+
+static TranscodeOptions resolve_options(const TranscodeOptions* options) {
+  TranscodeOptions resolved;
+  transcode_options_init(&resolved);
+  if (options) {
+    resolved = *options;
+    resolved.preset[sizeof(resolved.preset) - 1] = '\0';
+  }
+  return resolved;
+}
+
+// 选择转码的视频流与音频流 (没有音频时 audio_idx 为 -1)
+static int find_transcode_streams(AVFormatContext* ifmt_ctx, int* video_idx, int* audio_idx) {
+  *video_idx = av_find_best_stream(ifmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+  if (*video_idx < 0) return *video_idx;
+  int audio = av_find_best_stream(ifmt_ctx, AVMEDIA_TYPE_AUDIO, -1, *video_idx, NULL, 0);
+  *audio_idx = audio >= 0 ? audio : -1;
+  return 0;
+}
+
+// =================================================================
+// 流拷贝快速路径的判断
+// =================================================================
+
+bool video_copy_compatible(const AVCodecParameters* par, const TranscodeOptions* options) {
+  if (par->codec_id != AV_CODEC_ID_H264) return false;
+  if (par->format != AV_PIX_FMT_YUV420P && par->format != AV_PIX_FMT_YUVJ420P) return false;
+  if (options && options->max_width > 0 && par->width > options->max_width) return false;
+  if (options && options->max_height > 0 && par->height > options->max_height) return false;
+  return true;
+}
+
+bool audio_copy_compatible(const AVCodecParameters* par) {
+  return par->codec_id == AV_CODEC_ID_AAC || par->codec_id == AV_CODEC_ID_MP3;
+}
+
+// MP4 / MOV 的顶层 box 中 moov 是否在 mdat 之前 (只读 box 头，不读数据)
+static bool mp4_is_faststart(const char* path) {
+  AVIOContext* io = nullptr;
+  if (avio_open(&io, path, AVIO_FLAG_READ) < 0) return false;
+
+  bool faststart = false;
+  int64_t file_size = avio_size(io);
+  int64_t pos = 0;
+  for (int i = 0; i < 64; i++) { // ftyp / free / moov / mdat ...，顶层 box 很少
+    if (avio_seek(io, pos, SEEK_SET) < 0) break;
+    uint64_t size = avio_rb32(io);
+    uint32_t type = avio_rl32(io);
+    if (avio_feof(io)) break;
+    if (size == 1) size = avio_rb64(io);                            // 64 位长度
+    else if (size == 0) size = file_size > pos ? file_size - pos : 0; // 延续到文件末尾
+
+    if (type == MKTAG('m', 'o', 'o', 'v')) { faststart = true; break; }
+    if (type == MKTAG('m', 'd', 'a', 't') || size < 8) break;
+    pos += (int64_t)size;
+  }
+
+  avio_closep(&io);
+  return faststart;
+}
+
+static int resolve_plan(AVFormatContext* ifmt_ctx, int video_idx, int audio_idx, const char* input_path,
+  const TranscodeOptions& options) {
+  if (options.force_encode) return TRANSCODE_PLAN_ENCODE;
+  if (!video_copy_compatible(ifmt_ctx->streams[video_idx]->codecpar, &options)) return TRANSCODE_PLAN_ENCODE;
+  if (audio_idx >= 0 && !audio_copy_compatible(ifmt_ctx->streams[audio_idx]->codecpar)) return TRANSCODE_PLAN_ENCODE;
+
+  bool is_mp4 = ifmt_ctx->iformat && strstr(ifmt_ctx->iformat->name, "mp4");
+  return is_mp4 && mp4_is_faststart(input_path) ? TRANSCODE_PLAN_NONE : TRANSCODE_PLAN_REMUX;
+}
+
+static void free_item(AVPacket* pkt) { av_packet_free(&pkt); }
+static void free_item(AVFrame* frame) { av_frame_free(&frame); }
+
+// =================================================================
+// 流水线阶段之间的有界队列
+// - 生产者 close 后，消费者取完剩余元素再结束
+// - abort (出错 / 取消) 立即唤醒两端，剩余元素在析构时释放
+// =================================================================
+template <class T>
+class StageQueue {
+public:
+  explicit StageQueue(size_t capacity) : capacity_(capacity) {}
+
+  ~StageQueue() {
+    for (T item : items_) free_item(item);
+  }
+
+  // 队列满时阻塞；已中止时返回 false，元素仍归调用方
+  bool push(T item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this]() { return aborted_ || items_.size() < capacity_; });
+    if (aborted_) return false;
+    items_.push_back(item);
+    not_empty_.notify_one();
+    return true;
+  }
+
+  // 队列空时阻塞；已关闭且取完、或已中止时返回 false
+  bool pop(T& item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this]() { return aborted_ || closed_ || !items_.empty(); });
+    if (aborted_ || items_.empty()) return false;
+    item = items_.front();
+    items_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    not_empty_.notify_all();
+  }
+
+  void abort() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    aborted_ = true;
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::deque<T> items_;
+  size_t capacity_;
+  bool closed_ = false;
+  bool aborted_ = false;
+};
+
+// =================================================================
+// 转码流水线
+//   解复用 (调用线程) -> 视频解码 -> 像素格式转换 / 缩放 -> 编码 + 写入
+//                    -> 音频 (拷贝时由解复用线程直接写入，否则单独一个线程解码 / 重采样 / 编码)
+// 各阶段线程大部分时间阻塞在队列上，使用独立线程；编解码器内部的线程从 CPU 预算中预留
+// =================================================================
+class Transcoder {
+public:
+  Transcoder(const TranscodeOptions& options, JobControl* job)
+    : options_(options), job_(job),
+    video_packets_(kPacketQueueSize), audio_packets_(kPacketQueueSize),
+    decoded_frames_(kFrameQueueSize), converted_frames_(kFrameQueueSize) {}
+
+  ~Transcoder() {
+    if (reserved_threads_ > 0) TranscodeThreadShares::instance().leave(reserved_threads_);
+    if (dec_) avcodec_free_context(&dec_);
+    if (enc_) avcodec_free_context(&enc_);
+    if (adec_) avcodec_free_context(&adec_);
+    if (aenc_) avcodec_free_context(&aenc_);
+    if (sws_) sws_freeContext(sws_);
+    if (swr_) swr_free(&swr_);
+    if (fifo_) av_audio_fifo_free(fifo_);
+    if (ifmt_) avformat_close_input(&ifmt_);
+    if (ofmt_) {
+      if (ofmt_->pb) avio_closep(&ofmt_->pb);
+      avformat_free_context(ofmt_);
+    }
+  }
+
+  Transcoder(const Transcoder&) = delete;
+  Transcoder& operator=(const Transcoder&) = delete;
+
+  int run(const char* input_path, const char* output_path);
+
+private:
+  int open_input(const char* input_path);
+  int remux(const char* output_path);
+  void reserve_threads();
+  int open_video();
+  int open_audio();
+  int open_output(const char* output_path);
+
+  void demux();
+  void video_decode_stage();
+  void convert_stage();
+  void video_encode_stage();
+  void audio_stage();
+
+  bool drain_video_encoder();
+  bool decode_audio_frames();
+  bool encode_audio_fifo(bool flush);
+  bool drain_audio_encoder();
+
+  // 写入输出 (各阶段线程共用 muxer，加锁)，pkt 的时间戳已是输出流 time_base
+  void write_packet(AVPacket* pkt);
+  void fail(int error);
+  bool failed() const { return error_.load() < 0; }
+
+  TranscodeOptions options_;
+  JobControl* job_;
+
+  AVFormatContext* ifmt_ = nullptr;
+  AVFormatContext* ofmt_ = nullptr;
+  int video_idx_ = -1;
+  int audio_idx_ = -1;
+  AVStream* video_out_ = nullptr;
+  AVStream* audio_out_ = nullptr;
+  int64_t start_time_ = 0; // 输入起始时间 (AV_TIME_BASE)，输出从 0 开始
+
+  AVCodecContext* dec_ = nullptr;
+  AVCodecContext* enc_ = nullptr;
+  SwsContext* sws_ = nullptr;
+  // 已设置范围转换的输入 (格式 / 宽 / 高 / 范围)，变化时 sws_getCachedContext 会重建上下文，需要重新设置
+  int sws_input_[4] = { -1, -1, -1, -1 };
+  int decoder_threads_ = 1;
+  int encoder_threads_ = 1;
+  int reserved_threads_ = 0;
+
+  bool audio_copy_ = false;
+  AVCodecContext* adec_ = nullptr;
+  AVCodecContext* aenc_ = nullptr;
+  SwrContext* swr_ = nullptr;
+  AVAudioFifo* fifo_ = nullptr;
+  int64_t next_audio_pts_ = AV_NOPTS_VALUE;
+
+  StageQueue<AVPacket*> video_packets_;
+  StageQueue<AVPacket*> audio_packets_;
+  StageQueue<AVFrame*> decoded_frames_;
+  StageQueue<AVFrame*> converted_frames_;
+
+  std::mutex mux_mutex_;
+  std::atomic<int> error_{ 0 };
+  long long progress_ms_ = 0; // 只在视频编码线程上更新
+};
+
+int Transcoder::open_input(const char* input_path) {
+  int ret;
+  if ((ret = avformat_open_input(&ifmt_, input_path, NULL, NULL)) < 0) return ret;
+  if ((ret = avformat_find_stream_info(ifmt_, NULL)) < 0) return ret;
+
+  if ((ret = find_transcode_streams(ifmt_, &video_idx_, &audio_idx_)) < 0) return ret;
+
+  if (ifmt_->start_time != AV_NOPTS_VALUE) start_time_ = ifmt_->start_time;
+  if (ifmt_->duration > 0) job_set_total(ifmt_->duration / 1000);
+  return 0;
+}
+
+// 只换封装: 选中的视频与音频流拷贝为 faststart MP4
+int Transcoder::remux(const char* output_path) {
+  std::vector<int> stream_mapping;
+  map_copy_streams(ifmt_, [this](int i) { return i == video_idx_ || i == audio_idx_; }, stream_mapping);
+
+  SegmentInfo info;
+  return remux_streams(ifmt_, output_path, stream_mapping, video_idx_, &info);
+}
+
+void Transcoder::reserve_threads() {
+  reserved_threads_ = TranscodeThreadShares::instance().join(options_.threads);
+
+  // 解码远比 x264 编码便宜，大部分线程给编码器
+  decoder_threads_ = (std::max)(reserved_threads_ / 4, 1);
+  encoder_threads_ = (std::max)(reserved_threads_ - decoder_threads_, 1);
+}
+
+int Transcoder::open_video() {
+  AVStream* in = ifmt_->streams[video_idx_];
+  int ret;
+
+  const AVCodec* decoder = avcodec_find_decoder(in->codecpar->codec_id);
+  if (!decoder) return AVERROR_DECODER_NOT_FOUND;
+  dec_ = avcodec_alloc_context3(decoder);
+  if (!dec_) return AVERROR(ENOMEM);
+  if ((ret = avcodec_parameters_to_context(dec_, in->codecpar)) < 0) return ret;
+  dec_->pkt_timebase = in->time_base;
+  dec_->thread_count = decoder_threads_;
+  if ((ret = avcodec_open2(dec_, decoder, NULL)) < 0) return ret;
+
+  // 输出尺寸: 等比缩小到限制以内，不放大；yuv420p 要求偶数
+  int width = in->codecpar->width;
+  int height = in->codecpar->height;
+  if (width <= 0 || height <= 0) return AVERROR_INVALIDDATA;
+  double scale = 1.0;
+  if (options_.max_width > 0 && width > options_.max_width) scale = (std::min)(scale, (double)options_.max_width / width);
+  if (options_.max_height > 0 && height > options_.max_height) scale = (std::min)(scale, (double)options_.max_height / height);
+  width = (std::max)((int)(width * scale) & ~1, 2);
+  height = (std::max)((int)(height * scale) & ~1, 2);
+
+  const AVCodec* encoder = avcodec_find_encoder_by_name("libx264");
+  if (!encoder) encoder = avcodec_find_encoder(AV_CODEC_ID_H264);
+  if (!encoder) return AVERROR_ENCODER_NOT_FOUND;
+  enc_ = avcodec_alloc_context3(encoder);
+  if (!enc_) return AVERROR(ENOMEM);
+
+  enc_->width = width;
+  enc_->height = height;
+  enc_->pix_fmt = AV_PIX_FMT_YUV420P;
+  enc_->sample_aspect_ratio = in->codecpar->sample_aspect_ratio;
+  enc_->time_base = in->time_base;
+  enc_->framerate = av_guess_frame_rate(ifmt_, in, NULL);
+  enc_->color_range = AVCOL_RANGE_MPEG; // 全范围输入在 convert_stage 中转换
+  enc_->color_primaries = in->codecpar->color_primaries;
+  enc_->color_trc = in->codecpar->color_trc;
+  enc_->colorspace = in->codecpar->color_space;
+  enc_->thread_count = encoder_threads_;
+  if (ofmt_->oformat->flags & AVFMT_GLOBALHEADER) enc_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+  // x264 使用 preset / CRF，其它 H.264 编码器 (系统硬件编码器) 按原码率
+  int crf = options_.crf >= 0 && options_.crf <= 51 ? options_.crf : kDefaultCrf;
+  char crf_text[16];
+  snprintf(crf_text, sizeof(crf_text), "%d", crf);
+  if (av_opt_set(enc_->priv_data, "crf", crf_text, 0) < 0) {
+    int64_t bit_rate = in->codecpar->bit_rate > 0 ? in->codecpar->bit_rate : ifmt_->bit_rate;
+    enc_->bit_rate = bit_rate > 0 ? bit_rate : 5000000;
+  }
+  av_opt_set(enc_->priv_data, "preset", options_.preset[0] ? options_.preset : kDefaultPreset, 0);
+
+  if ((ret = avcodec_open2(enc_, encoder, NULL)) < 0) return ret;
+
+  video_out_ = avformat_new_stream(ofmt_, NULL);
+  if (!video_out_) return AVERROR(ENOMEM);
+  if ((ret = avcodec_parameters_from_context(video_out_->codecpar, enc_)) < 0) return ret;
+  video_out_->time_base = enc_->time_base;
+  video_out_->avg_frame_rate = enc_->framerate;
+
+  // 保留旋转信息 (只转码像素，不旋转画面)
+#pragma warning(push)
+#pragma warning(disable: 4996)
+  for (int j = 0; j < in->nb_side_data; j++) {
+    const AVPacketSideData* sd = &in->side_data[j];
+    if (sd->type != AV_PKT_DATA_DISPLAYMATRIX) continue;
+    uint8_t* dst = av_stream_new_side_data(video_out_, sd->type, sd->size);
+    if (dst) memcpy(dst, sd->data, sd->size);
+  }
+#pragma warning(pop)
+  av_dict_copy(&video_out_->metadata, in->metadata, 0);
+  return 0;
+}
+
+int Transcoder::open_audio() {
+  if (audio_idx_ < 0) return 0;
+  AVStream* in = ifmt_->streams[audio_idx_];
+  int ret;
+
+  // AAC 直接拷贝
+  if (in->codecpar->codec_id == AV_CODEC_ID_AAC) {
+    audio_out_ = avformat_new_stream(ofmt_, NULL);
+    if (!audio_out_) return AVERROR(ENOMEM);
+    av_dict_copy(&audio_out_->metadata, in->metadata, 0);
+    if ((ret = avcodec_parameters_copy(audio_out_->codecpar, in->codecpar)) < 0) return ret;
+    audio_out_->codecpar->codec_tag = 0;
+    audio_out_->time_base = in->time_base;
+    audio_copy_ = true;
+    return 0;
+  }
+
+  const AVCodec* decoder = avcodec_find_decoder(in->codecpar->codec_id);
+  const AVCodec* encoder = avcodec_find_encoder(AV_CODEC_ID_AAC);
+  if (!decoder || !encoder) {
+    // 无法转换的音轨丢弃，只输出视频
+    audio_idx_ = -1;
+    return 0;
+  }
+
+  adec_ = avcodec_alloc_context3(decoder);
+  if (!adec_) return AVERROR(ENOMEM);
+  if ((ret = avcodec_parameters_to_context(adec_, in->codecpar)) < 0) return ret;
+  adec_->pkt_timebase = in->time_base;
+  if ((ret = avcodec_open2(adec_, decoder, NULL)) < 0) return ret;
+
+  aenc_ = avcodec_alloc_context3(encoder);
+  if (!aenc_) return AVERROR(ENOMEM);
+  // 多声道下混为立体声，兼容性最好
+  av_channel_layout_default(&aenc_->ch_layout, adec_->ch_layout.nb_channels >= 2 ? 2 : 1);
+  aenc_->sample_rate = adec_->sample_rate > 0 ? adec_->sample_rate : 48000;
+  aenc_->sample_fmt = AV_SAMPLE_FMT_FLTP;
+  aenc_->bit_rate = options_.audio_bitrate > 0 ? options_.audio_bitrate : kDefaultAudioBitrate;
+  aenc_->time_base = { 1, aenc_->sample_rate };
+  if (ofmt_->oformat->flags & AVFMT_GLOBALHEADER) aenc_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+  if ((ret = avcodec_open2(aenc_, encoder, NULL)) < 0) return ret;
+
+  audio_out_ = avformat_new_stream(ofmt_, NULL);
+  if (!audio_out_) return AVERROR(ENOMEM);
+  av_dict_copy(&audio_out_->metadata, in->metadata, 0);
+  if ((ret = avcodec_parameters_from_context(audio_out_->codecpar, aenc_)) < 0) return ret;
+  audio_out_->time_base = aenc_->time_base;
+
+  fifo_ = av_audio_fifo_alloc(aenc_->sample_fmt, aenc_->ch_layout.nb_channels, aenc_->frame_size > 0 ? aenc_->frame_size : 1024);
+  return fifo_ ? 0 : AVERROR(ENOMEM);
+}
+
+int Transcoder::open_output(const char* output_path) {
+  int ret;
+  if (!(ofmt_->oformat->flags & AVFMT_NOFILE)) {
+    if ((ret = avio_open(&ofmt_->pb, output_path, AVIO_FLAG_WRITE)) < 0) return ret;
+  }
+  av_dict_copy(&ofmt_->metadata, ifmt_->metadata, 0);
+
+  AVDictionary* muxer_opts = nullptr;
+  av_dict_set(&muxer_opts, "movflags", "faststart", 0);
+  ret = avformat_write_header(ofmt_, &muxer_opts);
+  av_dict_free(&muxer_opts);
+  return ret;
+}
+
+void Transcoder::fail(int error) {
+  int expected = 0;
+  error_.compare_exchange_strong(expected, error);
+  video_packets_.abort();
+  audio_packets_.abort();
+  decoded_frames_.abort();
+  converted_frames_.abort();
+}
+
+void Transcoder::write_packet(AVPacket* pkt) {
+  std::lock_guard<std::mutex> lock(mux_mutex_);
+  int ret = av_interleaved_write_frame(ofmt_, pkt);
+  if (ret < 0) fail(ret);
+}
+
+// 解复用 (调用线程): 视频包进入解码队列，音频包拷贝写入或进入音频队列
+void Transcoder::demux() {
+  AVPacket* pkt = av_packet_alloc();
+  if (!pkt) { fail(AVERROR(ENOMEM)); return; }
+
+  while (!failed()) {
+    if (job_cancelled()) { fail(AVERROR_EXIT); break; }
+    if (av_read_frame(ifmt_, pkt) < 0) break; // 文件末尾 (读取错误按末尾处理)
+
+    if (pkt->stream_index == video_idx_ || (pkt->stream_index == audio_idx_ && !audio_copy_)) {
+      job_add_progress(0, 0, pkt->size);
+      AVPacket* item = av_packet_alloc();
+      if (!item) { fail(AVERROR(ENOMEM)); break; }
+      av_packet_move_ref(item, pkt);
+      StageQueue<AVPacket*>& queue = item->stream_index == video_idx_ ? video_packets_ : audio_packets_;
+      if (!queue.push(item)) { av_packet_free(&item); break; }
+    }
+    else if (pkt->stream_index == audio_idx_) {
+      job_add_progress(0, 0, pkt->size);
+      AVStream* in = ifmt_->streams[audio_idx_];
+      int64_t offset = av_rescale_q(start_time_, AV_TIME_BASE_Q, in->time_base);
+      if (pkt->pts != AV_NOPTS_VALUE) pkt->pts -= offset;
+      if (pkt->dts != AV_NOPTS_VALUE) pkt->dts -= offset;
+      av_packet_rescale_ts(pkt, in->time_base, audio_out_->time_base);
+      pkt->stream_index = audio_out_->index;
+      pkt->pos = -1;
+      write_packet(pkt);
+    }
+    av_packet_unref(pkt);
+  }
+
+  av_packet_free(&pkt);
+  video_packets_.close();
+  audio_packets_.close();
+}
+
+void Transcoder::video_decode_stage() {
+  AVFrame* frame = av_frame_alloc();
+  if (!frame) { fail(AVERROR(ENOMEM)); return; }
+
+  auto receive = [&]() {
+    while (avcodec_receive_frame(dec_, frame) == 0) {
+      AVFrame* item = av_frame_alloc();
+      if (!item) { fail(AVERROR(ENOMEM)); return false; }
+      av_frame_move_ref(item, frame);
+      if (!decoded_frames_.push(item)) { av_frame_free(&item); return false; }
+    }
+    return true;
+  };
+
+  AVPacket* pkt = nullptr;
+  bool running = true;
+  while (running && video_packets_.pop(pkt)) {
+    avcodec_send_packet(dec_, pkt); // 损坏的包直接跳过
+    av_packet_free(&pkt);
+    running = receive();
+  }
+  if (running && !failed()) {
+    avcodec_send_packet(dec_, NULL);
+    receive();
+  }
+
+  av_frame_free(&frame);
+  decoded_frames_.close();
+}
+
+// 转换为编码器的尺寸与 yuv420p (swscale 上下文按输入帧参数缓存，支持中途变化)
+// 全范围 (JPEG) 的 YUV: yuvj* 像素格式，或 yuv* 标记为 JPEG 范围
+static bool is_full_range(const AVFrame* frame) {
+  if (frame->color_range == AVCOL_RANGE_JPEG) return true;
+  AVPixelFormat fmt = (AVPixelFormat)frame->format;
+  return fmt == AV_PIX_FMT_YUVJ420P || fmt == AV_PIX_FMT_YUVJ422P || fmt == AV_PIX_FMT_YUVJ444P || fmt == AV_PIX_FMT_YUVJ440P;
+}
+
+void Transcoder::convert_stage() {
+  AVFrame* frame = nullptr;
+  while (decoded_frames_.pop(frame)) {
+    // 输出统一为有限范围 (播放器兼容性最好)，全范围输入必须在缩放时转换，否则黑白电平错误
+    bool full_range = is_full_range(frame);
+    if (full_range || frame->format != AV_PIX_FMT_YUV420P || frame->width != enc_->width || frame->height != enc_->height) {
+      sws_ = sws_getCachedContext(sws_, frame->width, frame->height, (AVPixelFormat)frame->format,
+        enc_->width, enc_->height, AV_PIX_FMT_YUV420P, SWS_BICUBIC, NULL, NULL, NULL);
+      AVFrame* converted = av_frame_alloc();
+      if (!sws_ || !converted) { av_frame_free(&converted); av_frame_free(&frame); fail(AVERROR(ENOMEM)); break; }
+
+      // 矩阵系数沿用源 (未标记时按 BT.601)，只转换范围
+      const int input[4] = { frame->format, frame->width, frame->height, full_range ? 1 : 0 };
+      if (memcmp(input, sws_input_, sizeof(input)) != 0) {
+        int colorspace = frame->colorspace != AVCOL_SPC_UNSPECIFIED ? frame->colorspace : SWS_CS_DEFAULT;
+        const int* coefficients = sws_getCoefficients(colorspace);
+        sws_setColorspaceDetails(sws_, coefficients, input[3], coefficients, 0, 0, 1 << 16, 1 << 16);
+        memcpy(sws_input_, input, sizeof(input));
+      }
+
+      converted->format = AV_PIX_FMT_YUV420P;
+      converted->width = enc_->width;
+      converted->height = enc_->height;
+      if (av_frame_get_buffer(converted, 0) < 0) { av_frame_free(&converted); av_frame_free(&frame); fail(AVERROR(ENOMEM)); break; }
+      sws_scale(sws_, frame->data, frame->linesize, 0, frame->height, converted->data, converted->linesize);
+      av_frame_copy_props(converted, frame);
+      converted->color_range = AVCOL_RANGE_MPEG;
+      av_frame_free(&frame);
+      frame = converted;
+    }
+    if (!converted_frames_.push(frame)) { av_frame_free(&frame); break; }
+  }
+  converted_frames_.close();
+}
+
+bool Transcoder::drain_video_encoder() {
+  AVPacket* pkt = av_packet_alloc();
+  if (!pkt) { fail(AVERROR(ENOMEM)); return false; }
+
+  int ret;
+  while ((ret = avcodec_receive_packet(enc_, pkt)) == 0) {
+    av_packet_rescale_ts(pkt, enc_->time_base, video_out_->time_base);
+    pkt->stream_index = video_out_->index;
+
+    // 进度: 已编码的最大 pts (毫秒)
+    long long pts_ms = av_rescale_q(pkt->pts, video_out_->time_base, { 1, 1000 });
+    job_add_progress(pts_ms > progress_ms_ ? pts_ms - progress_ms_ : 0, 1, 0);
+    progress_ms_ = (std::max)(progress_ms_, pts_ms);
+
+    write_packet(pkt);
+    av_packet_unref(pkt);
+  }
+  av_packet_free(&pkt);
+
+  if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) { fail(ret); return false; }
+  return !failed();
+}
+
+void Transcoder::video_encode_stage() {
+  AVStream* in = ifmt_->streams[video_idx_];
+  int64_t offset = av_rescale_q(start_time_, AV_TIME_BASE_Q, in->time_base);
+  int64_t last_pts = AV_NOPTS_VALUE;
+
+  AVFrame* frame = nullptr;
+  bool running = true;
+  while (running && converted_frames_.pop(frame)) {
+    // 编码器要求 pts 严格递增
+    int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+    pts = pts != AV_NOPTS_VALUE ? pts - offset : (last_pts != AV_NOPTS_VALUE ? last_pts + 1 : 0);
+    if (last_pts != AV_NOPTS_VALUE && pts <= last_pts) pts = last_pts + 1;
+    last_pts = pts;
+
+    frame->pts = pts;
+    frame->pict_type = AV_PICTURE_TYPE_NONE;
+    int ret = avcodec_send_frame(enc_, frame);
+    av_frame_free(&frame);
+    if (ret < 0) { fail(ret); break; }
+    running = drain_video_encoder();
+  }
+
+  if (running && !failed()) {
+    avcodec_send_frame(enc_, NULL);
+    drain_video_encoder();
+  }
+}
+
+bool Transcoder::drain_audio_encoder() {
+  AVPacket* pkt = av_packet_alloc();
+  if (!pkt) { fail(AVERROR(ENOMEM)); return false; }
+
+  int ret;
+  while ((ret = avcodec_receive_packet(aenc_, pkt)) == 0) {
+    av_packet_rescale_ts(pkt, aenc_->time_base, audio_out_->time_base);
+    pkt->stream_index = audio_out_->index;
+    write_packet(pkt);
+    av_packet_unref(pkt);
+  }
+  av_packet_free(&pkt);
+
+  if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) { fail(ret); return false; }
+  return !failed();
+}
+
+// 从 FIFO 取出编码器帧长的采样编码 (flush 时最后不足一帧也编码)
+bool Transcoder::encode_audio_fifo(bool flush) {
+  int frame_size = aenc_->frame_size > 0 ? aenc_->frame_size : 1024;
+  while (av_audio_fifo_size(fifo_) >= frame_size || (flush && av_audio_fifo_size(fifo_) > 0)) {
+    AVFrame* frame = av_frame_alloc();
+    if (!frame) { fail(AVERROR(ENOMEM)); return false; }
+    frame->nb_samples = (std::min)(frame_size, av_audio_fifo_size(fifo_));
+    frame->format = aenc_->sample_fmt;
+    frame->sample_rate = aenc_->sample_rate;
+    av_channel_layout_copy(&frame->ch_layout, &aenc_->ch_layout);
+    if (av_frame_get_buffer(frame, 0) < 0) { av_frame_free(&frame); fail(AVERROR(ENOMEM)); return false; }
+
+    av_audio_fifo_read(fifo_, (void**)frame->data, frame->nb_samples);
+    frame->pts = next_audio_pts_;
+    next_audio_pts_ += frame->nb_samples;
+
+    int ret = avcodec_send_frame(aenc_, frame);
+    av_frame_free(&frame);
+    if (ret < 0) { fail(ret); return false; }
+    if (!drain_audio_encoder()) return false;
+  }
+  return true;
+}
+
+// 取出解码器中的音频帧，重采样后写入 FIFO
+bool Transcoder::decode_audio_frames() {
+  AVFrame* frame = av_frame_alloc();
+  if (!frame) { fail(AVERROR(ENOMEM)); return false; }
+
+  bool ok = true;
+  while (ok && avcodec_receive_frame(adec_, frame) == 0) {
+    if (!swr_) {
+      AVChannelLayout in_layout;
+      if (frame->ch_layout.order == AV_CHANNEL_ORDER_UNSPEC) av_channel_layout_default(&in_layout, frame->ch_layout.nb_channels);
+      else av_channel_layout_copy(&in_layout, &frame->ch_layout);
+      int ret = swr_alloc_set_opts2(&swr_, &aenc_->ch_layout, aenc_->sample_fmt, aenc_->sample_rate,
+        &in_layout, (AVSampleFormat)frame->format, frame->sample_rate, 0, NULL);
+      av_channel_layout_uninit(&in_layout);
+      if (ret < 0 || swr_init(swr_) < 0) { fail(AVERROR(EINVAL)); ok = false; break; }
+    }
+
+    // 第一帧决定音频起点 (相对输入起始时间)，之后按采样数连续递增
+    if (next_audio_pts_ == AV_NOPTS_VALUE) {
+      int64_t ts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+      AVRational in_tb = ifmt_->streams[audio_idx_]->time_base;
+      next_audio_pts_ = ts != AV_NOPTS_VALUE ?
+        (std::max)(av_rescale_q(ts, in_tb, aenc_->time_base) - av_rescale_q(start_time_, AV_TIME_BASE_Q, aenc_->time_base), (int64_t)0) : 0;
+    }
+
+    uint8_t** samples = nullptr;
+    int capacity = swr_get_out_samples(swr_, frame->nb_samples);
+    if (capacity > 0 && av_samples_alloc_array_and_samples(&samples, NULL, aenc_->ch_layout.nb_channels, capacity, aenc_->sample_fmt, 0) >= 0) {
+      int converted = swr_convert(swr_, samples, capacity, (const uint8_t**)frame->extended_data, frame->nb_samples);
+      if (converted > 0) av_audio_fifo_write(fifo_, (void**)samples, converted);
+      av_freep(&samples[0]);
+      av_freep(&samples);
+    }
+    av_frame_unref(frame);
+    ok = encode_audio_fifo(false);
+  }
+
+  av_frame_free(&frame);
+  return ok;
+}
+
+void Transcoder::audio_stage() {
+  AVPacket* pkt = nullptr;
+  bool running = true;
+  while (running && audio_packets_.pop(pkt)) {
+    avcodec_send_packet(adec_, pkt); // 损坏的包直接跳过
+    av_packet_free(&pkt);
+    running = decode_audio_frames();
+  }
+  if (!running || failed()) return;
+
+  avcodec_send_packet(adec_, NULL);
+  if (!decode_audio_frames()) return;
+
+  // 取出重采样器中缓存的尾部采样
+  if (swr_) {
+    uint8_t** samples = nullptr;
+    int capacity = swr_get_out_samples(swr_, 0);
+    if (capacity > 0 && av_samples_alloc_array_and_samples(&samples, NULL, aenc_->ch_layout.nb_channels, capacity, aenc_->sample_fmt, 0) >= 0) {
+      int converted = swr_convert(swr_, samples, capacity, NULL, 0);
+      if (converted > 0) av_audio_fifo_write(fifo_, (void**)samples, converted);
+      av_freep(&samples[0]);
+      av_freep(&samples);
+    }
+  }
+  if (!encode_audio_fifo(true)) return;
+
+  avcodec_send_frame(aenc_, NULL);
+  drain_audio_encoder();
+}
+
+int Transcoder::run(const char* input_path, const char* output_path) {
+  int ret;
+  if ((ret = open_input(input_path)) < 0) return ret;
+  if (resolve_plan(ifmt_, video_idx_, audio_idx_, input_path, options_) != TRANSCODE_PLAN_ENCODE) return remux(output_path);
+
+  // 与原 ffmpeg 命令行一致: 不论后缀都输出 MP4
+  avformat_alloc_output_context2(&ofmt_, NULL, "mp4", output_path);
+  if (!ofmt_) return AVERROR(ENOMEM);
+
+  reserve_threads();
+  if ((ret = open_video()) < 0) return ret;
+  if ((ret = open_audio()) < 0) return ret;
+  if ((ret = open_output(output_path)) < 0) return ret;
+
+  // 阶段线程继承调用方所属的异步任务 (取消 / 进度)
+  auto stage = [this](void (Transcoder::*fn)()) {
+    return std::thread([this, fn]() {
+      JobScope scope(job_);
+      (this->*fn)();
+    });
+  };
+
+  std::thread decode_thread = stage(&Transcoder::video_decode_stage);
+  std::thread convert_thread = stage(&Transcoder::convert_stage);
+  std::thread encode_thread = stage(&Transcoder::video_encode_stage);
+  std::thread audio_thread;
+  if (audio_idx_ >= 0 && !audio_copy_) audio_thread = stage(&Transcoder::audio_stage);
+
+  demux();
+
+  decode_thread.join();
+  convert_thread.join();
+  encode_thread.join();
+  if (audio_thread.joinable()) audio_thread.join();
+
+  if (failed()) return error_.load();
+  return av_write_trailer(ofmt_);
+}
+
+DLLEXPORT int transcode_video_plan(const char* input_path, const TranscodeOptions* options) {
+  if (!input_path) return AVERROR(EINVAL);
+
+  AVFormatContext* ifmt_ctx = nullptr;
+  int video_idx = -1;
+  int audio_idx = -1;
+  int ret;
+
+  if ((ret = avformat_open_input(&ifmt_ctx, input_path, NULL, NULL)) < 0) return ret;
+  if ((ret = avformat_find_stream_info(ifmt_ctx, NULL)) < 0) goto cleanup;
+  if ((ret = find_transcode_streams(ifmt_ctx, &video_idx, &audio_idx)) < 0) goto cleanup;
+  ret = resolve_plan(ifmt_ctx, video_idx, audio_idx, input_path, resolve_options(options));
+
+cleanup:
+  avformat_close_input(&ifmt_ctx);
+  return ret;
+}
+
+DLLEXPORT int transcode_video(const char* input_path, const char* output_path, const TranscodeOptions* options) {
+  if (!input_path || !output_path) return AVERROR(EINVAL);
+
+  av_log_set_level(AV_LOG_ERROR);
+
+  Transcoder transcoder(resolve_options(options), JobControl::current());
+  return transcoder.run(input_path, output_path);
+}
+
+// =================================================================
+// 异步转码任务
+// =================================================================
+struct TranscodeJobData {
+  std::string input_path;
+  std::string output_path;
+  TranscodeOptions options;
+};
+
+DLLEXPORT long long transcode_video_submit(const char* input_path, const char* output_path,
+  const TranscodeOptions* options) {
+  if (!input_path || !output_path) return -1;
+
+  auto data = std::make_shared<TranscodeJobData>();
+  data->input_path = input_path;
+  data->output_path = output_path;
+  transcode_options_init(&data->options);
+  if (options) data->options = *options;
+
+  TranscodeJobData* raw = data.get();
+  // 驱动线程只分发数据包并等待各阶段线程，不占用线程池的后台名额
+  return JobRegistry::instance().submit_dedicated(JOB_KIND_TRANSCODE, 0, data, [raw]() {
+    return transcode_video(raw->input_path.c_str(), raw->output_path.c_str(), &raw->options);
+    });
+}
@@ -0,0 +1,77 @@
+// video_transcode/VideoTranscoder.h
+#pragma once
+
+#include "../common.h"
+
+// =================================================================
+// 进程内转码为 H.264 / AAC MP4 (faststart)，代替外部 ffmpeg 进程
+//
+// 解复用 -> 视频解码 -> 像素格式转换 / 缩放 -> 编码 各自一个线程，之间用有界队列连接；
+// 音频已是 AAC 时直接拷贝，否则解码后重采样并编码为 AAC。
+// 编解码线程数从线程池的 CPU 预算中预留 (ThreadPool::reserve_threads)，
+// 多个转码任务并行时在开始时按正在执行的任务数平分预算。
+//
+// 视频已是 H.264 (8 bit 4:2:0)、音频是 AAC / MP3 时 (MKV / AVI / TS 封装，或 moov 在文件末尾的 MP4)，
+// 只需换封装: 直接流拷贝为 faststart MP4 (与 trim_video 共用时间戳处理)，不解码也不编码。
+// =================================================================
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef struct {
+    int crf;           // x264 CRF (0-51)，小于 0 使用默认值 23
+    char preset[16];   // x264 preset (ultrafast ... veryslow)，空字符串使用 "veryfast"
+    int max_width;     // 输出最大宽度，0 = 不限制 (等比缩小，不放大)
+    int max_height;    // 输出最大高度，0 = 不限制
+    int audio_bitrate; // AAC 码率 (bps)，小于等于 0 使用 128000
+    int threads;       // 编解码线程数，0 = 自动 (CPU 预算按正在执行的转码任务平分)
+    int force_encode;  // 非 0 时总是重新编码，不走流拷贝快速路径
+  } TranscodeOptions;
+
+  typedef enum {
+    TRANSCODE_PLAN_NONE = 0,  // 已是 faststart 的兼容 MP4，无需处理
+    TRANSCODE_PLAN_REMUX = 1, // 编码兼容，只需流拷贝换封装
+    TRANSCODE_PLAN_ENCODE = 2 // 需要重新编码
+  } TranscodePlan;
+
+  /**
+   * @brief 填充默认选项 (CRF 23, veryfast, 原尺寸)。
+   */
+  DLLEXPORT void transcode_options_init(TranscodeOptions* options);
+
+  /**
+   * @brief 根据流的编码参数 (和 MP4 的 moov 位置) 判断转码方式，只探测不读取数据包。
+   * @param options 转码选项，可为 NULL (尺寸限制、force_encode 会影响结果)。
+   * @return TranscodePlan；小于 0 表示文件无法打开或没有视频流。
+   */
+  DLLEXPORT int transcode_video_plan(const char* input_path, const TranscodeOptions* options);
+
+  /**
+   * @brief 把视频转码为 H.264 (yuv420p) + AAC 的 MP4 (同步，阻塞到完成)。
+   *        编码已兼容时 (transcode_video_plan 不是 ENCODE) 流拷贝换封装，只保留选中的视频与音频流。
+   *        在异步任务中执行时按读包粒度响应取消，进度为已编码的视频毫秒数。
+   * @param options 转码选项，可为 NULL。
+   * @return 0 表示成功，小于 0 表示 FFmpeg 错误码 (取消时为 AVERROR_EXIT，输出文件不完整)。
+   */
+  DLLEXPORT int transcode_video(const char* input_path, const char* output_path, const TranscodeOptions* options);
+
+  /**
+   * @brief [异步] 提交转码任务，立即返回任务编号。任务在独立线程上执行，不占用线程池的后台名额。
+   *        通过 job_poll / job_cancel / job_wait / job_release (core/Job.h) 管理，
+   *        进度单位为毫秒，total 在打开输入后填入视频时长。
+   * @return 任务编号；小于 0 表示参数错误。
+   */
+  DLLEXPORT long long transcode_video_submit(const char* input_path, const char* output_path,
+    const TranscodeOptions* options);
+
+#ifdef __cplusplus
+}
+
+// 浏览器能直接解码、可以流拷贝的视频: H.264 8 bit 4:2:0 (High 10 / 4:2:2 / 4:4:4 不行)，
+// 且不超过 options 的尺寸限制 (options 可为 NULL)
+bool video_copy_compatible(const AVCodecParameters* par, const TranscodeOptions* options);
+
+// 可以流拷贝进 MP4 并由浏览器解码的音频: AAC / MP3
+bool audio_copy_compatible(const AVCodecParameters* par);
+#endif
@@ -1,66 +1,639 @@
 #include "VideoTrimer.h"
+#include "VideoTrimerInternal.h"
+#include "../core/Job.h"
+#include "../core/ThreadPool.h"
 #include <vector>
 #include <algorithm>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <string>
 
-// 内部状态维护
-struct StreamState {
-  long long first_pts = -1;
-  long long first_dts = -1;
-  long long next_offset_tb = 0;
-  long long current_clip_duration_tb = 0;
-  long long last_written_dts_out = AV_NOPTS_VALUE;
+// 智能渲染重新编码部分的默认 CRF
+static const int kDefaultSmartQuality = 18;
+
+DLLEXPORT void trim_options_init(TrimOptions* options) {
+  if (!options) return;
+  options->mode = TRIM_MODE_COPY;
+  options->quality = -1;
+}
+
+// 把输入包映射到输出时间轴 (减去片段锚点 first_dts，加上之前片段的总长) 并写入
+// 锚点之前或 dts 不单调的包被丢弃 (返回 0)，写入失败时返回错误码
+static int write_segment_packet(AVFormatContext* ofmt_ctx, AVStream* in_stream, int out_idx, StreamState& state,
+  AVPacket* pkt) {
+  long long dts_offset = pkt->dts - state.first_dts;
+  long long pts_offset = pkt->pts - state.first_dts;
+
+  if (dts_offset < 0) return 0;
+
+  pkt->pts = pts_offset + state.next_offset_tb;
+  pkt->dts = dts_offset + state.next_offset_tb;
+
+  long long pkt_duration = pkt->duration;
+  if (pkt_duration <= 0) {
+    if (in_stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+      pkt_duration = in_stream->avg_frame_rate.num > 0 ?
+      av_rescale_q(1, av_inv_q(in_stream->avg_frame_rate), in_stream->time_base) :
+      av_rescale_q(1, { 1, 30 }, in_stream->time_base);
+    else
+      pkt_duration = av_rescale_q(1024, { 1, in_stream->codecpar->sample_rate ? in_stream->codecpar->sample_rate : 44100 }, in_stream->time_base);
+  }
+
+  long long previous_duration_tb = state.current_clip_duration_tb;
+  state.current_clip_duration_tb = (std::max)(state.current_clip_duration_tb, pts_offset + pkt_duration);
+
+  // 异步任务进度: 输出的视频时长 (毫秒)
+  if (in_stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+    long long grown_ms = av_rescale_q(state.current_clip_duration_tb - previous_duration_tb, in_stream->time_base, { 1, 1000 });
+    job_add_progress(grown_ms, 1, pkt->size);
+  }
+  else {
+    job_add_progress(0, 0, pkt->size);
+  }
+
+  av_packet_rescale_ts(pkt, in_stream->time_base, ofmt_ctx->streams[out_idx]->time_base);
+
+  if (state.last_written_dts_out != AV_NOPTS_VALUE && pkt->dts <= state.last_written_dts_out) return 0;
+  state.last_written_dts_out = pkt->dts;
+
+  pkt->stream_index = out_idx;
+  return av_interleaved_write_frame(ofmt_ctx, pkt);
+}
+
+// =================================================================
+// H.264 / HEVC 码流格式
+// MP4 / MKV 中的 H.264 / HEVC 为长度前缀格式，参数集 (SPS / PPS / VPS) 在 avcC / hvcC 中；
+// 编码器输出起始码格式 (Annex B)，参数集在每个 IDR 之前
+// =================================================================
+static void append_length_prefixed(std::vector<uint8_t>& out, const uint8_t* nal, size_t size, int length_size) {
+  for (int i = length_size - 1; i >= 0; i--) out.push_back((uint8_t)(size >> (8 * i)));
+  out.insert(out.end(), nal, nal + size);
+}
+
+// 从 avcC / hvcC 中取出参数集，转为长度前缀格式
+// 返回 NAL 长度字节数；不是长度前缀格式时返回 0
+static int parse_length_prefixed_config(const AVCodecParameters* par, std::vector<uint8_t>& parameter_sets) {
+  const uint8_t* d = par->extradata;
+  int n = par->extradata_size;
+  if (!d || n < 7 || d[0] != 1) return 0;
+
+  auto read_nals = [&](int& pos, int count, int length_size) {
+    for (int i = 0; i < count && pos + 2 <= n; i++) {
+      int size = (d[pos] << 8) | d[pos + 1];
+      pos += 2;
+      if (pos + size > n) return false;
+      append_length_prefixed(parameter_sets, d + pos, size, length_size);
+      pos += size;
+    }
+    return true;
+  };
+
+  if (par->codec_id == AV_CODEC_ID_H264) {
+    int length_size = (d[4] & 3) + 1;
+    int pos = 6;
+    if (!read_nals(pos, d[5] & 0x1f, length_size) || pos >= n) return length_size; // SPS
+    int pps_count = d[pos++];
+    read_nals(pos, pps_count, length_size);                                          // PPS
+    return length_size;
+  }
+  if (par->codec_id == AV_CODEC_ID_HEVC && n >= 23) {
+    int length_size = (d[21] & 3) + 1;
+    int pos = 23;
+    for (int a = 0; a < d[22] && pos + 3 <= n; a++) { // VPS / SPS / PPS / SEI 数组
+      int count = (d[pos + 1] << 8) | d[pos + 2];
+      pos += 3;
+      if (!read_nals(pos, count, length_size)) break;
+    }
+    return length_size;
+  }
+  return 0;
+}
+
+// 替换包数据，保留时间戳、标志等属性
+static int replace_packet_data(AVPacket* pkt, const std::vector<uint8_t>& data) {
+  AVBufferRef* buf = av_buffer_alloc(data.size() + AV_INPUT_BUFFER_PADDING_SIZE);
+  if (!buf) return AVERROR(ENOMEM);
+  memcpy(buf->data, data.data(), data.size());
+  memset(buf->data + data.size(), 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+  av_buffer_unref(&pkt->buf);
+  pkt->buf = buf;
+  pkt->data = buf->data;
+  pkt->size = (int)data.size();
+  return 0;
+}
+
+// 起始码格式 -> 长度前缀格式 (不是起始码格式时不做处理)
+static int annexb_to_length_prefixed(AVPacket* pkt, int length_size) {
+  const uint8_t* begin = pkt->data;
+  const uint8_t* end = pkt->data + pkt->size;
+  auto next_start_code = [end](const uint8_t* p) {
+    for (; p + 3 <= end; p++) {
+      if (p[0] == 0 && p[1] == 0 && p[2] == 1) return p;
+    }
+    return end;
+  };
+
+  const uint8_t* nal = next_start_code(begin);
+  if (nal == end || nal - begin > 1) return 0;
+
+  std::vector<uint8_t> out;
+  out.reserve(pkt->size + 16);
+  while (nal < end) {
+    nal += 3;
+    const uint8_t* next = next_start_code(nal);
+    const uint8_t* nal_end = next;
+    while (nal_end > nal && nal_end[-1] == 0) nal_end--; // 下一个 4 字节起始码的前导 0
+    if (nal_end > nal) append_length_prefixed(out, nal, nal_end - nal, length_size);
+    nal = next;
+  }
+  return replace_packet_data(pkt, out);
+}
+
+// 在关键帧前插入参数集
+static int prepend_parameter_sets(AVPacket* pkt, const std::vector<uint8_t>& parameter_sets) {
+  std::vector<uint8_t> out(parameter_sets);
+  out.insert(out.end(), pkt->data, pkt->data + pkt->size);
+  return replace_packet_data(pkt, out);
+}
+
+// =================================================================
+// 智能渲染: 按 GOP 处理视频
+//   - 完整落在 [start, end] 内、参考帧都会被输出的 GOP 原样拷贝
+//   - 其余 GOP (切点所在) 解码后只把片段内的帧重新编码，编码器每段重新编码结束后冲刷并释放
+// 音频包按时间戳筛选后直接拷贝
+// =================================================================
+class SmartCutter {
+public:
+  SmartCutter(AVFormatContext* ifmt_ctx, AVFormatContext* ofmt_ctx, int video_idx,
+    const std::vector<int>& stream_mapping, std::vector<StreamState>& states, int quality)
+    : ifmt_ctx_(ifmt_ctx), ofmt_ctx_(ofmt_ctx), in_stream_(ifmt_ctx->streams[video_idx]), video_idx_(video_idx),
+    out_idx_(stream_mapping[video_idx]), mapping_(stream_mapping), states_(states), quality_(quality) {
+    nal_length_size_ = parse_length_prefixed_config(in_stream_->codecpar, parameter_sets_);
+    frame_ = av_frame_alloc();
+    enc_pkt_ = av_packet_alloc();
+  }
+
+  ~SmartCutter() {
+    gop_.clear();
+    prev_gop_.clear();
+    if (dec_) avcodec_free_context(&dec_);
+    if (enc_) avcodec_free_context(&enc_);
+    if (frame_) av_frame_free(&frame_);
+    if (enc_pkt_) av_packet_free(&enc_pkt_);
+  }
+
+  SmartCutter(const SmartCutter&) = delete;
+  SmartCutter& operator=(const SmartCutter&) = delete;
+
+  // 处理一个片段 (调用前各流的 first_dts 已重置)，返回 0 或错误码
+  int run_segment(long long start_ms, long long end_ms, AVPacket* pkt, SegmentInfo* info);
+
+private:
+  struct Gop {
+    std::vector<AVPacket*> packets;
+    int64_t min_pts = INT64_MAX;
+    int64_t max_pts = INT64_MIN;
+    bool leading = false; // 含有显示在关键帧之前的帧 (开放 GOP，参考上一个 GOP)
+
+    bool add(const AVPacket* pkt) {
+      AVPacket* ref = av_packet_clone(pkt);
+      if (!ref) return false;
+      if (!packets.empty() && pkt->pts < packets.front()->pts) leading = true;
+      min_pts = (std::min)(min_pts, (int64_t)pkt->pts);
+      max_pts = (std::max)(max_pts, (int64_t)pkt->pts);
+      packets.push_back(ref);
+      return true;
+    }
+
+    void clear() {
+      for (AVPacket*& p : packets) av_packet_free(&p);
+      packets.clear();
+      min_pts = INT64_MAX;
+      max_pts = INT64_MIN;
+      leading = false;
+    }
+  };
+
+  void set_anchor(const AVPacket* keyframe);
+  int flush_gop();
+  int copy_gop(bool fallback);
+  int reencode_gop();
+  int finish_reencode();
+  bool open_decoder();
+  bool open_encoder();
+  int decode(const AVPacket* packet, bool emit);
+  int encode(AVFrame* frame);
+  int write_video(AVPacket* pkt);
+
+  AVFormatContext* ifmt_ctx_;
+  AVFormatContext* ofmt_ctx_;
+  AVStream* in_stream_;
+  int video_idx_;
+  int out_idx_;
+  const std::vector<int>& mapping_;
+  std::vector<StreamState>& states_;
+  int quality_;
+
+  AVCodecContext* dec_ = nullptr;
+  AVCodecContext* enc_ = nullptr;
+  AVFrame* frame_ = nullptr;
+  AVPacket* enc_pkt_ = nullptr;
+  bool decoder_failed_ = false;
+  bool encoder_failed_ = false;
+  bool decoder_active_ = false; // 解码器连续接收到了当前 GOP 之前的数据，不需要重置
+
+  int nal_length_size_ = 0;             // 长度前缀格式时的 NAL 长度字节数，0 表示不需要转换
+  std::vector<uint8_t> parameter_sets_; // 原视频的参数集 (长度前缀格式)
+  bool need_parameter_sets_ = false;    // 重新编码后，下一个拷贝的关键帧前需要恢复原参数集
+
+  // 当前片段 (视频流 time_base)
+  int64_t start_ = 0;
+  int64_t end_ = 0;
+  int64_t delay_ = 0; // 关键帧 pts - dts (解码延迟)，重新编码的包沿用它保持 dts 连续
+  int64_t first_output_pts_ = AV_NOPTS_VALUE;
+  int64_t last_output_pts_ = AV_NOPTS_VALUE;
+  bool past_end_ = false;
+  Gop gop_;
+  Gop prev_gop_;
+  bool prev_copied_ = false;
 };
 
-/**
- * 高速裁剪合并视频 (针对 HTML5 兼容容器优化版)
- */
-DLLEXPORT int trim_video(const char* input_path, const char* output_path,
-  const long long* starts_ms, const long long* ends_ms,
-  int count, SegmentInfo* out_info) {
+int SmartCutter::run_segment(long long start_ms, long long end_ms, AVPacket* pkt, SegmentInfo* info) {
+  AVRational tb = in_stream_->time_base;
+  start_ = av_rescale_q(start_ms, { 1, 1000 }, tb);
+  end_ = av_rescale_q(end_ms, { 1, 1000 }, tb);
+  first_output_pts_ = AV_NOPTS_VALUE;
+  last_output_pts_ = AV_NOPTS_VALUE;
+  past_end_ = false;
+  prev_copied_ = false;
+  gop_.clear();
+  prev_gop_.clear();
+  if (dec_) avcodec_flush_buffers(dec_);
+  decoder_active_ = false;
 
-  // --- 1. 将所有变量声明移至顶部，解决 C2362 错误 ---
-  AVFormatContext* ifmt_ctx = nullptr;
-  AVFormatContext* ofmt_ctx = nullptr;
-  AVPacket* pkt = nullptr;
-  AVDictionary* muxer_opts = nullptr;
+  av_seek_frame(ifmt_ctx_, video_idx_, start_, AVSEEK_FLAG_BACKWARD);
+
+  bool started = false;
   int ret = 0;
-  int video_idx = -1;
-  int out_stream_counter = 0;
+  while (ret >= 0 && !job_cancelled() && av_read_frame(ifmt_ctx_, pkt) >= 0) {
+    int out_idx = mapping_[pkt->stream_index];
+    if (pkt->pts == AV_NOPTS_VALUE) pkt->pts = pkt->dts; // AVI 等容器只有 dts
+    if (out_idx < 0 || pkt->pts == AV_NOPTS_VALUE) { av_packet_unref(pkt); continue; }
 
-  // C++ 容器必须在第一个 goto 之前定义
-  std::vector<int> stream_mapping;
-  std::vector<StreamState> states;
+    if (pkt->stream_index == video_idx_) {
+      bool key = (pkt->flags & AV_PKT_FLAG_KEY) != 0;
+      if (!started) {
+        if (!key) { av_packet_unref(pkt); continue; }
+        started = true;
+        set_anchor(pkt);
+      }
 
-  // 抑制冗余日志
-  av_log_set_level(AV_LOG_ERROR);
+      // 下一个关键帧到达: 上一个 GOP 完整了
+      if (key && !gop_.packets.empty()) {
+        ret = flush_gop();
+        if (pkt->pts > end_) { av_packet_unref(pkt); break; }
+      }
+      if (ret >= 0 && !gop_.add(pkt)) ret = AVERROR(ENOMEM);
+    }
+    else if (started) {
+      AVStream* stream = ifmt_ctx_->streams[pkt->stream_index];
+      long long pts_ms = av_rescale_q(pkt->pts, stream->time_base, { 1, 1000 });
+      if (pts_ms >= start_ms && pts_ms <= end_ms) {
+        ret = write_segment_packet(ofmt_ctx_, stream, out_idx, states_[out_idx], pkt);
+      }
+    }
+    av_packet_unref(pkt);
+  }
 
-  pkt = av_packet_alloc();
-  if (!pkt) return -1;
+  if (ret >= 0 && job_cancelled()) ret = AVERROR_EXIT;
+  if (ret >= 0 && !gop_.packets.empty()) ret = flush_gop();
+  if (ret >= 0) ret = finish_reencode();
+  gop_.clear();
+  prev_gop_.clear();
 
-  // 1. 打开输入
-  if ((ret = avformat_open_input(&ifmt_ctx, input_path, NULL, NULL)) < 0) goto cleanup;
-  if ((ret = avformat_find_stream_info(ifmt_ctx, NULL) < 0)) goto cleanup;
+  if (first_output_pts_ != AV_NOPTS_VALUE) info->actual_start_ms = av_rescale_q(first_output_pts_, tb, { 1, 1000 });
+  info->actual_duration_ms = av_rescale_q(states_[out_idx_].current_clip_duration_tb, tb, { 1, 1000 });
+  return ret;
+}
 
-  // 2. 初始化输出
-  avformat_alloc_output_context2(&ofmt_ctx, NULL, NULL, output_path);
-  if (!ofmt_ctx) { ret = -1; goto cleanup; }
+// 锚点取请求起点减去解码延迟: 第一帧的 dts 不小于 0，各流以同一时刻对齐
+void SmartCutter::set_anchor(const AVPacket* keyframe) {
+  delay_ = keyframe->dts != AV_NOPTS_VALUE ? (std::max)(keyframe->pts - keyframe->dts, (int64_t)0) : 0;
+  int64_t anchor = (std::min)(start_, (int64_t)keyframe->pts) - delay_;
 
-  // 开启自动比特流过滤
-  ofmt_ctx->flags |= AVFMT_FLAG_AUTO_BSF;
+  for (unsigned int j = 0; j < ifmt_ctx_->nb_streams; j++) {
+    int o_idx = mapping_[j];
+    if (o_idx < 0) continue;
+    states_[o_idx].first_dts = av_rescale_q(anchor, in_stream_->time_base, ifmt_ctx_->streams[j]->time_base);
+  }
+}
+
+int SmartCutter::flush_gop() {
+  bool inside = gop_.min_pts >= start_ && gop_.max_pts <= end_;
+  bool refs_kept = !gop_.leading || prev_copied_;
+
+  int ret;
+  if (inside && refs_kept) ret = copy_gop(false);
+  else if (!open_decoder() || !open_encoder()) ret = copy_gop(true); // 无法重新编码: 退回流拷贝的行为
+  else ret = reencode_gop();
+
+  std::swap(prev_gop_, gop_);
+  gop_.clear();
+  return ret;
+}
+
+int SmartCutter::copy_gop(bool fallback) {
+  int ret = finish_reencode(); // 先写完之前重新编码的帧
+  if (ret < 0) return ret;
+
+  // 流拷贝模式从起点之后的第一个关键帧开始，终点之后的包丢弃
+  if (fallback && gop_.packets.front()->pts < start_) {
+    prev_copied_ = false;
+    return 0;
+  }
+
+  for (const AVPacket* p : gop_.packets) {
+    if (fallback && p->pts > end_) continue;
+    AVPacket* out = av_packet_clone(p); // 原包保留，下一个 GOP 重新编码时可能需要它作为参考
+    if (!out) return AVERROR(ENOMEM);
+
+    if (need_parameter_sets_ && (out->flags & AV_PKT_FLAG_KEY)) {
+      ret = prepend_parameter_sets(out, parameter_sets_);
+      need_parameter_sets_ = false;
+    }
+    if (ret >= 0) ret = write_video(out);
+    av_packet_free(&out);
+    if (ret < 0) return ret;
+  }
+
+  last_output_pts_ = last_output_pts_ == AV_NOPTS_VALUE ? gop_.max_pts : (std::max)(last_output_pts_, gop_.max_pts);
+  prev_copied_ = true;
+  return 0;
+}
+
+int SmartCutter::reencode_gop() {
+  if (!decoder_active_) {
+    avcodec_flush_buffers(dec_);
+    // 开放 GOP 的前导帧参考上一个 GOP: 先把上一个 GOP 送入解码器 (只解码不输出)
+    if (gop_.leading) {
+      for (const AVPacket* p : prev_gop_.packets) {
+        int ret = decode(p, false);
+        if (ret < 0) return ret;
+      }
+    }
+    decoder_active_ = true;
+  }
+
+  for (const AVPacket* p : gop_.packets) {
+    if (past_end_) break; // 终点之前的帧都已输出，剩下的包不需要解码
+    int ret = decode(p, true);
+    if (ret < 0) return ret;
+  }
+  prev_copied_ = false;
+  return 0;
+}
+
+// 冲刷解码器和编码器 (切换回拷贝或片段结束时)
+int SmartCutter::finish_reencode() {
+  int ret = 0;
+  if (decoder_active_) {
+    ret = decode(nullptr, true);
+    avcodec_flush_buffers(dec_);
+    decoder_active_ = false;
+  }
+  if (enc_) {
+    if (ret >= 0) ret = encode(nullptr);
+    avcodec_free_context(&enc_); // 冲刷后的编码器不能继续使用，下次重新编码时重新打开
+  }
+  return ret;
+}
+
+bool SmartCutter::open_decoder() {
+  if (dec_) return true;
+  if (decoder_failed_ || !frame_ || !enc_pkt_) return false;
+
+  const AVCodec* codec = avcodec_find_decoder(in_stream_->codecpar->codec_id);
+  dec_ = codec ? avcodec_alloc_context3(codec) : nullptr;
+  if (dec_ && avcodec_parameters_to_context(dec_, in_stream_->codecpar) >= 0) {
+    dec_->pkt_timebase = in_stream_->time_base;
+    dec_->thread_count = ThreadPool::instance().decoder_threads();
+    if (avcodec_open2(dec_, codec, NULL) >= 0) return true;
+  }
+
+  if (dec_) avcodec_free_context(&dec_);
+  decoder_failed_ = true;
+  return false;
+}
+
+// 编码参数与原视频一致，使接上拷贝部分后播放器不需要重新初始化
+bool SmartCutter::open_encoder() {
+  if (enc_) return true;
+  if (encoder_failed_) return false;
+
+  const AVCodecParameters* par = in_stream_->codecpar;
+  const AVCodec* codec = avcodec_find_encoder(par->codec_id);
+  enc_ = codec ? avcodec_alloc_context3(codec) : nullptr;
+  if (!enc_) {
+    encoder_failed_ = true;
+    return false;
+  }
+
+  enc_->width = par->width;
+  enc_->height = par->height;
+  enc_->pix_fmt = dec_->pix_fmt;
+  enc_->sample_aspect_ratio = par->sample_aspect_ratio;
+  enc_->time_base = in_stream_->time_base;
+  if (in_stream_->avg_frame_rate.num > 0) enc_->framerate = in_stream_->avg_frame_rate;
+  enc_->color_range = par->color_range;
+  enc_->color_primaries = par->color_primaries;
+  enc_->color_trc = par->color_trc;
+  enc_->colorspace = par->color_space;
+  enc_->chroma_sample_location = par->chroma_location;
+  enc_->profile = par->profile;
+  enc_->level = par->level;
+  enc_->max_b_frames = 0; // 输出顺序即显示顺序，dts 可直接由 pts 推出
+  enc_->thread_count = ThreadPool::instance().decoder_threads();
+
+  // x264 / x265 使用 CRF，其它编码器使用原码率
+  char crf[16];
+  snprintf(crf, sizeof(crf), "%d", quality_);
+  if (av_opt_set(enc_->priv_data, "crf", crf, 0) < 0) {
+    enc_->bit_rate = par->bit_rate > 0 ? par->bit_rate : ifmt_ctx_->bit_rate;
+  }
+  av_opt_set(enc_->priv_data, "preset", "veryfast", 0);
+
+  if (avcodec_open2(enc_, codec, NULL) < 0) {
+    avcodec_free_context(&enc_);
+    encoder_failed_ = true;
+    return false;
+  }
+  return true;
+}
+
+// 送入一个包 (NULL 表示冲刷) 并取出所有帧；emit 时把片段内、尚未输出的帧送去编码
+int SmartCutter::decode(const AVPacket* packet, bool emit) {
+  int ret = avcodec_send_packet(dec_, packet);
+  if (ret < 0 && ret != AVERROR_EOF) return 0; // 损坏的包跳过
+
+  while ((ret = avcodec_receive_frame(dec_, frame_)) >= 0) {
+    int64_t pts = frame_->best_effort_timestamp;
+    if (pts != AV_NOPTS_VALUE && pts > end_) past_end_ = true;
+
+    bool wanted = emit && pts != AV_NOPTS_VALUE && pts >= start_ && pts <= end_ &&
+      (last_output_pts_ == AV_NOPTS_VALUE || pts > last_output_pts_);
+    int err = 0;
+    if (wanted) {
+      frame_->pts = pts;
+      err = encode(frame_);
+      last_output_pts_ = pts;
+    }
+    av_frame_unref(frame_);
+    if (err < 0) return err;
+  }
+  return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+// 送入一帧 (NULL 表示冲刷) 并写出所有编码后的包
+int SmartCutter::encode(AVFrame* frame) {
+  if (frame) {
+    if (frame->format != enc_->pix_fmt || frame->width != enc_->width || frame->height != enc_->height) return 0;
+    frame->pict_type = AV_PICTURE_TYPE_NONE;
+  }
+
+  int ret = avcodec_send_frame(enc_, frame);
+  if (ret < 0) return ret;
+
+  while ((ret = avcodec_receive_packet(enc_, enc_pkt_)) >= 0) {
+    enc_pkt_->dts = enc_pkt_->pts - delay_;
+    if (nal_length_size_ > 0) ret = annexb_to_length_prefixed(enc_pkt_, nal_length_size_);
+    if (ret >= 0) ret = write_video(enc_pkt_);
+    av_packet_unref(enc_pkt_);
+    if (ret < 0) return ret;
+    need_parameter_sets_ = nal_length_size_ > 0;
+  }
+  return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+int SmartCutter::write_video(AVPacket* pkt) {
+  if (first_output_pts_ == AV_NOPTS_VALUE || pkt->pts < first_output_pts_) first_output_pts_ = pkt->pts;
+  return write_segment_packet(ofmt_ctx_, in_stream_, out_idx_, states_[out_idx_], pkt);
+}
+
+// =================================================================
+// 流拷贝模式的一个片段: 从第一个读到的视频关键帧开始，视频 pts 超过终点时结束
+// trim_video 按片段顺序逐个使用，trim_video_multi 在一次读取中同时驱动多个
+// =================================================================
+CopySegmentWriter::CopySegmentWriter(AVFormatContext* ifmt_ctx, AVFormatContext* ofmt_ctx, int video_idx,
+  const std::vector<int>& stream_mapping, std::vector<StreamState>& states, long long end_ms, SegmentInfo* info)
+  : ifmt_ctx_(ifmt_ctx), ofmt_ctx_(ofmt_ctx), video_idx_(video_idx), mapping_(stream_mapping), states_(states),
+  end_ms_(end_ms), info_(info) {
+  info_->actual_start_ms = 0;
+  info_->actual_duration_ms = 0;
+}
+
+bool CopySegmentWriter::write(AVPacket* pkt) {
+  if (error_ < 0) return false;
+  int out_idx = mapping_[pkt->stream_index];
+  if (out_idx < 0) return true;
+
+  AVStream* in_stream = ifmt_ctx_->streams[pkt->stream_index];
+  StreamState& state = states_[out_idx];
+  bool is_video = pkt->stream_index == video_idx_;
+  if (pkt->pts == AV_NOPTS_VALUE) pkt->pts = pkt->dts; // AVI 等容器只有 dts
+
+  long long pts_ms = av_rescale_q(pkt->pts, in_stream->time_base, { 1, 1000 });
+  if (is_video && pts_ms > end_ms_) return false;
 
+  if (!started_) {
+    if (!is_video || !(pkt->flags & AV_PKT_FLAG_KEY)) return true;
+    started_ = true;
+    anchor_dts_ = pkt->dts;
+    info_->actual_start_ms = pts_ms;
+  }
+
+  if (state.first_dts == -1) {
+    state.first_dts = av_rescale_q(anchor_dts_, ifmt_ctx_->streams[video_idx_]->time_base, in_stream->time_base);
+  }
+
+  int ret = write_segment_packet(ofmt_ctx_, in_stream, out_idx, state, pkt);
+  if (ret < 0) {
+    error_ = ret;
+    return false;
+  }
+  if (is_video) {
+    info_->actual_duration_ms = av_rescale_q(state.current_clip_duration_tb, in_stream->time_base, { 1, 1000 });
+  }
+  return true;
+}
+
+// 流拷贝模式处理一个片段: seek 到起点处或之前的关键帧后顺序读取，返回 0 或写入的错误码
+static int copy_segment(AVFormatContext* ifmt_ctx, AVFormatContext* ofmt_ctx, int video_idx,
+  const std::vector<int>& stream_mapping, std::vector<StreamState>& states,
+  long long target_start_ms, long long target_end_ms, AVPacket* pkt, SegmentInfo* info) {
+  int64_t seek_target = av_rescale_q(target_start_ms, { 1, 1000 }, ifmt_ctx->streams[video_idx]->time_base);
+  av_seek_frame(ifmt_ctx, video_idx, seek_target, AVSEEK_FLAG_BACKWARD);
+
+  CopySegmentWriter writer(ifmt_ctx, ofmt_ctx, video_idx, stream_mapping, states, target_end_ms, info);
+  while (!job_cancelled() && av_read_frame(ifmt_ctx, pkt) >= 0) {
+    bool more = writer.write(pkt);
+    av_packet_unref(pkt);
+    if (!more) break;
+  }
+  return writer.error();
+}
+
+// 片段开始前重置各流的锚点
+static void reset_segment_states(std::vector<StreamState>& states) {
+  for (auto& s : states) { s.first_pts = -1; s.first_dts = -1; s.current_clip_duration_tb = 0; }
+}
+
+// 片段结束后按视频长度推进各流的输出时间轴
+static void advance_segment_offsets(AVFormatContext* ifmt_ctx, int video_idx, const std::vector<int>& stream_mapping,
+  std::vector<StreamState>& states) {
+  long long master_duration_tb = states[stream_mapping[video_idx]].current_clip_duration_tb;
+  AVRational master_tb = ifmt_ctx->streams[video_idx]->time_base;
+
+  for (int j = 0; j < (int)ifmt_ctx->nb_streams; j++) {
+    int o_idx = stream_mapping[j];
+    if (o_idx == -1) continue;
+    states[o_idx].next_offset_tb += av_rescale_q(master_duration_tb, master_tb, ifmt_ctx->streams[j]->time_base);
+  }
+}
+
+int map_copy_streams(AVFormatContext* ifmt_ctx, const std::function<bool(int)>& keep, std::vector<int>& stream_mapping) {
+  int out_stream_counter = 0;
   stream_mapping.assign(ifmt_ctx->nb_streams, -1);
+  for (unsigned int i = 0; i < ifmt_ctx->nb_streams; i++) {
+    if (keep((int)i)) stream_mapping[i] = out_stream_counter++;
+  }
+  return out_stream_counter;
+}
+
+// 输入流到输出流的映射 (只保留音视频)，返回第一个视频流下标，没有视频流时返回 -1
+static int build_stream_mapping(AVFormatContext* ifmt_ctx, std::vector<int>& stream_mapping) {
+  map_copy_streams(ifmt_ctx, [ifmt_ctx](int i) {
+    AVMediaType type = ifmt_ctx->streams[i]->codecpar->codec_type;
+    return type == AVMEDIA_TYPE_VIDEO || type == AVMEDIA_TYPE_AUDIO;
+    }, stream_mapping);
 
-  // 3. 准备流映射与元数据拷贝
   for (unsigned int i = 0; i < ifmt_ctx->nb_streams; i++) {
-    AVStream* in_stream = ifmt_ctx->streams[i];
-    if (in_stream->codecpar->codec_type != AVMEDIA_TYPE_VIDEO &&
-      in_stream->codecpar->codec_type != AVMEDIA_TYPE_AUDIO) continue;
+    if (ifmt_ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) return i;
+  }
+  return -1;
+}
 
-    if (in_stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && video_idx == -1)
-      video_idx = i;
+int create_copy_streams(AVFormatContext* ifmt_ctx, AVFormatContext* ofmt_ctx, const std::vector<int>& stream_mapping) {
+  // 开启自动比特流过滤
+  ofmt_ctx->flags |= AVFMT_FLAG_AUTO_BSF;
 
-    stream_mapping[i] = out_stream_counter++;
+  for (unsigned int i = 0; i < ifmt_ctx->nb_streams; i++) {
+    if (stream_mapping[i] < 0) continue;
+    AVStream* in_stream = ifmt_ctx->streams[i];
     AVStream* out_stream = avformat_new_stream(ofmt_ctx, NULL);
+    if (!out_stream) return AVERROR(ENOMEM);
+    if (out_stream->index != stream_mapping[i]) return AVERROR(EINVAL); // 映射不是按输入顺序编号的
 
     avcodec_parameters_copy(out_stream->codecpar, in_stream->codecpar);
 
@@ -81,118 +654,487 @@ DLLEXPORT int trim_video(const char* input_path, const char* output_path,
 #pragma warning(pop)
 
     av_dict_copy(&out_stream->metadata, in_stream->metadata, 0);
-    states.push_back(StreamState());
   }
 
   av_dict_copy(&ofmt_ctx->metadata, ifmt_ctx->metadata, 0);
+  return 0;
+}
 
-  if (video_idx == -1) { ret = -1; goto cleanup; }
+// 按映射创建输出文件 (流参数、side data、元数据从输入拷贝) 并写入文件头
+// format_name 为 NULL 时按输出文件后缀确定格式
+static int open_trim_output(AVFormatContext* ifmt_ctx, const char* output_path, const char* format_name,
+  const std::vector<int>& stream_mapping, AVFormatContext** out_ctx) {
+  AVFormatContext* ofmt_ctx = nullptr;
+  AVDictionary* muxer_opts = nullptr;
+  int ret = 0;
+
+  avformat_alloc_output_context2(&ofmt_ctx, NULL, format_name, output_path);
+  if (!ofmt_ctx) return -1;
+
+  if ((ret = create_copy_streams(ifmt_ctx, ofmt_ctx, stream_mapping)) < 0) goto fail;
 
   if (!(ofmt_ctx->oformat->flags & AVFMT_NOFILE)) {
-    if ((ret = avio_open(&ofmt_ctx->pb, output_path, AVIO_FLAG_WRITE)) < 0) goto cleanup;
+    if ((ret = avio_open(&ofmt_ctx->pb, output_path, AVIO_FLAG_WRITE)) < 0) goto fail;
   }
 
   av_dict_set(&muxer_opts, "movflags", "faststart", 0);
-  if ((ret = avformat_write_header(ofmt_ctx, &muxer_opts)) < 0) goto cleanup;
+  ret = avformat_write_header(ofmt_ctx, &muxer_opts);
+  av_dict_free(&muxer_opts);
+  if (ret < 0) goto fail;
+
+  *out_ctx = ofmt_ctx;
+  return 0;
+
+fail:
+  if (ofmt_ctx->pb) avio_closep(&ofmt_ctx->pb);
+  avformat_free_context(ofmt_ctx);
+  return ret;
+}
+
+static void close_trim_output(AVFormatContext** ofmt_ctx) {
+  if (!*ofmt_ctx) return;
+  if ((*ofmt_ctx)->pb) avio_closep(&(*ofmt_ctx)->pb);
+  avformat_free_context(*ofmt_ctx);
+  *ofmt_ctx = nullptr;
+}
+
+int remux_streams(AVFormatContext* ifmt_ctx, const char* output_path, const std::vector<int>& stream_mapping,
+  int video_idx, SegmentInfo* info) {
+  AVFormatContext* ofmt_ctx = nullptr;
+  std::vector<StreamState> states;
+  int ret = 0;
+
+  for (int idx : stream_mapping) {
+    if (idx >= 0) states.push_back(StreamState());
+  }
+
+  AVPacket* pkt = av_packet_alloc();
+  if (!pkt) return AVERROR(ENOMEM);
+
+  if ((ret = open_trim_output(ifmt_ctx, output_path, "mp4", stream_mapping, &ofmt_ctx)) < 0) goto cleanup;
+
+  // 与单个片段 [开头, 结尾] 的流拷贝裁剪相同，只是不 seek，从当前读取位置顺序读到文件末尾
+  {
+    CopySegmentWriter writer(ifmt_ctx, ofmt_ctx, video_idx, stream_mapping, states, LLONG_MAX, info);
+    while (!job_cancelled() && av_read_frame(ifmt_ctx, pkt) >= 0) {
+      bool ok = writer.write(pkt);
+      av_packet_unref(pkt);
+      if (!ok) break;
+    }
+    if ((ret = writer.error()) < 0) goto cleanup;
+  }
+
+  // 异步任务被取消: 不写文件尾，输出文件不完整
+  if (job_cancelled()) { ret = AVERROR_EXIT; goto cleanup; }
+  ret = av_write_trailer(ofmt_ctx);
+
+cleanup:
+  av_packet_free(&pkt);
+  close_trim_output(&ofmt_ctx);
+  return ret;
+}
+
+/**
+ * 高速裁剪合并视频 (针对 HTML5 兼容容器优化版)
+ */
+DLLEXPORT int trim_video_ex(const char* input_path, const char* output_path,
+  const long long* starts_ms, const long long* ends_ms,
+  int count, const TrimOptions* options, SegmentInfo* out_info) {
+
+  // --- 1. 将所有变量声明移至顶部，解决 C2362 错误 ---
+  AVFormatContext* ifmt_ctx = nullptr;
+  AVFormatContext* ofmt_ctx = nullptr;
+  AVPacket* pkt = nullptr;
+  int ret = 0;
+  int video_idx = -1;
+
+  // C++ 容器必须在第一个 goto 之前定义
+  std::vector<int> stream_mapping;
+  std::vector<StreamState> states;
+  std::unique_ptr<SmartCutter> smart_cutter;
+
+  TrimOptions resolved;
+  trim_options_init(&resolved);
+  if (options) resolved = *options;
+  if (resolved.quality < 0 || resolved.quality > 51) resolved.quality = kDefaultSmartQuality;
+
+  // 抑制冗余日志
+  av_log_set_level(AV_LOG_ERROR);
+
+  pkt = av_packet_alloc();
+  if (!pkt) return -1;
+
+  // 1. 打开输入
+  if ((ret = avformat_open_input(&ifmt_ctx, input_path, NULL, NULL)) < 0) goto cleanup;
+  if ((ret = avformat_find_stream_info(ifmt_ctx, NULL)) < 0) goto cleanup;
+
+  // 2. 准备流映射，初始化输出
+  video_idx = build_stream_mapping(ifmt_ctx, stream_mapping);
+  if (video_idx == -1) { ret = -1; goto cleanup; }
+  for (int idx : stream_mapping) {
+    if (idx >= 0) states.push_back(StreamState());
+  }
+
+  if ((ret = open_trim_output(ifmt_ctx, output_path, NULL, stream_mapping, &ofmt_ctx)) < 0) goto cleanup;
 
-  // 4. 片段处理大循环
+  if (resolved.mode == TRIM_MODE_SMART) {
+    smart_cutter.reset(new SmartCutter(ifmt_ctx, ofmt_ctx, video_idx, stream_mapping, states, resolved.quality));
+  }
+
+  // 3. 片段处理大循环
   for (int i = 0; i < count; i++) {
     long long target_start_ms = starts_ms[i];
     long long target_end_ms = ends_ms[i];
 
-    int64_t seek_target = av_rescale_q(target_start_ms, { 1, 1000 }, ifmt_ctx->streams[video_idx]->time_base);
-    av_seek_frame(ifmt_ctx, video_idx, seek_target, AVSEEK_FLAG_BACKWARD);
+    reset_segment_states(states);
 
-    for (auto& s : states) { s.first_pts = -1; s.first_dts = -1; s.current_clip_duration_tb = 0; }
+    if (smart_cutter) {
+      if ((ret = smart_cutter->run_segment(target_start_ms, target_end_ms, pkt, &out_info[i])) < 0) goto cleanup;
+    }
+    else {
+      if ((ret = copy_segment(ifmt_ctx, ofmt_ctx, video_idx, stream_mapping, states, target_start_ms, target_end_ms,
+        pkt, &out_info[i])) < 0) goto cleanup;
+    }
 
-    bool video_started = false;
-    long long master_anchor_dts = AV_NOPTS_VALUE;
-    long long clip_v_duration_ms = 0;
+    advance_segment_offsets(ifmt_ctx, video_idx, stream_mapping, states);
 
-    while (av_read_frame(ifmt_ctx, pkt) >= 0) {
-      int out_idx = stream_mapping[pkt->stream_index];
-      if (out_idx < 0) { av_packet_unref(pkt); continue; }
+    // 异步任务被取消: 不写文件尾，输出文件不完整
+    if (job_cancelled()) { ret = AVERROR_EXIT; goto cleanup; }
+  }
 
-      AVStream* in_stream = ifmt_ctx->streams[pkt->stream_index];
-      StreamState& state = states[out_idx];
+  ret = av_write_trailer(ofmt_ctx);
 
-      long long pts_ms = av_rescale_q(pkt->pts, in_stream->time_base, { 1, 1000 });
-      if (pkt->stream_index == video_idx && pts_ms > target_end_ms) {
-        av_packet_unref(pkt);
-        break;
-      }
+cleanup:
+  smart_cutter.reset();
+  if (pkt) av_packet_free(&pkt);
+  if (ifmt_ctx) avformat_close_input(&ifmt_ctx);
+  close_trim_output(&ofmt_ctx);
+  return ret;
+}
 
-      if (!video_started) {
-        if (pkt->stream_index == video_idx && (pkt->flags & AV_PKT_FLAG_KEY)) {
-          video_started = true;
-          master_anchor_dts = pkt->dts;
-          out_info[i].actual_start_ms = pts_ms;
-        }
-      }
-      if (!video_started) { av_packet_unref(pkt); continue; }
+DLLEXPORT int trim_video(const char* input_path, const char* output_path,
+  const long long* starts_ms, const long long* ends_ms,
+  int count, SegmentInfo* out_info) {
+  return trim_video_ex(input_path, output_path, starts_ms, ends_ms, count, nullptr, out_info);
+}
+
+// =================================================================
+// 多输出流拷贝: 一次顺序读取同时写入多个输出
+//
+// 每个输出同一时刻最多处于一个片段内。单独裁剪时片段从 "起点处或之前最近的关键帧" 开始，
+// 顺序读取时要到读到下一个关键帧才知道上一个关键帧是不是这个位置，所以缓存当前 GOP 的包
+// (引用计数，不拷贝数据): 读到关键帧 P 时，起点落在 [当前 GOP 起点, P) 的片段开始，
+// 先重放缓存的 GOP，再接收之后的包。
+// 起点已经读过的片段 (同一输出内片段未按时间排序) 留到下一轮，下一轮 seek 到剩余片段的最小起点。
+// =================================================================
+
+// 没有进行中的片段、下一个片段起点距当前位置超过该值时 seek 过去，而不是顺序读过去
+static const long long kMultiTrimSeekGapMs = 10000;
+
+struct MultiTrimTarget {
+  const TrimOutput* request = nullptr;
+  AVFormatContext* ofmt_ctx = nullptr;
+  std::vector<StreamState> states;
+  std::unique_ptr<CopySegmentWriter> writer; // 进行中的片段，没有时为空
+  int next_segment = 0;                      // 下一个未完成的片段
+  int result = 0;
+
+  bool waiting() const { return ofmt_ctx && !writer && next_segment < request->count; }
+  long long next_start_ms() const { return request->starts_ms[next_segment]; }
+};
+
+class MultiTrimmer {
+public:
+  MultiTrimmer(AVFormatContext* ifmt_ctx, int video_idx, const std::vector<int>& stream_mapping,
+    std::vector<MultiTrimTarget>& targets)
+    : ifmt_ctx_(ifmt_ctx), video_idx_(video_idx), mapping_(stream_mapping), targets_(targets) {
+    route_pkt_ = av_packet_alloc();
+  }
 
-      if (state.first_dts == -1) {
-        state.first_dts = av_rescale_q(master_anchor_dts,
-          ifmt_ctx->streams[video_idx]->time_base,
-          in_stream->time_base);
+  ~MultiTrimmer() {
+    clear_gop();
+    if (route_pkt_) av_packet_free(&route_pkt_);
+  }
+
+  MultiTrimmer(const MultiTrimmer&) = delete;
+  MultiTrimmer& operator=(const MultiTrimmer&) = delete;
+
+  // 完成全部输出的全部片段，返回 0 或错误码
+  int run(AVPacket* pkt) {
+    if (!route_pkt_) return AVERROR(ENOMEM);
+    for (;;) {
+      long long seek_ms = LLONG_MAX;
+      for (auto& t : targets_) {
+        if (t.waiting()) seek_ms = (std::min)(seek_ms, t.next_start_ms());
       }
+      if (seek_ms == LLONG_MAX) return 0;
+
+      int ret = run_pass(seek_ms, pkt);
+      if (ret < 0) return ret;
+    }
+  }
+
+private:
+  // 一轮读取: seek 到 seek_ms 之前的关键帧后顺序读取，直到没有能在本轮开始的片段
+  int run_pass(long long seek_ms, AVPacket* pkt) {
+    AVStream* video = ifmt_ctx_->streams[video_idx_];
+    av_seek_frame(ifmt_ctx_, video_idx_, av_rescale_q(seek_ms, { 1, 1000 }, video->time_base), AVSEEK_FLAG_BACKWARD);
 
-      long long dts_offset = pkt->dts - state.first_dts;
-      long long pts_offset = pkt->pts - state.first_dts;
+    clear_gop();
+    has_gop_ = false;
+    gop_start_ms_ = seek_ms;
+    int completed_before = completed_;
 
-      if (dts_offset < 0) { av_packet_unref(pkt); continue; }
+    for (;;) {
+      if (job_cancelled()) return AVERROR_EXIT;
+      if (av_read_frame(ifmt_ctx_, pkt) < 0) break;
+      if (mapping_[pkt->stream_index] < 0) { av_packet_unref(pkt); continue; }
 
-      pkt->pts = pts_offset + state.next_offset_tb;
-      pkt->dts = dts_offset + state.next_offset_tb;
+      if (pkt->stream_index == video_idx_ && (pkt->flags & AV_PKT_FLAG_KEY)) {
+        long long key_ms = av_rescale_q(pkt->pts, video->time_base, { 1, 1000 });
+        if (has_gop_) start_segments(key_ms);
+        clear_gop();
+        // seek 不精确时第一个关键帧可能在 seek_ms 之后，此时从它开始 (与单独裁剪一致)
+        gop_start_ms_ = has_gop_ ? key_ms : (std::min)(seek_ms, key_ms);
+        has_gop_ = true;
+      }
+
+      if (has_gop_) {
+        AVPacket* ref = av_packet_clone(pkt);
+        if (!ref) { av_packet_unref(pkt); return AVERROR(ENOMEM); }
+        gop_.push_back(ref);
+      }
 
-      long long pkt_duration = pkt->duration;
-      if (pkt_duration <= 0) {
-        if (in_stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
-          pkt_duration = in_stream->avg_frame_rate.num > 0 ?
-          av_rescale_q(1, av_inv_q(in_stream->avg_frame_rate), in_stream->time_base) :
-          av_rescale_q(1, { 1, 30 }, in_stream->time_base);
-        else
-          pkt_duration = av_rescale_q(1024, { 1, in_stream->codecpar->sample_rate ? in_stream->codecpar->sample_rate : 44100 }, in_stream->time_base);
+      for (auto& t : targets_) {
+        if (t.writer && !route(t, pkt)) finish_segment(t);
       }
+      av_packet_unref(pkt);
+
+      if (!any_active() && !keep_reading(completed_ > completed_before)) return 0;
+    }
 
-      state.current_clip_duration_tb = (std::max)(state.current_clip_duration_tb, pts_offset + pkt_duration);
-      if (pkt->stream_index == video_idx) {
-        clip_v_duration_ms = av_rescale_q(state.current_clip_duration_tb, in_stream->time_base, { 1, 1000 });
+    // 文件结束: 最后一个 GOP 中还能开始的片段依次完成
+    if (has_gop_) {
+      for (;;) {
+        start_segments(LLONG_MAX);
+        if (!any_active()) break;
+        for (auto& t : targets_) {
+          if (t.writer) finish_segment(t);
+        }
+      }
+    }
+    // 之后没有关键帧的片段为空 (保证每轮至少完成一个片段)
+    for (auto& t : targets_) {
+      while (t.waiting() && t.next_start_ms() >= gop_start_ms_) {
+        start_segment(t);
+        finish_segment(t);
       }
+    }
+    return 0;
+  }
 
-      av_packet_rescale_ts(pkt, in_stream->time_base, ofmt_ctx->streams[out_idx]->time_base);
+  // 起点落在 [gop_start_ms_, key_ms) 的等待中片段开始，重放缓存的 GOP
+  // 重放过程中结束的片段，其输出的下一个片段也可能落在这个区间内
+  void start_segments(long long key_ms) {
+    bool started = true;
+    while (started) {
+      started = false;
+      for (auto& t : targets_) {
+        if (!t.waiting()) continue;
+        long long start_ms = t.next_start_ms();
+        if (start_ms < gop_start_ms_ || start_ms >= key_ms) continue;
 
-      if (state.last_written_dts_out != AV_NOPTS_VALUE && pkt->dts <= state.last_written_dts_out) {
-        av_packet_unref(pkt);
-        continue;
+        start_segment(t);
+        started = true;
+        for (AVPacket* buffered : gop_) {
+          if (!route(t, buffered)) { finish_segment(t); break; }
+        }
       }
-      state.last_written_dts_out = pkt->dts;
+    }
+  }
 
-      pkt->stream_index = out_idx;
-      av_interleaved_write_frame(ofmt_ctx, pkt);
-      av_packet_unref(pkt);
+  // 没有进行中的片段时决定是否继续读取本轮
+  bool keep_reading(bool made_progress) const {
+    long long next_ms = LLONG_MAX;
+    for (const auto& t : targets_) {
+      if (t.waiting() && t.next_start_ms() >= gop_start_ms_) next_ms = (std::min)(next_ms, t.next_start_ms());
+    }
+    if (next_ms == LLONG_MAX) return false; // 剩余片段都在后面的轮次
+    // 间隔太大时结束本轮，下一轮 seek 过去 (本轮已完成片段，保证不会原地重复)
+    return !(made_progress && next_ms - gop_start_ms_ > kMultiTrimSeekGapMs);
+  }
+
+  bool any_active() const {
+    for (const auto& t : targets_) {
+      if (t.writer) return true;
+    }
+    return false;
+  }
+
+  void start_segment(MultiTrimTarget& t) {
+    int i = t.next_segment;
+    reset_segment_states(t.states);
+    t.writer.reset(new CopySegmentWriter(ifmt_ctx_, t.ofmt_ctx, video_idx_, mapping_, t.states,
+      t.request->ends_ms[i], &t.request->out_info[i]));
+  }
+
+  // 写入失败的输出记录错误并放弃剩余片段，其他输出继续
+  void finish_segment(MultiTrimTarget& t) {
+    if (t.writer->error() < 0) {
+      t.result = t.writer->error();
+      t.next_segment = t.request->count - 1;
     }
+    t.writer.reset();
+    advance_segment_offsets(ifmt_ctx_, video_idx_, mapping_, t.states);
+    t.next_segment++;
+    completed_++;
+  }
 
-    long long master_duration_tb = states[stream_mapping[video_idx]].current_clip_duration_tb;
-    AVRational master_tb = ifmt_ctx->streams[video_idx]->time_base;
-    out_info[i].actual_duration_ms = clip_v_duration_ms;
+  // 把包的一个引用交给输出 (写入会消耗包)，返回 false 表示片段已结束
+  bool route(MultiTrimTarget& t, const AVPacket* pkt) {
+    if (av_packet_ref(route_pkt_, pkt) < 0) return true;
+    bool more = t.writer->write(route_pkt_);
+    av_packet_unref(route_pkt_);
+    return more;
+  }
+
+  void clear_gop() {
+    for (AVPacket*& p : gop_) av_packet_free(&p);
+    gop_.clear();
+  }
+
+  AVFormatContext* ifmt_ctx_;
+  int video_idx_;
+  const std::vector<int>& mapping_;
+  std::vector<MultiTrimTarget>& targets_;
+
+  AVPacket* route_pkt_ = nullptr;
+  std::vector<AVPacket*> gop_; // 当前 GOP 的包 (从关键帧开始，所有流)
+  bool has_gop_ = false;
+  long long gop_start_ms_ = 0;
+  int completed_ = 0;
+};
+
+DLLEXPORT int trim_video_multi(const char* input_path, const TrimOutput* outputs, int output_count,
+  const TrimOptions* options, int* out_results) {
+  if (!input_path || !outputs || output_count <= 0) return -1;
+
+  AVFormatContext* ifmt_ctx = nullptr;
+  AVPacket* pkt = nullptr;
+  int ret = 0;
+  int video_idx = -1;
+  int succeeded = 0;
+
+  std::vector<int> stream_mapping;
+  std::vector<MultiTrimTarget> targets(output_count);
+
+  TrimOptions resolved;
+  trim_options_init(&resolved);
+  if (options) resolved = *options;
+  if (resolved.quality < 0 || resolved.quality > 51) resolved.quality = kDefaultSmartQuality;
+
+  av_log_set_level(AV_LOG_ERROR);
+
+  pkt = av_packet_alloc();
+  if (!pkt) return -1;
+
+  if ((ret = avformat_open_input(&ifmt_ctx, input_path, NULL, NULL)) < 0) goto cleanup;
+  if ((ret = avformat_find_stream_info(ifmt_ctx, NULL)) < 0) goto cleanup;
+
+  video_idx = build_stream_mapping(ifmt_ctx, stream_mapping);
+  if (video_idx == -1) { ret = -1; goto cleanup; }
 
-    for (int j = 0; j < (int)ifmt_ctx->nb_streams; j++) {
-      int o_idx = stream_mapping[j];
-      if (o_idx == -1) continue;
-      states[o_idx].next_offset_tb += av_rescale_q(master_duration_tb, master_tb, ifmt_ctx->streams[j]->time_base);
+  // 打开全部输出 (无法创建的输出单独记为失败)
+  for (int i = 0; i < output_count; i++) {
+    MultiTrimTarget& t = targets[i];
+    t.request = &outputs[i];
+    for (int idx : stream_mapping) {
+      if (idx >= 0) t.states.push_back(StreamState());
     }
+    if (!t.request->output_path || t.request->count < 0 || (t.request->count > 0 &&
+      (!t.request->starts_ms || !t.request->ends_ms || !t.request->out_info))) {
+      t.result = -1;
+      continue;
+    }
+    t.result = open_trim_output(ifmt_ctx, t.request->output_path, NULL, stream_mapping, &t.ofmt_ctx);
   }
 
-  av_write_trailer(ofmt_ctx);
+  if (resolved.mode == TRIM_MODE_SMART) {
+    // 智能渲染按片段 seek 并维护编解码器状态，各输出依次处理
+    for (auto& t : targets) {
+      if (!t.ofmt_ctx) continue;
+      SmartCutter cutter(ifmt_ctx, t.ofmt_ctx, video_idx, stream_mapping, t.states, resolved.quality);
+      for (int i = 0; i < t.request->count && t.result >= 0; i++) {
+        reset_segment_states(t.states);
+        t.result = cutter.run_segment(t.request->starts_ms[i], t.request->ends_ms[i], pkt, &t.request->out_info[i]);
+        advance_segment_offsets(ifmt_ctx, video_idx, stream_mapping, t.states);
+      }
+    }
+  }
+  else {
+    MultiTrimmer trimmer(ifmt_ctx, video_idx, stream_mapping, targets);
+    if ((ret = trimmer.run(pkt)) < 0) goto cleanup;
+  }
+
+  for (auto& t : targets) {
+    if (!t.ofmt_ctx) continue;
+    if (t.result >= 0) t.result = av_write_trailer(t.ofmt_ctx);
+    if (t.result >= 0) { t.result = 0; succeeded++; }
+  }
+  ret = succeeded;
 
 cleanup:
+  for (int i = 0; i < output_count; i++) {
+    if (ret < 0 && targets[i].result >= 0) targets[i].result = ret;
+    if (out_results) out_results[i] = targets[i].result;
+    targets[i].writer.reset();
+    close_trim_output(&targets[i].ofmt_ctx);
+  }
   if (pkt) av_packet_free(&pkt);
-  if (muxer_opts) av_dict_free(&muxer_opts);
   if (ifmt_ctx) avformat_close_input(&ifmt_ctx);
-  if (ofmt_ctx) {
-    if (ofmt_ctx->pb) avio_closep(&ofmt_ctx->pb);
-    avformat_free_context(ofmt_ctx);
-  }
   return ret;
 }
+
+// =================================================================
+// 异步裁剪任务
+// =================================================================
+struct TrimJobData {
+  std::string input_path;
+  std::string output_path;
+  std::vector<long long> starts_ms;
+  std::vector<long long> ends_ms;
+  TrimOptions options;
+  std::vector<SegmentInfo> info;
+};
+
+DLLEXPORT long long trim_video_submit(const char* input_path, const char* output_path,
+  const long long* starts_ms, const long long* ends_ms, int count, const TrimOptions* options) {
+  if (!input_path || !output_path || count < 0 || (count > 0 && (!starts_ms || !ends_ms))) return -1;
+
+  auto data = std::make_shared<TrimJobData>();
+  data->input_path = input_path;
+  data->output_path = output_path;
+  data->starts_ms.assign(starts_ms, starts_ms + count);
+  data->ends_ms.assign(ends_ms, ends_ms + count);
+  trim_options_init(&data->options);
+  if (options) data->options = *options;
+  data->info.assign(count, SegmentInfo{});
+
+  long long total_ms = 0;
+  for (int i = 0; i < count; i++) total_ms += (std::max)(ends_ms[i] - starts_ms[i], 0LL);
+
+  TrimJobData* raw = data.get();
+  return JobRegistry::instance().submit(JOB_KIND_TRIM, TASK_PRIORITY_BACKGROUND, total_ms, data, [raw]() {
+    return trim_video_ex(raw->input_path.c_str(), raw->output_path.c_str(), raw->starts_ms.data(), raw->ends_ms.data(),
+      (int)raw->starts_ms.size(), &raw->options, raw->info.data());
+    });
+}
+
+DLLEXPORT int trim_video_job_segments(long long job_id, SegmentInfo* out_info, int capacity) {
+  std::shared_ptr<void> payload = JobRegistry::instance().finished_payload(job_id, JOB_KIND_TRIM);
+  if (!payload) return -1;
+  const TrimJobData* data = static_cast<const TrimJobData*>(payload.get());
+  int n = (std::min)((int)data->info.size(), (std::max)(capacity, 0));
+  if (out_info) std::copy(data->info.begin(), data->info.begin() + n, out_info);
+  return n;
+}
@@ -13,6 +13,25 @@ extern "C" {
     long long actual_duration_ms; // 物理长度：该片段在输出文件中的总长度
   } SegmentInfo;
 
+  typedef enum {
+    TRIM_MODE_COPY = 0,  // 纯流拷贝: 每段从请求起点处或之前最近的关键帧开始
+    TRIM_MODE_SMART = 1, // 智能渲染: 只重新编码切点所在的不完整 GOP，其余流拷贝，切点精确到帧
+  } TrimMode;
+
+  typedef struct {
+    int mode;    // TrimMode
+    int quality; // 重新编码部分的质量 (CRF，0-51，越小越好)，小于 0 使用默认值 18
+  } TrimOptions;
+
+  // 多输出裁剪中的一个输出文件
+  typedef struct {
+    const char* output_path;   // 输出文件路径 (UTF-8)
+    const long long* starts_ms; // 片段起点数组 (毫秒)，按此顺序拼接
+    const long long* ends_ms;   // 片段终点数组 (毫秒)
+    int count;                  // 片段数量
+    SegmentInfo* out_info;      // [输出] 长度等于 count
+  } TrimOutput;
+
 
   /**
    * @brief 高速无损裁剪合并视频 (Stream Copy 模式)
@@ -35,6 +54,96 @@ extern "C" {
     SegmentInfo* out_info
   );
 
+  /**
+   * @brief 填充默认选项 (流拷贝模式)。
+   */
+  DLLEXPORT void trim_options_init(TrimOptions* options);
+
+  /**
+   * @brief [扩展] 带选项的裁剪合并。
+   *
+   * 智能渲染模式下，切点所在 GOP 用与原视频相同的编码器、分辨率、像素格式和 profile / level
+   * 重新编码 (不使用 B 帧)，完整落在片段内的 GOP 原样拷贝。actual_start_ms 为请求起点处或之后的第一帧。
+   * 没有对应编码器时该 GOP 退回流拷贝模式的行为。
+   *
+   * @param options 裁剪选项，可为 NULL (等同于 trim_video)。
+   * @return 0 表示成功，小于 0 表示 FFmpeg 内部错误代码
+   */
+  DLLEXPORT int trim_video_ex(
+    const char* input_path,
+    const char* output_path,
+    const long long* starts_ms,
+    const long long* ends_ms,
+    int count,
+    const TrimOptions* options,
+    SegmentInfo* out_info
+  );
+
+  /**
+   * @brief [扩展] 从同一个输入裁剪出多个独立的输出文件 (输入只打开、探测一次)。
+   *
+   * 流拷贝模式下所有输出的片段在一次顺序读取中完成: 读到的包同时分发给当前处于片段内的
+   * 所有输出；片段之间的空隙较大时向前 seek 跳过，片段无法在本轮读取中完成时
+   * (同一输出内片段未按时间排序) 回退再读一轮。每段结果与单独调用 trim_video 相同。
+   * 智能渲染模式下各输出依次处理，但共用已打开的输入。
+   *
+   * @param outputs      输出数组
+   * @param output_count 输出数量
+   * @param options      裁剪选项，可为 NULL
+   * @param out_results  [输出] 可为 NULL，长度等于 output_count: 每个输出的结果 (0 成功，小于 0 失败)
+   * @return 成功的输出数量；小于 0 表示输入无法打开或没有视频流。
+   */
+  DLLEXPORT int trim_video_multi(
+    const char* input_path,
+    const TrimOutput* outputs,
+    int output_count,
+    const TrimOptions* options,
+    int* out_results
+  );
+
+  /**
+   * @brief [异步] 提交裁剪任务 (参数在调用时拷贝)，立即返回。进度单位为输出视频毫秒数，
+   *        通过 job_poll / job_cancel / job_wait / job_release (core/Job.h) 管理。
+   *        取消时输出文件不完整，由调用方删除。
+   * @param options 裁剪选项，可为 NULL。
+   * @return 任务编号；小于 0 表示参数错误。
+   */
+  DLLEXPORT long long trim_video_submit(
+    const char* input_path,
+    const char* output_path,
+    const long long* starts_ms,
+    const long long* ends_ms,
+    int count,
+    const TrimOptions* options
+  );
+
+  /**
+   * @brief 读取已结束的裁剪任务的每段信息。
+   * @param out_info [输出] 长度为 capacity
+   * @return 写入的段数；任务不存在、不是裁剪任务或尚未结束时返回 -1。
+   */
+  DLLEXPORT int trim_video_job_segments(long long job_id, SegmentInfo* out_info, int capacity);
+
 #ifdef __cplusplus
 }
+
+#include <functional>
+#include <vector>
+
+/**
+ * 为 keep(i) 为 true 的输入流按输入顺序分配输出流下标，其余为 -1。
+ * create_copy_streams 按输入顺序创建输出流，映射必须用它生成，否则音视频包会写进对方的轨道。
+ * @return 输出流数
+ */
+int map_copy_streams(AVFormatContext* ifmt_ctx, const std::function<bool(int)>& keep, std::vector<int>& stream_mapping);
+
+/**
+ * 把已打开输入的映射流 (stream_mapping[i] 为输出流下标，-1 表示丢弃) 从当前读取位置起
+ * 完整流拷贝为 faststart MP4，时间戳处理与 trim_video 相同: 从第一个视频关键帧开始，输出时间轴从 0 开始。
+ * 转码模块的 remux 快速路径使用。
+ * @param info [输出] 视频的物理起点与长度
+ * @return 0 表示成功，小于 0 表示 FFmpeg 错误码 (取消时为 AVERROR_EXIT)
+ */
+int remux_streams(AVFormatContext* ifmt_ctx, const char* output_path, const std::vector<int>& stream_mapping,
+  int video_idx, SegmentInfo* info);
 #endif
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include "../common.h"
+#include "VideoTrimer.h"
+
+// 流拷贝时每个输出流的时间轴状态
+struct StreamState {
+  long long first_pts = -1;
+  long long first_dts = -1;
+  long long next_offset_tb = 0;
+  long long current_clip_duration_tb = 0;
+  long long last_written_dts_out = AV_NOPTS_VALUE;
+};
+
+// 按映射 (stream_mapping[i] 为输出流下标，-1 表示丢弃，由 map_copy_streams 生成) 在 ofmt_ctx 中创建流拷贝的输出流:
+// 流参数、side data、元数据从输入拷贝，开启自动比特流过滤 (AVFMT_FLAG_AUTO_BSF)
+int create_copy_streams(AVFormatContext* ifmt_ctx, AVFormatContext* ofmt_ctx, const std::vector<int>& stream_mapping);
+
+// 流拷贝一个片段: 从第一个视频关键帧开始，输出时间轴以该关键帧为 0 (加上之前片段的总长)，
+// 视频包 pts 超过 end_ms 时结束。裁剪、remux 与分片 MP4 流 (video_stream) 共用
+class CopySegmentWriter {
+public:
+  // stream_mapping 与 states 必须比 writer 活得久
+  CopySegmentWriter(AVFormatContext* ifmt_ctx, AVFormatContext* ofmt_ctx, int video_idx,
+    const std::vector<int>& stream_mapping, std::vector<StreamState>& states, long long end_ms, SegmentInfo* info);
+
+  // 写入一个包 (包的内容会被消耗)。返回 false 表示片段已结束或写入失败 (见 error())，该包未写入
+  bool write(AVPacket* pkt);
+
+  // 第一次写入失败的错误码，没有失败时为 0
+  int error() const { return error_; }
+
+  // 是否已写入起始关键帧
+  bool started() const { return started_; }
+
+private:
+  AVFormatContext* ifmt_ctx_;
+  AVFormatContext* ofmt_ctx_;
+  int video_idx_;
+  const std::vector<int>& mapping_;
+  std::vector<StreamState>& states_;
+  long long end_ms_;
+  SegmentInfo* info_;
+  bool started_ = false;
+  long long anchor_dts_ = AV_NOPTS_VALUE;
+  int error_ = 0;
+};
@@ -6,8 +6,26 @@
 #include <filesystem>
 #include <chrono>
 #include <numeric>
+#include <algorithm>
 #include <iomanip> // for std::setprecision
+#include <thread>
+#include <fstream>
 #include "screen_shot/Screenshotter.h" // 引用你的头文件
+#include "core/MediaCache.h"
+#include "core/MediaIndex.h"
+#include "core/ThreadPool.h"
+#include "core/FramePool.h"
+#include "core/Job.h"
+#include "storyboard/Storyboard.h"
+#include "trickplay/Trickplay.h"
+#include "fast_hash/FastHash.h"
+#include "file_scan/FileScanner.h"
+#include "thumb_archive/ThumbArchive.h"
+#include "video_trim/VideoTrimer.h"
+#include "video_transcode/VideoTranscoder.h"
+#include "video_stream/TransmuxStream.h"
+#include "fingerprint/VideoFingerprint.h"
+#include "scene_detect/SceneDetector.h"
 
 namespace fs = std::filesystem;
 
@@ -45,6 +63,28 @@ void TestFormats(const std::string& videoFile, const std::string& outputDir);
 void TestPercentage(const std::string& videoFile, const std::string& outputDir);
 void TestSingleVideoMultipleTimestamps(const std::string& videoFile, const std::string& outputDir);
 void TestMultipleVideosSingleTimestamp(const std::vector<std::string>& videoFiles, const std::string& outputDir);
+void TestMediaCacheReuse(const std::string& videoFile, const std::string& outputDir);
+void TestGetKeyframes(const std::string& videoFile);
+void TestSeekModes(const std::string& videoFile, const std::string& outputDir);
+void TestOutputOptions(const std::string& videoFile, const std::string& outputDir);
+void TestThreadPoolPriority(const std::string& videoFile, const std::string& outputDir);
+void TestStoryboard(const std::string& outputDir);
+void TestTrickplay(const std::string& videoFile, const std::string& outputDir);
+void TestFastHash(const std::vector<std::string>& files);
+void TestFileScan(const std::string& rootDir, const std::string& excludeDir);
+void TestMetadataBatch(const std::vector<std::string>& files);
+void TestMediaIndex(const std::string& videoFile, const std::string& outputDir);
+void TestThumbArchive(const std::string& videoFile, const std::string& outputDir);
+void TestSmartTrim(const std::string& videoFile, const std::string& outputDir);
+void TestMultiTrim(const std::string& videoFile, const std::string& outputDir);
+void TestAsyncJobs(const std::string& videoFile, const std::string& outputDir);
+void TestTranscode(const std::string& videoFile, const std::string& outputDir);
+void TestRemux(const std::string& videoFile, const std::string& outputDir);
+void TestTransmuxStream(const std::string& videoFile, const std::string& outputDir);
+void TestVideoFingerprint(const std::string& videoFile, const std::string& outputDir);
+void TestSceneDetect(const std::string& videoFile, const std::string& outputDir);
+void TestAudioFirstCopy(const std::string& videoFile, const std::string& outputDir);
+void TestEncoderReuse(const std::string& videoFile, const std::string& outputDir);
 
 int main() {
   // ================== 配置路径 ==================
@@ -81,6 +121,72 @@ int main() {
   // 5. 测试多视频处理
   TestMultipleVideosSingleTimestamp({ testVideo1, testVideo2 }, outputDirectory);
 
+  // 6. 测试上下文缓存复用 (冷 / 热调用耗时对比)
+  TestMediaCacheReuse(testVideo2, outputDirectory);
+
+  // 7. 测试关键帧索引
+  TestGetKeyframes(testVideo1);
+
+  // 8. 测试近似定位模式 (精确 / 关键帧 / 容差)
+  TestSeekModes(testVideo1, outputDirectory);
+
+  // 9. 测试输出选项 (缩放 / 裁剪 / 旋转 / 质量)
+  TestOutputOptions(testVideo1, outputDirectory);
+
+  // 10. 测试线程池预算与优先级 (后台批量进行中的交互截图延迟)
+  TestThreadPoolPriority(testVideo1, outputDirectory);
+
+  // 11. 测试故事板拼贴 (使用前面生成的截图)
+  TestStoryboard(outputDirectory);
+
+  // 12. 测试进度条预览雪碧图与索引
+  TestTrickplay(testVideo1, outputDirectory);
+
+  // 13. 测试快速指纹 (与 hash.ts 算法一致)
+  TestFastHash({ testVideo1, testVideo2 });
+
+  // 14. 测试目录扫描 (排除截图输出目录)
+  TestFileScan("../test_video", outputDirectory);
+
+  // 15. 测试批量元数据探测
+  TestMetadataBatch({ testVideo1, testVideo2 });
+
+  // 16. 测试持久化媒体索引
+  TestMediaIndex(testVideo1, outputDirectory);
+
+  // 17. 测试截图归档 (批量写入 / 读取 / 删除 / 作为图片来源)
+  TestThumbArchive(testVideo1, outputDirectory);
+
+  // 18. 测试帧精确裁剪 (智能渲染)
+  TestSmartTrim(testVideo1, outputDirectory);
+
+  // 19. 测试多输出裁剪
+  TestMultiTrim(testVideo1, outputDirectory);
+
+  // 20. 测试异步任务 API
+  TestAsyncJobs(testVideo1, outputDirectory);
+
+  // 21. 测试进程内转码
+  TestTranscode(testVideo1, outputDirectory);
+
+  // 22. 测试流拷贝换封装
+  TestRemux(testVideo1, outputDirectory);
+
+  // 23. 测试分片 MP4 实时换封装
+  TestTransmuxStream(testVideo1, outputDirectory);
+
+  // 24. 测试视频感知指纹
+  TestVideoFingerprint(testVideo1, outputDirectory);
+
+  // 25. 测试镜头切换检测与场景截图
+  TestSceneDetect(testVideo1, outputDirectory);
+
+  // 26. 测试音频流在前的输入 (ffmpeg -i 1.mp4 -map 0:a -map 0:v -c copy audio_first.mkv)
+  TestAudioFirstCopy("../test_video/audio_first.mkv", outputDirectory);
+
+  // 27. 测试图片编码器复用
+  TestEncoderReuse(testVideo1, outputDirectory);
+
   std::cout << "\n=== 所有测试完成 ===" << std::endl;
   std::cout << "输出目录: " << fs::absolute(outputDirectory) << std::endl;
   std::cout << "按回车键退出..." << std::endl;
@@ -198,17 +304,31 @@ void TestSingleVideoMultipleTimestamps(const std::string& videoFile, const std::
 
   fs::path tpl = fs::path(outputDir) / "batch_%ms.webp";
 
+  ScreenshotBatchStats stats = {};
+  frame_memory_reset_peak();
+
   Stopwatch sw;
   sw.Start();
-  int success = generate_screenshots_for_video(
+  int success = generate_screenshots_for_video_ex(
     videoFile.c_str(),
     timestamps.data(),
     (int)timestamps.size(),
-    tpl.string().c_str()
+    tpl.string().c_str(),
+    nullptr,
+    nullptr,
+    &stats
   );
   sw.Stop();
 
   std::cout << "完成! 成功: " << success << " / " << count << std::endl;
+  std::cout << "Seek: " << stats.seeks << " 次, 读包: " << stats.packets_read
+    << " (跳过 " << stats.packets_skipped << "), 解码帧: " << stats.frames_decoded
+    << ", 使用帧: " << stats.frames_used << std::endl;
+
+  FrameMemoryStats memory = {};
+  frame_memory_get_stats(&memory);
+  std::cout << "在途帧内存峰值: " << memory.peak_bytes / (1024 * 1024) << " MB / 预算 "
+    << memory.budget_bytes / (1024 * 1024) << " MB (阻塞 " << memory.waits << " 次)" << std::endl;
   std::cout << "总耗时: " << std::fixed << std::setprecision(2) << sw.ElapsedSeconds() << " s" << std::endl;
   if (success > 0) {
     std::cout << "平均速度: " << (sw.ElapsedMilliseconds() / (double)success) << " ms/张" << std::endl;
@@ -247,4 +367,862 @@ void TestMultipleVideosSingleTimestamp(const std::vector<std::string>& videoFile
   std::cout << "耗时: " << sw.ElapsedMilliseconds() << " ms" << std::endl;
   std::cout << std::endl;
 }
+void TestMediaCacheReuse(const std::string& videoFile, const std::string& outputDir) {
+  std::cout << "--- [Test 6] 上下文缓存复用 ---" << std::endl;
+  if (!fs::exists(videoFile)) { std::cout << "Skipped: File not found.\n\n"; return; }
+
+  fs::path outPath = fs::path(outputDir) / "cache_test.jpg";
+  media_cache_evict(videoFile.c_str());
+
+  for (int round = 0; round < 2; round++) {
+    Stopwatch sw;
+    sw.Start();
+    VideoInfoResult info = get_video_metadata(videoFile.c_str());
+    int res = generate_screenshot(videoFile.c_str(), 1000, outPath.string().c_str());
+    sw.Stop();
+
+    std::cout << "  " << (round == 0 ? "冷调用" : "热调用") << ": metadata="
+      << (info.success ? "OK" : "FAILED") << ", screenshot=" << (res == 0 ? "OK" : "FAILED")
+      << " (" << sw.ElapsedMilliseconds() << " ms)" << std::endl;
+  }
+
+  media_cache_evict(videoFile.c_str());
+  std::cout << std::endl;
+}
+void TestGetKeyframes(const std::string& videoFile) {
+  std::cout << "--- [Test 7] 关键帧索引 ---" << std::endl;
+  if (!fs::exists(videoFile)) { std::cout << "Skipped: File not found.\n\n"; return; }
+
+  Stopwatch sw;
+  sw.Start();
+  int total = get_keyframes(videoFile.c_str(), nullptr, 0);
+  std::vector<long long> keyframes(total > 0 ? total : 0);
+  if (total > 0) get_keyframes(videoFile.c_str(), keyframes.data(), total);
+  sw.Stop();
+
+  if (total < 0) {
+    std::cout << "失败: 无法读取关键帧。" << std::endl << std::endl;
+    return;
+  }
+
+  bool sorted = std::is_sorted(keyframes.begin(), keyframes.end());
+  std::cout << "关键帧数量: " << total << (sorted ? " (升序)" : " (顺序错误!)") << std::endl;
+  for (int i = 0; i < total && i < 5; i++) {
+    std::cout << "  #" << i << ": " << keyframes[i] << " ms" << std::endl;
+  }
+  std::cout << "查询耗时: " << sw.ElapsedMilliseconds() << " ms" << std::endl;
+  std::cout << std::endl;
+}
+void TestSeekModes(const std::string& videoFile, const std::string& outputDir) {
+  std::cout << "--- [Test 8] 截图定位模式 ---" << std::endl;
+  if (!fs::exists(videoFile)) { std::cout << "Skipped: File not found.\n\n"; return; }
+
+  struct { int mode; long long tolerance; std::string name; } modes[] = {
+      {SCREENSHOT_SEEK_EXACT,     0,    "exact"},
+      {SCREENSHOT_SEEK_KEYFRAME,  0,    "keyframe"},
+      {SCREENSHOT_SEEK_TOLERANCE, 2000, "tolerance_2000"}
+  };
+
+  long long timestamp = 7300;
+
+  for (const auto& m : modes) {
+    ScreenshotOptions options;
+    screenshot_options_init(&options);
+    options.seek_mode = m.mode;
+    options.tolerance_ms = m.tolerance;
+
+    fs::path outPath = fs::path(outputDir) / ("seek_" + m.name + ".jpg");
+    long long actual = -1;
+
+    Stopwatch sw;
+    sw.Start();
+    int res = generate_screenshot_ex(videoFile.c_str(), timestamp, outPath.string().c_str(), &options, &actual);
+    sw.Stop();
+
+    if (res == 0) {
+      std::cout << "  [SUCCESS] " << m.name << ": 请求 " << timestamp << " ms -> 实际 " << actual
+        << " ms (" << sw.ElapsedMilliseconds() << " ms)" << std::endl;
+    }
+    else {
+      std::cout << "  [FAILED]  " << m.name << " (Code: " << res << ")" << std::endl;
+    }
+  }
+  std::cout << std::endl;
+}
+void TestOutputOptions(const std::string& videoFile, const std::string& outputDir) {
+  std::cout << "--- [Test 9] 输出选项 (缩放 / 裁剪 / 旋转 / 质量) ---" << std::endl;
+  if (!fs::exists(videoFile)) { std::cout << "Skipped: File not found.\n\n"; return; }
+
+  struct { int max_size; int crop; int rotation; int quality; int speed; std::string name; } cases[] = {
+      {0,   0, 0,   -1, SCREENSHOT_SPEED_BALANCED, "original.webp"},
+      {320, 0, 0,   -1, SCREENSHOT_SPEED_FAST,     "max320_fast.webp"},
+      {320, 0, 90,  -1, SCREENSHOT_SPEED_BALANCED, "max320_rot90.webp"},
+      {0,   1, 180, 90, SCREENSHOT_SPEED_BALANCED, "crop_rot180_q90.jpg"},
+      {480, 0, 270, -1, SCREENSHOT_SPEED_BEST,     "max480_rot270.png"}
+  };
+
+  long long timestamp = 5000;
+
+  for (const auto& c : cases) {
+    ScreenshotOptions options;
+    screenshot_options_init(&options);
+    options.output.max_width = c.max_size;
+    options.output.max_height = c.max_size;
+    options.output.rotation = c.rotation;
+    options.output.quality = c.quality;
+    options.output.speed_preset = c.speed;
+    if (c.crop) {
+      // 左上角 640x360 区域
+      options.output.crop_width = 640;
+      options.output.crop_height = 360;
+    }
+
+    fs::path outPath = fs::path(outputDir) / ("output_" + c.name);
+
+    Stopwatch sw;
+    sw.Start();
+    int res = generate_screenshot_ex(videoFile.c_str(), timestamp, outPath.string().c_str(), &options, nullptr);
+    sw.Stop();
+
+    if (res == 0) {
+      std::cout << "  [SUCCESS] " << c.name << " (" << fs::file_size(outPath) << " bytes, "
+        << sw.ElapsedMilliseconds() << " ms)" << std::endl;
+    }
+    else {
+      std::cout << "  [FAILED]  " << c.name << " (Code: " << res << ")" << std::endl;
+    }
+  }
+
+  // 导出旋转: 对已生成的图片再旋转一次
+  fs::path src = fs::path(outputDir) / "output_original.webp";
+  fs::path dst = fs::path(outputDir) / "output_converted_rot90.webp";
+  ScreenshotOptions defaults;
+  screenshot_options_init(&defaults);
+  ScreenshotOutputOptions output = defaults.output;
+  output.rotation = 90;
+  int res = convert_image_file(src.string().c_str(), dst.string().c_str(), &output);
+  std::cout << "  convert_image_file: " << (res == 0 ? "OK" : "FAILED") << std::endl;
+  std::cout << std::endl;
+}
+void TestThreadPoolPriority(const std::string& videoFile, const std::string& outputDir) {
+  std::cout << "--- [Test 10] 线程池预算与优先级 ---" << std::endl;
+  if (!fs::exists(videoFile)) { std::cout << "Skipped: File not found.\n\n"; return; }
+
+  thread_pool_configure(4);
+  std::cout << "CPU 预算: " << thread_pool_cpu_budget() << std::endl;
+
+  long long duration = get_video_duration(videoFile.c_str());
+  if (duration <= 0) duration = 60000;
+
+  std::vector<long long> timestamps;
+  for (int i = 1; i <= 60; i++) timestamps.push_back(duration * i / 62);
+  fs::path tpl = fs::path(outputDir) / "pool_bg_%ms.webp";
+
+  ScreenshotOptions background;
+  screenshot_options_init(&background);
+  background.priority = 1;
+
+  // 后台批量截图进行中，同时发起交互截图
+  Stopwatch bg;
+  bg.Start();
+  std::thread batch([&]() {
+    generate_screenshots_for_video_ex(videoFile.c_str(), timestamps.data(), (int)timestamps.size(),
+      tpl.string().c_str(), &background, nullptr, nullptr);
+    bg.Stop();
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  for (int i = 0; i < 3; i++) {
+    fs::path outPath = fs::path(outputDir) / ("pool_fg_" + std::to_string(i) + ".webp");
+    Stopwatch sw;
+    sw.Start();
+    int res = generate_screenshot(videoFile.c_str(), 3000 + i * 1000, outPath.string().c_str());
+    sw.Stop();
+    std::cout << "  交互截图 #" << i << ": " << (res == 0 ? "OK" : "FAILED")
+      << " (" << sw.ElapsedMilliseconds() << " ms)" << std::endl;
+  }
+
+  batch.join();
+  std::cout << "  后台批量: " << bg.ElapsedMilliseconds() << " ms" << std::endl;
+
+  thread_pool_configure(0);
+  std::cout << std::endl;
+}
+void TestStoryboard(const std::string& outputDir) {
+  std::cout << "--- [Test 11] 故事板拼贴 ---" << std::endl;
+
+  // 使用前面测试生成的截图
+  std::vector<std::string> images;
+  for (const auto& entry : fs::directory_iterator(outputDir)) {
+    if (entry.path().extension() == ".webp" && images.size() < 15) images.push_back(entry.path().string());
+  }
+  if (images.empty()) { std::cout << "Skipped: No screenshots.\n\n"; return; }
+
+  std::vector<const char*> paths;
+  for (const auto& p : images) paths.push_back(p.c_str());
+
+  StoryboardLayout layout;
+  storyboard_layout_init(&layout);
+  layout.seed = 42;
+
+  std::vector<unsigned char> buffer(1024 * 1024);
+
+  Stopwatch sw;
+  sw.Start();
+  int size = compose_storyboard(paths.data(), (int)paths.size(), &layout, buffer.data(), (int)buffer.size());
+  if (size > (int)buffer.size()) {
+    buffer.resize(size);
+    size = compose_storyboard(paths.data(), (int)paths.size(), &layout, buffer.data(), (int)buffer.size());
+  }
+  sw.Stop();
+
+  if (size > 0) {
+    fs::path outPath = fs::path(outputDir) / "storyboard_collage.webp";
+    std::ofstream(outPath, std::ios::binary).write((const char*)buffer.data(), size);
+    std::cout << "  [SUCCESS] " << images.size() << " images -> " << size << " bytes ("
+      << sw.ElapsedMilliseconds() << " ms)" << std::endl;
+  }
+  else {
+    std::cout << "  [FAILED]  Code: " << size << std::endl;
+  }
+  std::cout << std::endl;
+}
+void TestTrickplay(const std::string& videoFile, const std::string& outputDir) {
+  std::cout << "--- [Test 12] 进度条预览雪碧图 (trickplay) ---" << std::endl;
+  if (!fs::exists(videoFile)) { std::cout << "Skipped: File not found.\n\n"; return; }
+
+  fs::path trickplayDir = fs::path(outputDir) / "trickplay";
+  fs::create_directories(trickplayDir);
+
+  TrickplayOptions options;
+  trickplay_options_init(&options);
+
+  Stopwatch sw;
+  sw.Start();
+  int entries = generate_trickplay(videoFile.c_str(), trickplayDir.string().c_str(), &options);
+  sw.Stop();
+
+  if (entries > 0) {
+    int sheets = 0;
+    for (const auto& entry : fs::directory_iterator(trickplayDir)) {
+      if (entry.path().extension() == ".webp") sheets++;
+    }
+    fs::path indexPath = trickplayDir / "index.bin";
+    bool indexOk = fs::exists(indexPath) &&
+      fs::file_size(indexPath) == TRICKPLAY_INDEX_HEADER_SIZE + (uintmax_t)entries * TRICKPLAY_INDEX_ENTRY_SIZE;
+
+    std::cout << "  [SUCCESS] " << entries << " entries, " << sheets << " sheets ("
+      << sw.ElapsedMilliseconds() << " ms)" << std::endl;
+    std::cout << "  Index size: " << (indexOk ? "OK" : "MISMATCH") << std::endl;
+  }
+  else {
+    std::cout << "  [FAILED]  Code: " << entries << std::endl;
+  }
+  std::cout << std::endl;
+}
+void TestFastHash(const std::vector<std::string>& files) {
+  std::cout << "--- [Test 13] 快速指纹 (批量 / 单个一致性) ---" << std::endl;
+
+  std::vector<const char*> paths;
+  for (const auto& f : files) paths.push_back(f.c_str());
+
+  std::vector<unsigned long long> hashes(files.size());
+  std::vector<int> status(files.size());
+
+  Stopwatch sw;
+  sw.Start();
+  int ok = fast_hash_batch(paths.data(), (int)paths.size(), hashes.data(), status.data(), 0,
+    [](int processed, int total, int last_index) {
+      std::cout << "  Progress: " << processed << "/" << total << " (last finished #" << last_index << ")" << std::endl;
+    });
+  sw.Stop();
+  std::cout << "  Batch: " << ok << "/" << files.size() << " (" << sw.ElapsedMilliseconds() << " ms)" << std::endl;
+
+  for (size_t i = 0; i < files.size(); i++) {
+    unsigned long long single = 0;
+    int res = fast_hash_file(paths[i], &single);
+    bool match = res == status[i] && (res != 0 || single == hashes[i]);
+    std::cout << "  " << (match ? "[MATCH]    " : "[MISMATCH] ") << std::hex << std::setw(16) << std::setfill('0')
+      << hashes[i] << std::dec << std::setfill(' ') << "  " << files[i] << std::endl;
+  }
+  std::cout << std::endl;
+}
+void TestFileScan(const std::string& rootDir, const std::string& excludeDir) {
+  std::cout << "--- [Test 14] 目录扫描 ---" << std::endl;
+  if (!fs::exists(rootDir)) { std::cout << "Skipped: Directory not found.\n\n"; return; }
+
+  std::string blacklist = fs::absolute(excludeDir).lexically_normal().string();
+  const char* blacklistPaths[] = { blacklist.c_str() };
+  std::string root = fs::absolute(rootDir).lexically_normal().string();
+
+  Stopwatch sw;
+  sw.Start();
+  FileScanResult* result = scan_video_files(root.c_str(), blacklistPaths, 1, nullptr, 0);
+  sw.Stop();
+
+  int count = file_scan_count(result);
+  std::cout << "  Found " << count << " videos (" << sw.ElapsedMilliseconds() << " ms)" << std::endl;
+
+  const ScannedFile* entries = file_scan_entries(result, 0);
+  for (int i = 0; i < count && i < 5; i++) {
+    std::cout << "  " << entries[i].path << " (" << entries[i].size << " bytes)" << std::endl;
+  }
+  file_scan_free(result);
+  std::cout << std::endl;
+}
+void TestMetadataBatch(const std::vector<std::string>& files) {
+  std::cout << "--- [Test 15] 批量元数据 (与单个接口对比) ---" << std::endl;
+
+  std::vector<const char*> paths;
+  for (const auto& f : files) paths.push_back(f.c_str());
+  std::vector<VideoInfoResult> results(files.size());
+
+  Stopwatch sw;
+  sw.Start();
+  int ok = get_video_metadata_batch(paths.data(), (int)paths.size(), VIDEO_PROBE_FAST, results.data(), nullptr);
+  sw.Stop();
+  std::cout << "  Batch: " << ok << "/" << files.size() << " (" << sw.ElapsedMilliseconds() << " ms)" << std::endl;
+
+  for (size_t i = 0; i < files.size(); i++) {
+    VideoInfoResult single = get_video_metadata(paths[i]);
+    const VideoInfoResult& r = results[i];
+    bool match = single.success == r.success && single.duration_ms == r.duration_ms &&
+      single.width == r.width && single.height == r.height;
+    std::cout << "  " << (match ? "[MATCH]    " : "[MISMATCH] ") << r.width << "x" << r.height
+      << " " << r.duration_ms << "ms " << r.video_codec << "/" << r.pixel_format_name << " rot=" << r.rotation
+      << " audio=" << (r.has_audio ? r.audio_codec : "none") << "  " << files[i] << std::endl;
+  }
+  std::cout << std::endl;
+}
+void TestMediaIndex(const std::string& videoFile, const std::string& outputDir) {
+  std::cout << "--- [Test 16] 持久化媒体索引 (冷 / 索引命中耗时对比) ---" << std::endl;
+  if (!fs::exists(videoFile)) { std::cout << "Skipped: File not found.\n\n"; return; }
+
+  std::string indexPath = (fs::path(outputDir) / "media_index.bin").string();
+  fs::remove(indexPath);
+  if (media_index_open(indexPath.c_str()) != 0) { std::cout << "  [FAIL] media_index_open\n\n"; return; }
+
+  auto measure = [&](const char* label) {
+    media_cache_clear(); // 排除 MediaCache 的影响
+    Stopwatch sw;
+    sw.Start();
+    VideoInfoResult info = get_video_metadata(videoFile.c_str());
+    int keyframes = get_keyframes(videoFile.c_str(), nullptr, 0);
+    sw.Stop();
+    std::cout << "  " << label << ": " << info.width << "x" << info.height << ", " << keyframes << " keyframes ("
+      << sw.ElapsedMilliseconds() << " ms)" << std::endl;
+  };
+
+  measure("Cold   ");
+  measure("Indexed");
+
+  // 重新打开，模拟下次启动
+  media_index_close();
+  media_index_open(indexPath.c_str());
+  measure("Reopen ");
+
+  media_index_close();
+  std::cout << "  Index size: " << fs::file_size(indexPath) << " bytes\n" << std::endl;
+}
+void TestThumbArchive(const std::string& videoFile, const std::string& outputDir) {
+  std::cout << "--- [Test 17] 截图归档 (单文件 / 散文件对比) ---" << std::endl;
+  if (!fs::exists(videoFile)) { std::cout << "Skipped: File not found.\n\n"; return; }
+
+  long long duration = get_video_duration(videoFile.c_str());
+  if (duration <= 0) { std::cout << "Skipped: Duration unknown.\n\n"; return; }
+
+  std::vector<long long> timestamps;
+  for (int i = 1; i <= 20; i++) timestamps.push_back(duration * i / 21);
+
+  std::string archivePath = (fs::path(outputDir) / "thumbs.gra").string();
+  fs::remove(archivePath);
+
+  Stopwatch sw;
+  sw.Start();
+  int ok = generate_screenshots_for_video_ex(videoFile.c_str(), timestamps.data(), (int)timestamps.size(),
+    archivePath.c_str(), nullptr, nullptr, nullptr);
+  sw.Stop();
+  std::cout << "  Archive: " << ok << "/" << timestamps.size() << " (" << sw.ElapsedMilliseconds() << " ms, "
+    << fs::file_size(archivePath) << " bytes)" << std::endl;
+
+  // 读取 + 删除
+  ThumbArchive* archive = thumb_archive_open(archivePath.c_str());
+  int size = 0;
+  const uint8_t* data = thumb_archive_data(archive, thumb_archive_find(archive, timestamps[0]), &size);
+  std::cout << "  Entries: " << thumb_archive_count(archive) << ", first " << size << " bytes"
+    << (data && size > 12 && std::string((const char*)data + 8, 4) == "WEBP" ? " [WEBP]" : " [FAIL]") << std::endl;
+  thumb_archive_close(archive);
+
+  int removed = thumb_archive_delete(archivePath.c_str(), timestamps.data(), 10);
+  archive = thumb_archive_open(archivePath.c_str());
+  std::cout << "  Deleted " << removed << ", remaining " << thumb_archive_count(archive) << std::endl;
+  thumb_archive_close(archive);
+
+  // 归档中的项可直接作为图片来源
+  std::string source = archivePath + "#" + std::to_string(timestamps.back());
+  std::string rotated = (fs::path(outputDir) / "thumb_archive_rotated.png").string();
+  ScreenshotOptions defaults;
+  screenshot_options_init(&defaults);
+  ScreenshotOutputOptions output = defaults.output;
+  output.rotation = 90;
+  int res = convert_image_file(source.c_str(), rotated.c_str(), &output);
+  std::cout << "  Convert from archive: " << (res == 0 ? "OK" : "FAILED") << "\n" << std::endl;
+}
+
+void TestSmartTrim(const std::string& videoFile, const std::string& outputDir) {
+  std::cout << "--- [Test 18] 裁剪: 流拷贝 / 智能渲染对比 ---" << std::endl;
+  if (!fs::exists(videoFile)) { std::cout << "Skipped: File not found.\n\n"; return; }
+
+  long long duration = get_video_duration(videoFile.c_str());
+  if (duration <= 0) { std::cout << "Skipped: Duration unknown.\n\n"; return; }
+
+  // 切点故意不落在关键帧上
+  std::vector<long long> starts = { duration / 5 + 1234, duration / 2 + 567 };
+  std::vector<long long> ends = { starts[0] + 5000, starts[1] + 5000 };
+
+  const char* names[] = { "copy", "smart" };
+  for (int mode = TRIM_MODE_COPY; mode <= TRIM_MODE_SMART; mode++) {
+    TrimOptions options;
+    trim_options_init(&options);
+    options.mode = mode;
+
+    std::string outPath = (fs::path(outputDir) / ("trim_" + std::string(names[mode]) + ".mp4")).string();
+    std::vector<SegmentInfo> infos(starts.size());
+
+    Stopwatch sw;
+    sw.Start();
+    int res = trim_video_ex(videoFile.c_str(), outPath.c_str(), starts.data(), ends.data(), (int)starts.size(),
+      &options, infos.data());
+    sw.Stop();
+
+    std::cout << "  [" << names[mode] << "] " << (res == 0 ? "OK" : "FAILED") << " (" << sw.ElapsedMilliseconds() << " ms)" << std::endl;
+    if (res != 0) continue;
+    for (size_t i = 0; i < starts.size(); i++) {
+      std::cout << "    Segment " << i << ": requested " << starts[i] << " ms, actual " << infos[i].actual_start_ms
+        << " ms (off " << (infos[i].actual_start_ms - starts[i]) << " ms), length " << infos[i].actual_duration_ms << " ms" << std::endl;
+    }
+  }
+  std::cout << std::endl;
+}
+
+void TestMultiTrim(const std::string& videoFile, const std::string& outputDir) {
+  std::cout << "--- [Test 19] 多输出裁剪 (一次读取 / 逐个调用对比) ---" << std::endl;
+  if (!fs::exists(videoFile)) { std::cout << "Skipped: File not found.\n\n"; return; }
+
+  long long duration = get_video_duration(videoFile.c_str());
+  if (duration <= 0) { std::cout << "Skipped: Duration unknown.\n\n"; return; }
+
+  // 三个输出: 单段、两段 (有重叠)、两段 (逆序，需要第二轮读取)
+  const int kOutputs = 3;
+  std::vector<std::vector<long long>> starts = {
+    { duration / 10 },
+    { duration / 8, duration / 2 },
+    { duration * 3 / 4, duration / 4 },
+  };
+  std::vector<std::vector<long long>> ends(kOutputs);
+  for (int i = 0; i < kOutputs; i++) {
+    for (long long s : starts[i]) ends[i].push_back(s + 4000);
+  }
+
+  // 逐个调用 trim_video
+  std::vector<std::vector<SegmentInfo>> single(kOutputs);
+  Stopwatch sw;
+  sw.Start();
+  for (int i = 0; i < kOutputs; i++) {
+    single[i].resize(starts[i].size());
+    std::string outPath = (fs::path(outputDir) / ("trim_single_" + std::to_string(i) + ".mp4")).string();
+    trim_video(videoFile.c_str(), outPath.c_str(), starts[i].data(), ends[i].data(), (int)starts[i].size(), single[i].data());
+  }
+  sw.Stop();
+  std::cout << "  Single calls: " << sw.ElapsedMilliseconds() << " ms" << std::endl;
+
+  // 一次调用
+  std::vector<std::vector<SegmentInfo>> multi(kOutputs);
+  std::vector<std::string> paths(kOutputs);
+  std::vector<TrimOutput> outputs(kOutputs);
+  for (int i = 0; i < kOutputs; i++) {
+    multi[i].resize(starts[i].size());
+    paths[i] = (fs::path(outputDir) / ("trim_multi_" + std::to_string(i) + ".mp4")).string();
+    outputs[i] = { paths[i].c_str(), starts[i].data(), ends[i].data(), (int)starts[i].size(), multi[i].data() };
+  }
+  std::vector<int> results(kOutputs);
+
+  sw.Start();
+  int ok = trim_video_multi(videoFile.c_str(), outputs.data(), kOutputs, nullptr, results.data());
+  sw.Stop();
+  std::cout << "  Multi call: " << ok << "/" << kOutputs << " (" << sw.ElapsedMilliseconds() << " ms)" << std::endl;
+
+  for (int i = 0; i < kOutputs; i++) {
+    for (size_t j = 0; j < starts[i].size(); j++) {
+      bool same = single[i][j].actual_start_ms == multi[i][j].actual_start_ms &&
+        single[i][j].actual_duration_ms == multi[i][j].actual_duration_ms;
+      std::cout << "    Output " << i << " segment " << j << ": start " << multi[i][j].actual_start_ms
+        << " ms, length " << multi[i][j].actual_duration_ms << " ms " << (same ? "[MATCH]" : "[DIFF]") << std::endl;
+    }
+  }
+  std::cout << std::endl;
+}
+
+void TestAsyncJobs(const std::string& videoFile, const std::string& outputDir) {
+  std::cout << "--- [Test 20] 异步任务 (进度轮询 / 取消) ---" << std::endl;
+  if (!fs::exists(videoFile)) { std::cout << "Skipped: File not found.\n\n"; return; }
+
+  long long duration = get_video_duration(videoFile.c_str());
+  if (duration <= 0) { std::cout << "Skipped: Duration unknown.\n\n"; return; }
+
+  std::vector<long long> timestamps;
+  for (int i = 1; i <= 60; i++) timestamps.push_back(duration * i / 61);
+  std::string templatePath = (fs::path(outputDir) / "job_%ms.webp").string();
+
+  // 1. 完整执行，轮询进度
+  long long job = generate_screenshots_for_video_submit(videoFile.c_str(), timestamps.data(), (int)timestamps.size(),
+    templatePath.c_str(), nullptr);
+  JobProgress progress = {};
+  int polls = 0;
+  while (job_poll(job, &progress) < JOB_STATE_DONE) {
+    polls++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  std::vector<long long> actual(timestamps.size());
+  int n = screenshot_job_actual_ms(job, actual.data(), (int)actual.size());
+  std::cout << "  Screenshots: result " << progress.result << ", done " << progress.done << "/" << progress.total
+    << ", " << progress.frames << " frames, " << progress.bytes << " bytes, " << polls << " polls, "
+    << n << " actual timestamps" << std::endl;
+  job_release(job);
+
+  // 2. 启动后立即取消
+  std::string trimPath = (fs::path(outputDir) / "job_trim.mp4").string();
+  long long start = 0;
+  long long end = duration;
+  Stopwatch sw;
+  sw.Start();
+  job = trim_video_submit(videoFile.c_str(), trimPath.c_str(), &start, &end, 1, nullptr);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  job_cancel(job);
+  int state = job_wait(job, -1);
+  sw.Stop();
+  job_poll(job, &progress);
+  std::cout << "  Trim cancelled: " << (state == JOB_STATE_CANCELLED ? "YES" : "NO (finished first)")
+    << " after " << sw.ElapsedMilliseconds() << " ms, " << progress.done << "/" << progress.total << " ms written" << std::endl;
+  job_release(job);
+
+  // 3. 完整裁剪，读取每段信息
+  end = (std::min)(duration, 10000LL);
+  job = trim_video_submit(videoFile.c_str(), trimPath.c_str(), &start, &end, 1, nullptr);
+  state = job_wait(job, -1);
+  SegmentInfo info = {};
+  trim_video_job_segments(job, &info, 1);
+  job_poll(job, &progress);
+  std::cout << "  Trim: state " << state << ", result " << progress.result << ", segment " << info.actual_start_ms
+    << " + " << info.actual_duration_ms << " ms\n" << std::endl;
+  job_release(job);
+}
+
+void TestTranscode(const std::string& videoFile, const std::string& outputDir) {
+  std::cout << "--- [Test 21] 进程内转码 (H.264 / AAC) ---" << std::endl;
+  if (!fs::exists(videoFile)) { std::cout << "Skipped: File not found.\n\n"; return; }
+
+  // 1. 同步转码，限制为 720p
+  std::string outputPath = (fs::path(outputDir) / "transcode_720p.mp4").string();
+  TranscodeOptions options;
+  transcode_options_init(&options);
+  options.max_width = 1280;
+  options.max_height = 720;
+  Stopwatch sw;
+  sw.Start();
+  int ret = transcode_video(videoFile.c_str(), outputPath.c_str(), &options);
+  sw.Stop();
+  VideoInfoResult info = get_video_metadata(outputPath.c_str());
+  std::cout << "  Sync: result " << ret << ", " << sw.ElapsedMilliseconds() << " ms, output "
+    << info.width << "x" << info.height << ", " << info.duration_ms << " ms" << std::endl;
+
+  // 2. 两个异步任务并行，共享 CPU 预算，轮询进度
+  std::string pathA = (fs::path(outputDir) / "transcode_a.mp4").string();
+  std::string pathB = (fs::path(outputDir) / "transcode_b.mp4").string();
+  sw.Start();
+  long long jobA = transcode_video_submit(videoFile.c_str(), pathA.c_str(), nullptr);
+  long long jobB = transcode_video_submit(videoFile.c_str(), pathB.c_str(), nullptr);
+  JobProgress progressA = {}, progressB = {};
+  int polls = 0;
+  while (job_poll(jobA, &progressA) < JOB_STATE_DONE || job_poll(jobB, &progressB) < JOB_STATE_DONE) {
+    if (++polls % 10 == 0) {
+      std::cout << "  Progress: " << std::fixed << std::setprecision(1) << progressA.percent << "% / "
+        << progressB.percent << "%" << std::endl;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  sw.Stop();
+  std::cout << "  Parallel: results " << progressA.result << " / " << progressB.result << ", "
+    << sw.ElapsedMilliseconds() << " ms, " << progressA.frames + progressB.frames << " frames encoded" << std::endl;
+  job_release(jobA);
+  job_release(jobB);
+
+  // 3. 启动后取消
+  long long job = transcode_video_submit(videoFile.c_str(), pathA.c_str(), nullptr);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  job_cancel(job);
+  int state = job_wait(job, -1);
+  job_poll(job, &progressA);
+  std::cout << "  Cancel: " << (state == JOB_STATE_CANCELLED ? "YES" : "NO (finished first)") << ", result "
+    << progressA.result << "\n" << std::endl;
+  job_release(job);
+}
+
+void TestRemux(const std::string& videoFile, const std::string& outputDir) {
+  std::cout << "--- [Test 22] 流拷贝换封装快速路径 ---" << std::endl;
+  if (!fs::exists(videoFile)) { std::cout << "Skipped: File not found.\n\n"; return; }
+
+  const char* planNames[] = { "NONE", "REMUX", "ENCODE" };
+  int plan = transcode_video_plan(videoFile.c_str(), nullptr);
+  std::cout << "  Plan: " << (plan >= 0 && plan <= 2 ? planNames[plan] : "ERROR") << " (" << plan << ")" << std::endl;
+
+  // 1. 先用普通裁剪生成一个 MKV (H.264 源时编码兼容、封装不兼容)
+  std::string mkvPath = (fs::path(outputDir) / "remux_source.mkv").string();
+  long long start = 0;
+  long long end = (std::min)(get_video_duration(videoFile.c_str()), 30000LL);
+  SegmentInfo info = {};
+  trim_video(videoFile.c_str(), mkvPath.c_str(), &start, &end, 1, &info);
+  plan = transcode_video_plan(mkvPath.c_str(), nullptr);
+  std::cout << "  MKV plan: " << (plan >= 0 && plan <= 2 ? planNames[plan] : "ERROR") << std::endl;
+
+  // 2. 自动选择 (流拷贝) 与强制重新编码对比
+  std::string remuxPath = (fs::path(outputDir) / "remux_auto.mp4").string();
+  std::string encodePath = (fs::path(outputDir) / "remux_encode.mp4").string();
+  TranscodeOptions options;
+  transcode_options_init(&options);
+
+  Stopwatch sw;
+  sw.Start();
+  int ret = transcode_video(mkvPath.c_str(), remuxPath.c_str(), &options);
+  sw.Stop();
+  long long remuxMs = sw.ElapsedMilliseconds();
+
+  options.force_encode = 1;
+  sw.Start();
+  int retEncode = transcode_video(mkvPath.c_str(), encodePath.c_str(), &options);
+  sw.Stop();
+
+  VideoInfoResult remuxInfo = get_video_metadata(remuxPath.c_str());
+  std::cout << "  Auto: result " << ret << ", " << remuxMs << " ms, " << remuxInfo.duration_ms << " ms output"
+    << ", plan now " << transcode_video_plan(remuxPath.c_str(), nullptr) << std::endl;
+  std::cout << "  Forced encode: result " << retEncode << ", " << sw.ElapsedMilliseconds() << " ms\n" << std::endl;
+}
+
+void TestTransmuxStream(const std::string& videoFile, const std::string& outputDir) {
+  std::cout << "--- [Test 23] 分片 MP4 实时换封装 ---" << std::endl;
+  if (!fs::exists(videoFile)) { std::cout << "Skipped: File not found.\n\n"; return; }
+
+  Stopwatch sw;
+  sw.Start();
+  TransmuxInfo info = {};
+  TransmuxStream* stream = transmux_open(videoFile.c_str(), 0, &info);
+  if (!stream) { std::cout << "Skipped: Codecs not stream-copy compatible.\n\n"; return; }
+
+  // 1. 首个数据块 (ftyp + moov + 第一个片段) 的延迟
+  std::vector<uint8_t> buffer(256 * 1024);
+  int n = transmux_read(stream, buffer.data(), (int)buffer.size());
+  sw.Stop();
+  std::cout << "  Open: codecs " << info.codecs << ", " << info.width << "x" << info.height << ", start "
+    << info.start_ms << " ms, first " << n << " bytes after " << sw.ElapsedMilliseconds() << " ms" << std::endl;
+
+  // 2. 读完整个流写入文件，再按普通 MP4 探测
+  std::string outputPath = (fs::path(outputDir) / "transmux_full.mp4").string();
+  std::ofstream out(outputPath, std::ios::binary);
+  long long total = 0;
+  sw.Start();
+  while (n > 0) {
+    out.write((const char*)buffer.data(), n);
+    total += n;
+    n = transmux_read(stream, buffer.data(), (int)buffer.size());
+  }
+  out.close();
+  sw.Stop();
+  VideoInfoResult probed = get_video_metadata(outputPath.c_str());
+  std::cout << "  Full: " << total << " bytes in " << sw.ElapsedMilliseconds() << " ms, last result " << n
+    << ", probed duration " << probed.duration_ms << " ms (source " << info.duration_ms << ")" << std::endl;
+
+  // 3. seek 到中间: 重新输出一个从关键帧开始的流
+  long long target = info.duration_ms / 2;
+  int ret = transmux_seek(stream, target, &info);
+  n = transmux_read(stream, buffer.data(), (int)buffer.size());
+  std::cout << "  Seek to " << target << " ms: result " << ret << ", keyframe " << info.start_ms << " ms, first "
+    << n << " bytes\n" << std::endl;
+
+  transmux_close(stream);
+}
+
+void TestVideoFingerprint(const std::string& videoFile, const std::string& outputDir) {
+  std::cout << "--- [Test 24] 视频感知指纹与近似重复检索 ---" << std::endl;
+  if (!fs::exists(videoFile)) { std::cout << "Skipped: File not found.\n\n"; return; }
+
+  // 1. 原视频、中间裁剪出的片段、缩小后重新编码的副本
+  long long duration = get_video_duration(videoFile.c_str());
+  std::string clipPath = (fs::path(outputDir) / "fingerprint_clip.mp4").string();
+  std::string encodedPath = (fs::path(outputDir) / "fingerprint_encoded.mp4").string();
+  long long start = duration / 3;
+  long long end = (std::min)(start + 60000, duration);
+  SegmentInfo info = {};
+  trim_video(videoFile.c_str(), clipPath.c_str(), &start, &end, 1, &info);
+  TranscodeOptions options;
+  transcode_options_init(&options);
+  options.force_encode = 1;
+  options.max_width = 640;
+  options.max_height = 640;
+  options.crf = 30;
+  transcode_video(videoFile.c_str(), encodedPath.c_str(), &options);
+
+  const std::string paths[] = { videoFile, clipPath, encodedPath };
+  unsigned long long hashes[3][FINGERPRINT_DEFAULT_FRAMES] = {};
+  int counts[3] = {};
+  Stopwatch sw;
+  for (int i = 0; i < 3; i++) {
+    sw.Start();
+    counts[i] = video_fingerprint(paths[i].c_str(), 0, hashes[i]);
+    sw.Stop();
+    std::cout << "  " << fs::path(paths[i]).filename().string() << ": " << counts[i] << " hashes, "
+      << sw.ElapsedMilliseconds() << " ms" << std::endl;
+  }
+
+  // 2. 第二次调用命中媒体索引 (需要 media_index_open)
+  sw.Start();
+  video_fingerprint(videoFile.c_str(), 0, hashes[0]);
+  sw.Stop();
+  std::cout << "  Repeat: " << sw.ElapsedMilliseconds() << " ms" << std::endl;
+
+  // 3. 以原视频建索引，查询片段与重新编码的副本 (界面按相似度 0.8 分组)
+  FingerprintIndex* index = fingerprint_index_create();
+  fingerprint_index_add(index, 1, hashes[0], (std::max)(counts[0], 0));
+  for (int i = 1; i < 3; i++) {
+    FingerprintMatch match = {};
+    int n = fingerprint_index_query(index, hashes[i], (std::max)(counts[i], 0), -1, 0.0, -1, &match, 1);
+    std::cout << "  Query " << fs::path(paths[i]).filename().string() << ": " << n << " match, similarity "
+      << std::fixed << std::setprecision(2) << (n > 0 ? match.similarity : 0.0) << " (" << match.matched_frames
+      << "/" << counts[i] << " frames) " << (n > 0 && match.similarity >= 0.8 ? "OK" : "FAILED") << std::endl;
+  }
+
+  // 反方向: 以片段建索引，用原视频查询
+  FingerprintIndex* clipIndex = fingerprint_index_create();
+  fingerprint_index_add(clipIndex, 2, hashes[1], (std::max)(counts[1], 0));
+  FingerprintMatch reverse = {};
+  int reverseCount = fingerprint_index_query(clipIndex, hashes[0], (std::max)(counts[0], 0), -1, 0.0, -1, &reverse, 1);
+  std::cout << "  Source -> clip: similarity " << (reverseCount > 0 ? reverse.similarity : 0.0) << " "
+    << (reverseCount > 0 && reverse.similarity >= 0.8 ? "OK" : "FAILED") << std::endl;
+  fingerprint_index_destroy(clipIndex);
+
+  // 4. 5 万个随机指纹 (每个 16 帧) 中查询的耗时
+  unsigned long long seed = 0x9E3779B97F4A7C15ULL;
+  auto next = [&seed]() {
+    seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+    return seed;
+  };
+  std::vector<unsigned long long> random_hashes(FINGERPRINT_DEFAULT_FRAMES);
+  for (long long id = 2; id < 50002; id++) {
+    for (auto& h : random_hashes) h = next();
+    fingerprint_index_add(index, id, random_hashes.data(), (int)random_hashes.size());
+  }
+  std::vector<FingerprintMatch> matches(20);
+  sw.Start();
+  int n = fingerprint_index_query(index, hashes[2], (std::max)(counts[2], 0), -1, 0.5, -1, matches.data(), (int)matches.size());
+  sw.Stop();
+  std::cout << "  Query among " << fingerprint_index_size(index) << " videos: " << n << " matches in "
+    << sw.ElapsedMilliseconds() << " ms\n" << std::endl;
+
+  fingerprint_index_destroy(index);
+}
+void TestSceneDetect(const std::string& videoFile, const std::string& outputDir) {
+  std::cout << "--- [Test 25] 镜头切换检测与场景截图 ---" << std::endl;
+  if (!fs::exists(videoFile)) { std::cout << "Skipped: File not found.\n\n"; return; }
+
+  // 1. 关键帧模式与逐帧抽样模式的结果和耗时
+  const char* modeNames[] = { "Keyframes", "Frames" };
+  std::vector<SceneBoundary> scenes(256);
+  Stopwatch sw;
+  for (int mode = SCENE_ANALYZE_KEYFRAMES; mode <= SCENE_ANALYZE_FRAMES; mode++) {
+    SceneDetectOptions options;
+    scene_detect_options_init(&options);
+    options.analyze_mode = mode;
+    sw.Start();
+    int n = detect_scenes(videoFile.c_str(), &options, scenes.data(), (int)scenes.size());
+    sw.Stop();
+    std::cout << "  " << modeNames[mode] << ": " << n << " scenes in " << sw.ElapsedMilliseconds() << " ms";
+    for (int i = 0; i < (std::min)(n, 5); i++) {
+      std::cout << (i == 0 ? " [" : ", ") << scenes[i].time_ms << "ms " << std::fixed << std::setprecision(2)
+        << scenes[i].score;
+    }
+    std::cout << (n > 0 ? "]" : "") << std::endl;
+  }
+
+  // 2. 最佳场景帧截图: 不传时间点，由镜头切换选择
+  std::string sceneDir = (fs::path(outputDir) / "scenes").string();
+  fs::create_directories(sceneDir);
+  std::string templ = (fs::path(sceneDir) / "scene_%ms.jpg").string();
+  ScreenshotOptions shotOptions;
+  screenshot_options_init(&shotOptions);
+  shotOptions.seek_mode = SCREENSHOT_SEEK_KEYFRAME;
+  shotOptions.select_mode = SCREENSHOT_SELECT_SCENES;
+  const int count = 8;
+  long long actual[count];
+  sw.Start();
+  int success = generate_screenshots_for_video_ex(videoFile.c_str(), NULL, count, templ.c_str(), &shotOptions, actual, NULL);
+  sw.Stop();
+  std::cout << "  Scene screenshots: " << success << "/" << count << " in " << sw.ElapsedMilliseconds() << " ms [";
+  for (int i = 0; i < count; i++) std::cout << (i ? ", " : "") << actual[i];
+  std::cout << "]\n" << std::endl;
+}
+
+void TestAudioFirstCopy(const std::string& videoFile, const std::string& outputDir) {
+  std::cout << "--- [Test 26] 流拷贝: 音频流在视频流之前的输入 ---" << std::endl;
+  if (!fs::exists(videoFile)) { std::cout << "Skipped: File not found.\n\n"; return; }
+
+  // 音视频轨道互换时，视频包写进音频轨道: 输出的"视频"无法解码出截图
+  auto check = [&outputDir](const char* label, const std::string& path) {
+    VideoInfoResult info = get_video_metadata(path.c_str());
+    std::string shot = (fs::path(outputDir) / (std::string(label) + "_audio_first.jpg")).string();
+    int shotRet = generate_screenshot(path.c_str(), info.duration_ms / 2, shot.c_str());
+    bool ok = info.success && std::string(info.video_codec) == "h264" && info.audio_codec[0] && shotRet == 0;
+    std::cout << "  " << label << ": video " << info.video_codec << ", audio " << info.audio_codec << ", screenshot "
+      << shotRet << " -> " << (ok ? "OK" : "FAILED") << std::endl;
+  };
+
+  // 1. 转码接口的流拷贝快速路径 (H.264 + AAC 的 MKV 应选择 REMUX)
+  std::string remuxPath = (fs::path(outputDir) / "audio_first_remux.mp4").string();
+  TranscodeOptions options;
+  transcode_options_init(&options);
+  int plan = transcode_video_plan(videoFile.c_str(), &options);
+  int ret = transcode_video(videoFile.c_str(), remuxPath.c_str(), &options);
+  std::cout << "  Remux: plan " << plan << " (REMUX = " << TRANSCODE_PLAN_REMUX << "), result " << ret << std::endl;
+  if (ret == 0) check("Remux", remuxPath);
+
+  // 2. 分片 MP4 实时换封装: 读完整个流写入文件后同样检查
+  TransmuxInfo info = {};
+  TransmuxStream* stream = transmux_open(videoFile.c_str(), 0, &info);
+  if (stream) {
+    std::string transmuxPath = (fs::path(outputDir) / "audio_first_transmux.mp4").string();
+    std::ofstream out(transmuxPath, std::ios::binary);
+    std::vector<uint8_t> buffer(256 * 1024);
+    int n;
+    while ((n = transmux_read(stream, buffer.data(), (int)buffer.size())) > 0) out.write((const char*)buffer.data(), n);
+    out.close();
+    transmux_close(stream);
+    std::cout << "  Transmux: codecs " << info.codecs << ", last result " << n << std::endl;
+    check("Transmux", transmuxPath);
+  }
+  std::cout << std::endl;
+}
+
+void TestEncoderReuse(const std::string& videoFile, const std::string& outputDir) {
+  std::cout << "--- [Test 27] 图片编码器复用 (WebP) ---" << std::endl;
+  if (!fs::exists(videoFile)) { std::cout << "Skipped: File not found.\n\n"; return; }
+
+  // 单张截图在调用线程上编码: 第二次相同参数的保存应复用第一次打开的编码器
+  std::string first = (fs::path(outputDir) / "encoder_reuse_1.webp").string();
+  std::string second = (fs::path(outputDir) / "encoder_reuse_2.webp").string();
+  int ret1 = generate_screenshot(videoFile.c_str(), 1000, first.c_str());
+  long long opens = image_encoder_open_count();
+  int ret2 = generate_screenshot(videoFile.c_str(), 2000, second.c_str());
+  long long reopened = image_encoder_open_count() - opens;
+
+  std::cout << "  Results " << ret1 << " / " << ret2 << ", encoders opened by second save: " << reopened << " -> "
+    << (ret1 == 0 && ret2 == 0 && reopened == 0 ? "OK" : "FAILED") << "\n" << std::endl;
+}
 // --- END OF FILE ffmpeg_extensions_test.cpp ---
@@ -1,6 +1,7 @@
 import fs from 'fs-extra'
 import { BaseAssetManager } from './BaseAssetManager'
 import { ScreenshotGenerator } from '../../utils/ScreenshotGenerator'
+import { screenshotManager } from './ScreenshotManager'
 import log from 'electron-log'
 
 export class CoverManager extends BaseAssetManager {
@@ -47,7 +48,7 @@ export class CoverManager extends BaseAssetManager {
    * [核心方法] 手动设置封面
    * 逻辑：将外部图片拷贝并覆盖现有的封面文件
    * @param videoPath - 视频路径（用于锁定Hash）
-   * @param sourceImagePath - 用户选择的图片路径
+   * @param sourceImagePath - 用户选择的图片路径，或截图的 thumb:// 地址
    */
   public async setManualCoverFromPath(
     videoPath: string,
@@ -57,8 +58,13 @@ export class CoverManager extends BaseAssetManager {
       const hash = await this.getHash(videoPath)
       const targetPath = this.getCoverPath(hash)
 
-      // 直接覆盖旧文件
-      await fs.copy(sourceImagePath, targetPath)
+      // 截图归档中的图片 (thumb://) 直接写出数据，其它直接覆盖旧文件
+      const thumb = screenshotManager.readByUrl(sourceImagePath)
+      if (thumb) {
+        await fs.writeFile(targetPath, thumb)
+      } else {
+        await fs.copy(sourceImagePath, targetPath)
+      }
 
       log.info(`[CoverManager] Manual cover updated: ${targetPath}`)
       return true
@@ -79,7 +85,10 @@ export class CoverManager extends BaseAssetManager {
       const duration = await ScreenshotGenerator.getVideoDuration(videoPath)
       const timestamp = duration * 0.2
 
-      await ScreenshotGenerator.generateScreenshotAtTimestamp(videoPath, timestamp, targetPath)
+      // 封面不需要精确到帧，取最近的关键帧只解码一个 I 帧
+      await ScreenshotGenerator.generateScreenshotAtTimestamp(videoPath, timestamp, targetPath, {
+        mode: 'keyframe'
+      })
 
       return targetPath
     } catch (error) {
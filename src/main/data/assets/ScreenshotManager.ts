@@ -1,23 +1,76 @@
 import path from 'path'
 import fs from 'fs-extra'
-import sharp from 'sharp'
 
 import { BaseAssetManager } from './BaseAssetManager'
 import { storageManager } from '../json'
 import { ScreenshotGenerator } from '../../utils/ScreenshotGenerator'
+import { ThumbArchive } from '../../utils/ThumbArchive'
 
 /**
  * 视频截图管理器
  * 负责截图的生成、加载、删除及导出
+ *
+ * 一个视频的全部截图保存在哈希目录下的一个归档文件 (thumbs.gra) 中，键为截图时间戳 (毫秒)。
+ * 对外仍使用 "00001000.webp" 形式的文件名 (metadata.json 以它为键)，
+ * 界面通过 thumb://<hash>/<文件名> 协议读取图片。
  */
 export class ScreenshotManager extends BaseAssetManager {
   private readonly META_FILE = 'metadata.json'
   private readonly COLLAGE_NAME = 'storyboard_collage.webp'
+  private readonly ARCHIVE_NAME = 'thumbs.gra'
+  public static readonly PROTOCOL = 'thumb'
+
+  // 进行中的旧版散文件迁移任务 (并发调用等待同一个任务，结束后移除，之后出现的散文件在下次访问时迁移)
+  private migrations = new Map<string, Promise<void>>()
 
   constructor() {
     super('screenshots')
   }
 
+  private getArchivePath(hash: string): string {
+    return this.getFilePathInHash(hash, this.ARCHIVE_NAME)
+  }
+
+  /** 时间戳 (毫秒) -> 文件名，补齐位数便于排序 */
+  private toFilename(timestampMs: number): string {
+    return `${Math.floor(timestampMs).toString().padStart(8, '0')}.webp`
+  }
+
+  private toKey(filename: string): number {
+    return parseInt(path.parse(filename).name, 10) || 0
+  }
+
+  /**
+   * 旧版每张截图一个 WebP 文件: 首次访问时写入归档并删除散文件
+   */
+  private migrateLooseFiles(hash: string): Promise<void> {
+    let task = this.migrations.get(hash)
+    if (!task) {
+      task = this.doMigrateLooseFiles(hash).finally(() => {
+        this.migrations.delete(hash)
+      })
+      this.migrations.set(hash, task)
+    }
+    return task
+  }
+
+  private async doMigrateLooseFiles(hash: string): Promise<void> {
+    const files = await this.listFilesInHashDir(hash)
+    const loose = files.filter((file) => /^\d+\.webp$/.test(file))
+    if (loose.length === 0) return
+
+    const archivePath = this.getArchivePath(hash)
+    for (const file of loose) {
+      const filePath = this.getFilePathInHash(hash, file)
+      try {
+        await ThumbArchive.put(archivePath, this.toKey(file), await fs.readFile(filePath))
+        await fs.remove(filePath)
+      } catch (error) {
+        console.error(`[ScreenshotManager] 迁移截图失败: ${filePath}`, error)
+      }
+    }
+  }
+
   /**
    * 手动创建视频截图
    * @param videoPath 视频文件路径
@@ -26,20 +79,41 @@ export class ScreenshotManager extends BaseAssetManager {
   public async createManualScreenshot(videoPath: string, timestamp: number): Promise<boolean> {
     try {
       const hash = await this.getHash(videoPath)
-      // 将时间戳转为毫秒并补齐位数，作为文件名（便于排序）
-      const filename = `${Math.floor(timestamp * 1000)
-        .toString()
-        .padStart(8, '0')}.webp`
-      const savePath = this.getFilePathInHash(hash, filename)
-
-      await ScreenshotGenerator.generateScreenshotAtTimestamp(videoPath, timestamp, savePath)
-      return true
+      await this.migrateLooseFiles(hash)
+
+      // 将时间戳转为毫秒作为归档的键
+      const count = await ScreenshotGenerator.generateScreenshotsToArchive(
+        videoPath,
+        [Math.floor(timestamp * 1000)],
+        this.getArchivePath(hash)
+      )
+      return count > 0
     } catch (error) {
       console.error(`[ScreenshotManager] 截图生成失败: ${videoPath}`, error)
       return false
     }
   }
 
+  /**
+   * 按镜头切换自动挑选截图 (每段时间取切换最明显的画面)
+   * @param count 截图数量
+   * @returns 实际截图的时间点 (毫秒)
+   */
+  public async createSceneScreenshots(videoPath: string, count: number): Promise<number[]> {
+    try {
+      const hash = await this.getHash(videoPath)
+      await this.migrateLooseFiles(hash)
+      return await ScreenshotGenerator.generateSceneScreenshotsToArchive(
+        videoPath,
+        Math.floor(count),
+        this.getArchivePath(hash)
+      )
+    } catch (error) {
+      console.error(`[ScreenshotManager] 场景截图生成失败: ${videoPath}`, error)
+      return []
+    }
+  }
+
   public async getMetadata(filePath: string): Promise<Record<string, any>> {
     try {
       const hash = await this.getHash(filePath)
@@ -69,16 +143,55 @@ export class ScreenshotManager extends BaseAssetManager {
    */
   public async loadScreenshots(filePath: string) {
     const hash = await this.getHash(filePath)
-    const files = await this.listFilesInHashDir(hash)
+    await this.migrateLooseFiles(hash)
+
+    // 归档中的键已按升序排列
+    return ThumbArchive.keys(this.getArchivePath(hash)).map((key) => {
+      const filename = this.toFilename(key)
+      return {
+        filename,
+        timestamp: key,
+        path: `${ScreenshotManager.PROTOCOL}://${hash}/${filename}`
+      }
+    })
+  }
+
+  /**
+   * 读取 thumb://<hash>/<文件名> 对应的图片数据，不存在时返回 null
+   */
+  public readByUrl(url: string): Buffer | null {
+    const match = url.match(/^thumb:\/\/([0-9a-f]+)\/(\d+)\.webp/i)
+    if (!match) return null
+    const hash = match[1].toLowerCase()
+    return ThumbArchive.read(this.getArchivePath(hash), parseInt(match[2], 10))
+  }
 
-    return files
-      .filter((file) => file.endsWith('.webp') && file !== this.COLLAGE_NAME)
-      .map((file) => ({
-        filename: file,
-        timestamp: parseInt(path.parse(file).name, 10) || 0,
-        path: `file://${this.getFilePathInHash(hash, file)}`
-      }))
-      .sort((a, b) => a.timestamp - b.timestamp)
+  /**
+   * 截图的图片来源路径 (C++ 端的故事板 / 图片转换可直接读取归档中的项)
+   */
+  public async getImageSources(filePath: string, filenames: string[]): Promise<string[]> {
+    const hash = await this.getHash(filePath)
+    const archivePath = this.getArchivePath(hash)
+    return filenames.map((filename) => `${archivePath}#${this.toKey(filename)}`)
+  }
+
+  /**
+   * 把截图从一个视频哈希复制到另一个 (视频裁剪后迁移截图)
+   * @param moves 源 / 目标时间戳 (毫秒)
+   */
+  public async copyScreenshots(
+    fromHash: string,
+    toHash: string,
+    moves: Array<{ from: number; to: number }>
+  ): Promise<void> {
+    await this.migrateLooseFiles(fromHash)
+    const fromArchive = this.getArchivePath(fromHash)
+    const toArchive = this.getArchivePath(toHash)
+
+    for (const move of moves) {
+      const data = ThumbArchive.read(fromArchive, move.from)
+      if (data) await ThumbArchive.put(toArchive, Math.floor(move.to), data)
+    }
   }
 
   /**
@@ -88,8 +201,8 @@ export class ScreenshotManager extends BaseAssetManager {
    */
   public async deleteScreenshot(filePath: string, filename: string): Promise<void> {
     const hash = await this.getHash(filePath)
-    const targetPath = this.getFilePathInHash(hash, filename)
-    await this.delete(targetPath)
+    await this.migrateLooseFiles(hash)
+    await ThumbArchive.delete(this.getArchivePath(hash), [this.toKey(filename)])
 
     const meta = await this.getMetadata(filePath)
     if (meta[filename]) {
@@ -109,6 +222,7 @@ export class ScreenshotManager extends BaseAssetManager {
    */
   public async exportScreenshots(filePath: string, rotation: number): Promise<void> {
     const hash = await this.getHash(filePath)
+    await this.migrateLooseFiles(hash)
 
     // 1. 获取元数据
     const meta = await this.getMetadata(filePath)
@@ -116,12 +230,12 @@ export class ScreenshotManager extends BaseAssetManager {
     const exportBaseDir = storageManager.getScreenshotExportPath()
     const targetDir = path.join(exportBaseDir, hash)
 
-    // 2. 获取该目录下所有文件
-    const files = await this.listFilesInHashDir(hash)
+    // 2. 获取归档中的所有截图
+    const archivePath = this.getArchivePath(hash)
+    const keys = ThumbArchive.keys(archivePath)
 
-    for (const file of files) {
-      // 排除元数据 JSON 文件本身
-      if (file === this.META_FILE) continue
+    for (const key of keys) {
+      const file = this.toFilename(key)
 
       // 3. 核心逻辑：检查导出属性
       // 如果 JSON 中有记录且 export 为 false，则跳过
@@ -132,18 +246,20 @@ export class ScreenshotManager extends BaseAssetManager {
         continue
       }
 
-      const src = this.getFilePathInHash(hash, file)
       const dest = path.join(targetDir, file)
 
       // 确保目标目录存在
       await fs.ensureDir(targetDir)
 
       if (rotation > 0) {
-        // 如果有旋转角度，使用 sharp 处理后保存
-        await sharp(src).rotate(rotation).toFile(dest)
+        // 如果有旋转角度，由 C++ 端直接从归档解码、旋转后重新编码
+        await ScreenshotGenerator.convertImage(`${archivePath}#${key}`, dest, {
+          rotation: rotation as 90 | 180 | 270
+        })
       } else {
-        // 无旋转则直接拷贝
-        await fs.copy(src, dest)
+        // 无旋转则直接写出原始数据
+        const data = ThumbArchive.read(archivePath, key)
+        if (data) await fs.writeFile(dest, data)
       }
     }
   }
@@ -153,8 +269,10 @@ export class ScreenshotManager extends BaseAssetManager {
    * @param hash 视频哈希值
    */
   public async hasScreenshots(hash: string): Promise<boolean> {
+    if (ThumbArchive.keys(this.getArchivePath(hash)).length > 0) return true
+    // 尚未迁移的旧版散文件
     const files = await this.listFilesInHashDir(hash)
-    return files.some((f) => f.endsWith('.webp'))
+    return files.some((f) => /^\d+\.webp$/.test(f))
   }
 
   public async getStoryboardCollage(filePath: string): Promise<string | null> {
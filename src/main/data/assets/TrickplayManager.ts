@@ -0,0 +1,112 @@
+import fs from 'fs-extra'
+import log from 'electron-log'
+import { BaseAssetManager } from './BaseAssetManager'
+import { ScreenshotGenerator } from '../../utils/ScreenshotGenerator'
+
+/** 单个预览图块 (对应 index.bin 条目) */
+export interface TrickplayTile {
+  /** 实际使用的帧时间 (秒) */
+  time: number
+  sheet: number
+  x: number
+  y: number
+}
+
+/** 进度条悬停预览索引: 第 i 个图块对应 i * interval 秒 */
+export interface TrickplayIndex {
+  interval: number
+  duration: number
+  tileWidth: number
+  tileHeight: number
+  /** 每张雪碧图的列数 */
+  columns: number
+  /** 雪碧图 file:// 路径 */
+  sheets: string[]
+  tiles: TrickplayTile[]
+}
+
+// 与 C++ Trickplay.h 中的 index.bin 格式一致
+const INDEX_MAGIC = 'GRTP'
+const INDEX_VERSION = 1
+const HEADER_SIZE = 40
+const ENTRY_SIZE = 12
+
+/**
+ * 进度条悬停预览 (trickplay) 管理器
+ * 结构: baseDir/ab/abcdefg.../sheet_000.webp, index.bin
+ */
+export class TrickplayManager extends BaseAssetManager {
+  private readonly INDEX_NAME = 'index.bin'
+  // 同一视频同时只生成一次
+  private pending = new Map<string, Promise<TrickplayIndex | null>>()
+
+  constructor() {
+    super('trickplay')
+  }
+
+  /**
+   * 获取视频的悬停预览索引，不存在时生成
+   * @param videoPath 视频文件路径
+   */
+  public async getTrickplay(videoPath: string): Promise<TrickplayIndex | null> {
+    const hash = await this.getHash(videoPath)
+    const running = this.pending.get(hash)
+    if (running) return running
+
+    const task = this.loadOrGenerate(hash, videoPath).finally(() => this.pending.delete(hash))
+    this.pending.set(hash, task)
+    return task
+  }
+
+  private async loadOrGenerate(hash: string, videoPath: string): Promise<TrickplayIndex | null> {
+    const indexPath = this.getFilePathInHash(hash, this.INDEX_NAME)
+    try {
+      if (!(await this.exists(indexPath))) {
+        log.info(`[TrickplayManager] Generating trickplay for: ${hash}`)
+        await ScreenshotGenerator.generateTrickplay(videoPath, this.getHashDir(hash))
+      }
+      return this.parseIndex(hash, await fs.readFile(indexPath))
+    } catch (error) {
+      log.error(`[TrickplayManager] getTrickplay failed for ${videoPath}:`, error)
+      return null
+    }
+  }
+
+  private parseIndex(hash: string, data: Buffer): TrickplayIndex | null {
+    if (data.length < HEADER_SIZE || data.toString('latin1', 0, 4) !== INDEX_MAGIC) return null
+    if (data.readUInt32LE(4) !== INDEX_VERSION) return null
+
+    const sheetCount = data.readUInt32LE(20)
+    const entryCount = data.readUInt32LE(24)
+    if (data.length < HEADER_SIZE + entryCount * ENTRY_SIZE) return null
+
+    const sheets: string[] = []
+    for (let i = 0; i < sheetCount; i++) {
+      const name = `sheet_${i.toString().padStart(3, '0')}.webp`
+      sheets.push(`file://${this.getFilePathInHash(hash, name)}`)
+    }
+
+    const tiles: TrickplayTile[] = new Array(entryCount)
+    for (let i = 0; i < entryCount; i++) {
+      const offset = HEADER_SIZE + i * ENTRY_SIZE
+      tiles[i] = {
+        time: data.readUInt32LE(offset) / 1000,
+        sheet: data.readUInt16LE(offset + 4),
+        x: data.readUInt16LE(offset + 6),
+        y: data.readUInt16LE(offset + 8)
+      }
+    }
+
+    return {
+      interval: data.readUInt32LE(8) / 1000,
+      tileWidth: data.readUInt16LE(12),
+      tileHeight: data.readUInt16LE(14),
+      columns: data.readUInt16LE(16),
+      duration: Number(data.readBigInt64LE(28)) / 1000,
+      sheets,
+      tiles
+    }
+  }
+}
+
+export const trickplayManager = new TrickplayManager()
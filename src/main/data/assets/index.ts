@@ -1,3 +1,4 @@
 export { BaseAssetManager } from './BaseAssetManager'
 export { screenshotManager } from './ScreenshotManager'
 export { CoverManager } from './CoverManager'
+export { trickplayManager } from './TrickplayManager'
@@ -1,60 +1,54 @@
 import log from 'electron-log'
-import { BaseShardedJsonManager } from './BaseShardedJsonManager'
 import { ScreenshotGenerator } from '../../utils/ScreenshotGenerator'
-import { fileProfileManager } from './FileProfileManager'
 import { VideoMetadata } from '../../../shared'
 
-export class VideoMetadataManager extends BaseShardedJsonManager<VideoMetadata> {
-  // 并发控制：防止同一个 Hash 被同时提取多次
+/**
+ * 视频元数据
+ * 持久化由 C++ 端的媒体索引负责 (路径 + mtime + size 为键，文件修改后自动失效)，
+ * 启动时不需要加载 JSON 分片；这里只负责合并同一文件的并发请求。
+ */
+export class VideoMetadataManager {
+  // 并发控制：防止同一个文件被同时提取多次
   private pendingTasks = new Map<string, Promise<VideoMetadata | null>>()
 
-  constructor() {
-    super('video_metadata')
-  }
-
   /**
    * 获取视频元数据
-   * @param filePath 物理路径（用于提取和获取 Hash）
+   * @param filePath 物理路径
    */
   public async getVideoMetadata(filePath: string): Promise<VideoMetadata | null> {
-    // 1. 获取文件的 Hash
-    const profile = await fileProfileManager.getProfile(filePath)
-    if (!profile) return null
-
-    const hash = profile.hash
+    // 检查是否正在提取中
+    const running = this.pendingTasks.get(filePath)
+    if (running) return running
 
-    // 2. 从分片缓存中读取
-    const cached = this.getItem(hash)
-    if (cached) return cached
-
-    // 3. 检查是否正在提取中
-    if (this.pendingTasks.has(hash)) {
-      return this.pendingTasks.get(hash)!
-    }
-
-    // 4. 执行提取任务
+    // 执行提取任务 (索引命中时不会打开视频)
     const task = (async () => {
       try {
-        log.debug(`[VideoMetadata] Extracting metadata for: ${hash}`)
         const metadata = await ScreenshotGenerator.getVideoMetadata(filePath)
-
-        if (metadata && metadata.duration > 0) {
-          // 存入分片 JSON
-          await this.setItem(hash, metadata)
-          return metadata
-        }
-        return null
+        return metadata && metadata.duration > 0 ? metadata : null
       } catch (e) {
         log.error(`[VideoMetadata] Extraction failed: ${filePath}`, e)
         return null
       } finally {
-        this.pendingTasks.delete(hash)
+        this.pendingTasks.delete(filePath)
       }
     })()
 
-    this.pendingTasks.set(hash, task)
+    this.pendingTasks.set(filePath, task)
     return task
   }
+
+  /**
+   * 预取一批文件的元数据 (刷新媒体库后调用)
+   * 已在索引中的文件只做一次 stat，其余的快速探测后写入索引
+   * @returns 有元数据的文件数
+   */
+  public async prefetchMetadata(files: Array<{ path: string }>): Promise<number> {
+    const paths = files.map((f) => f.path).filter((p) => !this.pendingTasks.has(p))
+    if (paths.length === 0) return 0
+
+    const results = await ScreenshotGenerator.getVideoMetadataBatch(paths)
+    return results.filter((metadata) => metadata && metadata.duration > 0).length
+  }
 }
 
 export const videoMetadataManager = new VideoMetadataManager()
@@ -10,7 +10,8 @@ import {
   registerVideoExportHandlers,
   registerVideoTranscodeHandlers,
   registerTranscodeHandlers,
-  registerStroyBoardServiceHandlers
+  registerStroyBoardServiceHandlers,
+  registerNearDuplicateHandlers
 } from './services'
 import {
   registerWindowHandlers,
@@ -21,13 +22,16 @@ import {
   registerAnnotationHandlers,
   registerTagHandlers,
   registerHistoryHandlers,
-  registerDebugHandlers
+  registerDebugHandlers,
+  registerThumbScheme,
+  registerThumbProtocol
 } from './ipc'
 
 import { setupFfmpeg, exposeGC } from './utils'
 
 exposeGC()
 setupFfmpeg()
+registerThumbScheme()
 
 function createWindow(): void {
   const mainWindow = new BrowserWindow({
@@ -75,6 +79,7 @@ app.whenReady().then(async () => {
   await startupService.startup()
 
   setupIpcHandlers()
+  registerThumbProtocol()
 
   createWindow()
 
@@ -103,6 +108,7 @@ function setupIpcHandlers() {
   registerVideoTranscodeHandlers()
   registerTranscodeHandlers()
   registerStroyBoardServiceHandlers()
+  registerNearDuplicateHandlers()
   registerDebugHandlers()
 
   ipcMain.handle('select-directory', async () => {
@@ -1,6 +1,10 @@
 export { registerWindowHandlers } from './windowHandlers'
 export { registerMetadataHandler } from './MetadataHandler'
-export { registerScreenshotHandlers } from './screenshotHandlers'
+export {
+  registerScreenshotHandlers,
+  registerThumbScheme,
+  registerThumbProtocol
+} from './screenshotHandlers'
 export { registerCoverHandlers } from './coverHandlers'
 export { registerSettingsHandlers } from './settingsHandlers'
 export { registerAnnotationHandlers } from './AnnotationHandlers'
@@ -1,5 +1,6 @@
-import { ipcMain } from 'electron'
-import { screenshotManager } from '../data/assets/ScreenshotManager'
+import { ipcMain, protocol } from 'electron'
+import { screenshotManager, ScreenshotManager } from '../data/assets/ScreenshotManager'
+import { trickplayManager } from '../data/assets/TrickplayManager'
 import { safeInvoke } from '../utils/handlerHelper'
 
 export function registerScreenshotHandlers() {
@@ -7,6 +8,11 @@ export function registerScreenshotHandlers() {
     return safeInvoke(() => screenshotManager.createManualScreenshot(filePath, timestamp), false)
   })
 
+  // 按镜头切换自动挑选 count 张截图
+  ipcMain.handle('save-scene-screenshots', async (_, filePath: string, count: number) => {
+    return safeInvoke(() => screenshotManager.createSceneScreenshots(filePath, count), [])
+  })
+
   ipcMain.handle('load-screenshots', async (_, filePath: string) => {
     return safeInvoke(
       () => screenshotManager.loadScreenshots(filePath),
@@ -34,4 +40,34 @@ export function registerScreenshotHandlers() {
   ipcMain.handle('get-storyboard-collage', async (_, filePath: string) => {
     return await screenshotManager.getStoryboardCollage(filePath)
   })
+
+  // 进度条悬停预览索引 (不存在时由 C++ 端生成)
+  ipcMain.handle('get-trickplay', async (_, filePath: string) => {
+    return safeInvoke(() => trickplayManager.getTrickplay(filePath), null)
+  })
+}
+
+/**
+ * 截图归档协议 thumb://<hash>/<文件名>，必须在 app ready 之前调用
+ */
+export function registerThumbScheme() {
+  protocol.registerSchemesAsPrivileged([
+    {
+      scheme: ScreenshotManager.PROTOCOL,
+      privileges: { standard: true, secure: true, supportFetchAPI: true }
+    }
+  ])
+}
+
+/**
+ * 从截图归档读取图片 (app ready 之后调用)
+ */
+export function registerThumbProtocol() {
+  protocol.handle(ScreenshotManager.PROTOCOL, (request) => {
+    const data = screenshotManager.readByUrl(request.url)
+    if (!data) return new Response(null, { status: 404 })
+    return new Response(data, {
+      headers: { 'Content-Type': 'image/webp', 'Cache-Control': 'no-cache' }
+    })
+  })
 }
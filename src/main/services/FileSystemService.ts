@@ -4,6 +4,7 @@ import { storageManager } from '../data/json'
 import log from 'electron-log'
 import { shell, clipboard, ipcMain } from 'electron'
 import { exec } from 'child_process'
+import { ScreenshotGenerator } from '../utils/ScreenshotGenerator'
 
 export class FileSystemService {
   /** 内部工具：确保目录存在 */
@@ -57,6 +58,7 @@ export class FileSystemService {
     await this.ensureDir(targetDir)
 
     const finalPath = await this.uniquePath(targetDir, path.basename(srcFile))
+    ScreenshotGenerator.releaseFile(srcFile)
     await fs.move(srcFile, finalPath)
     log.info(`[FileManager] moved to ${finalPath}`)
     return finalPath
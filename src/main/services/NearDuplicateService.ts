@@ -0,0 +1,52 @@
+import { ipcMain } from 'electron'
+import log from 'electron-log'
+import { startupService } from './StartupService'
+import { calculateFingerprintBatch, NearDuplicateIndex } from '../utils/VideoFingerprint'
+
+/**
+ * 近似重复检测 (重新编码 / 换封装 / 裁剪出的副本，字节哈希不同)
+ * 只在界面请求时运行；指纹缓存在 C++ 媒体索引中，再次检测只解码新增 / 修改过的文件
+ */
+export class NearDuplicateService {
+  private detection: Promise<string[][]> | null = null
+
+  /**
+   * 当前视频库中互相近似重复的文件路径分组，并发调用共享同一次检测
+   */
+  public findGroups(): Promise<string[][]> {
+    if (!this.detection) {
+      this.detection = this.detect().finally(() => {
+        this.detection = null
+      })
+    }
+    return this.detection
+  }
+
+  private async detect(): Promise<string[][]> {
+    const paths = (startupService.getLastResult()?.videoList ?? []).map((video) => video.path)
+    const fingerprints = await calculateFingerprintBatch(paths)
+
+    const index = new NearDuplicateIndex()
+    try {
+      for (const [path, fingerprint] of fingerprints) index.add(path, fingerprint)
+      const groups = await index.groupDuplicates()
+      log.info(`Near-duplicate groups: ${groups.length} (${fingerprints.size} fingerprinted)`)
+      return groups
+    } finally {
+      index.dispose()
+    }
+  }
+}
+
+export const nearDuplicateService = new NearDuplicateService()
+
+export function registerNearDuplicateHandlers() {
+  ipcMain.handle('find-near-duplicates', async () => {
+    try {
+      return await nearDuplicateService.findGroups()
+    } catch (error) {
+      log.error('Near-duplicate detection failed:', error)
+      return []
+    }
+  })
+}
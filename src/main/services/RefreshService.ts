@@ -1,7 +1,7 @@
-import { storageManager } from '../data/json'
+import { storageManager, videoMetadataManager } from '../data/json'
 import { AnnotationManager } from '../data/json/AnnotationManager'
 import { scanVideoFiles, ScanResult } from '../utils/fileScanner'
-import { calculateFastHash } from '../utils/hash'
+import { calculateHashBatch } from '../utils/hash'
 import log from 'electron-log'
 import { BrowserWindow } from 'electron'
 
@@ -81,6 +81,12 @@ export class RefreshService {
       this.sendProgress({ phase: 'syncing', current: 0, total: filesWithHash.length })
       const result = await this.syncMetadata(filesWithHash)
 
+      // 后台预取元数据 (不阻塞刷新结果)，之后打开详情 / 列表时直接命中缓存
+      videoMetadataManager
+        .prefetchMetadata(filesWithHash)
+        .then((count) => log.info(`Metadata prefetched: ${count}`))
+        .catch((error) => log.error('Metadata prefetch failed:', error))
+
       // Phase 4: Complete
       this.sendProgress({ phase: 'complete', current: 100, total: 100 })
 
@@ -124,27 +130,20 @@ export class RefreshService {
    * Phase 2: Calculate hashes for all files
    */
   private async calculateHashes(files: ScanResult[]): Promise<FileWithHash[]> {
-    const filesWithHash: FileWithHash[] = []
-    let processed = 0
+    const hashes = await calculateHashBatch(
+      files.map((file) => file.path),
+      (processed, total, currentFile) => {
+        this.sendProgress({ phase: 'hashing', current: processed, total, currentFile })
+      }
+    )
 
+    const filesWithHash: FileWithHash[] = []
     for (const file of files) {
-      try {
-        const hash = await calculateFastHash(file.path)
+      const hash = hashes.get(file.path)
+      if (hash) {
         filesWithHash.push({ ...file, hash })
-
-        processed++
-
-        // Update progress every 10 files to avoid UI flooding
-        if (processed % 10 === 0 || processed === files.length) {
-          this.sendProgress({
-            phase: 'hashing',
-            current: processed,
-            total: files.length,
-            currentFile: file.path
-          })
-        }
-      } catch (error) {
-        log.error(`Failed to hash file ${file.path}:`, error)
+      } else {
+        log.error(`Failed to hash file ${file.path}`)
       }
     }
 
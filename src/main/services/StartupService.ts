@@ -5,12 +5,13 @@ import {
   annotationManager,
   fileProfileManager,
   historyManager,
-  videoMetadataManager,
   tagManager
 } from '../data'
 import { scanVideoFiles } from '../utils'
+import { ScreenshotGenerator } from '../utils/ScreenshotGenerator'
 import { StartupResult, VideoFile } from '../../shared'
-import { ipcMain } from 'electron'
+import { app, ipcMain } from 'electron'
+import path from 'path'
 
 export class StartupService {
   private lastResult: StartupResult | null = null
@@ -19,6 +20,9 @@ export class StartupService {
    * 执行核心启动逻辑：物理扫描 + 档案库映射
    */
   async startup(): Promise<StartupResult> {
+    // 媒体索引 (元数据 / 关键帧) 只需 mmap，先于其它管理器打开
+    ScreenshotGenerator.openMediaIndex(path.join(app.getAppPath(), 'data/data', 'media_index.bin'))
+
     // 统一初始化所有管理器
     await Promise.all([
       storageManager.load(),
@@ -26,7 +30,6 @@ export class StartupService {
       fileProfileManager.init(),
       annotationManager.init(),
       historyManager.load(),
-      videoMetadataManager.init(),
       tagManager.load()
     ])
 
@@ -1,6 +1,7 @@
 import { BrowserWindow } from 'electron'
 import { videoTranscodeService } from './VideoTranscodeService'
 import path from 'path'
+import { ScreenshotGenerator } from '../utils/ScreenshotGenerator'
 import { ipcMain } from 'electron'
 
 export interface TranscodeTask {
@@ -19,9 +20,12 @@ export interface TranscodeTask {
   error?: string
 }
 
+// 同时进行的转码任务数，CPU 预算在它们之间平分
+const MAX_CONCURRENT_TRANSCODES = 2
+
 class TranscodeQueueManager {
   private queue: TranscodeTask[] = []
-  private isProcessing = false
+  private running = 0
 
   /**
    * 添加任务到队列
@@ -45,26 +49,35 @@ class TranscodeQueueManager {
   }
 
   /**
-   * 单线程循环调度
+   * 并发调度: 最多同时执行 MAX_CONCURRENT_TRANSCODES 个任务
    */
-  private async processNext() {
-    if (this.isProcessing) return
-
-    const task = this.queue.find((t) => t.status === 'pending')
-    if (!task) {
-      this.isProcessing = false
-      return
+  private processNext() {
+    while (this.running < MAX_CONCURRENT_TRANSCODES) {
+      const task = this.queue.find((t) => t.status === 'pending')
+      if (!task) return
+      this.running++
+      task.status = 'processing'
+      this.notifyUpdate()
+      this.runTask(task)
     }
+  }
 
-    this.isProcessing = true
-    task.status = 'processing'
-    this.notifyUpdate()
+  private async runTask(task: TranscodeTask) {
+    // 每个任务分到 CPU 预算的一份，多个任务并行也不会超额占用
+    const threads = Math.max(
+      1,
+      Math.floor(ScreenshotGenerator.getCpuBudget() / MAX_CONCURRENT_TRANSCODES)
+    )
 
     try {
-      const result = await videoTranscodeService.transcodeAndReplace(task.path, (p) => {
-        task.progress = p
-        this.notifyUpdate() // 进度更新时推送
-      })
+      const result = await videoTranscodeService.transcodeAndReplace(
+        task.path,
+        (p) => {
+          task.progress = p
+          this.notifyUpdate() // 进度更新时推送
+        },
+        { threads }
+      )
 
       if (result.success) {
         task.status = 'completed'
@@ -76,7 +89,7 @@ class TranscodeQueueManager {
       task.status = 'failed'
       task.error = err.message || '未知错误'
     } finally {
-      this.isProcessing = false
+      this.running--
       this.notifyUpdate()
       this.processNext() // 处理下一个
     }
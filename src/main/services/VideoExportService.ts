@@ -118,6 +118,7 @@ export class VideoExportService {
     const oldHash = oldProfile!.hash
 
     let cumulativeOffsetMs = 0
+    const moves: Array<{ from: number; to: number }> = []
 
     for (const range of pRanges) {
       const pStartMs = range.pStart * 1000
@@ -128,18 +129,13 @@ export class VideoExportService {
 
       for (const s of inRange) {
         // 时间轴平移计算
-        const newTimestamp = s.timestamp - pStartMs + cumulativeOffsetMs
-        const newFilename = `${Math.floor(newTimestamp).toString().padStart(8, '0')}.webp`
-
-        // 物理搬运
-        const src = screenshotManager['getFilePathInHash'](oldHash, s.filename)
-        const dest = screenshotManager['getFilePathInHash'](newHash, newFilename)
-
-        await fs.ensureDir(path.dirname(dest))
-        await fs.copy(src, dest)
+        moves.push({ from: s.timestamp, to: s.timestamp - pStartMs + cumulativeOffsetMs })
       }
       cumulativeOffsetMs += pEndMs - pStartMs
     }
+
+    // 从旧视频的截图归档复制到新视频的归档
+    await screenshotManager.copyScreenshots(oldHash, newHash, moves)
   }
 }
 
@@ -3,16 +3,19 @@ import fs from 'fs-extra'
 import log from 'electron-log'
 import { storageManager } from '../data'
 import { VideoTranscodeUtils } from '../utils'
+import type { TranscodeOptions } from '../utils/VideoTranscodeUtils'
 import { ipcMain } from 'electron'
 
 export class VideoTranscodeService {
   /**
    * 执行视频转码并替换原文件
    * @param sourcePath 视频绝对路径
+   * @param options 编码参数 (线程数等)
    */
   public async transcodeAndReplace(
     sourcePath: string,
-    onProgress?: (p: number) => void
+    onProgress?: (p: number) => void,
+    options?: TranscodeOptions
   ): Promise<{ success: boolean; error?: string }> {
     if (!(await fs.pathExists(sourcePath))) {
       throw new Error(`文件不存在: ${sourcePath}`)
@@ -40,7 +43,7 @@ export class VideoTranscodeService {
       await VideoTranscodeUtils.transcodeToH264(sourcePath, tempOutputPath, (progress) => {
         if (onProgress) onProgress(progress) // 透传给 QueueManager
         log.debug(`[TranscodeService] 进度: ${progress}% - ${fileName}`)
-      })
+      }, options)
 
       // 5. 物理文件流转
       // A. 将原视频移入“已转码”归档
@@ -7,3 +7,4 @@ export { registerFileSytemHandlers } from './FileSystemService'
 export { registerVideoTranscodeHandlers } from './VideoTranscodeService'
 export { registerTranscodeHandlers } from './TranscodeQueueManager'
 export { registerStroyBoardServiceHandlers } from './StoryboardService'
+export { registerNearDuplicateHandlers } from './NearDuplicateService'
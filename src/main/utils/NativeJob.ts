@@ -0,0 +1,106 @@
+import koffi from 'koffi'
+import { nativeLib } from './ScreenshotGenerator'
+
+// ==========================================
+// C++ 异步任务 (core/Job.h)
+// *_submit 提交后立即返回任务编号，这里定时轮询进度直到结束，不占用 Koffi / libuv 的工作线程
+// ==========================================
+
+// 与 C++ JobState 一致
+const JOB_STATE_DONE = 2
+const JOB_STATE_CANCELLED = 3
+
+const DEFAULT_POLL_INTERVAL_MS = 100
+
+export interface NativeJobProgress {
+  /** 已完成的工作量 (单位由任务决定: 截图张数 / 视频数 / 输出毫秒数) */
+  done: number
+  /** 总工作量，0 表示未知 */
+  total: number
+  frames: number
+  bytes: number
+  /** 0-100 */
+  percent: number
+}
+
+export interface NativeJobOptions {
+  onProgress?: (progress: NativeJobProgress) => void
+  /** 中止时取消 C++ 任务 (读包粒度生效)，Promise 以 AbortError 拒绝 */
+  signal?: AbortSignal
+  pollIntervalMs?: number
+  /** 任务成功结束、释放之前调用，用于读取任务的附加输出 (例如 screenshot_job_actual_ms) */
+  onFinished?: (jobId: number) => void
+}
+
+// ScreenshotGenerator 加载 DLL 时会引用本模块，绑定推迟到第一次使用
+let bindings: { poll: any; cancel: any; release: any } | null = null
+
+function getBindings() {
+  if (!bindings) {
+    koffi.struct('JobProgress', {
+      state: 'int',
+      result: 'int',
+      done: 'int64',
+      total: 'int64',
+      frames: 'int64',
+      bytes: 'int64',
+      percent: 'double'
+    })
+    bindings = {
+      poll: nativeLib.func('int job_poll(longlong job_id, _Out_ JobProgress* out)'),
+      cancel: nativeLib.func('int job_cancel(longlong job_id)'),
+      release: nativeLib.func('void job_release(longlong job_id)')
+    }
+  }
+  return bindings
+}
+
+function abortError(): Error {
+  const error = new Error('Native job cancelled')
+  error.name = 'AbortError'
+  return error
+}
+
+/**
+ * 等待 C++ 任务结束并释放，返回任务结果 (与对应同步函数的返回值相同)
+ */
+export function runNativeJob(jobId: number, options: NativeJobOptions = {}): Promise<number> {
+  const { poll, cancel, release } = getBindings()
+  if (jobId < 0) return Promise.reject(new Error(`C++ submit failed with code ${jobId}`))
+
+  const onAbort = () => cancel(jobId)
+  if (options.signal) {
+    if (options.signal.aborted) cancel(jobId)
+    else options.signal.addEventListener('abort', onAbort, { once: true })
+  }
+
+  return new Promise((resolve, reject) => {
+    const tick = () => {
+      const progress: any = {}
+      const state = poll(jobId, progress)
+
+      if (state >= 0 && options.onProgress) {
+        options.onProgress({
+          done: Number(progress.done),
+          total: Number(progress.total),
+          frames: Number(progress.frames),
+          bytes: Number(progress.bytes),
+          percent: progress.percent
+        })
+      }
+
+      if (state >= 0 && state < JOB_STATE_DONE) {
+        setTimeout(tick, options.pollIntervalMs ?? DEFAULT_POLL_INTERVAL_MS)
+        return
+      }
+
+      options.signal?.removeEventListener('abort', onAbort)
+      if (state === JOB_STATE_DONE) options.onFinished?.(jobId)
+      release(jobId)
+      if (state < 0) reject(new Error(`Native job ${jobId} not found`))
+      else if (state === JOB_STATE_CANCELLED) reject(abortError())
+      else resolve(progress.result)
+    }
+    tick()
+  })
+}
@@ -3,6 +3,7 @@ import * as fs from 'fs'
 import { app } from 'electron'
 import koffi from 'koffi'
 import type { VideoMetadata } from '../../shared/models'
+import { runNativeJob, type NativeJobOptions } from './NativeJob'
 
 // ==========================================
 // 1. DLL 路径查找与加载 (核心修复)
@@ -40,12 +41,98 @@ try {
   throw error
 }
 
+// 其它模块 (hash 等) 的原生函数绑定共用同一个 DLL 句柄
+export { lib as nativeLib }
+
 const VideoInfoResult = koffi.struct('VideoInfoResult', {
   duration_ms: 'int64',
   width: 'int',
   height: 'int',
   framerate: 'double',
-  success: 'int'
+  success: 'int',
+  rotation: 'int',
+  bit_rate: 'int64',
+  video_codec_id: 'int',
+  profile: 'int',
+  pixel_format: 'int',
+  has_audio: 'int',
+  audio_codec_id: 'int',
+  video_codec: 'char[32]',
+  pixel_format_name: 'char[32]',
+  audio_codec: 'char[32]'
+})
+
+// 与 C++ VideoProbeFlags 一致
+const VIDEO_PROBE_FAST = 1
+
+const EMPTY_METADATA: VideoMetadata = { duration: 0, width: 0, height: 0, framerate: 0 }
+
+// Koffi 解析后的 VideoInfoResult -> VideoMetadata (int64 可能为 BigInt，统一转 Number)
+function toVideoMetadata(res: any): VideoMetadata {
+  return {
+    // C++ 返回的是 ms，除以 1000 转为秒
+    duration: Number(res.duration_ms) / 1000,
+    width: res.width,
+    height: res.height,
+    framerate: res.framerate,
+    codec: res.video_codec,
+    profile: res.profile,
+    pixelFormat: res.pixel_format_name,
+    bitRate: Number(res.bit_rate),
+    rotation: res.rotation as VideoMetadata['rotation'],
+    hasAudio: res.has_audio === 1,
+    audioCodec: res.audio_codec
+  }
+}
+
+const ScreenshotOutputOptionsNative = koffi.struct('ScreenshotOutputOptions', {
+  max_width: 'int',
+  max_height: 'int',
+  crop_x: 'int',
+  crop_y: 'int',
+  crop_width: 'int',
+  crop_height: 'int',
+  rotation: 'int',
+  quality: 'int',
+  speed_preset: 'int'
+})
+
+const ScreenshotOptionsNative = koffi.struct('ScreenshotOptions', {
+  seek_mode: 'int',
+  tolerance_ms: 'int64',
+  parallel_decoders: 'int',
+  output: ScreenshotOutputOptionsNative,
+  priority: 'int',
+  select_mode: 'int'
+})
+
+const FrameMemoryStatsNative = koffi.struct('FrameMemoryStats', {
+  budget_bytes: 'int64',
+  in_use_bytes: 'int64',
+  peak_bytes: 'int64',
+  cached_bytes: 'int64',
+  waits: 'int'
+})
+
+const StoryboardLayoutNative = koffi.struct('StoryboardLayout', {
+  canvas_width: 'int',
+  canvas_height: 'int',
+  columns: 'int',
+  border: 'int',
+  photo_scale: 'double',
+  max_rotation_deg: 'double',
+  jitter: 'double',
+  seed: 'uint32',
+  background_rgb: 'uint32',
+  quality: 'int'
+})
+
+const TrickplayOptionsNative = koffi.struct('TrickplayOptions', {
+  interval_ms: 'int',
+  tile_width: 'int',
+  columns: 'int',
+  rows: 'int',
+  quality: 'int'
 })
 
 // ==========================================
@@ -56,21 +143,118 @@ const funcGetVideoDuration = lib.func('longlong get_video_duration(str video_pat
 const funcGenerateScreenshot = lib.func(
   'int generate_screenshot(str video_path, longlong timestamp_ms, str output_path)'
 )
-const funcGeneratePercent = lib.func(
-  'int generate_screenshot_at_percentage(str video_path, double percentage, str output_path)'
+const funcGenerateScreenshotEx = lib.func(
+  'int generate_screenshot_ex(str video_path, longlong timestamp_ms, str output_path, ScreenshotOptions* options, _Out_ longlong* out_actual_ms)'
+)
+const funcGeneratePercentEx = lib.func(
+  'int generate_screenshot_at_percentage_ex(str video_path, double percentage, str output_path, ScreenshotOptions* options)'
+)
+const funcSubmitBatch = lib.func(
+  'longlong generate_screenshots_for_video_submit(str video_path, longlong* timestamps_ms, int count, str output_path_template, ScreenshotOptions* options)'
 )
-const funcGenerateBatch = lib.func(
-  'int generate_screenshots_for_video(str video_path, longlong* timestamps_ms, int count, str output_path_template)'
+const funcScreenshotJobActualMs = lib.func(
+  'int screenshot_job_actual_ms(longlong job_id, longlong* out_actual_ms, int capacity)'
 )
 const funcGenerateMultiVideos = lib.func(
   'int generate_screenshots_for_videos(str* video_paths, int count, longlong timestamp_ms, str output_dir)'
 )
 const funcGetVideoMetadata = lib.func('VideoInfoResult get_video_metadata(str video_path)')
+const funcMediaIndexOpen = lib.func('int media_index_open(str index_path)')
+const MetadataProgress = koffi.proto('void MetadataProgressCallback(int processed, int total)')
+const funcGetVideoMetadataBatch = lib.func(
+  'int get_video_metadata_batch(str* video_paths, int count, int flags, VideoInfoResult* out_results, MetadataProgressCallback* progress)'
+)
+const funcMediaCacheEvict = lib.func('void media_cache_evict(str video_path)')
+const funcGetKeyframes = lib.func(
+  'int get_keyframes(str video_path, longlong* out_array, int capacity)'
+)
+const funcThreadPoolConfigure = lib.func('void thread_pool_configure(int cpu_budget)')
+const funcThreadPoolCpuBudget = lib.func('int thread_pool_cpu_budget()')
+const funcFrameMemoryConfigure = lib.func('void frame_memory_configure(longlong budget_bytes)')
+const funcFrameMemoryGetStats = lib.func('void frame_memory_get_stats(_Out_ FrameMemoryStats* out_stats)')
+const funcFrameMemoryResetPeak = lib.func('void frame_memory_reset_peak()')
+const funcConvertImageFile = lib.func(
+  'int convert_image_file(str input_path, str output_path, ScreenshotOutputOptions* output)'
+)
+const funcGenerateTrickplay = lib.func(
+  'int generate_trickplay(str video_path, str output_dir, TrickplayOptions* options)'
+)
+const funcStoryboardLayoutInit = lib.func('void storyboard_layout_init(_Out_ StoryboardLayout* layout)')
+const funcComposeStoryboard = lib.func(
+  'int compose_storyboard(str* image_paths, int count, StoryboardLayout* layout, uint8* out_buffer, int capacity)'
+)
 
 // ==========================================
 // 3. 业务类定义
 // ==========================================
 
+/**
+ * 截图定位模式 (与 C++ ScreenshotSeekMode 一致)
+ * - exact: 精确到请求的时间点
+ * - keyframe: 最近的关键帧，只解码一个 I 帧 (封面 / 网格缩略图)
+ * - tolerance: 请求时间点前 toleranceMs 内的第一帧
+ */
+export type ScreenshotSeekMode = 'exact' | 'keyframe' | 'tolerance'
+
+export interface ScreenshotSeekOptions {
+  mode: ScreenshotSeekMode
+  toleranceMs?: number
+}
+
+/**
+ * 输出图片选项 (与 C++ ScreenshotOutputOptions 一致)
+ * 裁剪、缩放、旋转在 C++ 端一次转换中完成，不需要再经过 sharp
+ */
+export interface ScreenshotOutputSettings {
+  /** 旋转后的最大宽高，等比缩放，不放大 */
+  maxWidth?: number
+  maxHeight?: number
+  /** 裁剪矩形 (源帧像素坐标) */
+  crop?: { x: number; y: number; width: number; height: number }
+  /** 顺时针旋转角度 */
+  rotation?: 0 | 90 | 180 | 270
+  /** 0-100，用于 webp / jpg */
+  quality?: number
+  speed?: 'fast' | 'balanced' | 'best'
+}
+
+function toNativeOutputOptions(output?: ScreenshotOutputSettings) {
+  const speeds = { fast: 0, balanced: 1, best: 2 }
+  return {
+    max_width: Math.floor(output?.maxWidth ?? 0),
+    max_height: Math.floor(output?.maxHeight ?? 0),
+    crop_x: Math.floor(output?.crop?.x ?? 0),
+    crop_y: Math.floor(output?.crop?.y ?? 0),
+    crop_width: Math.floor(output?.crop?.width ?? 0),
+    crop_height: Math.floor(output?.crop?.height ?? 0),
+    rotation: output?.rotation ?? 0,
+    quality: Math.floor(output?.quality ?? -1),
+    speed_preset: speeds[output?.speed ?? 'balanced']
+  }
+}
+
+/**
+ * C++ 线程池优先级: interactive 用于界面上等待的缩略图，background 用于批量刷新
+ * 后台任务不会占满线程池，交互任务总有线程可用
+ */
+export type ScreenshotPriority = 'interactive' | 'background'
+
+function toNativeSeekOptions(
+  seek?: ScreenshotSeekOptions,
+  output?: ScreenshotOutputSettings,
+  priority: ScreenshotPriority = 'interactive'
+) {
+  const modes: Record<ScreenshotSeekMode, number> = { exact: 0, keyframe: 1, tolerance: 2 }
+  return {
+    seek_mode: modes[seek?.mode ?? 'exact'],
+    tolerance_ms: Math.floor(seek?.toleranceMs ?? 0),
+    parallel_decoders: 0,
+    output: toNativeOutputOptions(output),
+    priority: priority === 'background' ? 1 : 0,
+    select_mode: 0
+  }
+}
+
 export interface ScreenshotOptions {
   outputDir: string
   filenamePrefix?: string
@@ -78,9 +262,171 @@ export interface ScreenshotOptions {
   // 如果不传，则默认使用 prefix_%ms
   filenamePattern?: string
   format?: 'webp' | 'png' | 'jpg'
+  output?: ScreenshotOutputSettings
+  priority?: ScreenshotPriority
+}
+
+/** 故事板拼贴布局 (与 C++ StoryboardLayout 一致) */
+export interface StoryboardLayoutSettings {
+  width: number
+  height: number
+  /** 0 = 自动 (超过 8 张为 4 列，否则 3 列) */
+  columns: number
+  /** 照片白边宽度 */
+  border: number
+  /** 随机旋转的最大角度 */
+  maxRotation: number
+  /** 随机种子，不传则每次随机 */
+  seed: number
+  quality: number
 }
 
 export class ScreenshotGenerator {
+  /**
+   * 释放 C++ 端缓存的已打开文件句柄。
+   * 移动 / 删除视频文件前调用，否则 Windows 上会提示文件被占用。
+   */
+  public static releaseFile(videoPath: string): void {
+    funcMediaCacheEvict(videoPath)
+  }
+
+  /**
+   * 设置 C++ 端线程池的 CPU 预算 (所有截图 / 转换任务共享)。
+   * @param cpuBudget 线程数，0 表示使用逻辑核数
+   */
+  public static configureThreadPool(cpuBudget: number): void {
+    funcThreadPoolConfigure(Math.max(0, Math.floor(cpuBudget)))
+  }
+
+  /**
+   * 当前线程池的 CPU 预算 (线程数)
+   */
+  public static getCpuBudget(): number {
+    return funcThreadPoolCpuBudget()
+  }
+
+  /**
+   * 设置批量截图在途帧的内存预算 (所有批量任务共享)，超出时 C++ 端解码循环阻塞等待。
+   * @param budgetBytes 字节数，0 表示默认值 (256 MB)
+   */
+  public static configureFrameMemory(budgetBytes: number): void {
+    funcFrameMemoryConfigure(Math.max(0, Math.floor(budgetBytes)))
+  }
+
+  /**
+   * 查询在途帧内存统计，用于调整预算。
+   * @param resetPeak 读取后重置峰值
+   */
+  public static getFrameMemoryStats(resetPeak = false): {
+    budgetBytes: number
+    inUseBytes: number
+    peakBytes: number
+    cachedBytes: number
+    waits: number
+  } {
+    const stats: any = {}
+    funcFrameMemoryGetStats(stats)
+    if (resetPeak) funcFrameMemoryResetPeak()
+    return {
+      budgetBytes: Number(stats.budget_bytes),
+      inUseBytes: Number(stats.in_use_bytes),
+      peakBytes: Number(stats.peak_bytes),
+      cachedBytes: Number(stats.cached_bytes),
+      waits: stats.waits
+    }
+  }
+
+  /**
+   * 按输出选项转换已有图片 (旋转 / 缩放 / 裁剪)，输出格式由 outputPath 后缀决定。
+   */
+  public static async convertImage(
+    inputPath: string,
+    outputPath: string,
+    output: ScreenshotOutputSettings
+  ): Promise<void> {
+    return new Promise((resolve, reject) => {
+      funcConvertImageFile.async(
+        inputPath,
+        outputPath,
+        toNativeOutputOptions(output),
+        (err: any, res: number) => {
+          if (err) return reject(err)
+          if (res !== 0) return reject(new Error(`C++ failed with code ${res}`))
+          resolve()
+        }
+      )
+    })
+  }
+
+  /**
+   * 把多张截图合成为故事板拼贴图，返回 WebP 数据。
+   * 布局未指定的字段使用 C++ 默认值 (1920x1080，白边 16，±13 度随机旋转)。
+   */
+  public static async composeStoryboard(
+    imagePaths: string[],
+    layout: Partial<StoryboardLayoutSettings> = {}
+  ): Promise<Buffer> {
+    const native: any = {}
+    funcStoryboardLayoutInit(native)
+    if (layout.width !== undefined) native.canvas_width = layout.width
+    if (layout.height !== undefined) native.canvas_height = layout.height
+    if (layout.columns !== undefined) native.columns = layout.columns
+    if (layout.border !== undefined) native.border = layout.border
+    if (layout.maxRotation !== undefined) native.max_rotation_deg = layout.maxRotation
+    if (layout.quality !== undefined) native.quality = layout.quality
+    native.seed = layout.seed ?? Math.floor(Math.random() * 0xffffffff)
+
+    const call = (buffer: Buffer, capacity: number): Promise<number> =>
+      new Promise((resolve, reject) => {
+        funcComposeStoryboard.async(
+          imagePaths,
+          imagePaths.length,
+          native,
+          buffer,
+          capacity,
+          (err: any, res: number) => {
+            if (err) return reject(err)
+            if (res < 0) return reject(new Error(`C++ failed with code ${res}`))
+            resolve(res)
+          }
+        )
+      })
+
+    // 有损 WebP 远小于画布像素数，一般一次即可；不够时按返回的大小重试 (同一种子结果相同)
+    let buffer = Buffer.alloc(native.canvas_width * native.canvas_height)
+    let size = await call(buffer, buffer.length)
+    if (size > buffer.length) {
+      buffer = Buffer.alloc(size)
+      size = await call(buffer, buffer.length)
+    }
+    return buffer.subarray(0, size)
+  }
+
+  /**
+   * 生成进度条悬停预览的雪碧图与索引 (sheet_NNN.webp + index.bin，格式见 Trickplay.h)。
+   * 只解码关键帧，返回索引条目数。
+   */
+  public static async generateTrickplay(
+    videoPath: string,
+    outputDir: string,
+    options: { intervalMs?: number; tileWidth?: number; columns?: number; rows?: number } = {}
+  ): Promise<number> {
+    const native = {
+      interval_ms: Math.floor(options.intervalMs ?? 0),
+      tile_width: Math.floor(options.tileWidth ?? 0),
+      columns: Math.floor(options.columns ?? 0),
+      rows: Math.floor(options.rows ?? 0),
+      quality: 0
+    }
+    return new Promise((resolve, reject) => {
+      funcGenerateTrickplay.async(videoPath, outputDir, native, (err: any, res: number) => {
+        if (err) return reject(err)
+        if (res < 0) return reject(new Error(`C++ failed with code ${res}`))
+        resolve(res)
+      })
+    })
+  }
+
   public static async getVideoDuration(videoPath: string): Promise<number> {
     return new Promise((resolve, reject) => {
       funcGetVideoDuration.async(videoPath, (err: any, res: number) => {
@@ -91,6 +437,16 @@ export class ScreenshotGenerator {
     })
   }
 
+  /**
+   * 打开持久化媒体索引 (启动时调用一次)。之后元数据、关键帧、截图调用先查询索引，
+   * 命中时不再打开视频文件。打开失败不影响其它功能。
+   */
+  public static openMediaIndex(indexPath: string): boolean {
+    const res = funcMediaIndexOpen(indexPath)
+    if (res !== 0) console.error(`[ScreenshotGenerator] media_index_open failed (${res}): ${indexPath}`)
+    return res === 0
+  }
+
   // [新增] 获取完整元数据
   public static async getVideoMetadata(videoPath: string): Promise<VideoMetadata> {
     return new Promise((resolve, reject) => {
@@ -99,27 +455,82 @@ export class ScreenshotGenerator {
         if (err) {
           console.error('C++ Error:', err)
           // 出错时返回默认安全值
-          return resolve({ duration: 0, width: 0, height: 0, framerate: 0 })
+          return resolve({ ...EMPTY_METADATA })
         }
 
-        // res 是 Koffi 解析后的 JS 对象
-        if (res.success === 1) {
-          resolve({
-            // C++ 返回的是 ms (long long -> BigInt/Number)，除以 1000 转为秒
-            // Koffi 默认处理 int64 可能为 BigInt，这里转 Number 比较安全
-            duration: Number(res.duration_ms) / 1000,
-            width: res.width,
-            height: res.height,
-            framerate: res.framerate
-          })
-        } else {
-          // C++ 内部打开失败
-          resolve({ duration: 0, width: 0, height: 0, framerate: 0 })
-        }
+        // res 是 Koffi 解析后的 JS 对象；C++ 内部打开失败时 success = 0
+        resolve(res.success === 1 ? toVideoMetadata(res) : { ...EMPTY_METADATA })
       })
     })
   }
 
+  /**
+   * 批量获取元数据：一次原生调用，在 C++ I/O 线程上并发探测整个列表。
+   * 使用快速探测 (限制读取量，容器头足够时不解码)。结果与 paths 一一对应，失败的文件为 null。
+   */
+  public static async getVideoMetadataBatch(
+    paths: string[],
+    onProgress?: (processed: number, total: number) => void
+  ): Promise<Array<VideoMetadata | null>> {
+    if (paths.length === 0) return []
+
+    const output = Buffer.alloc(koffi.sizeof(VideoInfoResult) * paths.length)
+    const callback = onProgress
+      ? koffi.register(onProgress, koffi.pointer(MetadataProgress))
+      : null
+
+    try {
+      await new Promise<void>((resolve, reject) => {
+        funcGetVideoMetadataBatch.async(
+          paths,
+          paths.length,
+          VIDEO_PROBE_FAST,
+          output,
+          callback,
+          (err: any, res: number) => {
+            if (err) return reject(err)
+            if (res < 0) return reject(new Error(`C++ failed with code ${res}`))
+            resolve()
+          }
+        )
+      })
+    } finally {
+      if (callback) koffi.unregister(callback)
+    }
+
+    const results: any[] = koffi.decode(output, VideoInfoResult, paths.length)
+    return results.map((res) => (res.success === 1 ? toVideoMetadata(res) : null))
+  }
+
+  /**
+   * 获取视频全部关键帧时间戳（秒，升序）。
+   * C++ 端优先读取容器索引，无索引时只扫描数据包、不解码。
+   */
+  public static async getKeyframes(videoPath: string): Promise<number[]> {
+    const call = (buffer: BigInt64Array | null, capacity: number): Promise<number> =>
+      new Promise((resolve, reject) => {
+        funcGetKeyframes.async(videoPath, buffer, capacity, (err: any, res: number) => {
+          if (err) return reject(err)
+          if (res < 0) return reject(new Error('Failed to get keyframes via C++.'))
+          resolve(res)
+        })
+      })
+
+    // 先按常见规模分配，不够时按返回的总数重试 (第二次命中 C++ 端缓存)
+    let buffer = new BigInt64Array(4096)
+    let total = await call(buffer, buffer.length)
+    if (total > buffer.length) {
+      buffer = new BigInt64Array(total)
+      total = Math.min(await call(buffer, buffer.length), buffer.length)
+    }
+
+    const result: number[] = new Array(total)
+    for (let i = 0; i < total; i++) {
+      result[i] = Number(buffer[i]) / 1000
+    }
+    return result
+  }
+
   /**
    * [修改] 现在支持直接传入完整的 outputPath，不再强制只能传 outputDir
    * 如果传入的是目录，则自动生成文件名；如果传入的是文件路径，则直接使用。
@@ -127,7 +538,9 @@ export class ScreenshotGenerator {
   public static async generateScreenshotAtTimestamp(
     videoPath: string,
     timestampInSeconds: number,
-    targetPathOrDir: string // 参数名改了，逻辑更灵活
+    targetPathOrDir: string, // 参数名改了，逻辑更灵活
+    seek?: ScreenshotSeekOptions,
+    output?: ScreenshotOutputSettings
   ): Promise<string> {
     let outputPath = targetPathOrDir
 
@@ -144,11 +557,25 @@ export class ScreenshotGenerator {
     const timestampMs = Math.floor(timestampInSeconds * 1000)
 
     return new Promise((resolve, reject) => {
-      funcGenerateScreenshot.async(videoPath, timestampMs, outputPath, (err: any, res: number) => {
+      const done = (err: any, res: number) => {
         if (err) return reject(err)
         if (res === 0) resolve(outputPath)
         else reject(new Error(`C++ failed with code ${res}`))
-      })
+      }
+
+      if ((!seek || seek.mode === 'exact') && !output) {
+        funcGenerateScreenshot.async(videoPath, timestampMs, outputPath, done)
+      } else {
+        const actual = [0]
+        funcGenerateScreenshotEx.async(
+          videoPath,
+          timestampMs,
+          outputPath,
+          toNativeSeekOptions(seek, output),
+          actual,
+          done
+        )
+      }
     })
   }
 
@@ -169,20 +596,85 @@ export class ScreenshotGenerator {
       const outputPath = path.join(options.outputDir, filename)
 
       return new Promise((resolve) => {
-        funcGeneratePercent.async(videoPath, percentage, outputPath, (err: any, res: number) => {
-          if (err || res !== 0) resolve(null)
-          else resolve(outputPath)
-        })
+        funcGeneratePercentEx.async(
+          videoPath,
+          percentage,
+          outputPath,
+          toNativeSeekOptions(undefined, options.output, options.priority),
+          (err: any, res: number) => {
+            if (err || res !== 0) resolve(null)
+            else resolve(outputPath)
+          }
+        )
       })
     } catch (e) {
       return null
     }
   }
 
+  /**
+   * 批量截图写入截图归档 (.gra，WebP，键为请求的毫秒时间戳)
+   * @param job 进度回调 / 中止信号 (中止时以 AbortError 拒绝)
+   * @returns 成功写入的数量
+   */
+  public static async generateScreenshotsToArchive(
+    videoPath: string,
+    timestampsMs: number[],
+    archivePath: string,
+    seek?: ScreenshotSeekOptions,
+    output?: ScreenshotOutputSettings,
+    priority: ScreenshotPriority = 'interactive',
+    job?: NativeJobOptions
+  ): Promise<number> {
+    if (timestampsMs.length === 0) return 0
+    await fs.promises.mkdir(path.dirname(archivePath), { recursive: true })
+
+    const jobId = funcSubmitBatch(
+      videoPath,
+      timestampsMs,
+      timestampsMs.length,
+      archivePath,
+      toNativeSeekOptions(seek, output, priority)
+    )
+    const successCount = await runNativeJob(Number(jobId), job)
+    if (successCount < 0) throw new Error(`C++ failed with code ${successCount}`)
+    return successCount
+  }
+
+  /**
+   * 按镜头切换挑选 count 张截图写入截图归档: 时间轴等分为 count 段，
+   * 每段取切换最明显的新镜头第一帧 (没有切换的段取中点)。只解码关键帧做分析
+   * @returns 实际截图的时间点 (毫秒，升序，键与归档一致)；失败的截图不在结果中
+   */
+  public static async generateSceneScreenshotsToArchive(
+    videoPath: string,
+    count: number,
+    archivePath: string,
+    output?: ScreenshotOutputSettings,
+    priority: ScreenshotPriority = 'background',
+    job?: NativeJobOptions
+  ): Promise<number[]> {
+    if (count <= 0) return []
+    await fs.promises.mkdir(path.dirname(archivePath), { recursive: true })
+
+    const options = toNativeSeekOptions({ mode: 'keyframe' }, output, priority)
+    options.select_mode = 1
+    const jobId = funcSubmitBatch(videoPath, null, count, archivePath, options)
+
+    const actualMs = new BigInt64Array(count)
+    const successCount = await runNativeJob(Number(jobId), {
+      ...job,
+      onFinished: (id) => funcScreenshotJobActualMs(id, actualMs, count)
+    })
+    if (successCount < 0) throw new Error(`C++ failed with code ${successCount}`)
+    return Array.from(actualMs, Number).filter((ms) => ms >= 0)
+  }
+
   public static async generateMultipleScreenshots(
     videoPath: string,
     timestamps: number[],
-    options: ScreenshotOptions
+    options: ScreenshotOptions,
+    job?: NativeJobOptions
   ): Promise<string[]> {
     if (!timestamps || timestamps.length === 0) return []
 
@@ -204,25 +696,23 @@ export class ScreenshotGenerator {
 
     const fullPathTemplate = path.join(options.outputDir, filenameTemplateStr)
 
-    return new Promise((resolve, reject) => {
-      funcGenerateBatch.async(
-        videoPath,
-        timestampsMs,
-        timestampsMs.length,
-        fullPathTemplate,
-        (err: any, successCount: number) => {
-          if (err) return reject(err)
-          const resultPaths: string[] = []
-          if (successCount > 0) {
-            // 根据模板反向生成文件名列表，供前端使用
-            timestampsMs.forEach((ts) => {
-              const finalName = filenameTemplateStr.replace('%ms', ts.toString())
-              resultPaths.push(path.join(options.outputDir, finalName))
-            })
-          }
-          resolve(resultPaths)
-        }
-      )
-    })
+    const jobId = funcSubmitBatch(
+      videoPath,
+      timestampsMs,
+      timestampsMs.length,
+      fullPathTemplate,
+      toNativeSeekOptions(undefined, options.output, options.priority ?? 'background')
+    )
+    const successCount = await runNativeJob(Number(jobId), job)
+
+    const resultPaths: string[] = []
+    if (successCount > 0) {
+      // 根据模板反向生成文件名列表，供前端使用
+      timestampsMs.forEach((ts) => {
+        const finalName = filenameTemplateStr.replace('%ms', ts.toString())
+        resultPaths.push(path.join(options.outputDir, finalName))
+      })
+    }
+    return resultPaths
   }
 }
@@ -0,0 +1,91 @@
+import koffi from 'koffi'
+import { nativeLib } from './ScreenshotGenerator'
+
+// ==========================================
+// 截图归档 (C++ thumb_archive)
+// 一个视频的全部截图打包在一个 .gra 文件里，键为截图时间戳 (毫秒)
+// ==========================================
+
+const ThumbArchiveEntryNative = koffi.struct('ThumbArchiveEntry', {
+  key: 'longlong',
+  offset: 'longlong',
+  size: 'int',
+  reserved: 'int'
+})
+koffi.opaque('ThumbArchive')
+
+const funcOpen = nativeLib.func('ThumbArchive* thumb_archive_open(str archive_path)')
+const funcClose = nativeLib.func('void thumb_archive_close(ThumbArchive* archive)')
+const funcCount = nativeLib.func('int thumb_archive_count(ThumbArchive* archive)')
+const funcEntries = nativeLib.func('const ThumbArchiveEntry* thumb_archive_entries(ThumbArchive* archive)')
+const funcFind = nativeLib.func('int thumb_archive_find(ThumbArchive* archive, longlong key)')
+const funcData = nativeLib.func(
+  'const uint8_t* thumb_archive_data(ThumbArchive* archive, int index, _Out_ int* out_size)'
+)
+const funcPut = nativeLib.func(
+  'int thumb_archive_put(str archive_path, longlong key, const uint8_t* data, int size)'
+)
+const funcDelete = nativeLib.func(
+  'int thumb_archive_delete(str archive_path, const longlong* keys, int count)'
+)
+
+export class ThumbArchive {
+  /**
+   * 以只读方式打开归档执行 fn，结束后关闭 (归档不存在时返回 fallback)
+   * 读取端是 mmap，打开 / 关闭都很便宜
+   */
+  private static withArchive<T>(archivePath: string, fallback: T, fn: (archive: any) => T): T {
+    const archive = funcOpen(archivePath)
+    if (!archive) return fallback
+    try {
+      return fn(archive)
+    } finally {
+      funcClose(archive)
+    }
+  }
+
+  /** 全部键 (升序) */
+  public static keys(archivePath: string): number[] {
+    return this.withArchive(archivePath, [], (archive) => {
+      const count = funcCount(archive)
+      if (count <= 0) return []
+      const entries = koffi.decode(funcEntries(archive), ThumbArchiveEntryNative, count)
+      return entries.map((e: any) => Number(e.key))
+    })
+  }
+
+  /** 读取一项 (拷贝出来，归档关闭后仍然有效)，不存在时返回 null */
+  public static read(archivePath: string, key: number): Buffer | null {
+    return this.withArchive<Buffer | null>(archivePath, null, (archive) => {
+      const index = funcFind(archive, key)
+      if (index < 0) return null
+      const size = [0]
+      const ptr = funcData(archive, index, size)
+      if (!ptr || size[0] <= 0) return null
+      return Buffer.from(new Uint8Array(koffi.view(ptr, size[0])))
+    })
+  }
+
+  /** 写入一项 (键已存在时替换) */
+  public static async put(archivePath: string, key: number, data: Buffer): Promise<void> {
+    return new Promise((resolve, reject) => {
+      funcPut.async(archivePath, key, data, data.length, (err: any, res: number) => {
+        if (err) return reject(err)
+        if (res !== 0) return reject(new Error(`C++ failed with code ${res}`))
+        resolve()
+      })
+    })
+  }
+
+  /** 删除若干键，返回实际删除的数量 */
+  public static async delete(archivePath: string, keys: number[]): Promise<number> {
+    if (keys.length === 0) return 0
+    return new Promise((resolve, reject) => {
+      funcDelete.async(archivePath, keys, keys.length, (err: any, res: number) => {
+        if (err) return reject(err)
+        if (res < 0) return reject(new Error(`C++ failed with code ${res}`))
+        resolve(res)
+      })
+    })
+  }
+}
@@ -0,0 +1,106 @@
+import koffi from 'koffi'
+import { nativeLib } from './ScreenshotGenerator'
+
+// ==========================================
+// 分片 MP4 实时换封装 (C++ video_stream)
+// H.264 + AAC / MP3 的 MKV / AVI / TS 不转码、不落盘，边读源文件边输出可直接播放的 fMP4
+// 播放器尚未接入: 接入时通过流式协议 + MSE 提供 (输出不支持 Range，seek 时从新起点重新打开)
+// ==========================================
+
+koffi.struct('TransmuxInfo', {
+  start_ms: 'longlong',
+  duration_ms: 'longlong',
+  width: 'int',
+  height: 'int',
+  has_audio: 'int',
+  codecs: 'char[64]'
+})
+koffi.opaque('TransmuxStream')
+
+const funcOpen = nativeLib.func(
+  'TransmuxStream* transmux_open(str input_path, longlong start_ms, _Out_ TransmuxInfo* out_info)'
+)
+const funcRead = nativeLib.func(
+  'int transmux_read(TransmuxStream* stream, uint8* buffer, int capacity)'
+)
+const funcClose = nativeLib.func('void transmux_close(TransmuxStream* stream)')
+
+// 每次从 C++ 读取的字节数
+const READ_CHUNK_SIZE = 256 * 1024
+
+export interface TransmuxInfo {
+  /** 输出起点在源视频中的时间 (关键帧，毫秒)，输出的 0 秒对应此处 */
+  startMs: number
+  durationMs: number
+  width: number
+  height: number
+  hasAudio: boolean
+  /** RFC 6381 codecs，例如 avc1.64001F,mp4a.40.2 */
+  codecs: string
+}
+
+export class TransmuxStream {
+  /**
+   * 打开换封装流 (探测在 C++ 工作线程执行)
+   * @returns 视频编码不能直接播放或文件无法打开时返回 null
+   */
+  public static async open(
+    videoPath: string,
+    startMs = 0
+  ): Promise<{ info: TransmuxInfo; body: ReadableStream<Uint8Array> } | null> {
+    const native: any = {}
+    const handle = await new Promise<any>((resolve, reject) => {
+      funcOpen.async(videoPath, Math.max(0, Math.floor(startMs)), native, (err: any, res: any) =>
+        err ? reject(err) : resolve(res)
+      )
+    })
+    if (!handle) return null
+
+    const info: TransmuxInfo = {
+      startMs: Number(native.start_ms),
+      durationMs: Number(native.duration_ms),
+      width: native.width,
+      height: native.height,
+      hasAudio: native.has_audio !== 0,
+      codecs: native.codecs
+    }
+    return { info, body: this.createBody(handle) }
+  }
+
+  /**
+   * 按播放器的读取节奏从 C++ 取数据；流结束、出错或被取消时关闭 C++ 句柄
+   */
+  private static createBody(handle: any): ReadableStream<Uint8Array> {
+    let closed = false
+    let reading: Promise<void> = Promise.resolve()
+
+    const close = () => {
+      if (closed) return
+      closed = true
+      funcClose(handle)
+    }
+
+    return new ReadableStream<Uint8Array>({
+      pull: (controller) => {
+        reading = new Promise<void>((resolve) => {
+          const buffer = Buffer.allocUnsafe(READ_CHUNK_SIZE)
+          funcRead.async(handle, buffer, buffer.length, (err: any, n: number) => {
+            if (err || n < 0) {
+              close()
+              controller.error(err || new Error(`transmux_read failed with code ${n}`))
+            } else if (n === 0) {
+              close()
+              controller.close()
+            } else {
+              controller.enqueue(new Uint8Array(buffer.buffer, buffer.byteOffset, n))
+            }
+            resolve()
+          })
+        })
+        return reading
+      },
+      // 播放器放弃请求 (seek / 切换视频): 等进行中的读取结束后再关闭，句柄不能被并发使用
+      cancel: () => reading.then(close)
+    })
+  }
+}
@@ -0,0 +1,195 @@
+import koffi from 'koffi'
+import { nativeLib } from './ScreenshotGenerator'
+
+// ==========================================
+// 视频感知指纹与近似重复检索 (C++ fingerprint/VideoFingerprint.h)
+// 重新编码、换封装、裁剪出的副本字节哈希不同，但指纹相近
+// ==========================================
+
+/** 每个视频的采样帧数 (与 C++ FINGERPRINT_DEFAULT_FRAMES 一致) */
+const FINGERPRINT_FRAMES = 16
+
+const FingerprintMatch = koffi.struct('FingerprintMatch', {
+  video_id: 'longlong',
+  matched_frames: 'int',
+  candidate_frames: 'int',
+  similarity: 'double'
+})
+koffi.opaque('FingerprintIndex')
+
+const FingerprintProgress = koffi.proto('void FingerprintProgressCallback(int processed, int total)')
+const funcFingerprintBatch = nativeLib.func(
+  'int video_fingerprint_batch(str* video_paths, int count, int frame_count, uint64* out_hashes, int* out_counts, FingerprintProgressCallback* progress)'
+)
+const funcIndexCreate = nativeLib.func('FingerprintIndex* fingerprint_index_create()')
+const funcIndexDestroy = nativeLib.func('void fingerprint_index_destroy(FingerprintIndex* index)')
+const funcIndexAdd = nativeLib.func(
+  'int fingerprint_index_add(FingerprintIndex* index, longlong video_id, uint64* hashes, int count)'
+)
+const funcIndexRemove = nativeLib.func('int fingerprint_index_remove(FingerprintIndex* index, longlong video_id)')
+const funcIndexQuery = nativeLib.func(
+  'int fingerprint_index_query(FingerprintIndex* index, uint64* hashes, int count, int max_distance, double min_similarity, longlong exclude_id, FingerprintMatch* out_matches, int capacity)'
+)
+const funcIndexGroup = nativeLib.func(
+  'int fingerprint_index_group(FingerprintIndex* index, int max_distance, double min_similarity, longlong* out_ids, longlong* out_groups, int capacity)'
+)
+
+export interface NearDuplicateMatch {
+  key: string
+  /** 0-1，max(查询视频命中帧比例, 候选视频命中帧比例) */
+  similarity: number
+}
+
+/**
+ * 批量计算视频指纹 (结果缓存在 C++ 媒体索引中，未修改的文件不再解码)
+ * @returns 路径 -> 指纹；失败或没有有效画面的文件不在结果中
+ */
+export async function calculateFingerprintBatch(
+  videoPaths: string[],
+  onProgress?: (processed: number, total: number) => void
+): Promise<Map<string, BigUint64Array>> {
+  const results = new Map<string, BigUint64Array>()
+  if (videoPaths.length === 0) return results
+
+  const hashes = new BigUint64Array(videoPaths.length * FINGERPRINT_FRAMES)
+  const counts = new Int32Array(videoPaths.length)
+
+  const callback = onProgress
+    ? koffi.register((processed: number, total: number) => onProgress(processed, total), koffi.pointer(FingerprintProgress))
+    : null
+
+  try {
+    await new Promise<void>((resolve, reject) => {
+      funcFingerprintBatch.async(
+        videoPaths,
+        videoPaths.length,
+        FINGERPRINT_FRAMES,
+        hashes,
+        counts,
+        callback,
+        (err: any, res: number) => {
+          if (err) return reject(err)
+          if (res < 0) return reject(new Error(`C++ failed with code ${res}`))
+          resolve()
+        }
+      )
+    })
+  } finally {
+    if (callback) koffi.unregister(callback)
+  }
+
+  for (let i = 0; i < videoPaths.length; i++) {
+    if (counts[i] > 0) {
+      const start = i * FINGERPRINT_FRAMES
+      results.set(videoPaths[i], hashes.slice(start, start + counts[i]))
+    }
+  }
+  return results
+}
+
+/**
+ * 近似重复检索索引 (C++ multi-index hashing)，以字符串 key (例如文件快速哈希) 标识视频
+ * 不再使用时必须调用 dispose 释放 C++ 内存 (groupDuplicates 完成之后)
+ */
+export class NearDuplicateIndex {
+  private handle: any = funcIndexCreate()
+  private ids = new Map<string, number>()
+  private keys = new Map<number, string>()
+  private fingerprints = new Map<string, BigUint64Array>()
+  private nextId = 1
+
+  get size(): number {
+    return this.ids.size
+  }
+
+  /** 添加或替换视频指纹 */
+  add(key: string, fingerprint: BigUint64Array): void {
+    let id = this.ids.get(key)
+    if (id === undefined) {
+      id = this.nextId++
+      this.ids.set(key, id)
+      this.keys.set(id, key)
+    }
+    this.fingerprints.set(key, fingerprint)
+    funcIndexAdd(this.handle, id, fingerprint, fingerprint.length)
+  }
+
+  remove(key: string): void {
+    const id = this.ids.get(key)
+    if (id === undefined) return
+    funcIndexRemove(this.handle, id)
+    this.ids.delete(key)
+    this.keys.delete(id)
+    this.fingerprints.delete(key)
+  }
+
+  /**
+   * 查找与 key 近似重复的视频 (不含自身)，按相似度从高到低
+   * @param minSimilarity 最小相似度，默认 0.8
+   * @param maxResults 最多返回数量，默认 20
+   */
+  findSimilar(key: string, minSimilarity = 0.8, maxResults = 20): NearDuplicateMatch[] {
+    const fingerprint = this.fingerprints.get(key)
+    if (!fingerprint) return []
+
+    const output = Buffer.alloc(koffi.sizeof(FingerprintMatch) * maxResults)
+    const n = funcIndexQuery(
+      this.handle,
+      fingerprint,
+      fingerprint.length,
+      -1,
+      minSimilarity,
+      this.ids.get(key),
+      output,
+      maxResults
+    )
+    if (n <= 0) return []
+
+    const matches: any[] = koffi.decode(output, FingerprintMatch, n)
+
+    const results: NearDuplicateMatch[] = []
+    for (let i = 0; i < n; i++) {
+      const matchKey = this.keys.get(Number(matches[i].video_id))
+      if (matchKey) results.push({ key: matchKey, similarity: matches[i].similarity })
+    }
+    return results
+  }
+
+  /**
+   * 把互相近似重复的视频分组 (传递闭包)，只返回至少两个视频的组
+   * 全部查询在 C++ 线程池中一次完成，不阻塞主进程
+   */
+  async groupDuplicates(minSimilarity = 0.8): Promise<string[][]> {
+    const capacity = this.ids.size
+    if (capacity < 2) return []
+
+    const ids = new BigInt64Array(capacity)
+    const groupIds = new BigInt64Array(capacity)
+    const n: number = await new Promise((resolve, reject) => {
+      funcIndexGroup.async(this.handle, -1, minSimilarity, ids, groupIds, capacity, (err: any, res: number) => {
+        if (err) return reject(err)
+        if (res < 0) return reject(new Error(`C++ failed with code ${res}`))
+        resolve(res)
+      })
+    })
+
+    const groups = new Map<bigint, string[]>()
+    for (let i = 0; i < Math.min(n, capacity); i++) {
+      const key = this.keys.get(Number(ids[i]))
+      if (!key) continue
+      const group = groups.get(groupIds[i])
+      if (group) group.push(key)
+      else groups.set(groupIds[i], [key])
+    }
+    return [...groups.values()].filter((group) => group.length > 1)
+  }
+
+  dispose(): void {
+    if (!this.handle) return
+    funcIndexDestroy(this.handle)
+    this.handle = null
+    this.ids.clear()
+    this.keys.clear()
+    this.fingerprints.clear()
+  }
+}
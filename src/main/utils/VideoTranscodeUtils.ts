@@ -1,82 +1,99 @@
-import ffmpeg, { FfprobeData } from 'fluent-ffmpeg'
+import koffi from 'koffi'
 import log from 'electron-log'
+import { nativeLib } from './ScreenshotGenerator'
+import { runNativeJob } from './NativeJob'
 
 /**
  * 视频转码工具类
  */
 
+/**
+ * 转码选项 (与 C++ TranscodeOptions 一致)
+ */
+export interface TranscodeOptions {
+  /** x264 CRF，18-28 是常用范围，默认 23 */
+  crf?: number
+  /** x264 preset，默认 veryfast (在速度和压缩率之间取得良好平衡) */
+  preset?: string
+  /** 输出最大宽度 / 高度 (等比缩小，不放大)，默认不限制 */
+  maxWidth?: number
+  maxHeight?: number
+  /** AAC 码率 (bps)，默认 128000；源音频已是 AAC 时直接拷贝 */
+  audioBitrate?: number
+  /** 编解码线程数，默认按 CPU 预算和同时进行的转码任务数自动分配 */
+  threads?: number
+  /** 总是重新编码。默认在视频已是 H.264、音频是 AAC / MP3 时只流拷贝换封装 (秒级完成) */
+  forceEncode?: boolean
+  /** 中止时取消转码，Promise 以 AbortError 拒绝 */
+  signal?: AbortSignal
+}
+
+// C++ 绑定推迟到第一次转码时创建
+let funcTranscodeSubmit: any = null
+
+function getTranscodeSubmit() {
+  if (!funcTranscodeSubmit) {
+    koffi.struct('TranscodeOptions', {
+      crf: 'int',
+      preset: 'char[16]',
+      max_width: 'int',
+      max_height: 'int',
+      audio_bitrate: 'int',
+      threads: 'int',
+      force_encode: 'int'
+    })
+    funcTranscodeSubmit = nativeLib.func(
+      'longlong transcode_video_submit(str input_path, str output_path, TranscodeOptions* options)'
+    )
+  }
+  return funcTranscodeSubmit
+}
+
 export class VideoTranscodeUtils {
   /**
-   * 将视频转码为高兼容性的 MP4 格式 (H.264/AAC)
+   * 将视频转码为高兼容性的 MP4 格式 (H.264/AAC, yuv420p, moov 前置)
+   * 在 C++ 端进程内执行 (解复用 / 解码 / 缩放 / 编码流水线)，编解码线程从共享的 CPU 预算中分配；
+   * 编码已兼容、只是封装不兼容 (MKV / AVI / TS，或 moov 在末尾的 MP4) 时直接流拷贝
    * @param inputPath 输入视频的绝对路径
    * @param outputPath 输出视频的绝对路径
-   * @param onProgress 可选的回调函数，用于接收转码进度 (0-100)
+   * @param onProgress 可选的回调函数，用于接收转码进度 (0-100，按已编码的视频时间计算)
+   * @param options 可选的编码参数
    * @returns Promise<void> 在转码完成时 resolve，失败时 reject
    */
   public static async transcodeToH264(
     inputPath: string,
     outputPath: string,
-    onProgress?: (progress: number) => void
+    onProgress?: (progress: number) => void,
+    options: TranscodeOptions = {}
   ): Promise<void> {
-    // 首先获取总时长，用于计算进度
-    let totalDuration = 0
-    try {
-      const metadata = await new Promise<FfprobeData>((resolve, reject) => {
-        ffmpeg(inputPath).ffprobe((err, data) => {
-          if (err) return reject(err)
-          resolve(data)
-        })
-      })
-      totalDuration = metadata.format.duration || 0
-    } catch (error) {
-      log.warn(
-        `[Transcode] Could not get video duration for progress calculation for ${inputPath}:`,
-        error
-      )
+    const nativeOptions = {
+      crf: options.crf ?? -1,
+      preset: options.preset ?? 'veryfast',
+      max_width: options.maxWidth ?? 0,
+      max_height: options.maxHeight ?? 0,
+      audio_bitrate: options.audioBitrate ?? 0,
+      threads: options.threads ?? 0,
+      force_encode: options.forceEncode ? 1 : 0
     }
 
-    return new Promise((resolve, reject) => {
-      ffmpeg(inputPath)
-        .videoCodec('libx264') // H.264 视频编码器，兼容性最强
-        .audioCodec('aac') // AAC 音频编码器，标准选择
-        .format('mp4')
-        .outputOptions([
-          '-pix_fmt yuv420p', // 像素格式，确保颜色在所有设备上正确显示
-          '-preset veryfast', // 在速度和压缩率之间取得良好平衡
-          '-crf 23', // 恒定速率因子，控制视频质量。18-28 是常用范围，23 是很好的默认值
-          '-movflags +faststart' // 将 moov atom 提前，支持网络流式播放
-        ])
-        .on('error', (err, stdout, stderr) => {
-          // 记录更详细的错误日志
-          log.error(`[Transcode] Failed to transcode ${inputPath}:`, err.message)
-          log.error(`[Transcode] FFmpeg stdout:`, stdout)
-          log.error(`[Transcode] FFmpeg stderr:`, stderr)
-          reject(new Error(`转码失败: ${err.message}`))
-        })
-        .on('end', (stdout, stderr) => {
-          log.info(`[Transcode] Successfully transcoded ${inputPath} to ${outputPath}`)
-          log.debug(`[Transcode] FFmpeg stdout:`, stdout)
-          log.debug(`[Transcode] FFmpeg stderr:`, stderr)
-          resolve()
-        })
-        .on('progress', (progress) => {
-          if (onProgress && totalDuration > 0) {
-            // fluent-ffmpeg 的 progress.percent 字段有时不准确，我们手动计算
-            const timemark = progress.timemark // 格式通常是 "HH:MM:SS.ms"
-            const timeParts = timemark.split(':')
-            const seconds =
-              parseFloat(timeParts[0]) * 3600 +
-              parseFloat(timeParts[1]) * 60 +
-              parseFloat(timeParts[2])
-
-            if (!isNaN(seconds)) {
-              let percent = Math.floor((seconds / totalDuration) * 100)
-              percent = Math.min(100, Math.max(0, percent)) // 保证在 0-100 范围
-              onProgress(percent)
-            }
-          }
-        })
-        .save(outputPath)
+    const jobId = getTranscodeSubmit()(inputPath, outputPath, nativeOptions)
+    let lastPercent = -1
+    const result = await runNativeJob(jobId, {
+      signal: options.signal,
+      pollIntervalMs: 500,
+      onProgress: (progress) => {
+        const percent = Math.min(100, Math.max(0, Math.floor(progress.percent)))
+        if (onProgress && percent !== lastPercent) {
+          lastPercent = percent
+          onProgress(percent)
+        }
+      }
     })
+
+    if (result < 0) {
+      log.error(`[Transcode] Failed to transcode ${inputPath}: native error ${result}`)
+      throw new Error(`转码失败: 错误码 ${result}`)
+    }
+    log.info(`[Transcode] Successfully transcoded ${inputPath} to ${outputPath}`)
   }
 }
@@ -1,60 +1,16 @@
 import { spawn } from 'child_process'
-import { ffprobeFullPath } from './ffmpegConfig'
+import { ScreenshotGenerator } from './ScreenshotGenerator'
 
 /**
  * 视频处理工具类
  */
 export class VideoMetadataUtils {
   /**
-   * 获取视频所有关键帧的时间戳
+   * 获取视频所有关键帧的时间戳（秒，升序）
+   * 由 ffmpeg_extensions 读取容器索引，不再启动 ffprobe 逐包输出文本
    */
   static async getKeyframes(filePath: string): Promise<number[]> {
-    return new Promise((resolve, reject) => {
-      // 1. 还原你测试成功的参数：查 packet 级的 flags
-      const args = [
-        '-v',
-        'error',
-        '-select_streams',
-        'v:0',
-        '-show_entries',
-        'packet=pts_time,flags',
-        '-of',
-        'csv=p=0',
-        filePath
-      ]
-
-      const child = spawn(ffprobeFullPath, args)
-      let output = ''
-
-      child.stdout.on('data/data', (data) => {
-        output += data.toString()
-      })
-
-      child.on('close', (code) => {
-        if (code !== 0) {
-          reject(new Error(`ffprobe exited with code ${code}`))
-          return
-        }
-
-        // 2. 模拟 findstr "K" 的逻辑
-        const timestamps = output
-          .split('\n')
-          .map((line) => line.trim())
-          // 过滤出包含 ",K" 的行（CSV 格式下 flags 紧跟在时间后面）
-          .filter((line) => line.includes(',K'))
-          // 提取逗号前的时间戳部分
-          .map((line) => line.split(',')[0])
-          .map(Number)
-          .filter((n) => !isNaN(n))
-
-        // 3. 排序并返回
-        resolve(timestamps.sort((a, b) => a - b))
-      })
-
-      child.on('error', (err) => {
-        reject(err)
-      })
-    })
+    return ScreenshotGenerator.getKeyframes(filePath)
   }
 
   /**
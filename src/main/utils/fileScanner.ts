@@ -1,7 +1,8 @@
-import * as fs from 'fs/promises'
 import path from 'path'
-import { isVideoFile } from './videoUtils'
+import koffi from 'koffi'
 import log from 'electron-log'
+import { getSupportedExtensions } from './videoUtils'
+import { nativeLib } from './ScreenshotGenerator'
 
 /**
  * 物理文件扫描结果
@@ -14,13 +15,32 @@ export interface ScanResult {
   size: number // 文件大小 (bytes) - 用于校验缓存是否失效
 }
 
-/**
- * 扫描配置
- */
-const MAX_CONCURRENCY = 200 // 最大并发操作数
+// ==========================================
+// Koffi 绑定 (ffmpeg_extensions file_scan/FileScanner.h)
+// ==========================================
+const ScannedFileNative = koffi.struct('ScannedFile', {
+  path: 'str',
+  created_ms: 'double',
+  mtime_ms: 'double',
+  size: 'int64'
+})
+koffi.opaque('FileScanResult')
+
+const funcScanVideoFiles = nativeLib.func(
+  'FileScanResult* scan_video_files(str root_dir, str* blacklist, int blacklist_count, str* extensions, int extension_count)'
+)
+const funcFileScanCount = nativeLib.func('int file_scan_count(FileScanResult* result)')
+const funcFileScanEntries = nativeLib.func(
+  'ScannedFile* file_scan_entries(FileScanResult* result, int offset)'
+)
+const funcFileScanFree = nativeLib.func('void file_scan_free(FileScanResult* result)')
+
+// 每次从 C++ 结果中解码的条目数，避免一次生成过大的临时数组
+const DECODE_CHUNK = 8192
 
 /**
  * 扫描目录下的视频文件
+ * 目录遍历、类型判断、黑名单与扩展名过滤都在 C++ 线程池中完成，一次调用返回全部结果
  * @param rootDir 根目录
  * @param blacklist 排除列表 (绝对路径)
  */
@@ -28,82 +48,46 @@ export async function scanVideoFiles(
   rootDir: string,
   blacklist: string[] = []
 ): Promise<ScanResult[]> {
-  const results: ScanResult[] = []
-  const queue: (() => Promise<void>)[] = []
-  let activePromises = 0
-
-  const normalizedBlacklist = blacklist.map((p) => path.normalize(p).toLowerCase())
+  const normalizedBlacklist = blacklist.map((p) => path.normalize(p))
+  const extensions = getSupportedExtensions()
 
-  let resolveFinish: () => void
-  let rejectFinish: (error: Error) => void
-  const finishPromise = new Promise<void>((res, rej) => {
-    resolveFinish = res
-    rejectFinish = rej
-  })
-
-  const processQueue = async (): Promise<void> => {
-    while (queue.length > 0 && activePromises < MAX_CONCURRENCY) {
-      activePromises++
-      const task = queue.shift()
-      if (task) {
-        task()
-          .finally(() => {
-            activePromises--
-            processQueue()
-            if (activePromises === 0 && queue.length === 0) {
-              resolveFinish()
-            }
-          })
-          .catch((error) => {
-            log.error('Error in scan task:', error)
-            rejectFinish(error)
-          })
+  const handle = await new Promise<any>((resolve, reject) => {
+    funcScanVideoFiles.async(
+      path.normalize(rootDir),
+      normalizedBlacklist,
+      normalizedBlacklist.length,
+      extensions,
+      extensions.length,
+      (err: any, res: any) => {
+        if (err) return reject(err)
+        resolve(res)
       }
-    }
-  }
-
-  const isBlacklisted = (dirPath: string): boolean => {
-    const normalizedPath = path.normalize(dirPath).toLowerCase()
-    return normalizedBlacklist.some((blacklistedPath) => normalizedPath.startsWith(blacklistedPath))
-  }
-
-  const processDirectory = async (currentPath: string): Promise<void> => {
-    try {
-      if (isBlacklisted(currentPath)) return
-
-      const items = await fs.readdir(currentPath, { withFileTypes: true })
+    )
+  })
 
-      for (const item of items) {
-        const fullPath = path.join(currentPath, item.name)
+  try {
+    const count: number = funcFileScanCount(handle)
+    const results: ScanResult[] = new Array(count)
 
-        if (item.isDirectory()) {
-          queue.push(() => processDirectory(fullPath))
-        } else if (item.isFile() && isVideoFile(item.name)) {
-          try {
-            // 获取文件的详细统计信息
-            const stats = await fs.stat(fullPath)
-            results.push({
-              path: fullPath,
-              createdAt: stats.birthtimeMs,
-              mtime: stats.mtimeMs, // 关键属性：修改时间
-              size: stats.size // 关键属性：文件大小
-            })
-          } catch (error) {
-            log.warn(`Failed to stat file: ${fullPath}`, error)
-          }
+    for (let offset = 0; offset < count; offset += DECODE_CHUNK) {
+      const n = Math.min(DECODE_CHUNK, count - offset)
+      const entries = koffi.decode(funcFileScanEntries(handle, offset), ScannedFileNative, n)
+      for (let i = 0; i < n; i++) {
+        const entry = entries[i]
+        results[offset + i] = {
+          path: entry.path,
+          createdAt: entry.created_ms,
+          mtime: entry.mtime_ms, // 关键属性：修改时间
+          size: Number(entry.size) // 关键属性：文件大小
         }
       }
-    } catch (error) {
-      log.warn(`Failed to read directory: ${currentPath}`, error)
     }
-  }
 
-  // 开始递归
-  queue.push(() => processDirectory(rootDir))
-  processQueue()
-
-  await finishPromise
-  return results
+    log.info(`[fileScanner] Found ${count} video files under ${rootDir}`)
+    return results
+  } finally {
+    funcFileScanFree(handle)
+  }
 }
 
 /**
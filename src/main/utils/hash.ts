@@ -1,5 +1,7 @@
 import * as fs from 'fs/promises'
 import { constants } from 'fs'
+import koffi from 'koffi'
+import { nativeLib } from './ScreenshotGenerator'
 
 // Configuration constants
 const CONFIG = {
@@ -78,29 +80,59 @@ export async function calculateFastHash(filePath: string): Promise<string> {
   }
 }
 
+// Native batch binding (ffmpeg_extensions fast_hash/FastHash.h)
+const FastHashProgress = koffi.proto('void FastHashProgressCallback(int processed, int total, int last_index)')
+const funcFastHashBatch = nativeLib.func(
+  'int fast_hash_batch(str* paths, int count, uint64* out_hashes, int* out_status, int queue_depth, FastHashProgressCallback* progress)'
+)
+
 /**
  * Batch calculate hashes for multiple files
+ * Runs in C++ with concurrent positional reads (queue depth chosen per disk type);
+ * results are bit-for-bit identical to calculateFastHash.
  */
 export async function calculateHashBatch(
   filePaths: string[],
   onProgress?: (processed: number, total: number, currentFile: string) => void
 ): Promise<Map<string, string>> {
   const results = new Map<string, string>()
+  if (filePaths.length === 0) return results
+
+  const hashes = new BigUint64Array(filePaths.length)
+  const status = new Int32Array(filePaths.length)
+
+  const callback = onProgress
+    ? koffi.register((processed: number, total: number, lastIndex: number) => {
+        // 并发读取，完成顺序与下标无关: 使用 C++ 报告的最近完成的文件
+        onProgress(processed, total, filePaths[Math.max(lastIndex, 0)])
+      }, koffi.pointer(FastHashProgress))
+    : null
+
+  try {
+    await new Promise<void>((resolve, reject) => {
+      funcFastHashBatch.async(
+        filePaths,
+        filePaths.length,
+        hashes,
+        status,
+        0,
+        callback,
+        (err: any, res: number) => {
+          if (err) return reject(err)
+          if (res < 0) return reject(new Error(`C++ failed with code ${res}`))
+          resolve()
+        }
+      )
+    })
+  } finally {
+    if (callback) koffi.unregister(callback)
+  }
 
   for (let i = 0; i < filePaths.length; i++) {
-    const filePath = filePaths[i]
-
-    try {
-      const hash = await calculateFastHash(filePath)
-      results.set(filePath, hash)
-
-      // Update progress every 100 files to prevent UI flicker
-      if (onProgress && (i % 100 === 0 || i === filePaths.length - 1)) {
-        onProgress(i + 1, filePaths.length, filePath)
-      }
-    } catch (error) {
-      console.error(`Failed to hash file: ${filePath}`, error)
-      // Continue with other files
+    if (status[i] === 0) {
+      results.set(filePaths[i], hashes[i].toString(16).padStart(16, '0'))
+    } else {
+      console.error(`Failed to hash file: ${filePaths[i]}`)
     }
   }
 
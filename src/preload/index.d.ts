@@ -1,6 +1,7 @@
 import { ElectronAPI } from '@electron-toolkit/preload'
 import { Annotation } from '../main/data/json/AnnotationManager'
 import { Screenshot } from '../main/data/assets/ScreenshotManager'
+import type { TrickplayIndex } from '../main/data/assets/TrickplayManager'
 
 import type { FileProfile } from '../main/data/json/FileProfileManager';
 
@@ -26,6 +27,8 @@ declare global {
       updateConfiguration: (config: { videoSource: string; stagedPath: string; screenshotExportPath: string }) => Promise<{ success: boolean; error?: string; result?: any }>
       selectDirectory: () => Promise<string | null>
       refreshFiles: () => Promise<{ success: boolean; error?: string; result?: any }>
+      /** 近似重复视频分组 (每组为文件路径) */
+      findNearDuplicates: () => Promise<string[][]>
       
       // Window Control
       windowMinimize: () => Promise<void>
@@ -46,10 +49,12 @@ declare global {
 
       // Screenshot Management
       saveManualScreenshot: (fielPath: string, timestamp: number) => Promise<boolean>
+      saveSceneScreenshots: (filePath: string, count: number) => Promise<number[]>
       loadScreenshots: (fielPath: string) => Promise<Screenshot[]>
       deleteScreenshot: (fielPath: string, filename: string) => Promise<void>
       getScreenshotMetadata: (filePath: string) => Promise<Record<string, { storyboard: boolean; navigation: boolean; export: boolean }>>;
       saveScreenshotMetadata: (filePath: string, metadata: Record<string, any>) => Promise<void>;
+      getTrickplay: (filePath: string) => Promise<TrickplayIndex | null>;
       
       // Cover Management
       getCover: (fielPath: string) => Promise<string>
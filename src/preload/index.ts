@@ -14,6 +14,8 @@ const api = {
   }) => ipcRenderer.invoke('update-configuration', config),
   selectDirectory: () => ipcRenderer.invoke('select-directory'),
   refreshFiles: () => ipcRenderer.invoke('refresh-files'),
+  // 近似重复的视频分组 (文件路径)，首次调用需要为视频库计算指纹
+  findNearDuplicates: () => ipcRenderer.invoke('find-near-duplicates'),
 
   // Window controls
   windowMinimize: () => ipcRenderer.invoke('window-minimize'),
@@ -35,6 +37,8 @@ const api = {
   // Screenshot Management
   saveManualScreenshot: (filePath: string, timestamp: number) =>
     ipcRenderer.invoke('save-manual-screenshot', filePath, timestamp),
+  saveSceneScreenshots: (filePath: string, count: number) =>
+    ipcRenderer.invoke('save-scene-screenshots', filePath, count),
   generateAutoScreenshots: (filePath: string) =>
     ipcRenderer.invoke('generate-auto-screenshots', filePath),
   loadScreenshots: (filePath: string) => ipcRenderer.invoke('load-screenshots', filePath),
@@ -46,6 +50,7 @@ const api = {
     ipcRenderer.invoke('get-screenshot-metadata', filePath),
   saveScreenshotMetadata: (filePath: string, metadata: any) =>
     ipcRenderer.invoke('save-screenshot-metadata', filePath, metadata),
+  getTrickplay: (filePath: string) => ipcRenderer.invoke('get-trickplay', filePath),
 
   // Cover Management
   getCover: (filePath: string) => ipcRenderer.invoke('get-cover', filePath),
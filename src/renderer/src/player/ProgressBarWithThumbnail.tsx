@@ -4,6 +4,10 @@ import { useClipStore, usePlayerStore } from '../stores'
 import { useVideoContext } from './contexts'
 import usePlayerActions from './hooks/usePlayerActions'
 
+type TrickplayIndex = NonNullable<Awaited<ReturnType<typeof window.api.getTrickplay>>>
+
+const THUMBNAIL_WIDTH = 240
+
 interface ProgressBarWithThumbnailProps {
   videoPath: string | null
   onSeek: (time: number) => void
@@ -34,17 +38,40 @@ export function ProgressBarWithThumbnail({ videoPath, onSeek }: ProgressBarWithT
   const [thumbnailPosition, setThumbnailPosition] = useState(0)
   const [thumbnailTime, setThumbnailTime] = useState(0)
   const [isTracking, setIsTracking] = useState(false)
+  // 雪碧图索引，生成完成前 (或失败时) 回退到隐藏 video 的 seek 预览
+  const [trickplay, setTrickplay] = useState<TrickplayIndex | null>(null)
 
-  // 1. 初始化加载缩略图视频
+  // 1. 加载悬停预览索引 (不存在时主进程在后台生成)
+  useEffect(() => {
+    setTrickplay(null)
+    if (!videoPath) return undefined
+
+    let cancelled = false
+    window.api
+      .getTrickplay(videoPath)
+      .then((index) => {
+        if (!cancelled && index && index.tiles.length > 0) setTrickplay(index)
+      })
+      .catch(() => {})
+    return () => {
+      cancelled = true
+    }
+  }, [videoPath])
+
+  // 2. 初始化加载缩略图视频 (有雪碧图时不需要)
   useEffect(() => {
     const video = thumbnailVideoRef.current
-    if (video && videoPath) {
+    if (!video) return
+    if (videoPath && !trickplay) {
       video.src = `file:///${videoPath.replace(/\\/g, '/')}`
       video.load()
+    } else {
+      video.removeAttribute('src')
+      video.load()
     }
-  }, [videoPath])
+  }, [videoPath, trickplay])
 
-  // 2. 正常播放时，同步 fillingBar 的宽度
+  // 3. 正常播放时，同步 fillingBar 的宽度
   useEffect(() => {
     // 只有当不显示缩略图（意味着不在交互中）或者 不在磁吸模式下时，才由 Store 驱动
     // 简单的逻辑：只要没在手动 Seek，就跟着 currentTime 走
@@ -151,8 +178,8 @@ export function ProgressBarWithThumbnail({ videoPath, onSeek }: ProgressBarWithT
       setThumbnailPosition(x)
       setThumbnailTime(time)
 
-      // 2. 同步缩略图视频进度
-      if (thumbVideo && thumbVideo.readyState >= 1) {
+      // 2. 同步缩略图视频进度 (雪碧图模式只需查表，由渲染完成)
+      if (!trickplay && thumbVideo && thumbVideo.readyState >= 1) {
         thumbVideo.currentTime = time
       }
     }
@@ -190,6 +217,24 @@ export function ProgressBarWithThumbnail({ videoPath, onSeek }: ProgressBarWithT
     }
   }
 
+  // 当前悬停时间对应的图块样式
+  const getTrickplayStyle = (time: number): React.CSSProperties | null => {
+    if (!trickplay) return null
+    const i = Math.min(Math.floor(time / trickplay.interval), trickplay.tiles.length - 1)
+    const tile = trickplay.tiles[Math.max(i, 0)]
+    const scale = THUMBNAIL_WIDTH / trickplay.tileWidth
+    return {
+      width: '100%',
+      height: trickplay.tileHeight * scale,
+      backgroundImage: `url("${trickplay.sheets[tile.sheet]}")`,
+      backgroundSize: `${trickplay.columns * trickplay.tileWidth * scale}px auto`,
+      backgroundPosition: `-${tile.x * scale}px -${tile.y * scale}px`,
+      backgroundRepeat: 'no-repeat'
+    }
+  }
+
+  const trickplayStyle = getTrickplayStyle(thumbnailTime)
+
   const formatTime = (time: number) => {
     const minutes = Math.floor(time / 60)
     const seconds = Math.floor(time % 60)
@@ -205,7 +250,7 @@ export function ProgressBarWithThumbnail({ videoPath, onSeek }: ProgressBarWithT
           bottom: 30,
           left: thumbnailPosition,
           transform: 'translateX(-50%)',
-          width: 240,
+          width: THUMBNAIL_WIDTH,
           backgroundColor: '#000',
           border: '2px solid #fff',
           borderRadius: 4,
@@ -218,6 +263,7 @@ export function ProgressBarWithThumbnail({ videoPath, onSeek }: ProgressBarWithT
           transition: 'opacity 0.1s ease-in-out'
         }}
       >
+        {trickplayStyle && <Box style={trickplayStyle} />}
         <video
           ref={thumbnailVideoRef}
           muted
@@ -225,7 +271,7 @@ export function ProgressBarWithThumbnail({ videoPath, onSeek }: ProgressBarWithT
           style={{
             width: '100%',
             height: 'auto',
-            display: 'block',
+            display: trickplayStyle ? 'none' : 'block',
             backgroundColor: '#000'
           }}
         />
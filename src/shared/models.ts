@@ -59,6 +59,20 @@ export interface VideoMetadata {
     width: number;
     height: number;
     framerate: number;
+    // 以下字段由新版探测填充，旧缓存中可能不存在
+    /** 视频编码名称 (例如 "h264") */
+    codec?: string;
+    /** 编码 profile (FFmpeg AV_PROFILE_*，未知为 -99) */
+    profile?: number;
+    /** 像素格式 (例如 "yuv420p")，未知为空字符串 */
+    pixelFormat?: string;
+    /** 总码率 (bps) */
+    bitRate?: number;
+    /** 显示矩阵旋转 (顺时针) */
+    rotation?: 0 | 90 | 180 | 270;
+    hasAudio?: boolean;
+    /** 音频编码名称，无音频为空字符串 */
+    audioCodec?: string;
 }
 
 export interface VideoClip {